@@ -0,0 +1,52 @@
+# Prints:
+# - The functions that are placed in SRAM (e.g: __not_in_flash_func), and their total size.
+# - The flash used by each Bluepad32 parser, taken from the map file.
+# Usage: cmake -DNM=<path to nm> -DELF=<path to elf> -DMAP=<path to map> -P size_report.cmake
+
+execute_process(COMMAND ${NM} --print-size --size-sort ${ELF}
+    OUTPUT_VARIABLE symbols
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(WARNING "Could not read symbols from ${ELF}")
+    return()
+endif()
+
+string(REPLACE "\n" ";" symbols "${symbols}")
+set(total 0)
+foreach(line IN LISTS symbols)
+    # RP2040 SRAM starts at 0x20000000. Only code ("t" / "T") is reported.
+    if(line MATCHES "^(2[0-9a-fA-F]+) ([0-9a-fA-F]+) [tT] (.+)$")
+        math(EXPR size "0x${CMAKE_MATCH_2}")
+        math(EXPR total "${total} + ${size}")
+        message(STATUS "  ${CMAKE_MATCH_3}: ${size}")
+    endif()
+endforeach()
+message(STATUS "Code in SRAM: ${total} bytes")
+
+if(NOT EXISTS "${MAP}")
+    return()
+endif()
+
+# Map file entries look like:
+#  .text.uni_hid_parser_ds4_setup
+#                 0x1001a2b4       0x9c libbluepad32.a(uni_hid_parser_ds4.c.obj)
+# RP2040 flash (XIP) starts at 0x10000000.
+file(STRINGS ${MAP} lines REGEX "uni_hid_parser_[a-z0-9]+\\.c\\.obj")
+set(parsers "")
+set(total 0)
+foreach(line IN LISTS lines)
+    if(line MATCHES "0x0*(1[0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F]) +0x([0-9a-fA-F]+) .*uni_hid_parser_([a-z0-9]+)\\.c\\.obj")
+        set(parser ${CMAKE_MATCH_3})
+        math(EXPR size "0x${CMAKE_MATCH_2}")
+        if(NOT DEFINED parser_size_${parser})
+            set(parser_size_${parser} 0)
+            list(APPEND parsers ${parser})
+        endif()
+        math(EXPR parser_size_${parser} "${parser_size_${parser}} + ${size}")
+        math(EXPR total "${total} + ${size}")
+    endif()
+endforeach()
+foreach(parser IN LISTS parsers)
+    message(STATUS "  parser ${parser}: ${parser_size_${parser}}")
+endforeach()
+message(STATUS "Flash used by parsers: ${total} bytes")
@@ -13,14 +13,30 @@
 // Defined in picontrol.c
 struct uni_platform* get_picontrol(void);
 
+#ifdef CONFIG_BLUEPAD32_FAST_BOOT
+static void init_stdio(void) {
+    stdio_init_all();
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_STDIO_INIT);
+}
+#endif  // CONFIG_BLUEPAD32_FAST_BOOT
+
 int main() {
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_MAIN);
+
+#ifndef CONFIG_BLUEPAD32_FAST_BOOT
     stdio_init_all();
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_STDIO_INIT);
+#endif  // !CONFIG_BLUEPAD32_FAST_BOOT
 
     // initialize CYW43 driver architecture (will enable BT if/because CYW43_ENABLE_BLUETOOTH == 1)
     if (cyw43_arch_init()) {
+#ifdef CONFIG_BLUEPAD32_FAST_BOOT
+        stdio_init_all();
+#endif  // CONFIG_BLUEPAD32_FAST_BOOT
         loge("failed to initialise cyw43_arch\n");
         return -1;
     }
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_CYW43_INIT);
 
     // Turn-on LED. Turn it off once init is done.
     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
@@ -28,6 +44,13 @@ int main() {
     // Must be called before uni_init()
     uni_platform_set_custom(get_picontrol());
 
+#ifdef CONFIG_BLUEPAD32_FAST_BOOT
+    // USB stdio is not needed to drive the joystick port. Logs printed before the
+    // first report are lost.
+    // Deferred before uni_init(), so that it runs before the rest of the deferred work.
+    uni_boot_defer(init_stdio);
+#endif  // CONFIG_BLUEPAD32_FAST_BOOT
+
     // Initialize BP32
     uni_init(0, NULL);
 
@@ -1,5 +1,6 @@
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <pico/cyw43_arch.h>
@@ -16,8 +17,10 @@
 #error "Pico W must use BLUEPAD32_PLATFORM_CUSTOM"
 #endif
 
-// Joystick Analog dead zone
+// Joystick Analog dead zone. Can be changed from the console with "dead_zone"
 #define DEAD_ZONE 150
+// Throttle needed to trigger "fire". Can be changed from the console with "fire_threshold"
+#define FIRE_THRESHOLD 100
 
 #define UP_BTN 0
 #define DOWN_BTN 1
@@ -27,8 +30,28 @@
 #define INPUT_A 5 // Paddle A /Touch Tablet < ---   No idea how tf these work. Can't test them
 #define INPUT_B 6 // Paddle B /Touch Tablet < ---   I just know that the extra inputs are mapped to this.
 
+// Mice are output as an Atari ST mouse, same pinout as the Unijoysticle "atarist" mouse emulation:
+// XA: down, XB: up, YA: left, YB: right.
+// The waveforms are generated by PIO, which needs the A/B pins of each encoder on consecutive GPIOs.
+// It is not the case for the Amiga pinout with these GPIOs.
+#define ATARIST_MOUSE_DELTA_MAX 28
+
+// Controller fields used to drive the joystick port
+#define PICONTROL_INTEREST                                                                         \
+    (UNI_CONTROLLER_CHANGED_CLASS | UNI_CONTROLLER_CHANGED_DPAD | UNI_CONTROLLER_CHANGED_BUTTONS | \
+     UNI_CONTROLLER_CHANGED_AXIS_X | UNI_CONTROLLER_CHANGED_AXIS_Y | UNI_CONTROLLER_CHANGED_PEDALS |  \
+     UNI_CONTROLLER_CHANGED_DATA)
+
 // Declarations
 static void update_gamepad(uni_hid_device_t *d);
+static void init_quadrature_mouse(void);
+static void process_mouse(uni_mouse_t *mouse);
+static void stop_mouse(void);
+
+static int dead_zone = DEAD_ZONE;
+static int fire_threshold = FIRE_THRESHOLD;
+// Whether the direction pins are driven by PIO (mouse) instead of the CPU (joystick).
+static bool mouse_active;
 
 //
 // Platform Overrides
@@ -54,10 +77,11 @@ static void picontrol_on_init_complete(void)
     /* if (0)
         uni_bt_del_keys_unsafe();
     else */
-    uni_bt_list_keys_unsafe();
+    // Not needed to drive the joystick port. Deferred when fast boot is enabled.
+    uni_boot_defer(uni_bt_list_keys_unsafe);
 
     // Turn off LED once init is done.
-    stdio_init_all();
+    // stdio was initialized by main(), or is deferred until the first report with fast boot.
     gpio_init(UP_BTN);
     gpio_init(DOWN_BTN);
     gpio_init(LEFT_BTN);
@@ -82,6 +106,8 @@ static void picontrol_on_init_complete(void)
     gpio_set_dir(RIGHT_BTN, GPIO_OUT);
     gpio_set_dir(FIRE_BTN, GPIO_OUT);
 
+    init_quadrature_mouse();
+
     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
 }
 
@@ -97,6 +123,10 @@ static void picontrol_on_device_connected(uni_hid_device_t *d)
 static void picontrol_on_device_disconnected(uni_hid_device_t *d)
 {
     logi("PicoNtrol: device disconnected: %p\n", d);
+
+    // Give the direction pins back to the joystick.
+    if (d->controller.klass == UNI_CONTROLLER_CLASS_MOUSE)
+        stop_mouse();
 }
 
 static uni_error_t picontrol_on_device_ready(uni_hid_device_t *d)
@@ -107,18 +137,14 @@ static uni_error_t picontrol_on_device_ready(uni_hid_device_t *d)
     return UNI_ERROR_SUCCESS;
 }
 
-static void picontrol_on_controller_data(uni_hid_device_t *d, uni_controller_t *ctl)
+static void UNI_HOT_FUNC(picontrol_on_controller_data)(uni_hid_device_t *d, uni_controller_t *ctl, uint32_t changes)
 {
     static uint8_t leds = 0;
     static uint8_t enabled = true;
-    static uni_controller_t prev = {0};
     uni_gamepad_t *gp;
 
-    if (memcmp(&prev, ctl, sizeof(*ctl)) == 0)
-    {
-        return;
-    }
-    prev = *ctl;
+    // Only called when something in PICONTROL_INTEREST changed. See get_picontrol().
+    ARG_UNUSED(changes);
     // PRINT FULL DEBUG LOG
     /* logi("(%p) id=%d ", d, uni_hid_device_get_idx_for_instance(d));
     uni_controller_dump(ctl); */
@@ -130,6 +156,9 @@ static void picontrol_on_controller_data(uni_hid_device_t *d, uni_controller_t *
         gp = &ctl->gamepad;
         bool up = true, down = true, left = true, right = true;
 
+        // In case a mouse was used before: the direction pins are driven by the CPU again.
+        stop_mouse();
+
         if (gp->dpad == 0)
         {
             gpio_put(UP_BTN, up);
@@ -212,7 +241,7 @@ static void picontrol_on_controller_data(uni_hid_device_t *d, uni_controller_t *
             }
         }
 
-        else if (!(fabs(x) < DEAD_ZONE && fabs(y) < DEAD_ZONE))
+        else if (!(fabs(x) < dead_zone && fabs(y) < dead_zone))
         {
             /*
              * Cool nerdy math function to nail every analog position correctly 😎
@@ -295,7 +324,7 @@ static void picontrol_on_controller_data(uni_hid_device_t *d, uni_controller_t *
             logi("UP\n");
         }
 
-        if ((gp->buttons == 128 && gp->throttle > 100) || gp->buttons == 1)
+        if ((gp->buttons == 128 && gp->throttle > fire_threshold) || gp->buttons == 1)
         {
             gpio_put(FIRE_BTN, false);
             logi("FIRE\n");
@@ -308,6 +337,9 @@ static void picontrol_on_controller_data(uni_hid_device_t *d, uni_controller_t *
         gpio_put(RIGHT_BTN, right);
     }
     break;
+    case UNI_CONTROLLER_CLASS_MOUSE:
+        process_mouse(&ctl->mouse);
+        break;
     default:
         loge("Unsupported controller class: %d\n", ctl->klass);
         break;
@@ -341,9 +373,116 @@ static void picontrol_on_oob_event(uni_platform_oob_event_t event, void *data)
     }
 }
 
+//
+// Console commands
+//
+static int set_int_value(int argc, char **argv, const char *name, int *value, int max)
+{
+    if (argc < 2)
+    {
+        logi("%s: %d\n", name, *value);
+        return 0;
+    }
+
+    char *end;
+    long v = strtol(argv[1], &end, 0);
+    if (end == argv[1] || *end != '\0' || v < 0 || v > max)
+    {
+        loge("Invalid %s: %s. Valid values: 0 - %d\n", name, argv[1], max);
+        return 1;
+    }
+    *value = v;
+    return 0;
+}
+
+static int cmd_dead_zone(int argc, char **argv)
+{
+    return set_int_value(argc, argv, "dead zone", &dead_zone, AXIS_NORMALIZE_RANGE / 2);
+}
+
+static int cmd_fire_threshold(int argc, char **argv)
+{
+    return set_int_value(argc, argv, "fire threshold", &fire_threshold, AXIS_NORMALIZE_RANGE - 1);
+}
+
+static void picontrol_register_console_cmds(void)
+{
+    static const uni_console_cmd_t cmd_dead_zone_def = {
+        .command = "dead_zone",
+        .hint = "[value]",
+        .help = "Get/Set the analog stick dead zone",
+        .func = cmd_dead_zone,
+    };
+    static const uni_console_cmd_t cmd_fire_threshold_def = {
+        .command = "fire_threshold",
+        .hint = "[value]",
+        .help = "Get/Set the throttle needed to trigger fire",
+        .func = cmd_fire_threshold,
+    };
+
+    uni_console_register_cmd(&cmd_dead_zone_def);
+    uni_console_register_cmd(&cmd_fire_threshold_def);
+}
+
 //
 // Helpers
 //
+static void init_quadrature_mouse(void)
+{
+    struct uni_mouse_quadrature_encoder_gpios x = {
+        .a = DOWN_BTN,  // XA
+        .b = UP_BTN,    // XB
+    };
+    struct uni_mouse_quadrature_encoder_gpios y = {
+        .a = LEFT_BTN,   // YA
+        .b = RIGHT_BTN,  // YB
+    };
+
+    uni_mouse_quadrature_init(0 /* cpu_id, not used */);
+    uni_mouse_quadrature_setup_port(UNI_MOUSE_QUADRATURE_PORT_0, x, y);
+}
+
+static void process_mouse(uni_mouse_t *mouse)
+{
+    int32_t dx = mouse->delta_x;
+    int32_t dy = mouse->delta_y;
+
+    // Same limit as the Unijoysticle Atari ST mouse emulation.
+    if (dx < -ATARIST_MOUSE_DELTA_MAX)
+        dx = -ATARIST_MOUSE_DELTA_MAX;
+    if (dx > ATARIST_MOUSE_DELTA_MAX)
+        dx = ATARIST_MOUSE_DELTA_MAX;
+    if (dy < -ATARIST_MOUSE_DELTA_MAX)
+        dy = -ATARIST_MOUSE_DELTA_MAX;
+    if (dy > ATARIST_MOUSE_DELTA_MAX)
+        dy = ATARIST_MOUSE_DELTA_MAX;
+
+    // PIO takes over the direction pins while a mouse is used.
+    if (!mouse_active)
+    {
+        uni_mouse_quadrature_start(UNI_MOUSE_QUADRATURE_PORT_0);
+        mouse_active = true;
+    }
+    uni_mouse_quadrature_update(UNI_MOUSE_QUADRATURE_PORT_0, dx, dy);
+
+    // Active low, like the joystick buttons.
+    gpio_put(FIRE_BTN, !(mouse->buttons & MOUSE_BUTTON_LEFT));
+}
+
+static void stop_mouse(void)
+{
+    if (!mouse_active)
+        return;
+    uni_mouse_quadrature_pause(UNI_MOUSE_QUADRATURE_PORT_0);
+    mouse_active = false;
+
+    // Released, like when no direction is pressed.
+    gpio_put(UP_BTN, true);
+    gpio_put(DOWN_BTN, true);
+    gpio_put(LEFT_BTN, true);
+    gpio_put(RIGHT_BTN, true);
+}
+
 static void update_gamepad(uni_hid_device_t *d)
 {
     if (d->report_parser.set_rumble != NULL)
@@ -385,8 +524,10 @@ struct uni_platform *get_picontrol(void)
         .on_device_disconnected = picontrol_on_device_disconnected,
         .on_device_ready = picontrol_on_device_ready,
         .on_oob_event = picontrol_on_oob_event,
-        .on_controller_data = picontrol_on_controller_data,
+        .on_controller_data_changed = picontrol_on_controller_data,
+        .controller_data_interest = PICONTROL_INTEREST,
         .get_property = picontrol_get_property,
+        .register_console_cmds = picontrol_register_console_cmds,
     };
 
     return &plat;
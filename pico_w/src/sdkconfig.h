@@ -3,9 +3,52 @@
 //
 #define CONFIG_BLUEPAD32_MAX_DEVICES 4
 #define CONFIG_BLUEPAD32_MAX_ALLOWLIST 4
+// 0: MAX_DEVICES * 384 bytes. See Kconfig.
+#define CONFIG_BLUEPAD32_HID_DESCRIPTOR_ARENA_SIZE 0
 #define CONFIG_BLUEPAD32_GAP_SECURITY 1
+#define CONFIG_BLUEPAD32_L2CAP_FAST_PATH 1
 #define CONFIG_BLUEPAD32_ENABLE_BLE_BY_DEFAULT 1
 // #define CONFIG_BLUEPAD32_ENABLE_VIRTUAL_DEVICE_BY_DEFAULT 1
+// Console on stdio (USB CDC). Type "help" + Enter.
+#define CONFIG_BLUEPAD32_USB_CONSOLE_ENABLE 1
+// Places the input report hot path in SRAM instead of flash (XIP). Only the functions marked
+// with UNI_HOT_FUNC() are moved, see uni_config.h. The parsers without it, the platform
+// callbacks and the BTstack / CYW43 code still run from flash.
+// See "processing histogram" in the device dump, and "Code in SRAM" after building.
+// #define CONFIG_BLUEPAD32_HOT_PATH_IN_RAM 1
+
+// Records the HID traffic in a RAM ring buffer. See Kconfig.
+// #define CONFIG_BLUEPAD32_HID_CAPTURE 1
+// #define CONFIG_BLUEPAD32_HID_CAPTURE_BUFFER_SIZE 8192
+
+// Cycles spent in each parser callback, printed with the device dump. See Kconfig.
+// #define CONFIG_BLUEPAD32_PROFILER 1
+
+// Raises clk_sys while a controller is connected, and lowers it when idle.
+// Max active clock is 200 MHz: the CYW43 gSPI is clocked from clk_sys.
+// #define CONFIG_BLUEPAD32_CLOCK_SCALING 1
+// #define CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ 200000
+// #define CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ 64000
+// #define CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_DELAY_MS 3000
+
+// Records the time from power-on to the first report, per boot phase.
+// Printed by the "boot" console command. See Kconfig.
+#define CONFIG_BLUEPAD32_BOOT_TIMELINE 1
+
+// The adapter is powered by the console: every power-on is a cold boot.
+// USB stdio, the console, the GATT service advertising and the list of keys are deferred until
+// the first report arrives. See Kconfig.
+#define CONFIG_BLUEPAD32_FAST_BOOT 1
+// #define CONFIG_BLUEPAD32_FAST_BOOT_TIMEOUT_MS 5000
+
+// Include only the selected parsers. See Kconfig for the complete list.
+// E.g: for Atari 2600 joysticks, only gamepads are needed.
+// #define CONFIG_BLUEPAD32_PARSERS_CUSTOM 1
+// #define CONFIG_BLUEPAD32_PARSER_DS4 1
+// #define CONFIG_BLUEPAD32_PARSER_DS5 1
+// #define CONFIG_BLUEPAD32_PARSER_SWITCH 1
+// #define CONFIG_BLUEPAD32_PARSER_XBOXONE 1
+// #define CONFIG_BLUEPAD32_PARSER_8BITDO 1
 
 #define CONFIG_BLUEPAD32_PLATFORM_CUSTOM
 #define CONFIG_TARGET_PICO_W
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#include "uni_clock_scaling.h"
+
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <btstack.h>
+#include <hardware/clocks.h>
+#include <hardware/timer.h>
+#include <hardware/vreg.h>
+#include <pico/cyw43_arch.h>
+#if LIB_PICO_STDIO_UART
+#include <hardware/uart.h>
+#endif  // LIB_PICO_STDIO_UART
+
+#include "uni_common.h"
+#include "uni_config.h"
+#include "uni_hid_device.h"
+#include "uni_log.h"
+#include "uni_mouse_quadrature.h"
+
+// Limits:
+// - The CYW43 gSPI clock is generated by PIO: clk_sys / CYW43_PIO_CLOCK_DIV_INT / 2.
+//   The CYW43439 supports up to 50 MHz. 200 MHz is the max with the default divider.
+// - Above 133 MHz, the RP2040 max nominal clock, the core voltage is raised to 1.15V.
+//   Same as what the SDK does when it is configured to boot at 200 MHz.
+// - XIP flash clock is clk_sys / PICO_FLASH_SPI_CLKDIV: 100 MHz at 200 MHz with the default divider.
+// - USB (pll_usb) and the timer (clk_ref) don't depend on clk_sys, so USB, time_us_32() and
+//   the BTstack timers are not affected.
+//   But set_sys_clock_pll() moves clk_peri to pll_usb, so the UART baud rate is set again.
+#ifndef CYW43_PIO_CLOCK_DIV_INT
+// The SDK default is private to the CYW43 driver, and a copy of it could get out of sync.
+#error "CYW43_PIO_CLOCK_DIV_INT must be defined. Set by CMakeLists.txt, for both Bluepad32 and the CYW43 driver"
+#endif  // !CYW43_PIO_CLOCK_DIV_INT
+#define CYW43_SPI_MAX_KHZ 50000
+#define NOMINAL_MAX_KHZ 133000
+#define OVERCLOCK_VREG_VOLTAGE VREG_VOLTAGE_1_15
+// Same settle time that the SDK uses after changing the voltage.
+#define VREG_SETTLE_US 1000
+
+// Usually: the boot clock, the idle clock, the active clock, plus one "fixed" clock.
+#define MAX_CLOCKS 4
+
+_Static_assert(CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ / (CYW43_PIO_CLOCK_DIV_INT * 2) <= CYW43_SPI_MAX_KHZ,
+               "Active clock is too fast for the CYW43 gSPI");
+
+typedef struct {
+    uint32_t khz;
+    // Input reports processed at this clock
+    uint32_t reports;
+    uint32_t max_us;
+    uint64_t total_us;
+    // Time spent at this clock
+    uint64_t residency_us;
+} clock_stats_t;
+
+static clock_stats_t clocks[MAX_CLOCKS];
+static clock_stats_t* current_stats;
+static uint32_t current_khz;
+// 0 means "automatic"
+static uint32_t fixed_khz;
+static uint32_t changes;
+static uint32_t last_change_duration_us;
+static uint64_t last_change_us;
+static btstack_timer_source_t timer;
+
+static clock_stats_t* get_clock_stats(uint32_t khz) {
+    for (int i = 0; i < MAX_CLOCKS; i++) {
+        if (clocks[i].khz == khz)
+            return &clocks[i];
+    }
+    for (int i = 0; i < MAX_CLOCKS; i++) {
+        if (clocks[i].khz == 0) {
+            clocks[i].khz = khz;
+            return &clocks[i];
+        }
+    }
+    return NULL;
+}
+
+static bool is_valid_khz(uint32_t khz) {
+    uint vco, postdiv1, postdiv2;
+
+    if (khz / (CYW43_PIO_CLOCK_DIV_INT * 2) > CYW43_SPI_MAX_KHZ)
+        return false;
+    return check_sys_clock_khz(khz, &vco, &postdiv1, &postdiv2);
+}
+
+static int get_ready_devices(void) {
+    int count = 0;
+
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        uni_hid_device_t* d = uni_hid_device_get_instance_for_idx(i);
+        if (uni_bt_conn_get_state(&d->conn) == UNI_BT_CONN_STATE_DEVICE_READY)
+            count++;
+    }
+    return count;
+}
+
+static void set_clock(uint32_t khz) {
+    uint vco, postdiv1, postdiv2;
+
+    if (khz == current_khz)
+        return;
+
+    if (!check_sys_clock_khz(khz, &vco, &postdiv1, &postdiv2)) {
+        loge("Clock scaling: Cannot generate %" PRIu32 " kHz\n", khz);
+        return;
+    }
+
+    uint64_t now = time_us_64();
+    if (current_stats)
+        current_stats->residency_us += now - last_change_us;
+
+    // No gSPI transfers while clk_sys changes.
+    cyw43_thread_enter();
+    if (khz > NOMINAL_MAX_KHZ) {
+        // Raise the voltage before raising the clock.
+        vreg_set_voltage(OVERCLOCK_VREG_VOLTAGE);
+        busy_wait_us(VREG_SETTLE_US);
+    }
+    set_sys_clock_pll(vco, postdiv1, postdiv2);
+    if (khz <= NOMINAL_MAX_KHZ) {
+        // And lower it after lowering the clock.
+        vreg_set_voltage(VREG_VOLTAGE_DEFAULT);
+    }
+    cyw43_thread_exit();
+
+    // Peripherals clocked from clk_sys or clk_peri.
+#if LIB_PICO_STDIO_UART
+    uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+#endif  // LIB_PICO_STDIO_UART
+    uni_mouse_quadrature_on_sys_clock_changed();
+
+    last_change_us = time_us_64();
+    last_change_duration_us = last_change_us - now;
+    changes++;
+
+    logi("Clock scaling: %" PRIu32 " kHz -> %" PRIu32 " kHz, took %" PRIu32 " us\n", current_khz, khz,
+         last_change_duration_us);
+
+    current_khz = khz;
+    current_stats = get_clock_stats(khz);
+}
+
+static void on_timer(btstack_timer_source_t* ts) {
+    ARG_UNUSED(ts);
+
+    if (fixed_khz != 0)
+        set_clock(fixed_khz);
+    else
+        set_clock(get_ready_devices() > 0 ? CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ
+                                          : CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ);
+}
+
+// The clock is not changed from the caller, which is usually an HCI / L2CAP handler.
+// It is changed from the run loop, once the current event was processed.
+static void schedule(uint32_t delay_ms) {
+    btstack_run_loop_remove_timer(&timer);
+    btstack_run_loop_set_timer(&timer, delay_ms);
+    btstack_run_loop_add_timer(&timer);
+}
+
+void uni_clock_scaling_init(void) {
+    memset(clocks, 0, sizeof(clocks));
+    fixed_khz = 0;
+    changes = 0;
+
+    current_khz = clock_get_hz(clk_sys) / 1000;
+    current_stats = get_clock_stats(current_khz);
+    last_change_us = time_us_64();
+
+    logi("Clock scaling: boot: %" PRIu32 " kHz, active: %d kHz, idle: %d kHz\n", current_khz,
+         CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ, CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ);
+
+    if (!is_valid_khz(CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ))
+        loge("Clock scaling: Invalid idle clock: %d kHz\n", CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ);
+    if (!is_valid_khz(CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ))
+        loge("Clock scaling: Invalid active clock: %d kHz\n", CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ);
+
+    // Stay at the boot clock while booting. Goes idle if no device connects in the meantime.
+    btstack_run_loop_set_timer_handler(&timer, on_timer);
+    schedule(CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_DELAY_MS);
+}
+
+void uni_clock_scaling_on_device_ready(uni_hid_device_t* d) {
+    ARG_UNUSED(d);
+    schedule(0);
+}
+
+void uni_clock_scaling_on_device_disconnected(uni_hid_device_t* d) {
+    ARG_UNUSED(d);
+    // The device is still "ready" at this point. And it might reconnect soon, for example
+    // when it changes its mode. Check again later.
+    schedule(CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_DELAY_MS);
+}
+
+void UNI_HOT_FUNC(uni_clock_scaling_on_report_processed)(uint32_t elapsed_us) {
+    clock_stats_t* s = current_stats;
+
+    if (!s)
+        return;
+    s->reports++;
+    s->total_us += elapsed_us;
+    if (elapsed_us > s->max_us)
+        s->max_us = elapsed_us;
+}
+
+int uni_clock_scaling_set_fixed_khz(uint32_t khz) {
+    if (khz != 0 && !is_valid_khz(khz)) {
+        loge("Clock scaling: Invalid clock: %" PRIu32 " kHz\n", khz);
+        return -1;
+    }
+    fixed_khz = khz;
+    schedule(0);
+    return 0;
+}
+
+uint32_t uni_clock_scaling_get_khz(void) {
+    return current_khz;
+}
+
+void uni_clock_scaling_dump(void) {
+    for (int step = 0; uni_clock_scaling_dump_step(step); step++) {
+    }
+}
+
+bool uni_clock_scaling_dump_step(int step) {
+    if (step == 0) {
+        logi("Clock scaling: %" PRIu32 " kHz (%s), changes: %" PRIu32 ", last change took %" PRIu32 " us\n",
+             current_khz, fixed_khz ? "fixed" : "auto", changes, last_change_duration_us);
+        return true;
+    }
+    if (step == 1) {
+        logi("\t%10s %10s %8s %8s %10s\n", "kHz", "reports", "avg_us", "max_us", "time_s");
+        return true;
+    }
+
+    int i = step - 2;
+    const clock_stats_t* s = &clocks[i];
+    if (s->khz != 0) {
+        uint64_t residency_us = s->residency_us;
+        if (s == current_stats)
+            residency_us += time_us_64() - last_change_us;
+        uint32_t avg_us_x100 = s->reports ? (uint32_t)(s->total_us * 100 / s->reports) : 0;
+        logi("\t%10" PRIu32 " %10" PRIu32 " %5" PRIu32 ".%02" PRIu32 " %8" PRIu32 " %10" PRIu64 "\n", s->khz,
+             s->reports, avg_us_x100 / 100, avg_us_x100 % 100, s->max_us, residency_us / 1000000);
+    }
+    return i + 1 < MAX_CLOCKS;
+}
+
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
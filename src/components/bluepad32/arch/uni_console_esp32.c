@@ -4,6 +4,8 @@
 
 #include "uni_console.h"
 
+#include <string.h>
+
 #include <argtable3/argtable3.h>
 #include <cmd_system.h>
 #include <esp_console.h>
@@ -19,6 +21,7 @@
 #include "platform/uni_platform.h"
 #include "uni_common.h"
 #include "uni_gpio.h"
+#include "uni_hid_capture.h"
 #include "uni_log.h"
 #include "uni_mouse_quadrature.h"
 #include "uni_property.h"
@@ -81,6 +84,13 @@ static struct {
     struct arg_end* end;
 } getprop_args;
 
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+static struct {
+    struct arg_str* action;
+    struct arg_end* end;
+} capture_args;
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+
 static int list_devices(int argc, char** argv) {
     // FIXME: Should not belong to "bluetooth"
     uni_bt_dump_devices_safe();
@@ -319,6 +329,36 @@ static int getprop(int argc, char** argv) {
     return 0;
 }
 
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+static int capture(int argc, char** argv) {
+    int nerrors = arg_parse(argc, argv, (void**)&capture_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, capture_args.end, argv[0]);
+
+        // Don't treat it as error, just report the current value
+        logi("HID capture: %s\n", uni_hid_capture_is_enabled() ? "Enabled" : "Disabled");
+        return 0;
+    }
+
+    const char* action = capture_args.action->sval[0];
+    if (strcmp(action, "dump") == 0) {
+        uni_hid_capture_dump_safe();
+        // The dump is printed from the BTstack thread. Print bp32> after it.
+        vTaskDelay(pdMS_TO_TICKS(500));
+    } else if (strcmp(action, "clear") == 0) {
+        uni_hid_capture_clear_safe();
+    } else if (strcmp(action, "start") == 0) {
+        uni_hid_capture_set_enabled_safe(true);
+    } else if (strcmp(action, "stop") == 0) {
+        uni_hid_capture_set_enabled_safe(false);
+    } else {
+        loge("Invalid action: %s\n", action);
+        return 1;
+    }
+    return 0;
+}
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+
 static void register_bluepad32() {
     mouse_scale_args.value = arg_dbl1(NULL, NULL, "<value>", "Global mouse scale factor. Higher means faster");
     mouse_scale_args.end = arg_end(2);
@@ -353,6 +393,11 @@ static void register_bluepad32() {
     getprop_args.prop = arg_str1(NULL, NULL, "<property_name>", "Return property value");
     getprop_args.end = arg_end(2);
 
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+    capture_args.action = arg_str1(NULL, NULL, "<dump | clear | start | stop>", "HID traffic capture");
+    capture_args.end = arg_end(2);
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+
     const esp_console_cmd_t cmd_list_devices = {
         .command = "list_devices",
         .help = "List info about connected devices",
@@ -492,6 +537,17 @@ static void register_bluepad32() {
     ESP_ERROR_CHECK(esp_console_cmd_register(&cmd_mouse_scale));
     ESP_ERROR_CHECK(esp_console_cmd_register(&cmd_virtual_device_enable));
     ESP_ERROR_CHECK(esp_console_cmd_register(&cmd_getprop));
+
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+    const esp_console_cmd_t cmd_capture = {
+        .command = "capture",
+        .help = "Dump, clear, start or stop the HID traffic capture",
+        .hint = NULL,
+        .func = &capture,
+        .argtable = &capture_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd_capture));
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
 }
 
 void uni_console_init(void) {
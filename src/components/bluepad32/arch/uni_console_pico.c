@@ -2,8 +2,733 @@
 // Copyright 2023 Ricardo Quesada
 // http://retro.moe/unijoysticle2
 
+// Pico W console, using stdio. Usually USB CDC.
+//
+// Nothing runs from the input report path: a BTstack timer polls stdin without blocking,
+// so the console only runs when the run loop has nothing else to do.
+// Commands that print more than a few lines do it in steps, usually one line per step.
+// Only one step runs per timer callback, then the run loop gets back the control, so an input
+// report waits at most one step.
+// One line per millisecond is slower than what USB CDC drains while the host reads it.
+// But if the host opened the port and doesn't read it, the CDC buffer fills up, and stdio_usb
+// blocks up to PICO_STDIO_USB_STDOUT_TIMEOUT_US on each write. Steps keep these stalls
+// short, they don't prevent them.
+
 #include "uni_console.h"
 
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <btstack.h>
+#include <pico/stdio.h>
+
+#include "sdkconfig.h"
+
+#include "bt/uni_bt.h"
+#include "controller/uni_gamepad.h"
+#include "platform/uni_platform.h"
+#include "uni_boot.h"
+#include "uni_clock_scaling.h"
+#include "uni_common.h"
+#include "uni_hid_capture.h"
+#include "uni_hid_device.h"
+#include "uni_log.h"
+#include "uni_mouse_quadrature.h"
+#include "uni_profiler.h"
+#include "uni_property.h"
+#include "uni_system.h"
+
+#define PROMPT "bp32> "
+#define LINE_MAX_LEN 80
+#define MAX_ARGS 8
+#define MAX_PLATFORM_CMDS 8
+
+// How often stdin is polled when there is nothing else to do.
+#define POLL_MS 20
+// Delay between the steps of a command. The run loop processes its events in between.
+#define STEP_MS 1
+// Characters read per poll. A pasted line is read in a few polls.
+#define MAX_CHARS_PER_POLL 16
+#define HISTOGRAM_BAR_WIDTH 40
+
+#define CTRL_C 0x03
+#define CTRL_U 0x15
+#define ESC 0x1b
+
+typedef enum {
+    ESC_STATE_NONE,
+    ESC_STATE_START,  // Got ESC
+    ESC_STATE_CSI,    // Got ESC + '['
+} esc_state_t;
+
+// "fn" is called with step = 0, 1, 2... until it returns false.
+typedef bool (*step_fn_t)(int step, int arg);
+
+static struct {
+    step_fn_t fn;
+    int step;
+    int arg;
+} pending;
+
+static char line[LINE_MAX_LEN + 1];
+static int line_len;
+// Last executed line, recalled with "up arrow".
+static char history[LINE_MAX_LEN + 1];
+static esc_state_t esc_state;
+static int prev_char;
+
+static const uni_console_cmd_t* platform_cmds[MAX_PLATFORM_CMDS];
+static int platform_cmds_count;
+
+static btstack_timer_source_t timer;
+
+static const bd_addr_t zero_addr = {0, 0, 0, 0, 0, 0};
+
+static const char* const processing_bucket_names[] = {"<16",  "<32",  "<64",   "<128",
+                                                      "<256", "<512", "<1024", ">=1024"};
+static const char* const interval_bucket_names[] = {"<1", "<2", "<4", "<8", "<16", "<32", "<64", ">=64"};
+_Static_assert(ARRAY_SIZE(processing_bucket_names) == UNI_REPORT_STATS_HISTOGRAM_BUCKETS, "Invalid buckets");
+_Static_assert(ARRAY_SIZE(interval_bucket_names) == UNI_REPORT_STATS_HISTOGRAM_BUCKETS, "Invalid buckets");
+
+static const char* const mappings_names[UNI_GAMEPAD_MAPPINGS_TYPE_COUNT] = {
+    [UNI_GAMEPAD_MAPPINGS_TYPE_XBOX] = "xbox",
+    [UNI_GAMEPAD_MAPPINGS_TYPE_SWITCH] = "switch",
+    [UNI_GAMEPAD_MAPPINGS_TYPE_CUSTOM] = "custom",
+};
+
+//
+// Helpers
+//
+static void start_steps(step_fn_t fn, int arg) {
+    pending.fn = fn;
+    pending.step = 0;
+    pending.arg = arg;
+}
+
+static bool parse_int(const char* str, long* out) {
+    char* end;
+    long value = strtol(str, &end, 0);
+
+    if (end == str || *end != '\0')
+        return false;
+    *out = value;
+    return true;
+}
+
+static int parse_device_idx(int argc, char** argv) {
+    long idx;
+
+    if (argc < 2 || !parse_int(argv[1], &idx) || idx < 0 || idx >= CONFIG_BLUEPAD32_MAX_DEVICES) {
+        loge("Invalid device idx. Valid values: 0 - %d\n", CONFIG_BLUEPAD32_MAX_DEVICES - 1);
+        return -1;
+    }
+    return idx;
+}
+
+static uint32_t get_histogram_total(const uint32_t* histogram) {
+    uint32_t total = 0;
+    for (int i = 0; i < UNI_REPORT_STATS_HISTOGRAM_BUCKETS; i++)
+        total += histogram[i];
+    return total;
+}
+
+static void print_histogram_bucket(const char* name, uint32_t count, uint32_t total) {
+    char bar[HISTOGRAM_BAR_WIDTH + 1];
+    int n = total ? (uint64_t)count * HISTOGRAM_BAR_WIDTH / total : 0;
+
+    memset(bar, '#', n);
+    bar[n] = '\0';
+    logi("%8s %8" PRIu32 " %s\n", name, count, bar);
+}
+
+static void print_cmd(const uni_console_cmd_t* cmd) {
+    logi("  %s %s\n      %s\n", cmd->command, cmd->hint ? cmd->hint : "", cmd->help);
+}
+
+//
+// Steps
+//
+static bool getprop_step(int step, int arg) {
+    ARG_UNUSED(arg);
+
+    const uni_property_t* p = uni_property_get_property_by_idx(step);
+    if (!p)
+        return false;
+    uni_property_dump_property(p);
+    return true;
+}
+
+static bool list_devices_step(int step, int arg) {
+    ARG_UNUSED(arg);
+
+    if (step == 0) {
+        logi("%-3s %-17s %-6s %-20s %-16s %8s\n", "idx", "address", "state", "model", "name", "reports");
+        return true;
+    }
+
+    int idx = step - 1;
+    uni_hid_device_t* d = uni_hid_device_get_instance_for_idx(idx);
+    if (bd_addr_cmp(d->conn.btaddr, zero_addr) != 0) {
+        bool ready = uni_bt_conn_get_state(&d->conn) == UNI_BT_CONN_STATE_DEVICE_READY;
+        logi("%-3d %-17s %-6s %-20s %-16.16s %8" PRIu32 "\n", idx, bd_addr_to_str(d->conn.btaddr),
+             ready ? "ready" : "setup", uni_gamepad_get_model_name(d->controller_type), d->name,
+             d->report_stats.reports);
+    }
+    return idx + 1 < CONFIG_BLUEPAD32_MAX_DEVICES;
+}
+
+static bool stats_step(int step, int idx) {
+    const uni_report_stats_t* s = &uni_hid_device_get_instance_for_idx(idx)->report_stats;
+
+    switch (step) {
+        case 0:
+            logi("reports: %" PRIu32 ", fast-path: %" PRIu32 "\n", s->reports, s->fast_path_reports);
+            return true;
+        case 1:
+            logi("interval (us): min=%" PRIu32 ", max=%" PRIu32 ", avg=%" PRIu32 "\n", s->min_interval_us,
+                 s->max_interval_us, s->ewma_interval_us);
+            return true;
+        case 2:
+            logi("processing (us): avg=%" PRIu32 ", max=%" PRIu32 "\n", s->processing_ewma_us, s->processing_max_us);
+            return true;
+        default:
+            if (s->has_seq)
+                logi("sequence: lost=%" PRIu32 ", duplicated=%" PRIu32 "\n", s->seq_lost, s->seq_duplicated);
+            return false;
+    }
+}
+
+static bool dump_device_step(int step, int idx) {
+    uni_hid_device_t* d = uni_hid_device_get_instance_for_idx(idx);
+
+    // Might have disconnected between two steps.
+    if (bd_addr_cmp(d->conn.btaddr, zero_addr) == 0)
+        return false;
+    return uni_hid_device_dump_device_step(d, step);
+}
+
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+static bool capture_dump_step(int step, int arg) {
+    ARG_UNUSED(arg);
+    return uni_hid_capture_dump_step(step);
+}
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+
+static bool list_bluetooth_keys_step(int step, int arg) {
+    ARG_UNUSED(arg);
+    return uni_bt_list_keys_step_unsafe(step);
+}
+
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+static bool clock_step(int step, int arg) {
+    ARG_UNUSED(arg);
+    return uni_clock_scaling_dump_step(step);
+}
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
+
+#ifdef CONFIG_BLUEPAD32_PROFILER
+static bool profiler_step(int step, int arg) {
+    ARG_UNUSED(arg);
+    return uni_profiler_dump_step(step);
+}
+#endif  // CONFIG_BLUEPAD32_PROFILER
+
+#ifdef CONFIG_BLUEPAD32_BOOT_TIMELINE
+static bool boot_step(int step, int arg) {
+    ARG_UNUSED(arg);
+    return uni_boot_dump_step(step);
+}
+#endif  // CONFIG_BLUEPAD32_BOOT_TIMELINE
+
+// Processing histogram: title + buckets. Then the same for the interval histogram.
+static bool latency_step(int step, int idx) {
+    const uni_report_stats_t* s = &uni_hid_device_get_instance_for_idx(idx)->report_stats;
+    const int lines = UNI_REPORT_STATS_HISTOGRAM_BUCKETS + 1;
+
+    if (step == 0) {
+        logi("processing (us):\n");
+    } else if (step < lines) {
+        int b = step - 1;
+        print_histogram_bucket(processing_bucket_names[b], s->processing_histogram[b],
+                               get_histogram_total(s->processing_histogram));
+    } else if (step == lines) {
+        logi("interval (ms):\n");
+    } else {
+        int b = step - lines - 1;
+        print_histogram_bucket(interval_bucket_names[b], s->histogram[b], get_histogram_total(s->histogram));
+    }
+    return step + 1 < lines * 2;
+}
+
+//
+// Commands
+//
+static bool help_step(int step, int arg);
+
+static int cmd_help(int argc, char** argv) {
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    start_steps(help_step, 0);
+    return 0;
+}
+
+static int cmd_getprop(int argc, char** argv) {
+    if (argc < 2) {
+        start_steps(getprop_step, 0);
+        return 0;
+    }
+
+    const uni_property_t* p = uni_property_get_property_by_name(argv[1]);
+    if (!p) {
+        loge("Invalid property: %s\n", argv[1]);
+        return 1;
+    }
+    uni_property_dump_property(p);
+    return 0;
+}
+
+static int cmd_setprop(int argc, char** argv) {
+    uni_property_value_t value;
+    long l;
+    char* end;
+
+    if (argc != 3) {
+        loge("Usage: setprop <name> <value>\n");
+        return 1;
+    }
+
+    const uni_property_t* p = uni_property_get_property_by_name(argv[1]);
+    if (!p) {
+        loge("Invalid property: %s\n", argv[1]);
+        return 1;
+    }
+    if (p->flags & UNI_PROPERTY_FLAG_READ_ONLY) {
+        loge("Read-only property: %s\n", argv[1]);
+        return 1;
+    }
+
+    switch (p->type) {
+        case UNI_PROPERTY_TYPE_BOOL:
+        case UNI_PROPERTY_TYPE_U8:
+        case UNI_PROPERTY_TYPE_U32:
+            if (!parse_int(argv[2], &l)) {
+                loge("Invalid value: %s\n", argv[2]);
+                return 1;
+            }
+            if (p->type == UNI_PROPERTY_TYPE_BOOL)
+                value.boolean = !!l;
+            else if (p->type == UNI_PROPERTY_TYPE_U8)
+                value.u8 = l;
+            else
+                value.u32 = l;
+            break;
+        case UNI_PROPERTY_TYPE_FLOAT:
+            value.f32 = strtof(argv[2], &end);
+            if (end == argv[2] || *end != '\0') {
+                loge("Invalid value: %s\n", argv[2]);
+                return 1;
+            }
+            break;
+        default:
+            loge("Property type not supported: %d\n", p->type);
+            return 1;
+    }
+
+    uni_property_set_with_property(p, value);
+    logi("Done. Some properties need a restart. Type 'restart' + Enter\n");
+    return 0;
+}
+
+static int cmd_list_devices(int argc, char** argv) {
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    start_steps(list_devices_step, 0);
+    return 0;
+}
+
+static int cmd_dump_device(int argc, char** argv) {
+    int idx = parse_device_idx(argc, argv);
+    if (idx < 0)
+        return 1;
+
+    uni_hid_device_t* d = uni_hid_device_get_instance_for_idx(idx);
+    if (bd_addr_cmp(d->conn.btaddr, zero_addr) == 0) {
+        loge("No device at idx=%d\n", idx);
+        return 1;
+    }
+    start_steps(dump_device_step, idx);
+    return 0;
+}
+
+static int cmd_stats(int argc, char** argv) {
+    int idx = parse_device_idx(argc, argv);
+    if (idx < 0)
+        return 1;
+
+    if (argc > 2 && strcmp(argv[2], "reset") == 0) {
+        uni_report_stats_reset(&uni_hid_device_get_instance_for_idx(idx)->report_stats);
+        return 0;
+    }
+    start_steps(stats_step, idx);
+    return 0;
+}
+
+static int cmd_latency(int argc, char** argv) {
+    int idx = parse_device_idx(argc, argv);
+    if (idx < 0)
+        return 1;
+
+    start_steps(latency_step, idx);
+    return 0;
+}
+
+static int cmd_mapping(int argc, char** argv) {
+    if (argc < 2) {
+        logi("Mapping: %s\n", mappings_names[uni_gamepad_get_mappings_type()]);
+        return 0;
+    }
+
+    // "custom" needs the mappings. It can only be set with uni_gamepad_set_mappings().
+    for (int i = 0; i < UNI_GAMEPAD_MAPPINGS_TYPE_CUSTOM; i++) {
+        if (strcmp(argv[1], mappings_names[i]) == 0) {
+            uni_gamepad_set_mappings_type(i);
+            return 0;
+        }
+    }
+    loge("Invalid mapping: %s\n", argv[1]);
+    return 1;
+}
+
+static int cmd_mouse_scale(int argc, char** argv) {
+    char* end;
+
+    if (argc < 2) {
+        logi("%f\n", uni_mouse_quadrature_get_scale_factor());
+        return 0;
+    }
+
+    float scale = strtof(argv[1], &end);
+    if (end == argv[1] || *end != '\0' || scale <= 0) {
+        loge("Invalid scale: %s\n", argv[1]);
+        return 1;
+    }
+    uni_mouse_quadrature_set_scale_factor(scale);
+    return 0;
+}
+
+static int cmd_disconnect(int argc, char** argv) {
+    int idx = parse_device_idx(argc, argv);
+    if (idx < 0)
+        return 1;
+
+    uni_bt_disconnect_device_safe(idx);
+    return 0;
+}
+
+static int cmd_incoming_connections_enable(int argc, char** argv) {
+    long enabled;
+
+    if (argc < 2 || !parse_int(argv[1], &enabled)) {
+        logi("Incoming connections: %s\n", uni_bt_enable_new_connections_is_enabled() ? "Enabled" : "Disabled");
+        return 0;
+    }
+    uni_bt_enable_new_connections_unsafe(!!enabled);
+    return 0;
+}
+
+static int cmd_list_bluetooth_keys(int argc, char** argv) {
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    start_steps(list_bluetooth_keys_step, 0);
+    return 0;
+}
+
+static int cmd_del_bluetooth_keys(int argc, char** argv) {
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    uni_bt_del_keys_unsafe();
+    return 0;
+}
+
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+static int cmd_capture(int argc, char** argv) {
+    if (argc < 2) {
+        logi("HID capture: %s\n", uni_hid_capture_is_enabled() ? "Enabled" : "Disabled");
+        return 0;
+    }
+
+    if (strcmp(argv[1], "dump") == 0) {
+        start_steps(capture_dump_step, 0);
+    } else if (strcmp(argv[1], "clear") == 0) {
+        uni_hid_capture_clear();
+    } else if (strcmp(argv[1], "start") == 0) {
+        uni_hid_capture_set_enabled(true);
+    } else if (strcmp(argv[1], "stop") == 0) {
+        uni_hid_capture_set_enabled(false);
+    } else {
+        loge("Invalid action: %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+static int cmd_clock(int argc, char** argv) {
+    long khz;
+
+    if (argc < 2) {
+        start_steps(clock_step, 0);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "auto") == 0)
+        khz = 0;
+    else if (!parse_int(argv[1], &khz) || khz <= 0) {
+        loge("Invalid clock: %s\n", argv[1]);
+        return 1;
+    }
+    return uni_clock_scaling_set_fixed_khz(khz) == 0 ? 0 : 1;
+}
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
+
+#ifdef CONFIG_BLUEPAD32_PROFILER
+static int cmd_profiler(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0)
+        uni_profiler_reset();
+    else
+        start_steps(profiler_step, 0);
+    return 0;
+}
+#endif  // CONFIG_BLUEPAD32_PROFILER
+
+#ifdef CONFIG_BLUEPAD32_BOOT_TIMELINE
+static int cmd_boot(int argc, char** argv) {
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    start_steps(boot_step, 0);
+    return 0;
+}
+#endif  // CONFIG_BLUEPAD32_BOOT_TIMELINE
+
+static int cmd_restart(int argc, char** argv) {
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    uni_system_reboot();
+    return 0;
+}
+
+static const uni_console_cmd_t builtin_cmds[] = {
+    {"help", NULL, "Print the list of commands", cmd_help},
+    {"getprop", "[name]", "Get property or all properties", cmd_getprop},
+    {"setprop", "<name> <value>", "Set property. Booleans are 0 or 1", cmd_setprop},
+    {"list_devices", NULL, "List connected devices", cmd_list_devices},
+    {"dump_device", "<idx>", "Print all the info about a device", cmd_dump_device},
+    {"stats", "<idx> [reset]", "Input report stats of a device", cmd_stats},
+    {"latency", "<idx>", "Report processing time and interval histograms of a device", cmd_latency},
+    {"mapping", "[xbox | switch]", "Get/Set gamepad button mappings", cmd_mapping},
+    {"mouse_scale", "[value]", "Get/Set global mouse scale factor. Higher means faster", cmd_mouse_scale},
+    {"disconnect", "<idx>", "Disconnects a gamepad/mouse/etc.", cmd_disconnect},
+    {"incoming_connections_enable", "[0 | 1]", "Get/Set whether Bluetooth incoming connections are enabled",
+     cmd_incoming_connections_enable},
+    {"list_bluetooth_keys", NULL, "List stored Bluetooth keys", cmd_list_bluetooth_keys},
+    {"del_bluetooth_keys", NULL, "Delete stored Bluetooth keys. 'Unpairs' devices", cmd_del_bluetooth_keys},
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+    {"capture", "[dump | clear | start | stop]", "HID traffic capture", cmd_capture},
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+    {"clock", "[kHz | auto]", "Clock scaling stats. Or use a fixed clock", cmd_clock},
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
+#ifdef CONFIG_BLUEPAD32_PROFILER
+    {"profiler", "[reset]", "Cycles spent in each parser callback", cmd_profiler},
+#endif  // CONFIG_BLUEPAD32_PROFILER
+#ifdef CONFIG_BLUEPAD32_BOOT_TIMELINE
+    {"boot", NULL, "Boot timeline, from power-on to the first report", cmd_boot},
+#endif  // CONFIG_BLUEPAD32_BOOT_TIMELINE
+    {"restart", NULL, "Reboots the Pico W", cmd_restart},
+};
+static const int builtin_cmds_count = ARRAY_SIZE(builtin_cmds);
+
+static bool help_step(int step, int arg) {
+    ARG_UNUSED(arg);
+
+    if (step < builtin_cmds_count)
+        print_cmd(&builtin_cmds[step]);
+    else if (step - builtin_cmds_count < platform_cmds_count)
+        print_cmd(platform_cmds[step - builtin_cmds_count]);
+    return step + 1 < builtin_cmds_count + platform_cmds_count;
+}
+
+static const uni_console_cmd_t* find_cmd(const char* name) {
+    for (int i = 0; i < builtin_cmds_count; i++) {
+        if (strcmp(builtin_cmds[i].command, name) == 0)
+            return &builtin_cmds[i];
+    }
+    for (int i = 0; i < platform_cmds_count; i++) {
+        if (strcmp(platform_cmds[i]->command, name) == 0)
+            return platform_cmds[i];
+    }
+    return NULL;
+}
+
+//
+// Line editor
+//
+static void print_prompt(void) {
+    printf(PROMPT);
+}
+
+static void redraw_line(void) {
+    // Carriage return + erase line
+    printf("\r\x1b[K" PROMPT "%s", line);
+}
+
+static void execute_line(void) {
+    char buf[LINE_MAX_LEN + 1];
+    char* argv[MAX_ARGS];
+    int argc = 0;
+
+    strcpy(history, line);
+    strcpy(buf, line);
+    line_len = 0;
+    line[0] = '\0';
+
+    for (char* tok = strtok(buf, " \t"); tok && argc < MAX_ARGS; tok = strtok(NULL, " \t"))
+        argv[argc++] = tok;
+
+    if (argc == 0)
+        return;
+
+    const uni_console_cmd_t* cmd = find_cmd(argv[0]);
+    if (!cmd) {
+        loge("Unknown command: %s. Type 'help'\n", argv[0]);
+        return;
+    }
+    cmd->func(argc, argv);
+}
+
+static void on_char(int c) {
+    int prev = prev_char;
+    prev_char = c;
+
+    if (c == CTRL_C) {
+        pending.fn = NULL;
+        line_len = 0;
+        line[0] = '\0';
+        esc_state = ESC_STATE_NONE;
+        printf("^C\n");
+        print_prompt();
+        return;
+    }
+
+    // Ignore what is typed while a command is printing its output.
+    if (pending.fn)
+        return;
+
+    switch (esc_state) {
+        case ESC_STATE_START:
+            esc_state = (c == '[') ? ESC_STATE_CSI : ESC_STATE_NONE;
+            return;
+        case ESC_STATE_CSI:
+            esc_state = ESC_STATE_NONE;
+            if (c == 'A') {
+                // Up: recall the last line
+                strcpy(line, history);
+                line_len = strlen(line);
+                redraw_line();
+            } else if (c == 'B') {
+                // Down: empty line
+                line_len = 0;
+                line[0] = '\0';
+                redraw_line();
+            }
+            return;
+        default:
+            break;
+    }
+
+    switch (c) {
+        case '\n':
+            // "\r\n" is a single new line.
+            if (prev == '\r')
+                return;
+            // fall through
+        case '\r':
+            printf("\n");
+            if (line_len > 0)
+                execute_line();
+            if (!pending.fn)
+                print_prompt();
+            break;
+        case '\b':
+        case 0x7f:
+            if (line_len > 0) {
+                line[--line_len] = '\0';
+                printf("\b \b");
+            }
+            break;
+        case CTRL_U:
+            line_len = 0;
+            line[0] = '\0';
+            redraw_line();
+            break;
+        case ESC:
+            esc_state = ESC_STATE_START;
+            break;
+        default:
+            if (c >= ' ' && c < 0x7f && line_len < LINE_MAX_LEN) {
+                line[line_len++] = c;
+                line[line_len] = '\0';
+                putchar(c);
+            }
+            break;
+    }
+}
+
+static void on_timer(btstack_timer_source_t* ts) {
+    for (int i = 0; i < MAX_CHARS_PER_POLL; i++) {
+        int c = getchar_timeout_us(0);
+        if (c < 0)
+            break;
+        on_char(c);
+    }
+
+    if (pending.fn) {
+        if (!pending.fn(pending.step++, pending.arg)) {
+            pending.fn = NULL;
+            print_prompt();
+        }
+    }
+
+    btstack_run_loop_set_timer(ts, pending.fn ? STEP_MS : POLL_MS);
+    btstack_run_loop_add_timer(ts);
+}
+
+int uni_console_register_cmd(const uni_console_cmd_t* cmd) {
+    if (platform_cmds_count >= MAX_PLATFORM_CMDS) {
+        loge("Console: Cannot register '%s', too many commands\n", cmd->command);
+        return -1;
+    }
+    platform_cmds[platform_cmds_count++] = cmd;
+    return 0;
+}
+
 void uni_console_init(void) {
-    // FIXME: Implement me
+    if (uni_get_platform()->register_console_cmds)
+        uni_get_platform()->register_console_cmds();
+
+    logi("Console: Type 'help' + Enter for the list of commands\n");
+    print_prompt();
+
+    btstack_run_loop_set_timer_handler(&timer, on_timer);
+    btstack_run_loop_set_timer(&timer, POLL_MS);
+    btstack_run_loop_add_timer(&timer);
 }
@@ -0,0 +1,387 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2023 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+// Pico W version of uni_mouse_quadrature.c
+// The quadrature waveforms are generated by PIO: one state machine per encoder.
+// The CPU only pushes one word per mouse report and encoder, there is no CPU involvement per edge.
+
+#include "uni_mouse_quadrature.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <hardware/clocks.h>
+#include <hardware/gpio.h>
+#include <hardware/pio.h>
+
+#include "uni_common.h"
+#include "uni_log.h"
+#include "uni_mouse_quadrature_pico.pio.h"
+#include "uni_property.h"
+
+// Same max rate as the ESP32 version: one quadrature step every 80us per encoder.
+#define MIN_STEP_US (80)
+// Cycles per step in the PIO program: "set [30]" + "jmp".
+#define STEP_CYCLES (32)
+
+// Max steps sent in one FIFO word. 128 steps * 80us = ~10ms, about the time between two mouse reports.
+#define MAX_STEPS_PER_TRAIN (128)
+// Deltas that could not be sent are sent in the following reports. But don't accumulate
+// too many of them, otherwise the mouse "lags".
+#define MAX_PENDING_STEPS (MAX_STEPS_PER_TRAIN * 2)
+// Trains waiting in the TX FIFO, besides the one being generated. The FIFO could hold 4,
+// but queued trains count as "lag" too: with 1, at most ~20ms are queued in hardware,
+// the same as MAX_PENDING_STEPS in software.
+#define MAX_QUEUED_TRAINS (1)
+
+// Pending steps are stored as fixed-point, to keep the fractional part of the scaled deltas.
+#define STEP_FRACTION_BITS (8)
+
+// A mouse has two encoders.
+struct quadrature_state {
+    // Current quadrature phase. Where the last pushed train ends.
+    int phase;
+    // Steps that were not sent yet. Signed, fixed point.
+    int32_t pending;
+
+    // Whether the encoder has a state machine assigned.
+    bool valid;
+    // State machine. Uses the "pio" global.
+    uint sm;
+    // GPIO used as "set base". The other one is the next GPIO.
+    uint pin_base;
+    // If B is the "base" pin, then the direction is inverted.
+    bool inverted;
+
+    // GPIOs used
+    struct uni_mouse_quadrature_encoder_gpios gpios;
+};
+
+struct quadrature_stats {
+    uint32_t edges;
+    uint32_t trains;
+    uint32_t busy;           // Updates that arrived while MAX_QUEUED_TRAINS were queued
+    uint32_t dropped_steps;  // Steps discarded because too many were pending
+};
+
+static struct quadrature_state s_quadratures[UNI_MOUSE_QUADRATURE_PORT_MAX][UNI_MOUSE_QUADRATURE_ENCODER_MAX];
+static struct quadrature_stats s_stats[UNI_MOUSE_QUADRATURE_PORT_MAX];
+// Cache to prevent enabling/disabling the output that were already enabled/disabled
+static bool timer_started[UNI_MOUSE_QUADRATURE_PORT_MAX];
+
+// "Scale factor" for mouse movement. To make the mouse move faster or slower.
+// Bigger means faster movement. Stored as fixed point too.
+static float s_scale_factor;
+static int32_t s_scale_factor_fixed;
+
+static PIO s_pio;
+static uint s_program_offset;
+static bool initialized;
+
+// Values of the "set" pins (B:A) for each phase
+static const uint8_t phase_pins[4] = {0b00, 0b01, 0b11, 0b10};
+
+// Entry points of the PIO program, indexed by the phase that is going to be set.
+static const uint8_t fwd_entries[4] = {
+    quadrature_out_offset_fwd_0,
+    quadrature_out_offset_fwd_1,
+    quadrature_out_offset_fwd_2,
+    quadrature_out_offset_fwd_3,
+};
+static const uint8_t bwd_entries[4] = {
+    quadrature_out_offset_bwd_0,
+    quadrature_out_offset_bwd_1,
+    quadrature_out_offset_bwd_2,
+    quadrature_out_offset_bwd_3,
+};
+
+static void set_scale_factor_cache(float scale) {
+    s_scale_factor = scale;
+    s_scale_factor_fixed = (int32_t)roundf(scale * (1 << STEP_FRACTION_BITS));
+}
+
+static float get_clkdiv(void) {
+    return (float)clock_get_hz(clk_sys) * MIN_STEP_US / 1000000.0f / STEP_CYCLES;
+}
+
+static void send_train(struct quadrature_state* q, struct quadrature_stats* st) {
+    int32_t steps = q->pending >> STEP_FRACTION_BITS;
+    // Arithmetic shift rounds towards -inf. Round towards zero to keep the remainder with the same sign.
+    if (steps < 0 && (q->pending & ((1 << STEP_FRACTION_BITS) - 1)))
+        steps++;
+    if (steps > MAX_STEPS_PER_TRAIN)
+        steps = MAX_STEPS_PER_TRAIN;
+    if (steps < -MAX_STEPS_PER_TRAIN)
+        steps = -MAX_STEPS_PER_TRAIN;
+    if (steps == 0)
+        return;
+    q->pending -= steps * (1 << STEP_FRACTION_BITS);
+
+    // The phase is the one seen from the pins: when B is the base pin, "forward" in the
+    // program is "backward" for the encoder.
+    int dir = (steps < 0) ? -1 : 1;
+    int abs_steps = (steps < 0) ? -steps : steps;
+    int pin_dir = q->inverted ? -dir : dir;
+
+    int next_phase = (q->phase + pin_dir) & 3;
+    uint8_t entry = (pin_dir > 0) ? fwd_entries[next_phase] : bwd_entries[next_phase];
+    uint32_t word = ((uint32_t)(s_program_offset + entry) << 27) | (uint32_t)(abs_steps - 1);
+    pio_sm_put(s_pio, q->sm, word);
+
+    q->phase = (q->phase + pin_dir * abs_steps) & 3;
+    st->edges += abs_steps;
+    st->trains++;
+}
+
+static void process_update(struct quadrature_state* q, struct quadrature_stats* st, int32_t delta) {
+    if (!q->valid)
+        return;
+
+    q->pending += delta * s_scale_factor_fixed;
+
+    const int32_t max_pending = MAX_PENDING_STEPS * (1 << STEP_FRACTION_BITS);
+    if (q->pending > max_pending) {
+        st->dropped_steps += (q->pending - max_pending) >> STEP_FRACTION_BITS;
+        q->pending = max_pending;
+    } else if (q->pending < -max_pending) {
+        st->dropped_steps += (-max_pending - q->pending) >> STEP_FRACTION_BITS;
+        q->pending = -max_pending;
+    }
+
+    if (pio_sm_get_tx_fifo_level(s_pio, q->sm) >= MAX_QUEUED_TRAINS) {
+        // Will be sent in the next update.
+        st->busy++;
+        return;
+    }
+    send_train(q, st);
+}
+
+static void setup_encoder(struct quadrature_state* q) {
+    q->valid = false;
+
+    if (q->gpios.a == -1 || q->gpios.b == -1)
+        return;
+
+    // PIO "set" pins must be consecutive.
+    if (q->gpios.b == q->gpios.a + 1) {
+        q->pin_base = q->gpios.a;
+        q->inverted = false;
+    } else if (q->gpios.a == q->gpios.b + 1) {
+        q->pin_base = q->gpios.b;
+        q->inverted = true;
+    } else {
+        loge("Mouse quadrature: GPIOs %d and %d must be consecutive\n", q->gpios.a, q->gpios.b);
+        return;
+    }
+
+    int sm = pio_claim_unused_sm(s_pio, false);
+    if (sm < 0) {
+        loge("Mouse quadrature: No free PIO state machines\n");
+        return;
+    }
+    q->sm = sm;
+
+    pio_sm_config c = quadrature_out_program_get_default_config(s_program_offset);
+    sm_config_set_set_pins(&c, q->pin_base, 2);
+    // FIFOs are not joined: only MAX_QUEUED_TRAINS entries are used.
+    sm_config_set_out_shift(&c, true /* shift right */, false /* autopull */, 32);
+    sm_config_set_clkdiv(&c, get_clkdiv());
+
+    pio_sm_set_consecutive_pindirs(s_pio, q->sm, q->pin_base, 2, true /* out */);
+    pio_sm_init(s_pio, q->sm, s_program_offset + quadrature_out_offset_idle, &c);
+
+    q->valid = true;
+}
+
+void uni_mouse_quadrature_init(int cpu_id) {
+    // PIO doesn't need a task pinned to a certain CPU.
+    ARG_UNUSED(cpu_id);
+
+    memset(s_quadratures, 0, sizeof(s_quadratures));
+    memset(s_stats, 0, sizeof(s_stats));
+
+    for (int i = 0; i < UNI_MOUSE_QUADRATURE_PORT_MAX; i++) {
+        timer_started[i] = false;
+        for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
+            s_quadratures[i][j].gpios.a = -1;
+            s_quadratures[i][j].gpios.b = -1;
+        }
+    }
+
+    // The CYW43 driver prefers PIO1. Try PIO0 first.
+    s_pio = pio0;
+    if (!pio_can_add_program(s_pio, &quadrature_out_program)) {
+        s_pio = pio1;
+        if (!pio_can_add_program(s_pio, &quadrature_out_program)) {
+            loge("Mouse quadrature: No room for the PIO program\n");
+            return;
+        }
+    }
+    s_program_offset = pio_add_program(s_pio, &quadrature_out_program);
+
+    // Default value that can be overridden from the console
+    set_scale_factor_cache(uni_mouse_quadrature_get_scale_factor());
+
+    initialized = true;
+}
+
+void uni_mouse_quadrature_setup_port(int port_idx,
+                                     struct uni_mouse_quadrature_encoder_gpios h,
+                                     struct uni_mouse_quadrature_encoder_gpios v) {
+    if (!initialized) {
+        loge("%s: Error, Not initialized\n", __func__);
+        return;
+    }
+    if (port_idx < 0 || port_idx >= UNI_MOUSE_QUADRATURE_PORT_MAX) {
+        loge("%s: Invalid port idx=%d\n", __func__, port_idx);
+        return;
+    }
+    s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_H].gpios = h;
+    s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_V].gpios = v;
+
+    for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++)
+        setup_encoder(&s_quadratures[port_idx][j]);
+}
+
+void uni_mouse_quadrature_deinit(void) {
+    if (!initialized)
+        return;
+
+    for (int i = 0; i < UNI_MOUSE_QUADRATURE_PORT_MAX; i++) {
+        uni_mouse_quadrature_pause(i);
+        for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
+            struct quadrature_state* q = &s_quadratures[i][j];
+            if (!q->valid)
+                continue;
+            pio_sm_unclaim(s_pio, q->sm);
+            q->valid = false;
+        }
+    }
+    pio_remove_program(s_pio, &quadrature_out_program, s_program_offset);
+
+    initialized = false;
+}
+
+void uni_mouse_quadrature_start(int port_idx) {
+    if (!initialized) {
+        loge("%s: Error, Not initialized\n", __func__);
+        return;
+    }
+
+    if (port_idx < 0 || port_idx >= UNI_MOUSE_QUADRATURE_PORT_MAX) {
+        loge("%s: Invalid port idx=%d\n", __func__, port_idx);
+        return;
+    }
+
+    if (timer_started[port_idx])
+        return;
+
+    for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
+        struct quadrature_state* q = &s_quadratures[port_idx][j];
+        if (!q->valid)
+            continue;
+        // Start from a known phase
+        q->phase = 0;
+        q->pending = 0;
+        pio_sm_set_pins_with_mask(s_pio, q->sm, phase_pins[0] << q->pin_base, 0b11u << q->pin_base);
+        pio_gpio_init(s_pio, q->pin_base);
+        pio_gpio_init(s_pio, q->pin_base + 1);
+        pio_sm_set_enabled(s_pio, q->sm, true);
+    }
+
+    timer_started[port_idx] = true;
+}
+
+void uni_mouse_quadrature_pause(int port_idx) {
+    if (!initialized) {
+        loge("%s: Error, Not initialized\n", __func__);
+        return;
+    }
+
+    if (port_idx < 0 || port_idx >= UNI_MOUSE_QUADRATURE_PORT_MAX) {
+        loge("%s: Invalid port idx=%d\n", __func__, port_idx);
+        return;
+    }
+
+    if (!timer_started[port_idx])
+        return;
+
+    for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
+        struct quadrature_state* q = &s_quadratures[port_idx][j];
+        if (!q->valid)
+            continue;
+        pio_sm_set_enabled(s_pio, q->sm, false);
+        // Discard trains not sent yet, and go back to "idle" so that it can be restarted safely.
+        pio_sm_clear_fifos(s_pio, q->sm);
+        pio_sm_restart(s_pio, q->sm);
+        pio_sm_exec(s_pio, q->sm, pio_encode_jmp(s_program_offset + quadrature_out_offset_idle));
+        // Give the GPIOs back to SIO, so that they can be used as joystick lines.
+        gpio_set_function(q->pin_base, GPIO_FUNC_SIO);
+        gpio_set_function(q->pin_base + 1, GPIO_FUNC_SIO);
+    }
+
+    timer_started[port_idx] = false;
+}
+
+// Should be called everytime that mouse report is received.
+void uni_mouse_quadrature_update(int port_idx, int32_t dx, int32_t dy) {
+    if (!initialized) {
+        loge("%s: Error, Not initialized\n", __func__);
+        return;
+    }
+    if (port_idx < 0 || port_idx >= UNI_MOUSE_QUADRATURE_PORT_MAX) {
+        loge("%s: Invalid port idx=%d\n", __func__, port_idx);
+        return;
+    }
+    if (!timer_started[port_idx])
+        return;
+
+    struct quadrature_stats* st = &s_stats[port_idx];
+    process_update(&s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_H], st, dx);
+    // Invert delta Y so that mouse goes the right direction.
+    // This is based on empiric evidence. Also, it seems that SmallyMouse is doing the same thing
+    process_update(&s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_V], st, -dy);
+}
+
+void uni_mouse_quadrature_dump(int port_idx) {
+    if (port_idx < 0 || port_idx >= UNI_MOUSE_QUADRATURE_PORT_MAX)
+        return;
+    const struct quadrature_stats* st = &s_stats[port_idx];
+    logi("\tquadrature: edges=%" PRIu32 ", trains=%" PRIu32 ", busy=%" PRIu32 ", dropped steps=%" PRIu32
+         ", limit=%d edges/sec\n",
+         st->edges, st->trains, st->busy, st->dropped_steps, UNI_MOUSE_QUADRATURE_ENCODER_MAX * 1000000 / MIN_STEP_US);
+}
+
+void uni_mouse_quadrature_set_scale_factor(float scale) {
+    uni_property_value_t value;
+    value.f32 = scale;
+
+    set_scale_factor_cache(scale);
+    uni_property_set(UNI_PROPERTY_IDX_MOUSE_SCALE, value);
+}
+
+void uni_mouse_quadrature_on_sys_clock_changed(void) {
+    if (!initialized)
+        return;
+
+    // Keep the same step length.
+    float div = get_clkdiv();
+    for (int i = 0; i < UNI_MOUSE_QUADRATURE_PORT_MAX; i++) {
+        for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
+            struct quadrature_state* q = &s_quadratures[i][j];
+            if (q->valid)
+                pio_sm_set_clkdiv(s_pio, q->sm, div);
+        }
+    }
+}
+
+float uni_mouse_quadrature_get_scale_factor(void) {
+    uni_property_value_t value;
+
+    value = uni_property_get(UNI_PROPERTY_IDX_MOUSE_SCALE);
+    set_scale_factor_cache(value.f32);
+    return value.f32;
+}
@@ -66,6 +66,10 @@ out:
     nvs_close(nvs_handle);
 }
 
+void uni_property_flush(void) {
+    // Properties are committed to NVS in uni_property_set_with_property(). Nothing to do.
+}
+
 uni_property_value_t uni_property_get_with_property(const uni_property_t* p) {
     nvs_handle_t nvs_handle;
     esp_err_t err;
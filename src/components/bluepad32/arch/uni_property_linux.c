@@ -69,6 +69,10 @@ void uni_property_set_with_property(const uni_property_t* p, uni_property_value_
     }
 }
 
+void uni_property_flush(void) {
+    // Properties are stored in uni_property_set_with_property(). Nothing to do.
+}
+
 uni_property_value_t uni_property_get_with_property(const uni_property_t* p) {
     uni_property_value_t value;
     int size;
@@ -4,23 +4,140 @@
 
 #include "uni_property.h"
 
+#include <btstack.h>
 #include <btstack_tlv.h>
 #include <btstack_tlv_flash_bank.h>
 #include <btstack_util.h>
+#include <string.h>
 
+#include "bt/uni_bt_conn.h"
+#include "uni_hid_device.h"
 #include "uni_log.h"
 
-// TODO: Implement a memory cache.
-// Used only in non-ESP32 platforms.
-// Short-term solution: just return the default value.
+// Write-back cache.
+// Writing / erasing the flash stalls XIP on both cores, so a property change in the middle
+// of a game would freeze the Bluetooth stack for a few milliseconds.
+// Instead, the new values are kept in RAM and are written to flash when no device is
+// "ready", or when uni_property_flush() is called (e.g.: before rebooting).
+//
+// Crash-safety: the values are stored one tag at a time, and a property is marked as clean
+// only after its tag was stored. btstack_tlv_flash_bank appends the new entries and only erases
+// the old bank after the new one was populated, so a power loss in the middle of a flush
+// leaves each property with either its old or its new value.
+
+// How often to retry the flush when there are "ready" devices.
+#define FLUSH_RETRY_MS 1000
+
+typedef struct {
+    const uni_property_t* p;  // Set when the property is set / read for the first time
+    uni_property_value_t value;
+    bool cached;  // "value" is valid
+    bool dirty;   // "value" is not in flash yet
+} property_cache_entry_t;
 
 static const btstack_tlv_t* tlv_impl;
 static btstack_tlv_flash_bank_t* tlv_context;
 
-void uni_property_set_with_property(const uni_property_t* p, uni_property_value_t value) {
-    uint8_t* data;
-    int size;
+static property_cache_entry_t cache[UNI_PROPERTY_IDX_COUNT];
+static btstack_timer_source_t flush_timer;
+static bool flush_scheduled;
+static uint32_t deferred_writes;  // Number of sets that didn't hit the flash immediately
+
+static int get_property_size(const uni_property_t* p) {
+    switch (p->type) {
+        case UNI_PROPERTY_TYPE_BOOL:
+            return sizeof(bool);
+        case UNI_PROPERTY_TYPE_U8:
+            return sizeof(uint8_t);
+        case UNI_PROPERTY_TYPE_U32:
+            return sizeof(uint32_t);
+        case UNI_PROPERTY_TYPE_FLOAT:
+            return sizeof(float);
+        default:
+            return 0;
+    }
+}
+
+static bool can_flush(void) {
+    // Don't touch the flash while a controller is being used.
+    return uni_hid_device_get_first_device_with_state(UNI_BT_CONN_STATE_DEVICE_READY) == NULL;
+}
+
+static void store_dirty_properties(void) {
+    int stored = 0;
+
+    for (int i = 0; i < UNI_PROPERTY_IDX_COUNT; i++) {
+        if (!cache[i].dirty)
+            continue;
+
+        const uni_property_t* p = cache[i].p;
+        int size = get_property_size(p);
+
+        // Skip the write if flash already has the same value. E.g: a value that was changed and then restored.
+        uni_property_value_t in_flash;
+        if (tlv_impl->get_tag(tlv_context, i, (uint8_t*)&in_flash, size) == size &&
+            memcmp(&in_flash, &cache[i].value, size) == 0) {
+            cache[i].dirty = false;
+            continue;
+        }
+
+        if (tlv_impl->store_tag(tlv_context, i, (uint8_t*)&cache[i].value, size)) {
+            // Keep it dirty, will be retried in the next flush.
+            loge("Failed to store property %s(%d)\n", p->name, i);
+            continue;
+        }
+        cache[i].dirty = false;
+        stored++;
+    }
+
+    logd("Properties: stored %d in flash (deferred writes so far: %u)\n", stored, deferred_writes);
+}
+
+static bool has_dirty_properties(void) {
+    for (int i = 0; i < UNI_PROPERTY_IDX_COUNT; i++) {
+        if (cache[i].dirty)
+            return true;
+    }
+    return false;
+}
+
+static void schedule_flush(void);
+
+static void on_flush_timer(btstack_timer_source_t* ts) {
+    ARG_UNUSED(ts);
+    flush_scheduled = false;
+
+    if (!can_flush()) {
+        schedule_flush();
+        return;
+    }
+    store_dirty_properties();
+    if (has_dirty_properties())
+        schedule_flush();
+}
+
+static void schedule_flush(void) {
+    if (flush_scheduled)
+        return;
+    flush_scheduled = true;
+    flush_timer.process = &on_flush_timer;
+    btstack_run_loop_set_timer(&flush_timer, FLUSH_RETRY_MS);
+    btstack_run_loop_add_timer(&flush_timer);
+}
 
+void uni_property_flush(void) {
+    if (flush_scheduled) {
+        btstack_run_loop_remove_timer(&flush_timer);
+        flush_scheduled = false;
+    }
+    if (!has_dirty_properties())
+        return;
+    store_dirty_properties();
+    if (has_dirty_properties())
+        schedule_flush();
+}
+
+void uni_property_set_with_property(const uni_property_t* p, uni_property_value_t value) {
     if (!p) {
         loge("Invalid set property\n");
         return;
@@ -29,31 +146,24 @@ void uni_property_set_with_property(const uni_property_t* p, uni_property_value_
     if (p->flags & UNI_PROPERTY_FLAG_READ_ONLY)
         return;
 
-    switch (p->type) {
-        case UNI_PROPERTY_TYPE_BOOL:
-            data = (uint8_t*)&value.boolean;
-            size = sizeof(value.boolean);
-            break;
-        case UNI_PROPERTY_TYPE_U8:
-            data = (uint8_t*)&value.u8;
-            size = sizeof(value.u8);
-            break;
-        case UNI_PROPERTY_TYPE_U32:
-            data = (uint8_t*)&value.u32;
-            size = sizeof(value.u32);
-            break;
-        case UNI_PROPERTY_TYPE_FLOAT:
-            data = (uint8_t*)&value.f32;
-            size = sizeof(value.f32);
-            break;
-        default:
-            loge("uni_property_set_with_property: unsupported type %d\n", p->type);
-            return;
+    if (get_property_size(p) == 0 || p->idx >= UNI_PROPERTY_IDX_COUNT) {
+        loge("uni_property_set_with_property: unsupported type %d\n", p->type);
+        return;
     }
 
-    if (tlv_impl->store_tag(tlv_context, p->idx, data, size)) {
-        loge("Failed to store property %s(%d)\n", p->name, p->idx);
+    property_cache_entry_t* e = &cache[p->idx];
+    e->p = p;
+    e->value = value;
+    e->cached = true;
+    e->dirty = true;
+
+    if (can_flush()) {
+        store_dirty_properties();
+        return;
     }
+
+    deferred_writes++;
+    schedule_flush();
 }
 
 uni_property_value_t uni_property_get_with_property(const uni_property_t* p) {
@@ -92,11 +202,23 @@ uni_property_value_t uni_property_get_with_property(const uni_property_t* p) {
             return value;
     }
 
+    if (p->idx >= UNI_PROPERTY_IDX_COUNT) {
+        loge("Invalid property index: %d\n", p->idx);
+        return p->default_value;
+    }
+
+    property_cache_entry_t* e = &cache[p->idx];
+    if (e->cached)
+        return e->value;
+
     read = tlv_impl->get_tag(tlv_context, p->idx, (uint8_t*)&value, size);
     if (read == 0) {
         logd("Property %s (%d) not found in DB, returning default\n", p->name, p->idx);
-        return p->default_value;
+        value = p->default_value;
     }
+    e->p = p;
+    e->value = value;
+    e->cached = true;
     return value;
 }
 
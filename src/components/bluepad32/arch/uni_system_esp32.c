@@ -2,8 +2,42 @@
 // Copyright 2024 Ricardo Quesada
 // http://retro.moe/unijoysticle2
 
+#include "uni_system.h"
+
+#include <esp_idf_version.h>
+#include <esp_rom_sys.h>
 #include <esp_system.h>
+#include <esp_timer.h>
+#if ESP_IDF_VERSION_MAJOR == 4
+#include <hal/cpu_hal.h>
+#else
+#include <esp_cpu.h>
+#endif
 
 void uni_system_reboot(void) {
     esp_restart();
-}
\ No newline at end of file
+}
+
+uint32_t uni_system_get_time_us(void) {
+    return (uint32_t)esp_timer_get_time();
+}
+
+void uni_system_init_cycle_counter(void) {
+    // Always running
+}
+
+uint32_t uni_system_get_cycles(void) {
+#if ESP_IDF_VERSION_MAJOR == 4
+    return cpu_hal_get_cycle_count();
+#else
+    return esp_cpu_get_cycle_count();
+#endif
+}
+
+uint32_t uni_system_get_cycles_since(uint32_t start) {
+    return uni_system_get_cycles() - start;
+}
+
+uint32_t uni_system_get_cycles_per_us(void) {
+    return esp_rom_get_cpu_ticks_per_us();
+}
@@ -4,8 +4,35 @@
 
 #include "uni_system.h"
 
+#include <time.h>
+
 #include "uni_log.h"
 
 void uni_system_reboot(void) {
     logi("uni_system_reboot() not implemented in Linux\n");
-}
\ No newline at end of file
+}
+
+uint32_t uni_system_get_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+void uni_system_init_cycle_counter(void) {
+    // Nothing
+}
+
+uint32_t uni_system_get_cycles(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+uint32_t uni_system_get_cycles_since(uint32_t start) {
+    return uni_system_get_cycles() - start;
+}
+
+uint32_t uni_system_get_cycles_per_us(void) {
+    // "Cycles" are nanoseconds
+    return 1000;
+}
@@ -4,8 +4,46 @@
 
 #include "uni_system.h"
 
+#include <hardware/clocks.h>
+#include <hardware/structs/systick.h>
+#include <hardware/timer.h>
 #include <hardware/watchdog.h>
 
+#include "uni_common.h"
+#include "uni_config.h"
+#include "uni_property.h"
+
 void uni_system_reboot(void) {
+    // Don't lose the properties that were not written to flash yet.
+    uni_property_flush();
     watchdog_reboot(0 /* pc */, 0 /* sp */, 0 /* delay ms */);
-}
\ No newline at end of file
+}
+
+uint32_t UNI_HOT_FUNC(uni_system_get_time_us)(void) {
+    return time_us_32();
+}
+
+// The RP2040 timer only has microsecond resolution. SysTick counts CPU cycles, but it is a
+// 24-bit down-counter.
+#define SYSTICK_MASK 0x00ffffff
+#define SYSTICK_CSR_ENABLE BIT(0)
+#define SYSTICK_CSR_CLKSOURCE_CPU BIT(2)
+
+void uni_system_init_cycle_counter(void) {
+    systick_hw->rvr = SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = SYSTICK_CSR_ENABLE | SYSTICK_CSR_CLKSOURCE_CPU;
+}
+
+uint32_t UNI_HOT_FUNC(uni_system_get_cycles)(void) {
+    // Converted to an up-counter
+    return ~systick_hw->cvr & SYSTICK_MASK;
+}
+
+uint32_t UNI_HOT_FUNC(uni_system_get_cycles_since)(uint32_t start) {
+    return (uni_system_get_cycles() - start) & SYSTICK_MASK;
+}
+
+uint32_t uni_system_get_cycles_per_us(void) {
+    return clock_get_hz(clk_sys) / 1000000;
+}
@@ -246,6 +246,25 @@ void uni_bt_list_keys_unsafe(void) {
     bluetooth_list_keys();
 }
 
+bool uni_bt_list_keys_step_unsafe(int step) {
+    // BR/EDR keys first, then the LE ones, starting at this step. -1 while listing BR/EDR keys.
+    static int le_first_step;
+
+    if (step == 0)
+        le_first_step = IS_ENABLED(UNI_ENABLE_BREDR) ? -1 : 0;
+
+    if (le_first_step < 0) {
+        if (uni_bt_bredr_list_bonded_keys_step(step))
+            return true;
+        le_first_step = step + 1;
+        return IS_ENABLED(UNI_ENABLE_BLE);
+    }
+
+    if (!IS_ENABLED(UNI_ENABLE_BLE))
+        return false;
+    return uni_bt_le_list_bonded_keys_step(step - le_first_step);
+}
+
 void uni_bt_enable_new_connections_safe(bool enabled) {
     cmd_callback_registration.callback = &cmd_callback;
     cmd_callback_registration.context = (void*)(enabled ? (intptr_t)CMD_BT_ENABLE : (intptr_t)CMD_BT_DISABLE);
@@ -17,7 +17,10 @@
 #include "bt/uni_bt_sdp.h"
 #include "uni_common.h"
 #include "uni_config.h"
+#include "uni_hid_capture.h"
 #include "uni_log.h"
+#include "uni_profiler.h"
+#include "uni_system.h"
 
 // These are the only two supported platforms with BR/EDR support.
 #if !(defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_TARGET_LIBUSB) || defined(CONFIG_TARGET_PICO_W))
@@ -29,6 +32,92 @@ _Static_assert(INQUIRY_REMOTE_NAME_TIMEOUT_MS < HID_DEVICE_CONNECTION_TIMEOUT_MS
 
 static bool bt_bredr_enabled = true;
 
+// HID Interrupt channels bound to their device when the channel is opened.
+// Used by the Interrupt fast-path to avoid the per-report device lookup.
+typedef struct {
+    uint16_t cid;
+    uni_hid_device_t* device;
+} interrupt_channel_t;
+static interrupt_channel_t interrupt_channels[CONFIG_BLUEPAD32_MAX_DEVICES];
+// Most of the time only one controller is sending reports. Cache the last one.
+static interrupt_channel_t* last_interrupt_channel;
+// When interrupt_packet_handler() got the packet that is being processed, 0 outside of it.
+// The slow path measures from there too, so that its processing time includes the generic dispatch.
+static uint32_t interrupt_packet_received_us;
+
+static void interrupt_channel_bind(uint16_t cid, uni_hid_device_t* d) {
+    interrupt_channel_t* free_slot = NULL;
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        if (interrupt_channels[i].device == d || interrupt_channels[i].cid == cid) {
+            free_slot = &interrupt_channels[i];
+            break;
+        }
+        if (free_slot == NULL && interrupt_channels[i].device == NULL)
+            free_slot = &interrupt_channels[i];
+    }
+    if (free_slot == NULL) {
+        loge("Could not bind Interrupt channel 0x%04x, no free slots\n", cid);
+        return;
+    }
+    free_slot->cid = cid;
+    free_slot->device = d;
+}
+
+static void interrupt_channel_unbind(uint16_t cid) {
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        if (interrupt_channels[i].cid == cid) {
+            if (last_interrupt_channel == &interrupt_channels[i])
+                last_interrupt_channel = NULL;
+            interrupt_channels[i].cid = 0;
+            interrupt_channels[i].device = NULL;
+            return;
+        }
+    }
+}
+
+static uni_hid_device_t* UNI_HOT_FUNC(interrupt_channel_get_device)(uint16_t cid) {
+    if (last_interrupt_channel && last_interrupt_channel->cid == cid)
+        return last_interrupt_channel->device;
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        if (interrupt_channels[i].cid == cid) {
+            last_interrupt_channel = &interrupt_channels[i];
+            return interrupt_channels[i].device;
+        }
+    }
+    return NULL;
+}
+
+// Packet handler used by the HID Interrupt channels.
+// Input reports from "ready" devices go straight to the parser. Everything else, including
+// reports received while the device is being set up, goes through the generic handler.
+static void UNI_HOT_FUNC(interrupt_packet_handler)(uint8_t packet_type,
+                                                   uint16_t channel,
+                                                   uint8_t* packet,
+                                                   uint16_t size) {
+    uint32_t now = uni_system_get_time_us();
+
+    if (packet_type == L2CAP_DATA_PACKET && IS_ENABLED(CONFIG_BLUEPAD32_L2CAP_FAST_PATH)) {
+        uni_hid_device_t* d = interrupt_channel_get_device(channel);
+        // The binding could be stale if the device was deleted before the channel got closed.
+        // The "ready" state + cid checks cover that case.
+        if (d && d->conn.interrupt_cid == channel &&
+            uni_bt_conn_get_state(&d->conn) == UNI_BT_CONN_STATE_DEVICE_READY && size >= 2 &&
+            packet[0] == ((HID_MESSAGE_TYPE_DATA << 4) | HID_REPORT_TYPE_INPUT)) {
+            uni_report_stats_on_report(&d->report_stats, now);
+
+            // Skip the first byte, which is always 0xa1
+            uni_hid_parse_input_report(d, &packet[1], size - 1);
+            uni_hid_device_process_controller(d);
+
+            uni_report_stats_on_processed(&d->report_stats, uni_system_get_time_us() - now, true);
+            return;
+        }
+    }
+    interrupt_packet_received_us = now;
+    uni_bt_packet_handler(packet_type, channel, packet, size);
+    interrupt_packet_received_us = 0;
+}
+
 static void l2cap_create_control_connection(uni_hid_device_t* d) {
     uint8_t status;
     status = l2cap_create_channel(uni_bt_packet_handler, d->conn.btaddr, BLUETOOTH_PSM_HID_CONTROL,
@@ -42,7 +131,7 @@ static void l2cap_create_control_connection(uni_hid_device_t* d) {
 
 static void l2cap_create_interrupt_connection(uni_hid_device_t* d) {
     uint8_t status;
-    status = l2cap_create_channel(uni_bt_packet_handler, d->conn.btaddr, BLUETOOTH_PSM_HID_INTERRUPT,
+    status = l2cap_create_channel(interrupt_packet_handler, d->conn.btaddr, BLUETOOTH_PSM_HID_INTERRUPT,
                                   UNI_BT_L2CAP_CHANNEL_MTU, &d->conn.interrupt_cid);
     if (status) {
         loge("\nConnecting or Auth to HID Interrupt failed: 0x%02x", status);
@@ -126,23 +215,41 @@ void uni_bt_bredr_delete_bonded_keys(void) {
 }
 
 void uni_bt_bredr_list_bonded_keys(void) {
+    for (int step = 0; uni_bt_bredr_list_bonded_keys_step(step); step++) {
+    }
+}
+
+bool uni_bt_bredr_list_bonded_keys_step(int step) {
     bd_addr_t addr;
     link_key_t link_key;
     link_key_type_t type;
     btstack_link_key_iterator_t it;
+    bool found = false;
 
+    // The iterator is not kept between steps: the keys might change in the meantime.
     int ok = gap_link_key_iterator_init(&it);
     if (!ok) {
         loge("Link key iterator not implemented\n");
-        return;
+        return false;
     }
 
-    logi("Bluetooth BR/EDR keys:\n");
-    while (gap_link_key_iterator_get_next(&it, addr, link_key, &type)) {
-        logi("%s - type %u - key: ", bd_addr_to_str(addr), (int)type);
-        printf_hexdump(link_key, 16);
+    if (step == 0) {
+        logi("Bluetooth BR/EDR keys:\n");
+        found = true;
+    } else {
+        // Skip the keys printed in the previous steps.
+        for (int i = 0; i < step; i++) {
+            found = gap_link_key_iterator_get_next(&it, addr, link_key, &type);
+            if (!found)
+                break;
+        }
+        if (found) {
+            logi("%s - type %u - key: ", bd_addr_to_str(addr), (int)type);
+            printf_hexdump(link_key, 16);
+        }
     }
     gap_link_key_iterator_done(&it);
+    return found;
 }
 
 void uni_bt_bredr_setup(void) {
@@ -162,7 +269,7 @@ void uni_bt_bredr_setup(void) {
     // Needed for some incoming connections
     uni_bt_sdp_server_init();
 
-    l2cap_register_service(uni_bt_packet_handler, BLUETOOTH_PSM_HID_INTERRUPT, UNI_BT_L2CAP_CHANNEL_MTU,
+    l2cap_register_service(interrupt_packet_handler, BLUETOOTH_PSM_HID_INTERRUPT, UNI_BT_L2CAP_CHANNEL_MTU,
                            security_level);
     l2cap_register_service(uni_bt_packet_handler, BLUETOOTH_PSM_HID_CONTROL, UNI_BT_L2CAP_CHANNEL_MTU, security_level);
 
@@ -449,6 +556,7 @@ void uni_bt_bredr_on_l2cap_channel_opened(uint16_t channel, const uint8_t* packe
         case PSM_HID_INTERRUPT:
             device->conn.interrupt_cid = l2cap_event_channel_opened_get_local_cid(packet);
             logi("HID Interrupt opened, cid 0x%02x\n", device->conn.interrupt_cid);
+            interrupt_channel_bind(device->conn.interrupt_cid, device);
             uni_bt_conn_set_state(&device->conn, UNI_BT_CONN_STATE_L2CAP_INTERRUPT_CONNECTED);
 
             // Set "connected" only after PSM_HID_INTERRUPT.
@@ -469,6 +577,7 @@ void uni_bt_bredr_on_l2cap_channel_closed(uint16_t channel, const uint8_t* packe
 
     local_cid = l2cap_event_channel_closed_get_local_cid(packet);
     logi("L2CAP_EVENT_CHANNEL_CLOSED: 0x%04x (channel=0x%04x)\n", local_cid, channel);
+    interrupt_channel_unbind(local_cid);
     device = uni_hid_device_get_instance_for_cid(local_cid);
     if (device == NULL) {
         // Device might already been closed if the Control or Interrupt PSM was closed first.
@@ -480,8 +589,10 @@ void uni_bt_bredr_on_l2cap_channel_closed(uint16_t channel, const uint8_t* packe
     /* device is destroyed after this call, don't use it */
 }
 
-void uni_bt_bredr_on_l2cap_data_packet(uint16_t channel, const uint8_t* packet, uint16_t size) {
+void UNI_HOT_FUNC(uni_bt_bredr_on_l2cap_data_packet)(uint16_t channel, const uint8_t* packet, uint16_t size) {
     uni_hid_device_t* d;
+    // Not received by interrupt_packet_handler() when called directly. E.g: by the simulator.
+    uint32_t now = interrupt_packet_received_us ? interrupt_packet_received_us : uni_system_get_time_us();
 
     d = uni_hid_device_get_instance_for_cid(channel);
     if (d == NULL) {
@@ -498,9 +609,16 @@ void uni_bt_bredr_on_l2cap_data_packet(uint16_t channel, const uint8_t* packet,
 
     if (channel == d->conn.control_cid) {
         // Feature report
-        if (d->report_parser.parse_feature_report)
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+        // Skip the first byte which must be 0xa3, like the parser does
+        uni_hid_capture_on_feature_report(d, &packet[1], size - 1);
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+        if (d->report_parser.parse_feature_report) {
+            UNI_PROFILER_BEGIN(start);
             // Skip the first byte which must be 0xa3
             d->report_parser.parse_feature_report(d, &packet[1], size - 1);
+            UNI_PROFILER_END(d, UNI_PROFILER_STAGE_PARSE_FEATURE_REPORT, start);
+        }
         return;
     }
 
@@ -517,9 +635,13 @@ void uni_bt_bredr_on_l2cap_data_packet(uint16_t channel, const uint8_t* packet,
         return;
     }
 
+    uni_report_stats_on_report(&d->report_stats, now);
+
     // Skip the first byte, which is always 0xa1
     uni_hid_parse_input_report(d, &packet[1], size - 1);
     uni_hid_device_process_controller(d);
+
+    uni_report_stats_on_processed(&d->report_stats, uni_system_get_time_us() - now, false);
 }
 
 void uni_bt_bredr_on_gap_inquiry_result(uint16_t channel, const uint8_t* packet, uint16_t size) {
@@ -6,6 +6,7 @@
 
 #include <string.h>
 
+#include "uni_config.h"
 #include "uni_log.h"
 
 void uni_bt_conn_init(uni_bt_conn_t* conn) {
@@ -21,7 +22,7 @@ void uni_bt_conn_set_protocol(uni_bt_conn_t* conn, uni_bt_conn_protocol_t protoc
     conn->protocol = protocol;
 }
 
-uni_bt_conn_state_t uni_bt_conn_get_state(uni_bt_conn_t* conn) {
+uni_bt_conn_state_t UNI_HOT_FUNC(uni_bt_conn_get_state)(uni_bt_conn_t* conn) {
     return conn->state;
 }
 
@@ -71,12 +71,13 @@
 #include "uni_hid_device.h"
 #include "uni_log.h"
 #include "uni_property.h"
+#include "uni_system.h"
 
 static bool is_scanning;
 static bool ble_enabled;
 
 // Temporal space for SDP in BLE
-static uint8_t hid_descriptor_storage[512];
+static uint8_t hid_descriptor_storage[HID_MAX_DESCRIPTOR_LEN];
 static btstack_packet_callback_registration_t sm_event_callback_registration;
 
 /**
@@ -232,13 +233,19 @@ static void parse_report(uint8_t* packet, uint16_t size) {
         descriptor_data = hids_client_descriptor_storage_get_descriptor_data(hids_cid, service_index);
         descriptor_len = hids_client_descriptor_storage_get_descriptor_len(hids_cid, service_index);
 
-        uni_hid_device_set_hid_descriptor(device, descriptor_data, descriptor_len);
+        // If it doesn't fit, the device is being disconnected: drop the report.
+        if (uni_hid_device_set_hid_descriptor(device, descriptor_data, descriptor_len) ==
+            UNI_HID_DESCRIPTOR_HANDLE_NONE)
+            return;
     }
     report_data = gattservice_subevent_hid_report_get_report(packet);
     report_len = gattservice_subevent_hid_report_get_report_len(packet);
 
+    uint32_t now = uni_system_get_time_us();
+    uni_report_stats_on_report(&device->report_stats, now);
     uni_hid_parse_input_report(device, report_data, report_len);
     uni_hid_device_process_controller(device);
+    uni_report_stats_on_processed(&device->report_stats, uni_system_get_time_us() - now, false);
 }
 
 static void hids_client_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t* packet, uint16_t size) {
@@ -804,25 +811,34 @@ void uni_bt_le_on_hci_diconnection_complete(uint16_t channel, const uint8_t* pac
 }
 
 void uni_bt_le_list_bonded_keys(void) {
+    for (int step = 0; uni_bt_le_list_bonded_keys_step(step); step++) {
+    }
+}
+
+bool uni_bt_le_list_bonded_keys_step(int step) {
     bd_addr_t entry_address;
-    int i;
 
     if (!ble_enabled)
-        return;
+        return false;
 
-    logi("Bluetooth LE keys:\n");
+    if (step == 0) {
+        logi("Bluetooth LE keys:\n");
+        return true;
+    }
 
-    for (i = 0; i < le_device_db_max_count(); i++) {
-        int entry_address_type = (int)BD_ADDR_TYPE_UNKNOWN;
-        le_device_db_info(i, &entry_address_type, entry_address, NULL);
+    int i = step - 1;
+    if (i >= le_device_db_max_count()) {
+        logi(".\n");
+        return false;
+    }
 
-        // skip unused entries
-        if (entry_address_type == (int)BD_ADDR_TYPE_UNKNOWN)
-            continue;
+    int entry_address_type = (int)BD_ADDR_TYPE_UNKNOWN;
+    le_device_db_info(i, &entry_address_type, entry_address, NULL);
 
+    // skip unused entries
+    if (entry_address_type != (int)BD_ADDR_TYPE_UNKNOWN)
         logi("%s - type %u\n", bd_addr_to_str(entry_address), (int)entry_address_type);
-    }
-    logi(".\n");
+    return true;
 }
 
 void uni_bt_le_delete_bonded_keys(void) {
@@ -63,7 +63,8 @@
 #error "This file can only be compiled for ESP32, LibUSB or Pico W"
 #endif
 
-#define MAX_ATTRIBUTE_VALUE_SIZE 512  // Apparently PS4 has a 470-bytes report
+// Apparently PS4 has a 470-bytes report. Extra bytes for the Data Element headers.
+#define MAX_ATTRIBUTE_VALUE_SIZE (HID_MAX_DESCRIPTOR_LEN + 16)
 
 // Some old devices like "ThinkGeek 8-bitty Game Controller" takes a lot of time to respond
 // to SDP queries.
@@ -12,6 +12,7 @@
 #include "bt/uni_bt_service.gatt.h"
 #include "controller/uni_gamepad.h"
 #include "uni_common.h"
+#include "uni_config.h"
 #include "uni_log.h"
 #include "uni_system.h"
 #include "uni_version.h"
@@ -24,8 +25,10 @@
 // Max number of clients that can connect to the service at the same time.
 #define MAX_NR_CLIENT_CONNECTIONS 1
 
-// Don't know how to increate MTU for notification, so use the minimum which is 20 (23 - 3)
-#define NOTIFICATION_MTU 20
+// Notifications lose 3 bytes to the ATT opcode + attribute handle.
+#define NOTIFICATION_HEADER_SIZE 3
+// Payload available when the client didn't do an MTU exchange: 20 (23 - 3)
+#define NOTIFICATION_MIN_PAYLOAD (ATT_DEFAULT_MTU - NOTIFICATION_HEADER_SIZE)
 
 // Struct sent to the BLE client
 // A compact version of uni_hid_device_t.
@@ -39,22 +42,79 @@ typedef struct __attribute((packed)) {
     uint16_t controller_type;
     uni_controller_subtype_t controller_subtype;
 } compact_device_t;
-_Static_assert(sizeof(compact_device_t) <= NOTIFICATION_MTU, "compact_device_t too big");
+_Static_assert(sizeof(compact_device_t) <= NOTIFICATION_MIN_PAYLOAD, "compact_device_t too big");
+// "notified_mask" and "pending_mask" use one bit per device. Stream "seats" uses 8 bits.
+_Static_assert(CONFIG_BLUEPAD32_MAX_DEVICES <= 8, "Too many devices for notification mask");
+
+// Controller state stream.
+// Each notification has a 16-bit timestamp in milliseconds, followed by one entry per changed device:
+//  - uint8_t idx: device index
+//  - uint8_t fields: bitmask of the fields that are present, in the order listed below
+//  - the fields
+enum {
+    STREAM_FIELD_BUTTONS = BIT(0),       // uint16_t
+    STREAM_FIELD_MISC_BUTTONS = BIT(1),  // uint8_t
+    STREAM_FIELD_DPAD = BIT(2),          // uint8_t
+    STREAM_FIELD_AXIS_X = BIT(3),        // int8_t: axis / 4
+    STREAM_FIELD_AXIS_Y = BIT(4),        // int8_t: axis / 4
+    STREAM_FIELD_AXIS_RX = BIT(5),       // int8_t: axis / 4
+    STREAM_FIELD_AXIS_RY = BIT(6),       // int8_t: axis / 4
+    STREAM_FIELD_PEDALS = BIT(7),        // uint8_t brake / 4, uint8_t throttle / 4
+};
+#define STREAM_HEADER_SIZE 2
+// idx + fields + buttons + misc_buttons + dpad + 4 axis + 2 pedals
+#define STREAM_ENTRY_MAX_SIZE (1 + 1 + 2 + 1 + 1 + 4 + 2)
+
+// Rate is limited so that the stream never competes for airtime with the controllers.
+#define STREAM_DEFAULT_RATE_HZ 10
+#define STREAM_MAX_RATE_HZ 50
+
+// Quantized controller state, as sent in the stream.
+typedef struct {
+    uint16_t buttons;
+    uint8_t misc_buttons;
+    uint8_t dpad;
+    int8_t axis[4];
+    uint8_t pedals[2];
+} stream_state_t;
+
+// Read/write from the stream settings characteristic. Counters are read-only.
+typedef struct __attribute((packed)) {
+    uint8_t seats;        // bitmask of the device indexes to stream
+    uint8_t max_rate_hz;  // max notifications per second: 1 - STREAM_MAX_RATE_HZ
+    uint32_t frames_sent;
+    uint32_t frames_skipped;  // Changes that got replaced by a newer one before being sent
+} stream_settings_t;
 
 // client connection
 typedef struct {
     bool notification_enabled;
     uint16_t value_handle;
     hci_con_handle_t connection_handle;
+    // ATT MTU, as negotiated by the client. ATT_DEFAULT_MTU if no exchange took place.
+    uint16_t mtu;
+    bool stream_enabled;
 } client_connection_t;
 static client_connection_t client_connections[MAX_NR_CLIENT_CONNECTIONS];
 
 // Iterate all over the connected clients, but only one is supported. Hardcoded to 0, don't change.
 static int notification_connection_idx;
-// Iterate all over the connected controllers
-static int notification_device_idx;
 
 static compact_device_t compact_devices[CONFIG_BLUEPAD32_MAX_DEVICES];
+// Last state that was successfully sent to the client.
+// Only the entries that differ from it are notified.
+static compact_device_t notified_devices[CONFIG_BLUEPAD32_MAX_DEVICES];
+
+static struct {
+    stream_settings_t settings;
+    uint32_t last_frame_ms;
+    // Devices whose state changed since the last frame.
+    uint32_t pending_mask;
+    btstack_timer_source_t timer;
+    bool timer_armed;
+    stream_state_t current[CONFIG_BLUEPAD32_MAX_DEVICES];
+    stream_state_t streamed[CONFIG_BLUEPAD32_MAX_DEVICES];
+} stream;
 static bool service_enabled;
 
 // clang-format off
@@ -84,47 +144,286 @@ static uint16_t att_read_callback(hci_con_handle_t connection_handle,
                                   uint8_t* buffer,
                                   uint16_t buffer_size);
 static client_connection_t* connection_for_conn_handle(hci_con_handle_t conn_handle);
-static bool next_notify_device(void);
+static void reset_notified_devices(void);
 static void notify_client(void);
 static void maybe_notify_client();
+static void maybe_schedule_stream(void);
 
 static bool is_notify_client_valid(void) {
     return ((client_connections[notification_connection_idx].connection_handle != HCI_CON_HANDLE_INVALID) &&
             (client_connections[notification_connection_idx].notification_enabled));
 }
 
-static bool next_notify_device(void) {
-    // TODO: For simplicity, we send all 4 devices.
-    // But we should only send the connected ones.
-    notification_device_idx++;
-    if (notification_device_idx == CONFIG_BLUEPAD32_MAX_DEVICES) {
-        notification_device_idx = 0;
-        return true;
-    }
-    return false;
+static bool is_stream_client_valid(void) {
+    return ((client_connections[notification_connection_idx].connection_handle != HCI_CON_HANDLE_INVALID) &&
+            (client_connections[notification_connection_idx].stream_enabled));
 }
 
-static void notify_client(void) {
-    logd("Notifying client idx = %d, device idx = %d\n", notification_connection_idx, notification_device_idx);
+static void reset_compact_device(compact_device_t* cd, int idx) {
+    memset(cd, 0, sizeof(*cd));
+    cd->idx = idx;
+}
+
+static void set_compact_device_connected(compact_device_t* cd, const uni_hid_device_t* d) {
+    cd->vendor_id = d->vendor_id;
+    cd->product_id = d->product_id;
+    cd->controller_type = d->controller_type;
+    cd->controller_subtype = d->controller_subtype;
+    memcpy(cd->addr, d->conn.btaddr, 6);
+    cd->state = d->conn.state;
+    cd->incoming = d->conn.incoming;
+}
+
+static void set_compact_device_ready(compact_device_t* cd, const uni_hid_device_t* d) {
+    // Update the things that could have changed from "on_device_connected" callback.
+    cd->controller_subtype = d->controller_subtype;
+    cd->state = d->conn.connected;
+}
+
+static void reset_notified_devices(void) {
+    // Client starts with all slots empty. Only the non-empty ones will be notified.
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++)
+        reset_compact_device(&notified_devices[i], i);
+}
+
+// Returns true if a notification was sent.
+static bool notify_devices(client_connection_t* ctx) {
+    uint8_t payload[sizeof(compact_devices)];
+    uint32_t notified_mask = 0;
+    uint16_t max_len;
+    uint16_t len = 0;
+    bool pending = false;
     uint8_t status;
-    client_connection_t* ctx;
-    bool finish_round;
 
-    if (!is_notify_client_valid())
-        return;
+    // Pack as many changed devices as the MTU allows in one notification.
+    // Each entry has its own "idx", so the client knows which slot to update.
+    max_len = btstack_min(ctx->mtu - NOTIFICATION_HEADER_SIZE, sizeof(payload));
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        if (memcmp(&compact_devices[i], &notified_devices[i], sizeof(compact_devices[0])) == 0)
+            continue;
+        if (len + sizeof(compact_devices[0]) > max_len) {
+            pending = true;
+            break;
+        }
+        memcpy(&payload[len], &compact_devices[i], sizeof(compact_devices[0]));
+        len += sizeof(compact_devices[0]);
+        notified_mask |= BIT(i);
+    }
+
+    if (len == 0)
+        return false;
 
-    ctx = &client_connections[notification_connection_idx];
+    logd("Notifying client idx = %d, devices mask = %#x, len = %d\n", notification_connection_idx, notified_mask,
+         len);
 
-    // send
-    status = att_server_notify(ctx->connection_handle, ctx->value_handle,
-                               (const uint8_t*)&compact_devices[notification_device_idx], sizeof(compact_devices[0]));
+    status = att_server_notify(ctx->connection_handle, ctx->value_handle, payload, len);
     if (status != ERROR_CODE_SUCCESS) {
         loge("BLE Service: Failed to notify client, error: %#x\n", status);
+        // Entries remain "changed". Retry them as soon as possible, instead of waiting for
+        // the next change.
+        att_server_request_can_send_now_event(ctx->connection_handle);
+        return false;
+    }
+
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        if (notified_mask & BIT(i))
+            notified_devices[i] = compact_devices[i];
     }
 
-    finish_round = next_notify_device();
-    if (!finish_round)
+    // The stream might have been waiting for this "can send now" event as well.
+    if (pending || (ctx->stream_enabled && stream.pending_mask))
         att_server_request_can_send_now_event(ctx->connection_handle);
+    return true;
+}
+
+static int8_t stream_quantize_axis(int32_t value) {
+    // -512 / 511 -> -128 / 127
+    if (value < -AXIS_NORMALIZE_RANGE / 2)
+        value = -AXIS_NORMALIZE_RANGE / 2;
+    else if (value > AXIS_NORMALIZE_RANGE / 2 - 1)
+        value = AXIS_NORMALIZE_RANGE / 2 - 1;
+    return (int8_t)(value / 4);
+}
+
+static uint8_t stream_quantize_pedal(int32_t value) {
+    // 0 / 1023 -> 0 / 255
+    if (value < 0)
+        value = 0;
+    else if (value > AXIS_NORMALIZE_RANGE - 1)
+        value = AXIS_NORMALIZE_RANGE - 1;
+    return (uint8_t)(value / 4);
+}
+
+static void UNI_HOT_FUNC(stream_state_from_controller)(stream_state_t* st, const uni_controller_t* ctl) {
+    memset(st, 0, sizeof(*st));
+    if (ctl->klass != UNI_CONTROLLER_CLASS_GAMEPAD)
+        return;
+
+    const uni_gamepad_t* gp = &ctl->gamepad;
+    st->buttons = gp->buttons;
+    st->misc_buttons = gp->misc_buttons;
+    st->dpad = gp->dpad;
+    st->axis[0] = stream_quantize_axis(gp->axis_x);
+    st->axis[1] = stream_quantize_axis(gp->axis_y);
+    st->axis[2] = stream_quantize_axis(gp->axis_rx);
+    st->axis[3] = stream_quantize_axis(gp->axis_ry);
+    st->pedals[0] = stream_quantize_pedal(gp->brake);
+    st->pedals[1] = stream_quantize_pedal(gp->throttle);
+}
+
+// Encodes only the fields that differ between "prev" and "cur".
+// Returns the number of bytes written, or 0 if nothing changed.
+static uint8_t stream_encode_entry(uint8_t* buf, int idx, const stream_state_t* prev, const stream_state_t* cur) {
+    uint8_t fields = 0;
+    uint8_t len = 2;
+
+    if (cur->buttons != prev->buttons) {
+        fields |= STREAM_FIELD_BUTTONS;
+        little_endian_store_16(buf, len, cur->buttons);
+        len += 2;
+    }
+    if (cur->misc_buttons != prev->misc_buttons) {
+        fields |= STREAM_FIELD_MISC_BUTTONS;
+        buf[len++] = cur->misc_buttons;
+    }
+    if (cur->dpad != prev->dpad) {
+        fields |= STREAM_FIELD_DPAD;
+        buf[len++] = cur->dpad;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (cur->axis[i] != prev->axis[i]) {
+            fields |= STREAM_FIELD_AXIS_X << i;
+            buf[len++] = (uint8_t)cur->axis[i];
+        }
+    }
+    if (cur->pedals[0] != prev->pedals[0] || cur->pedals[1] != prev->pedals[1]) {
+        fields |= STREAM_FIELD_PEDALS;
+        buf[len++] = cur->pedals[0];
+        buf[len++] = cur->pedals[1];
+    }
+
+    if (fields == 0)
+        return 0;
+    buf[0] = idx;
+    buf[1] = fields;
+    return len;
+}
+
+static uint32_t stream_period_ms(void) {
+    return 1000 / stream.settings.max_rate_hz;
+}
+
+static void stream_timer_handler(btstack_timer_source_t* ts) {
+    ARG_UNUSED(ts);
+    stream.timer_armed = false;
+    if (stream.pending_mask && is_stream_client_valid())
+        att_server_request_can_send_now_event(client_connections[notification_connection_idx].connection_handle);
+}
+
+static void maybe_schedule_stream(void) {
+    uint32_t elapsed;
+    uint32_t period;
+
+    if (stream.timer_armed || !is_stream_client_valid())
+        return;
+
+    period = stream_period_ms();
+    elapsed = btstack_run_loop_get_time_ms() - stream.last_frame_ms;
+    if (elapsed >= period) {
+        att_server_request_can_send_now_event(client_connections[notification_connection_idx].connection_handle);
+        return;
+    }
+
+    // Too early. Coalesce all the changes until the next slot.
+    btstack_run_loop_set_timer_handler(&stream.timer, stream_timer_handler);
+    btstack_run_loop_set_timer(&stream.timer, period - elapsed);
+    btstack_run_loop_add_timer(&stream.timer);
+    stream.timer_armed = true;
+}
+
+static void notify_stream(client_connection_t* ctx) {
+    uint8_t payload[STREAM_HEADER_SIZE + CONFIG_BLUEPAD32_MAX_DEVICES * STREAM_ENTRY_MAX_SIZE];
+    uint32_t sent_mask = 0;
+    uint16_t max_len;
+    uint16_t len;
+    uint8_t status;
+    uint32_t now;
+
+    if (!stream.pending_mask)
+        return;
+
+    now = btstack_run_loop_get_time_ms();
+    if (now - stream.last_frame_ms < stream_period_ms()) {
+        // Woken up by another notification. Wait for our slot.
+        maybe_schedule_stream();
+        return;
+    }
+
+    little_endian_store_16(payload, 0, now & 0xffff);
+    len = STREAM_HEADER_SIZE;
+    max_len = btstack_min(ctx->mtu - NOTIFICATION_HEADER_SIZE, sizeof(payload));
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        if (!(stream.pending_mask & BIT(i)))
+            continue;
+        if (len + STREAM_ENTRY_MAX_SIZE > max_len)
+            break;
+        len += stream_encode_entry(&payload[len], i, &stream.streamed[i], &stream.current[i]);
+        sent_mask |= BIT(i);
+    }
+
+    if (len > STREAM_HEADER_SIZE) {
+        status = att_server_notify(ctx->connection_handle,
+                                   ATT_CHARACTERISTIC_4627C4A4_AC0E_46B9_B688_AFC5C1BF7F63_01_VALUE_HANDLE, payload, len);
+        if (status != ERROR_CODE_SUCCESS) {
+            loge("BLE Service: Failed to notify stream, error: %#x\n", status);
+            // Entries remain pending. Retry them as soon as possible.
+            att_server_request_can_send_now_event(ctx->connection_handle);
+            return;
+        }
+        stream.settings.frames_sent++;
+        stream.last_frame_ms = now;
+    }
+
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        if (sent_mask & BIT(i))
+            stream.streamed[i] = stream.current[i];
+    }
+    stream.pending_mask &= ~sent_mask;
+
+    // Devices that didn't fit go in the next slot.
+    if (stream.pending_mask)
+        maybe_schedule_stream();
+}
+
+static void stream_start(void) {
+    // Start from a snapshot of the connected controllers, as if they changed from "all released".
+    memset(stream.current, 0, sizeof(stream.current));
+    memset(stream.streamed, 0, sizeof(stream.streamed));
+    stream.pending_mask = 0;
+
+    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+        if (!(stream.settings.seats & BIT(i)))
+            continue;
+        uni_hid_device_t* d = uni_hid_device_get_instance_for_idx(i);
+        if (uni_bt_conn_get_state(&d->conn) != UNI_BT_CONN_STATE_DEVICE_READY)
+            continue;
+        stream_state_from_controller(&stream.current[i], &d->controller);
+        stream.pending_mask |= BIT(i);
+    }
+    maybe_schedule_stream();
+}
+
+static void notify_client(void) {
+    client_connection_t* ctx = &client_connections[notification_connection_idx];
+
+    if (ctx->connection_handle == HCI_CON_HANDLE_INVALID)
+        return;
+
+    // Device changes have priority over the stream: they are rare and small.
+    if (ctx->notification_enabled && notify_devices(ctx))
+        return;
+    if (ctx->stream_enabled)
+        notify_stream(ctx);
 }
 
 static void maybe_notify_client(void) {
@@ -176,8 +475,11 @@ static int att_write_callback(hci_con_handle_t con_handle,
             ctx->notification_enabled =
                 little_endian_read_16(buffer, 0) == GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION;
             ctx->value_handle = ATT_CHARACTERISTIC_4627C4A4_AC06_46B9_B688_AFC5C1BF7F63_01_VALUE_HANDLE;
-            if (ctx->notification_enabled)
+            if (ctx->notification_enabled) {
+                // New subscription: send a full snapshot of the non-empty slots.
+                reset_notified_devices();
                 att_server_request_can_send_now_event(ctx->connection_handle);
+            }
 
             logi("BLE Service: Notification enabled = %d for handle %#x\n", ctx->notification_enabled,
                  ctx->connection_handle);
@@ -245,6 +547,32 @@ static int att_write_callback(hci_con_handle_t con_handle,
             uni_system_reboot();
             return 1;
         }
+        case ATT_CHARACTERISTIC_4627C4A4_AC0E_46B9_B688_AFC5C1BF7F63_01_CLIENT_CONFIGURATION_HANDLE: {
+            // Controller state stream
+            ctx = connection_for_conn_handle(con_handle);
+            if (!ctx)
+                break;
+            ctx->stream_enabled =
+                little_endian_read_16(buffer, 0) == GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION;
+            if (ctx->stream_enabled)
+                stream_start();
+
+            logi("BLE Service: Stream enabled = %d for handle %#x\n", ctx->stream_enabled, ctx->connection_handle);
+            break;
+        }
+        case ATT_CHARACTERISTIC_4627C4A4_AC0F_46B9_B688_AFC5C1BF7F63_01_VALUE_HANDLE: {
+            // Controller state stream settings: seats + max rate. Counters are read-only.
+            if (buffer_size != 2 || offset != 0)
+                return 0;
+            uint8_t rate = buffer[1];
+            if (rate == 0 || rate > STREAM_MAX_RATE_HZ)
+                return 0;
+            stream.settings.seats = buffer[0];
+            stream.settings.max_rate_hz = rate;
+            if (is_stream_client_valid())
+                stream_start();
+            return 1;
+        }
         default:
             logi("BLE Service: Unsupported write to 0x%04x, len %u\n", att_handle, buffer_size);
             break;
@@ -284,9 +612,7 @@ static uint16_t att_read_callback(hci_con_handle_t connection_handle,
             return att_read_callback_handle_blob((const void*)compact_devices, (uint16_t)sizeof(compact_devices),
                                                  offset, buffer, buffer_size);
         case ATT_CHARACTERISTIC_4627C4A4_AC06_46B9_B688_AFC5C1BF7F63_01_VALUE_HANDLE:
-            // Notify all connected devices, only when there is a change, one at a time.
-            // Ideally it should be merged with the previous one, but don't know how to increase
-            // the MTU for the notify package.
+            // Notify the devices that changed, packed in as few notifications as the MTU allows.
             // Notify only. Read not supported.
             loge("BLE Service: 4627C4A4_AC06_46B9_B688_AFC5C1BF7F63 does not support read\n");
             break;
@@ -322,6 +648,14 @@ static uint16_t att_read_callback(hci_con_handle_t connection_handle,
             // Delete stored Bluetooth bond keys
             loge("BLE Service: 4627C4A4_AC0C_46B9_B688_AFC5C1BF7F63 does not support read\n");
             break;
+        case ATT_CHARACTERISTIC_4627C4A4_AC0E_46B9_B688_AFC5C1BF7F63_01_VALUE_HANDLE:
+            // Controller state stream. Notify only.
+            loge("BLE Service: 4627C4A4_AC0E_46B9_B688_AFC5C1BF7F63 does not support read\n");
+            break;
+        case ATT_CHARACTERISTIC_4627C4A4_AC0F_46B9_B688_AFC5C1BF7F63_01_VALUE_HANDLE:
+            // Controller state stream settings + counters
+            return att_read_callback_handle_blob((const uint8_t*)&stream.settings, (uint16_t)sizeof(stream.settings),
+                                                 offset, buffer, buffer_size);
 
         case ATT_CHARACTERISTIC_ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL_01_VALUE_HANDLE:
             break;
@@ -377,17 +711,20 @@ static void att_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t* p
             if (!ctx)
                 break;
             ctx->connection_handle = att_event_connected_get_handle(packet);
-            mtu = att_server_get_mtu(ctx->connection_handle);
-            logi("BLE Service: New client connected handle = %#x, mtu = %d\n", ctx->connection_handle, mtu);
+            ctx->mtu = att_server_get_mtu(ctx->connection_handle);
+            logi("BLE Service: New client connected handle = %#x, mtu = %d\n", ctx->connection_handle, ctx->mtu);
             break;
         case ATT_EVENT_MTU_EXCHANGE_COMPLETE:
-            mtu = att_event_mtu_exchange_complete_get_MTU(packet) - 3;
+            // The client initiates the exchange. BTstack answers with its max ATT buffer size,
+            // which is big enough to fit all the devices in one notification.
+            mtu = att_event_mtu_exchange_complete_get_MTU(packet);
             ctx = connection_for_conn_handle(att_event_mtu_exchange_complete_get_handle(packet));
             if (!ctx)
                 break;
+            ctx->mtu = btstack_max(mtu, ATT_DEFAULT_MTU);
+            logi("BLE Service: MTU exchange complete handle = %#x, mtu = %d\n", ctx->connection_handle, ctx->mtu);
             break;
         case ATT_EVENT_CAN_SEND_NOW:
-            printf_hexdump(packet, size);
             notify_client();
             break;
         case ATT_EVENT_DISCONNECTED:
@@ -397,6 +734,8 @@ static void att_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t* p
             logi("BLE Service: client disconnected, handle = %#x\n", ctx->connection_handle);
             memset(ctx, 0, sizeof(*ctx));
             ctx->connection_handle = HCI_CON_HANDLE_INVALID;
+            btstack_run_loop_remove_timer(&stream.timer);
+            stream.timer_armed = false;
             break;
         default:
             logi("BLE Service: Unsupported ATT_EVENT: %#x\n", hci_event_packet_get_type(packet));
@@ -406,7 +745,7 @@ static void att_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t* p
 
 /*
  * Configures the ATT Server with the pre-compiled ATT Database generated from the .gatt file.
- * Finally, it configures the advertisements.
+ * Advertisements are enabled later, by uni_bt_service_start().
  */
 void uni_bt_service_init(void) {
     logi("Starting Bluepad32 BLE service UUID: 4627C4A4-AC00-46B9-B688-AFC5C1BF7F63\n");
@@ -414,23 +753,33 @@ void uni_bt_service_init(void) {
     // Setup ATT server.
     att_server_init(profile_data, att_read_callback, att_write_callback);
 
-    // setup advertisements
-    uint16_t adv_int_min = 0x0030;
-    uint16_t adv_int_max = 0x0030;
-    uint8_t adv_type = 0;
-    bd_addr_t null_addr;
-
-    memset(null_addr, 0, 6);
     memset(compact_devices, 0, sizeof(compact_devices));
     memset(&client_connections, 0, sizeof(client_connections));
     for (int i = 0; i < MAX_NR_CLIENT_CONNECTIONS; i++)
         client_connections[i].connection_handle = HCI_CON_HANDLE_INVALID;
     for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++)
-        compact_devices[i].idx = i;
+        reset_compact_device(&compact_devices[i], i);
+    reset_notified_devices();
+
+    memset(&stream, 0, sizeof(stream));
+    stream.settings.seats = GENMASK(CONFIG_BLUEPAD32_MAX_DEVICES - 1, 0);
+    stream.settings.max_rate_hz = STREAM_DEFAULT_RATE_HZ;
 
     // register for ATT events
     att_server_register_packet_handler(att_packet_handler);
+}
+
+/*
+ * Configures and enables the advertisements. Until then, no client can connect, so no
+ * stream is sent either. Must be called after uni_bt_service_init().
+ */
+void uni_bt_service_start(void) {
+    uint16_t adv_int_min = 0x0030;
+    uint16_t adv_int_max = 0x0030;
+    uint8_t adv_type = 0;
+    bd_addr_t null_addr;
 
+    memset(null_addr, 0, 6);
     gap_advertisements_set_params(adv_int_min, adv_int_max, adv_type, 0, null_addr, 0x07, 0x00);
     gap_advertisements_set_data(adv_data_len, (uint8_t*)adv_data);
     gap_advertisements_enable(true);
@@ -454,9 +803,7 @@ void uni_bt_service_on_device_ready(const uni_hid_device_t* d) {
     if (idx < 0)
         return;
 
-    // Update the things that could have changed from "on_device_connected" callback.
-    compact_devices[idx].controller_subtype = d->controller_subtype;
-    compact_devices[idx].state = d->conn.connected;
+    set_compact_device_ready(&compact_devices[idx], d);
 
     maybe_notify_client();
 }
@@ -471,13 +818,7 @@ void uni_bt_service_on_device_connected(const uni_hid_device_t* d) {
     int idx = uni_hid_device_get_idx_for_instance(d);
     if (idx < 0)
         return;
-    compact_devices[idx].vendor_id = d->vendor_id;
-    compact_devices[idx].product_id = d->product_id;
-    compact_devices[idx].controller_type = d->controller_type;
-    compact_devices[idx].controller_subtype = d->controller_subtype;
-    memcpy(compact_devices[idx].addr, d->conn.btaddr, 6);
-    compact_devices[idx].state = d->conn.state;
-    compact_devices[idx].incoming = d->conn.incoming;
+    set_compact_device_connected(&compact_devices[idx], d);
 
     maybe_notify_client();
 }
@@ -492,8 +833,39 @@ void uni_bt_service_on_device_disconnected(const uni_hid_device_t* d) {
     int idx = uni_hid_device_get_idx_for_instance(d);
     if (idx < 0)
         return;
-    memset(&compact_devices[idx], 0, sizeof(compact_devices[0]));
-    compact_devices[idx].idx = idx;
+    reset_compact_device(&compact_devices[idx], idx);
+
+    // Let the stream client know that the controller was "released".
+    if (stream.settings.seats & BIT(idx)) {
+        memset(&stream.current[idx], 0, sizeof(stream.current[0]));
+        stream.pending_mask |= BIT(idx);
+        maybe_schedule_stream();
+    }
 
     maybe_notify_client();
 }
+
+void UNI_HOT_FUNC(uni_bt_service_on_controller_data)(const uni_hid_device_t* d) {
+    stream_state_t st;
+
+    // Must be called from BTstack task.
+    // Called for each input report, so bail out early when nobody is listening.
+    if (!service_enabled || !is_stream_client_valid())
+        return;
+
+    int idx = uni_hid_device_get_idx_for_instance(d);
+    if (idx < 0 || !(stream.settings.seats & BIT(idx)))
+        return;
+
+    stream_state_from_controller(&st, &d->controller);
+    if (memcmp(&st, &stream.current[idx], sizeof(st)) == 0)
+        return;
+
+    // Previous change was not sent yet. It gets replaced by this one.
+    if (stream.pending_mask & BIT(idx))
+        stream.settings.frames_skipped++;
+
+    stream.current[idx] = st;
+    stream.pending_mask |= BIT(idx);
+    maybe_schedule_stream();
+}
@@ -15,6 +15,7 @@
 #include "bt/uni_bt_le.h"
 #include "bt/uni_bt_service.h"
 #include "platform/uni_platform.h"
+#include "uni_boot.h"
 #include "uni_common.h"
 #include "uni_config.h"
 #include "uni_log.h"
@@ -53,6 +54,19 @@ static uint8_t setup_write_simple_pairing_mode(void) {
     return hci_send_cmd(&hci_write_simple_pairing_mode, true);
 }
 
+static void setup_service(void) {
+    // Platform can disable the service.
+    if (!IS_ENABLED(UNI_ENABLE_BLE) || !uni_bt_service_is_enabled())
+        return;
+
+    // The ATT server must be ready before any LE connection, since it handles the
+    // ATT requests of all of them.
+    uni_bt_service_init();
+
+    // Advertising, and the stream that depends on it, are not needed to get the first report.
+    uni_boot_defer(uni_bt_service_start);
+}
+
 static void setup_call_next_fn(void) {
     uint8_t status;
 
@@ -79,12 +93,13 @@ static void setup_call_next_fn(void) {
         // Populate global variable here, and just once.
         gap_local_bd_addr(uni_local_bd_addr);
 
+        UNI_BOOT_MARK(UNI_BOOT_PHASE_SETUP_COMPLETE);
+
         // Only after all BT setup is done, call on_init_complete()
         uni_get_platform()->on_init_complete();
+        UNI_BOOT_MARK(UNI_BOOT_PHASE_INIT_COMPLETE);
 
-        // Platform can disable the service.
-        if (IS_ENABLED(UNI_ENABLE_BLE) && uni_bt_service_is_enabled())
-            uni_bt_service_init();
+        setup_service();
     }
 }
 
@@ -109,6 +124,7 @@ void uni_bt_setup_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t*
     switch (event) {
         case BTSTACK_EVENT_STATE:
             if (btstack_event_state_get_state(packet) == HCI_STATE_WORKING) {
+                UNI_BOOT_MARK(UNI_BOOT_PHASE_HCI_WORKING);
                 setup_state = SETUP_STATE_BLUEPAD32_IN_PROGRESS;
 
                 setup_call_next_fn();
@@ -163,6 +179,7 @@ int uni_bt_setup(void) {
         loge("Failed to power on HCI, err = %x#\n", err);
         return UNI_ERROR_INIT_FAILED;
     }
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_HCI_POWER_ON);
 
     return UNI_ERROR_SUCCESS;
 }
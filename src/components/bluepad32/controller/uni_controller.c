@@ -3,6 +3,10 @@
 // http://retro.moe/unijoysticle2
 
 #include "controller/uni_controller.h"
+
+#include <string.h>
+
+#include "uni_config.h"
 #include "uni_log.h"
 
 void uni_controller_dump(const uni_controller_t* ctl) {
@@ -25,3 +29,59 @@ void uni_controller_dump(const uni_controller_t* ctl) {
     }
     logi(", battery=%d\n", ctl->battery);
 }
+
+uint32_t UNI_HOT_FUNC(uni_controller_get_changes)(const uni_controller_t* prev, const uni_controller_t* ctl) {
+    uint32_t changes = 0;
+
+    // New class (or first report): everything is new
+    if (prev->klass != ctl->klass)
+        return UNI_CONTROLLER_CHANGED_ALL;
+
+    if (prev->battery != ctl->battery)
+        changes |= UNI_CONTROLLER_CHANGED_BATTERY;
+
+    switch (ctl->klass) {
+        case UNI_CONTROLLER_CLASS_GAMEPAD: {
+            const uni_gamepad_t* old = &prev->gamepad;
+            const uni_gamepad_t* gp = &ctl->gamepad;
+            if (old->dpad != gp->dpad)
+                changes |= UNI_CONTROLLER_CHANGED_DPAD;
+            if (old->buttons != gp->buttons)
+                changes |= UNI_CONTROLLER_CHANGED_BUTTONS;
+            if (old->misc_buttons != gp->misc_buttons)
+                changes |= UNI_CONTROLLER_CHANGED_MISC_BUTTONS;
+            if (old->axis_x != gp->axis_x)
+                changes |= UNI_CONTROLLER_CHANGED_AXIS_X;
+            if (old->axis_y != gp->axis_y)
+                changes |= UNI_CONTROLLER_CHANGED_AXIS_Y;
+            if (old->axis_rx != gp->axis_rx)
+                changes |= UNI_CONTROLLER_CHANGED_AXIS_RX;
+            if (old->axis_ry != gp->axis_ry)
+                changes |= UNI_CONTROLLER_CHANGED_AXIS_RY;
+            if (old->brake != gp->brake || old->throttle != gp->throttle)
+                changes |= UNI_CONTROLLER_CHANGED_PEDALS;
+            if (memcmp(old->gyro, gp->gyro, sizeof(gp->gyro)) != 0 ||
+                memcmp(old->accel, gp->accel, sizeof(gp->accel)) != 0)
+                changes |= UNI_CONTROLLER_CHANGED_IMU;
+            break;
+        }
+        case UNI_CONTROLLER_CLASS_MOUSE:
+            // Deltas are relative: two identical reports with movement are still two movements
+            if (ctl->mouse.delta_x != 0 || ctl->mouse.delta_y != 0 || ctl->mouse.scroll_wheel != 0 ||
+                memcmp(&prev->mouse, &ctl->mouse, sizeof(ctl->mouse)) != 0)
+                changes |= UNI_CONTROLLER_CHANGED_DATA;
+            break;
+        case UNI_CONTROLLER_CLASS_KEYBOARD:
+            if (memcmp(&prev->keyboard, &ctl->keyboard, sizeof(ctl->keyboard)) != 0)
+                changes |= UNI_CONTROLLER_CHANGED_DATA;
+            break;
+        case UNI_CONTROLLER_CLASS_BALANCE_BOARD:
+            if (memcmp(&prev->balance_board, &ctl->balance_board, sizeof(ctl->balance_board)) != 0)
+                changes |= UNI_CONTROLLER_CHANGED_DATA;
+            break;
+        default:
+            break;
+    }
+
+    return changes;
+}
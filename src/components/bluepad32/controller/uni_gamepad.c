@@ -88,7 +88,8 @@ const uni_gamepad_mappings_t GAMEPAD_DEFAULT_MAPPINGS = {
 const int AXIS_NORMALIZE_RANGE = 1024;  // 10-bit resolution (1024)
 const int AXIS_THRESHOLD = (1024 / 8);
 
-static int32_t get_mappings_value_for_axis(uni_gamepad_mappings_axis_t axis_type, const uni_gamepad_t* gp) {
+static int32_t UNI_HOT_FUNC(get_mappings_value_for_axis)(uni_gamepad_mappings_axis_t axis_type,
+                                                         const uni_gamepad_t* gp) {
     switch (axis_type) {
         case UNI_GAMEPAD_MAPPINGS_AXIS_X:
             return gp->axis_x;
@@ -105,7 +106,8 @@ static int32_t get_mappings_value_for_axis(uni_gamepad_mappings_axis_t axis_type
     return -1;
 }
 
-static int32_t get_mappings_value_for_pedal(uni_gamepad_mappings_pedal_t pedal_type, const uni_gamepad_t* gp) {
+static int32_t UNI_HOT_FUNC(get_mappings_value_for_pedal)(uni_gamepad_mappings_pedal_t pedal_type,
+                                                          const uni_gamepad_t* gp) {
     switch (pedal_type) {
         case UNI_GAMEPAD_MAPPINGS_PEDAL_THROTTLE:
             return gp->throttle;
@@ -118,7 +120,7 @@ static int32_t get_mappings_value_for_pedal(uni_gamepad_mappings_pedal_t pedal_t
     return -1;
 }
 
-uni_gamepad_t uni_gamepad_remap(const uni_gamepad_t* gp) {
+uni_gamepad_t UNI_HOT_FUNC(uni_gamepad_remap)(const uni_gamepad_t* gp) {
     uni_gamepad_t new_gp = {0};
 
     // Quick return if using default mappings
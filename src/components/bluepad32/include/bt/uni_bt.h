@@ -26,6 +26,8 @@ int uni_bt_init(void);
 // List stored Bluetooth keys, created when a device get paired
 void uni_bt_list_keys_safe(void);
 void uni_bt_list_keys_unsafe(void);
+// Same as above, one key at a time. Call it with step = 0, 1, 2... until it returns false.
+bool uni_bt_list_keys_step_unsafe(int step);
 // Delete stored Bluetooth keys
 void uni_bt_del_keys_safe(void);
 void uni_bt_del_keys_unsafe(void);
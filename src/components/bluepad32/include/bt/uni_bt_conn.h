@@ -57,6 +57,8 @@ typedef struct {
 
     bool incoming;
     bool connected;
+    // Linux only: controller created by uni_simulator, without a real connection.
+    bool simulated;
 
     uni_bt_conn_state_t state;
     uni_bt_conn_protocol_t protocol;
@@ -30,6 +30,8 @@ void uni_bt_le_scan_stop(void);
 void uni_bt_le_disconnect(uni_hid_device_t* d);
 
 void uni_bt_le_list_bonded_keys(void);
+// Same as above, one key at a time. Call it with step = 0, 1, 2... until it returns false.
+bool uni_bt_le_list_bonded_keys_step(int step);
 void uni_bt_le_delete_bonded_keys(void);
 void uni_bt_le_setup(void);
 
@@ -14,6 +14,7 @@ extern "C" {
 #include "uni_hid_device.h"
 
 void uni_bt_service_init(void);
+void uni_bt_service_start(void);
 bool uni_bt_service_is_enabled();
 void uni_bt_service_set_enabled(bool enabled);
 
@@ -21,6 +22,8 @@ void uni_bt_service_set_enabled(bool enabled);
 void uni_bt_service_on_device_ready(const uni_hid_device_t* d);
 void uni_bt_service_on_device_connected(const uni_hid_device_t* d);
 void uni_bt_service_on_device_disconnected(const uni_hid_device_t* d);
+// Called on each input report. Streams the controller state to the BLE client, if subscribed.
+void uni_bt_service_on_controller_data(const uni_hid_device_t* d);
 
 #ifdef __cplusplus
 }
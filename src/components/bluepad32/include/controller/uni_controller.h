@@ -40,6 +40,32 @@ typedef enum {
     CONTROLLER_SUBTYPE_WII_BALANCE_BOARD
 } uni_controller_subtype_t;
 
+// Fields of uni_controller_t that changed since the previous report.
+// Passed to the platforms in "on_controller_data_changed".
+enum {
+    UNI_CONTROLLER_CHANGED_CLASS = BIT(0),
+    UNI_CONTROLLER_CHANGED_BATTERY = BIT(1),
+
+    // Gamepad
+    UNI_CONTROLLER_CHANGED_DPAD = BIT(2),
+    UNI_CONTROLLER_CHANGED_BUTTONS = BIT(3),
+    UNI_CONTROLLER_CHANGED_MISC_BUTTONS = BIT(4),
+    UNI_CONTROLLER_CHANGED_AXIS_X = BIT(5),
+    UNI_CONTROLLER_CHANGED_AXIS_Y = BIT(6),
+    UNI_CONTROLLER_CHANGED_AXIS_RX = BIT(7),
+    UNI_CONTROLLER_CHANGED_AXIS_RY = BIT(8),
+    UNI_CONTROLLER_CHANGED_PEDALS = BIT(9),  // Brake and/or throttle
+    UNI_CONTROLLER_CHANGED_IMU = BIT(10),    // Gyro and/or accelerometer
+
+    // Mouse, keyboard and balance board data.
+    // Always set when a mouse reports movement, since the deltas are relative.
+    UNI_CONTROLLER_CHANGED_DATA = BIT(11),
+
+    UNI_CONTROLLER_CHANGED_AXES = UNI_CONTROLLER_CHANGED_AXIS_X | UNI_CONTROLLER_CHANGED_AXIS_Y |
+                                  UNI_CONTROLLER_CHANGED_AXIS_RX | UNI_CONTROLLER_CHANGED_AXIS_RY,
+    UNI_CONTROLLER_CHANGED_ALL = BIT(12) - 1,
+};
+
 enum {
     // Matches spec which says "Null values indicate unknown battery status"
     UNI_CONTROLLER_BATTERY_NOT_AVAILABLE = 0,
@@ -62,6 +88,8 @@ typedef struct {
 } uni_controller_t;
 
 void uni_controller_dump(const uni_controller_t* ctl);
+// Returns a mask of UNI_CONTROLLER_CHANGED_xxx with the fields that are different in "ctl" compared to "prev".
+uint32_t uni_controller_get_changes(const uni_controller_t* prev, const uni_controller_t* ctl);
 
 #ifdef __cplusplus
 }
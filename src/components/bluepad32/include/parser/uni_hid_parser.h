@@ -5,8 +5,11 @@
 #ifndef UNI_HID_PARSER_H
 #define UNI_HID_PARSER_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "uni_common.h"
+
 // Forward declarations
 struct uni_hid_device_s;
 
@@ -40,6 +43,7 @@ typedef void (*report_set_player_leds_fn_t)(struct uni_hid_device_s* d, uint8_t
 typedef void (*report_set_lightbar_color_fn_t)(struct uni_hid_device_s* d, uint8_t r, uint8_t g, uint8_t b);
 typedef void (*report_set_rumble_fn_t)(struct uni_hid_device_s* d, uint8_t force, uint8_t duration);
 typedef void (*report_device_dump_t)(struct uni_hid_device_s* d);
+typedef bool (*report_does_name_match_fn_t)(struct uni_hid_device_s* d, const char* name);
 
 // Parsers should implement these optional functions:
 typedef struct {
@@ -63,6 +67,27 @@ typedef struct {
     report_device_dump_t device_dump;
 } uni_report_parser_t;
 
+// Max number of controller types handled by a single parser.
+// E.g: Switch parser handles Pro controller, JoyCon Left and JoyCon Right.
+#define UNI_HID_PARSER_MAX_TYPES 3
+
+enum {
+    // "does_name_match" is only tried when the controller type could not be guessed from VID/PID.
+    UNI_HID_PARSER_FLAG_NAME_MATCH_AS_FALLBACK = BIT(0),
+};
+
+// Each parser describes itself with one of these.
+// The ones included in the build are listed in uni_hid_parser.c. See "Parsers" in Kconfig.
+typedef struct {
+    const char* name;
+    // Controller types handled by the parser. Unused entries are CONTROLLER_TYPE_Unknown (0).
+    uint16_t types[UNI_HID_PARSER_MAX_TYPES];
+    // Optional. Guesses the controller from its Bluetooth name.
+    report_does_name_match_fn_t does_name_match;
+    uint32_t flags;
+    uni_report_parser_t report_parser;
+} uni_hid_parser_entry_t;
+
 void uni_hid_parse_input_report(struct uni_hid_device_s* d, const uint8_t* report, uint16_t report_len);
 int32_t uni_hid_parser_process_axis(hid_globals_t* globals, uint32_t value);
 int32_t uni_hid_parser_process_pedal(hid_globals_t* globals, uint32_t value);
@@ -70,4 +95,13 @@ uint8_t uni_hid_parser_process_hat(hid_globals_t* globals, uint32_t value);
 void uni_hid_parser_process_dpad(uint16_t usage, uint32_t value, uint8_t* dpad);
 uint8_t uni_hid_parser_hat_to_dpad(uint8_t hat);
 
+// Returns the parser that handles the controller type, or NULL if it is not included in the build.
+const uni_hid_parser_entry_t* uni_hid_parser_get_entry_for_type(uint16_t type);
+// Returns the first parser whose "does_name_match" matches the name, or NULL.
+// When "fallback" is true, only the parsers with UNI_HID_PARSER_FLAG_NAME_MATCH_AS_FALLBACK are tried.
+const uni_hid_parser_entry_t* uni_hid_parser_get_entry_for_name(struct uni_hid_device_s* d,
+                                                                const char* name,
+                                                                bool fallback);
+void uni_hid_parser_list_all(void);
+
 #endif  // UNI_HID_PARSER_H
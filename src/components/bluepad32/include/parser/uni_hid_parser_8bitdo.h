@@ -9,6 +9,8 @@
 
 #include "parser/uni_hid_parser.h"
 
+extern const uni_hid_parser_entry_t uni_hid_parser_8bitdo_entry;
+
 // 8Bitdo controllers
 void uni_hid_parser_8bitdo_init_report(struct uni_hid_device_s* d);
 void uni_hid_parser_8bitdo_parse_usage(struct uni_hid_device_s* d,
@@ -9,6 +9,8 @@
 
 #include "parser/uni_hid_parser.h"
 
+extern const uni_hid_parser_entry_t uni_hid_parser_android_entry;
+
 // Android devices
 void uni_hid_parser_android_init_report(struct uni_hid_device_s* d);
 void uni_hid_parser_android_parse_usage(struct uni_hid_device_s* d,
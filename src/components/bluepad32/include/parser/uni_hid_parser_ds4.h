@@ -9,6 +9,8 @@
 
 #include "parser/uni_hid_parser.h"
 
+extern const uni_hid_parser_entry_t uni_hid_parser_ds4_entry;
+
 // For DUALSHOCK 4 gamepads
 void uni_hid_parser_ds4_setup(struct uni_hid_device_s* d);
 void uni_hid_parser_ds4_init_report(struct uni_hid_device_s* d);
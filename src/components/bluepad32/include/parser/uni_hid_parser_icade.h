@@ -9,6 +9,8 @@
 
 #include "parser/uni_hid_parser.h"
 
+extern const uni_hid_parser_entry_t uni_hid_parser_icade_entry;
+
 // ION iCade setup.
 void uni_hid_parser_icade_setup(struct uni_hid_device_s* d);
 
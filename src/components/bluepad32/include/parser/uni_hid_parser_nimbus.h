@@ -9,6 +9,8 @@
 
 #include "parser/uni_hid_parser.h"
 
+extern const uni_hid_parser_entry_t uni_hid_parser_nimbus_entry;
+
 // For the Nimbus gamepad.
 void uni_hid_parser_nimbus_init_report(struct uni_hid_device_s* d);
 void uni_hid_parser_nimbus_parse_usage(struct uni_hid_device_s* d,
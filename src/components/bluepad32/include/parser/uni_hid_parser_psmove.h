@@ -10,6 +10,8 @@
 
 #include "parser/uni_hid_parser.h"
 
+extern const uni_hid_parser_entry_t uni_hid_parser_psmove_entry;
+
 // For PS Move controller
 void uni_hid_parser_psmove_setup(struct uni_hid_device_s* d);
 void uni_hid_parser_psmove_init_report(struct uni_hid_device_s* d);
@@ -9,6 +9,8 @@
 
 #include "parser/uni_hid_parser.h"
 
+extern const uni_hid_parser_entry_t uni_hid_parser_wii_entry;
+
 void uni_hid_parser_wii_setup(struct uni_hid_device_s* d);
 void uni_hid_parser_wii_init_report(struct uni_hid_device_s* d);
 void uni_hid_parser_wii_parse_input_report(struct uni_hid_device_s* d, const uint8_t* report, uint16_t len);
@@ -10,6 +10,8 @@
 
 #include "parser/uni_hid_parser.h"
 
+extern const uni_hid_parser_entry_t uni_hid_parser_xboxone_entry;
+
 // For Xbox Wireless Controllers
 bool uni_hid_parser_xboxone_does_name_match(struct uni_hid_device_s* d, const char* name);
 void uni_hid_parser_xboxone_setup(struct uni_hid_device_s* d);
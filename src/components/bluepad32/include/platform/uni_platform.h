@@ -56,6 +56,15 @@ struct uni_platform {
     // Indicates that a controller button, stick, gyro, etc. has changed.
     void (*on_controller_data)(uni_hid_device_t* d, uni_controller_t* ctl);
 
+    // Same as on_controller_data, but it also gets which fields changed since the previous
+    // report, as a mask of UNI_CONTROLLER_CHANGED_xxx. Takes precedence over on_controller_data.
+    void (*on_controller_data_changed)(uni_hid_device_t* d, uni_controller_t* ctl, uint32_t changes);
+
+    // Mask of UNI_CONTROLLER_CHANGED_xxx the platform is interested in.
+    // on_controller_data_changed is not called when none of them changed.
+    // 0 means that it is called for every report, even if nothing changed.
+    uint32_t controller_data_interest;
+
     // Return a property entry, or NULL if not supported.
     const uni_property_t* (*get_property)(uni_property_idx_t idx);
 
@@ -121,6 +121,13 @@ struct uni_platform_unijoysticle_gpio_config {
     gpio_num_t sync_irq[UNI_PLATFORM_UNIJOYSTICLE_SYNC_IRQ_MAX];
 };
 
+// How the Pot lines (Button 2 & 3) should be driven when a port gets updated.
+typedef enum {
+    UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_NORMAL,    // Same as the rest of the lines
+    UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_INVERTED,  // E.g.: C64 uses pull-ups for the Pot lines
+    UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_DISABLED,  // Don't touch them. E.g.: C64 in paddle mode
+} uni_platform_unijoysticle_pot_output_t;
+
 struct uni_platform_unijoysticle_variant {
     // The name of the variant: A500, C64, 800XL, etc.
     const char* name;
@@ -156,8 +163,8 @@ struct uni_platform_unijoysticle_variant {
     // Register console commands. Optional
     void (*register_console_cmds)(void);
 
-    // Set the pot values
-    void (*set_gpio_level_for_pot)(gpio_num_t gpio, bool value);
+    // How the pot lines should be driven. Optional. If not present, "normal" is used.
+    uni_platform_unijoysticle_pot_output_t (*get_pot_output)(void);
 
     // Process gamepad misc buttons
     // Returns "True" if the Misc buttons where processed. Otherwise, "False"
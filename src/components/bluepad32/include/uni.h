@@ -32,6 +32,7 @@ extern "C" {
 #include "parser/uni_hid_parser_keyboard.h"
 #include "parser/uni_hid_parser_mouse.h"
 #include "platform/uni_platform.h"
+#include "uni_boot.h"
 #include "uni_circular_buffer.h"
 #include "uni_console.h"
 #include "uni_hid_device.h"
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#ifndef UNI_BOOT_H
+#define UNI_BOOT_H
+
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+
+// Boot timeline and fast boot.
+//
+// - CONFIG_BLUEPAD32_BOOT_TIMELINE: records the timestamp of each boot phase, from main()
+//   until the first input report was delivered to the platform. Printed by
+//   uni_hid_device_dump_all(), and once the first report arrives, except on Pico W where the
+//   USB console is not open yet. There, use the "boot" console command.
+//   Timestamps are in microseconds since power-on on ESP32 and Pico W. Since an arbitrary
+//   point on Linux.
+//
+// - CONFIG_BLUEPAD32_FAST_BOOT: work that is not needed to get the first report (console,
+//   GATT service advertising, etc.) is deferred with uni_boot_defer(). It runs once the first
+//   report was delivered, or CONFIG_BLUEPAD32_FAST_BOOT_TIMEOUT_MS after the platform
+//   "on_init_complete" callback if no controller sent a report in the meantime.
+//
+// When both are disabled, UNI_BOOT_MARK() doesn't generate any code, and uni_boot_defer()
+// calls the function right away.
+
+#ifndef CONFIG_BLUEPAD32_FAST_BOOT_TIMEOUT_MS
+#define CONFIG_BLUEPAD32_FAST_BOOT_TIMEOUT_MS 5000
+#endif  // !CONFIG_BLUEPAD32_FAST_BOOT_TIMEOUT_MS
+
+// In the order they usually happen.
+typedef enum {
+    // Marked by the application, since they happen before uni_init().
+    UNI_BOOT_PHASE_MAIN,
+    UNI_BOOT_PHASE_STDIO_INIT,
+    // Pico W: includes the CYW43 WiFi + Bluetooth firmware download.
+    UNI_BOOT_PHASE_CYW43_INIT,
+
+    UNI_BOOT_PHASE_UNI_INIT,
+    UNI_BOOT_PHASE_PROPERTY_INIT,
+    UNI_BOOT_PHASE_PLATFORM_INIT,
+    UNI_BOOT_PHASE_HCI_POWER_ON,
+    UNI_BOOT_PHASE_UNI_INIT_DONE,
+    UNI_BOOT_PHASE_HCI_WORKING,
+    // Bluepad32 HCI commands sent, before calling "on_init_complete".
+    UNI_BOOT_PHASE_SETUP_COMPLETE,
+    // "on_init_complete" returned. Usually, scanning is enabled at this point.
+    UNI_BOOT_PHASE_INIT_COMPLETE,
+    UNI_BOOT_PHASE_FIRST_CONNECTION,
+    UNI_BOOT_PHASE_FIRST_READY,
+    // After the platform "on_controller_data" callback. E.g: the first pin update.
+    UNI_BOOT_PHASE_FIRST_REPORT,
+    UNI_BOOT_PHASE_DEFERRED_DONE,
+
+    UNI_BOOT_PHASE_COUNT,
+} uni_boot_phase_t;
+
+typedef void (*uni_boot_deferred_fn_t)(void);
+
+#if defined(CONFIG_BLUEPAD32_BOOT_TIMELINE) || defined(CONFIG_BLUEPAD32_FAST_BOOT)
+// Only the first mark of each phase is recorded. Cheap enough to be called from the hot path.
+#define UNI_BOOT_MARK(_phase) uni_boot_mark(_phase)
+#else
+#define UNI_BOOT_MARK(_phase) \
+    do {                      \
+    } while (0)
+#endif  // defined(CONFIG_BLUEPAD32_BOOT_TIMELINE) || defined(CONFIG_BLUEPAD32_FAST_BOOT)
+
+void uni_boot_mark(uni_boot_phase_t phase);
+
+// Fast boot: calls "fn" from the BTstack thread once the boot is complete.
+// Called right away if fast boot is disabled, or if the boot is already complete.
+void uni_boot_defer(uni_boot_deferred_fn_t fn);
+
+void uni_boot_dump(void);
+// Same as above, one line at a time. Call it with step = 0, 1, 2... until it returns false.
+bool uni_boot_dump_step(int step);
+
+#endif  // UNI_BOOT_H
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#ifndef UNI_CLOCK_SCALING_H
+#define UNI_CLOCK_SCALING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+// Pico W only: changes the system clock (clk_sys) according to the connection state.
+// - While at least one device is ready: CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ
+// - When no device is ready, after CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_DELAY_MS:
+//   CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ
+//
+// Enabled by defining CONFIG_BLUEPAD32_CLOCK_SCALING.
+//
+// The processing time of the input reports (from the L2CAP packet until the platform
+// updated its outputs) is recorded per clock, and printed by uni_hid_device_dump_all().
+
+#ifndef CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ
+#define CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ 200000
+#endif  // !CONFIG_BLUEPAD32_CLOCK_SCALING_ACTIVE_KHZ
+
+#ifndef CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ
+#define CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ 64000
+#endif  // !CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_KHZ
+
+#ifndef CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_DELAY_MS
+#define CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_DELAY_MS 3000
+#endif  // !CONFIG_BLUEPAD32_CLOCK_SCALING_IDLE_DELAY_MS
+
+struct uni_hid_device_s;
+
+void uni_clock_scaling_init(void);
+
+// Called from the HID code.
+void uni_clock_scaling_on_device_ready(struct uni_hid_device_s* d);
+void uni_clock_scaling_on_device_disconnected(struct uni_hid_device_s* d);
+void uni_clock_scaling_on_report_processed(uint32_t elapsed_us);
+
+// Uses "khz" regardless of the connection state. Useful to compare the processing
+// time at different clocks. 0 goes back to the automatic mode.
+// Returns 0 on success, -1 if "khz" is not valid.
+int uni_clock_scaling_set_fixed_khz(uint32_t khz);
+uint32_t uni_clock_scaling_get_khz(void);
+
+void uni_clock_scaling_dump(void);
+// Same as above, one line at a time. Call it with step = 0, 1, 2... until it returns false.
+bool uni_clock_scaling_dump_step(int step);
+
+#endif  // UNI_CLOCK_SCALING_H
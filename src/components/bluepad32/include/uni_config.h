@@ -18,6 +18,18 @@
 #error "Unsupported target platform"
 #endif
 
+// Functions in the input report hot path: from the L2CAP data packet until the platform gets the data.
+// On Pico W, when CONFIG_BLUEPAD32_HOT_PATH_IN_RAM is defined, they are placed in SRAM so that they don't
+// suffer XIP cache misses. Only the marked functions are moved: their callees must be marked as well,
+// otherwise they still run from flash. Inline functions and macros don't need it. Usage:
+//   void UNI_HOT_FUNC(my_func)(int arg) { ... }
+#if defined(CONFIG_TARGET_PICO_W) && defined(CONFIG_BLUEPAD32_HOT_PATH_IN_RAM)
+#include <pico/platform.h>
+#define UNI_HOT_FUNC(func_name) __not_in_flash_func(func_name)
+#else
+#define UNI_HOT_FUNC(func_name) func_name
+#endif
+
 // For more configurations, please look at the Kconfig file, or just do:
 // "idf.py menuconfig" -> "Component config" -> "Bluepad32"
 
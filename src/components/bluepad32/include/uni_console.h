@@ -10,4 +10,18 @@
 
 void uni_console_init(void);
 
-#endif  // UNI_CONSOLE_H
\ No newline at end of file
+// Pico W only.
+// Commands registered by the platform from its "register_console_cmds" callback.
+// ESP32 platforms use esp_console_cmd_register() instead.
+typedef struct {
+    const char* command;
+    const char* hint;  // Arguments. Printed by "help"
+    const char* help;
+    // Called from the BTstack thread. Should print no more than a few lines.
+    int (*func)(int argc, char** argv);
+} uni_console_cmd_t;
+
+// "cmd" must remain valid: it is not copied. Returns 0 on success.
+int uni_console_register_cmd(const uni_console_cmd_t* cmd);
+
+#endif  // UNI_CONSOLE_H
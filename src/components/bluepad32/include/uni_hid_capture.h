@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#ifndef UNI_HID_CAPTURE_H
+#define UNI_HID_CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "uni_hid_device.h"
+
+// HID traffic capture.
+//
+// Records the traffic of all the devices in a RAM ring, so that it can be dumped from the
+// console and replayed on Linux with the simulator: "--sim-replay=<file>".
+// Recording is enabled by defining CONFIG_BLUEPAD32_HID_CAPTURE. When the ring is full,
+// the oldest records are overwritten.
+//
+// Stream format. All numbers are little endian. "varint" is an unsigned LEB128.
+//   "BP32CAP" + version (1 byte)
+//   Records: varint body_len + body. The first byte of the body is: type << 4 | device idx
+//
+//   DEVICE:       vid (2), pid (2), cod (4), protocol (1), name_len (1), name, desc_len (2), desc
+//   INPUT_FULL:   timestamp_us (4), len (1), report
+//   INPUT_DELTA:  dt_us (varint), len (1), runs until the end of the body: skip (1), count (1), bytes
+//                 Bytes that are not in a run are the same as in the previous report of the device.
+//   OUTPUT_INTR:  dt_us (varint), len (1), report
+//   OUTPUT_CTRL:  dt_us (varint), len (1), report
+//   FEATURE:      dt_us (varint), len (1), report. Received on the HID Control channel.
+//                 E.g: the calibration of DualShock 4 and DualSense.
+//
+// "dt_us" is the time since the previous input / output / feature record, of any device.
+// Each device gets an INPUT_FULL record every UNI_HID_CAPTURE_KEYFRAME_INTERVAL input reports,
+// so the decoder can resync after the oldest records were overwritten.
+// Reports longer than UNI_HID_CAPTURE_MAX_REPORT_LEN are truncated. This bounds the
+// recording cost of each report.
+
+#ifndef CONFIG_BLUEPAD32_HID_CAPTURE_BUFFER_SIZE
+#define CONFIG_BLUEPAD32_HID_CAPTURE_BUFFER_SIZE 8192
+#endif  // !CONFIG_BLUEPAD32_HID_CAPTURE_BUFFER_SIZE
+
+// Version 2 added the FEATURE record. Version 1 streams can still be decoded.
+#define UNI_HID_CAPTURE_VERSION 2
+#define UNI_HID_CAPTURE_MAX_REPORT_LEN 128
+#define UNI_HID_CAPTURE_KEYFRAME_INTERVAL 64
+// Device idx is stored in 4 bits.
+#define UNI_HID_CAPTURE_MAX_DEVICES 16
+
+typedef enum {
+    UNI_HID_CAPTURE_RECORD_DEVICE = 1,
+    UNI_HID_CAPTURE_RECORD_INPUT_FULL,
+    UNI_HID_CAPTURE_RECORD_INPUT_DELTA,
+    UNI_HID_CAPTURE_RECORD_OUTPUT_INTR,
+    UNI_HID_CAPTURE_RECORD_OUTPUT_CTRL,
+    UNI_HID_CAPTURE_RECORD_FEATURE,
+} uni_hid_capture_record_type_t;
+
+typedef struct {
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint32_t cod;
+    uint8_t protocol;  // uni_bt_conn_protocol_t
+    char name[HID_MAX_NAME_LEN];
+    const uint8_t* hid_descriptor;  // Points to the decoded buffer
+    uint16_t hid_descriptor_len;
+} uni_hid_capture_device_t;
+
+typedef struct {
+    // A device was connected. Reports for "idx" belong to this device from now on.
+    void (*on_device)(void* context, int idx, const uni_hid_capture_device_t* device);
+    // "type" is either INPUT_FULL (for all input reports), OUTPUT_INTR, OUTPUT_CTRL or FEATURE.
+    // "timestamp_us" is 0 for the records that come before the first INPUT_FULL one.
+    void (*on_report)(void* context,
+                      int idx,
+                      uni_hid_capture_record_type_t type,
+                      uint32_t timestamp_us,
+                      const uint8_t* report,
+                      uint16_t len);
+} uni_hid_capture_decoder_t;
+
+void uni_hid_capture_init(void);
+void uni_hid_capture_set_enabled(bool enabled);
+bool uni_hid_capture_is_enabled(void);
+void uni_hid_capture_clear(void);
+
+// Called from the HID code.
+void uni_hid_capture_on_device(uni_hid_device_t* d);
+void uni_hid_capture_on_input_report(uni_hid_device_t* d, const uint8_t* report, uint16_t len);
+void uni_hid_capture_on_output_report(uni_hid_device_t* d, bool ctrl, const uint8_t* report, uint16_t len);
+void uni_hid_capture_on_feature_report(uni_hid_device_t* d, const uint8_t* report, uint16_t len);
+
+// Prints the stream as hex lines prefixed with "bp32cap:", plus the recorder stats.
+void uni_hid_capture_dump(void);
+// Same as above, a few lines at a time. Call it with step = 0, 1, 2... until it returns false.
+// Records added in the meantime are not part of the dump.
+bool uni_hid_capture_dump_step(int step);
+
+// Same as above, but can be called from other tasks, like the console.
+// They are executed on the BTstack thread.
+void uni_hid_capture_dump_safe(void);
+void uni_hid_capture_clear_safe(void);
+void uni_hid_capture_set_enabled_safe(bool enabled);
+
+// Decodes a stream. Records that can't be decoded because their previous records were
+// overwritten are skipped. Returns 0 on success, -1 if the stream is invalid.
+int uni_hid_capture_decode(const uint8_t* data, size_t len, const uni_hid_capture_decoder_t* decoder, void* context);
+
+#endif  // UNI_HID_CAPTURE_H
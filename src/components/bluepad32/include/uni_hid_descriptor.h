@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#ifndef UNI_HID_DESCRIPTOR_H
+#define UNI_HID_DESCRIPTOR_H
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+// HID descriptors are stored in a shared arena, instead of inline in each device.
+// Parsers that use the raw reports (e.g: Switch, Wii, DS4) don't need them, and identical
+// controllers share the same descriptor, since they are de-duplicated by content.
+
+// Max size of a HID descriptor that can be received.
+#define HID_MAX_DESCRIPTOR_LEN 1024
+
+// Average size of a HID descriptor used to size the arena automatically.
+#define HID_AVG_DESCRIPTOR_LEN 384
+
+// Total bytes reserved for all the HID descriptors. 0 means automatic: an average-size
+// descriptor per device.
+#if !defined(CONFIG_BLUEPAD32_HID_DESCRIPTOR_ARENA_SIZE) || (CONFIG_BLUEPAD32_HID_DESCRIPTOR_ARENA_SIZE == 0)
+#define UNI_HID_DESCRIPTOR_ARENA_SIZE (CONFIG_BLUEPAD32_MAX_DEVICES * HID_AVG_DESCRIPTOR_LEN)
+#else
+#define UNI_HID_DESCRIPTOR_ARENA_SIZE CONFIG_BLUEPAD32_HID_DESCRIPTOR_ARENA_SIZE
+#endif  // !defined(CONFIG_BLUEPAD32_HID_DESCRIPTOR_ARENA_SIZE) || ...
+
+// Handle to a descriptor in the arena. 0 means "no descriptor".
+typedef uint8_t uni_hid_descriptor_handle_t;
+#define UNI_HID_DESCRIPTOR_HANDLE_NONE 0
+
+// Returns a handle to a descriptor with the same content, adding it to the arena if needed.
+// Each call must be balanced with a call to uni_hid_descriptor_release().
+// Returns UNI_HID_DESCRIPTOR_HANDLE_NONE if there is no space left.
+uni_hid_descriptor_handle_t uni_hid_descriptor_acquire(const uint8_t* data, uint16_t len);
+void uni_hid_descriptor_release(uni_hid_descriptor_handle_t handle);
+// The returned pointer is valid until the next call to uni_hid_descriptor_release(), since
+// releasing a descriptor compacts the arena.
+const uint8_t* uni_hid_descriptor_get(uni_hid_descriptor_handle_t handle, uint16_t* len);
+void uni_hid_descriptor_dump(void);
+
+#endif  // UNI_HID_DESCRIPTOR_H
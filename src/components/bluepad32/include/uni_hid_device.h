@@ -13,9 +13,11 @@
 #include "controller/uni_controller.h"
 #include "parser/uni_hid_parser.h"
 #include "uni_circular_buffer.h"
+#include "uni_hid_descriptor.h"
+#include "uni_output_composer.h"
+#include "uni_report_stats.h"
 
 #define HID_MAX_NAME_LEN 240
-#define HID_MAX_DESCRIPTOR_LEN 512
 #define HID_DEVICE_MAX_PARSER_DATA 192
 #define HID_DEVICE_MAX_PLATFORM_DATA 192
 // HID_DEVICE_CONNECTION_TIMEOUT_MS includes the time from when the device is created until it is ready.
@@ -42,7 +44,7 @@ struct uni_hid_device_s {
     btstack_timer_source_t inquiry_remote_name_timer;
 
     // SDP
-    uint8_t hid_descriptor[HID_MAX_DESCRIPTOR_LEN];
+    uni_hid_descriptor_handle_t hid_descriptor;  // Use uni_hid_device_get_hid_descriptor() to get the data
     uint16_t hid_descriptor_len;
     // DualShock4 1st gen requires to do the SDP query before l2cap connect,
     // otherwise it won't work.
@@ -63,6 +65,7 @@ struct uni_hid_device_s {
     uint16_t controller_type;                     // type of controller. E.g: DualShock4, Switch, etc.
     uni_controller_subtype_t controller_subtype;  // sub-type of controller attached, used for Wii mostly
     uni_controller_t controller;                  // Data
+    uni_controller_t prev_controller;             // Data from the previous report, used to tell what changed
 
     // Functions used to parse the usage page/usage.
     uni_report_parser_t report_parser;
@@ -89,6 +92,12 @@ struct uni_hid_device_s {
     // Bluetooth connection info.
     uni_bt_conn_t conn;
 
+    // Input report rate, jitter and loss.
+    uni_report_stats_t report_stats;
+
+    // Rumble, lightbar and player LEDs, merged into one output report.
+    uni_output_composer_t output_composer;
+
     // Link to parent device. Used only when the device is a "virtual child".
     // Safe to assume that when parent != NULL, then it is a "virtual" device.
     // For example, the mouse implemented by DualShock4 has the "gamepad" as parent.
@@ -138,7 +147,8 @@ void uni_hid_device_delete(uni_hid_device_t* d);
 void uni_hid_device_set_cod(uni_hid_device_t* d, uint32_t cod);
 bool uni_hid_device_is_cod_supported(uint32_t cod);
 
-void uni_hid_device_set_hid_descriptor(uni_hid_device_t* d, const uint8_t* descriptor, int len);
+uni_hid_descriptor_handle_t uni_hid_device_set_hid_descriptor(uni_hid_device_t* d, const uint8_t* descriptor, int len);
+const uint8_t* uni_hid_device_get_hid_descriptor(uni_hid_device_t* d);
 bool uni_hid_device_has_hid_descriptor(uni_hid_device_t* d);
 
 void uni_hid_device_set_incoming(uni_hid_device_t* d, bool incoming);
@@ -154,6 +164,8 @@ void uni_hid_device_set_vendor_id(uni_hid_device_t* d, uint16_t vendor_id);
 uint16_t uni_hid_device_get_vendor_id(uni_hid_device_t* d);
 
 void uni_hid_device_dump_device(uni_hid_device_t* d);
+// Same as above, one section at a time. Call it with step = 0, 1, 2... until it returns false.
+bool uni_hid_device_dump_device_step(uni_hid_device_t* d, int step);
 void uni_hid_device_dump_all(void);
 
 bool uni_hid_device_guess_controller_type_from_name(uni_hid_device_t* d, const char* name);
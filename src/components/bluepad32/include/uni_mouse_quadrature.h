@@ -30,7 +30,7 @@ struct uni_mouse_quadrature_encoder_gpios {
 };
 
 /*
- * cpu_id indicates in which CPU the quadrature task runs.
+ * cpu_id is not used. Kept for compatibility: the waveforms are generated by hardware.
  * x1,x2: GPIOs for horizontal movement
  * y1,y2: GPIOs for vertical movement
  */
@@ -42,8 +42,13 @@ void uni_mouse_quadrature_update(int port_idx, int32_t dx, int32_t dy);
 void uni_mouse_quadrature_start(int port_idx);
 void uni_mouse_quadrature_pause(int port_idx);
 void uni_mouse_quadrature_deinit(void);
+// Prints the number of generated edges, edges/sec and dropped steps for the port.
+void uni_mouse_quadrature_dump(int port_idx);
 
 void uni_mouse_quadrature_set_scale_factor(float scale);
 float uni_mouse_quadrature_get_scale_factor(void);
 
+// Pico W only: the waveforms are clocked from clk_sys. Must be called after changing it.
+void uni_mouse_quadrature_on_sys_clock_changed(void);
+
 #endif  // UNI_MOUSE_QUADRATURE_H
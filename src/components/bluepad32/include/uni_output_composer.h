@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#ifndef UNI_OUTPUT_COMPOSER_H
+#define UNI_OUTPUT_COMPOSER_H
+
+#include <btstack.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "uni_common.h"
+
+// Per-device output state: rumble, lightbar and player LEDs.
+// Controllers like DualShock4 and DualSense send all of them in the same output report.
+// Instead of sending one report per change, the parsers store the desired values here, and
+// the composer sends a single report with all the pending changes, at most once per
+// run-loop iteration.
+
+struct uni_hid_device_s;
+struct uni_output_composer_s;
+
+enum {
+    UNI_OUTPUT_DIRTY_RUMBLE = BIT(0),
+    UNI_OUTPUT_DIRTY_LIGHTBAR = BIT(1),
+    UNI_OUTPUT_DIRTY_PLAYER_LEDS = BIT(2),
+};
+
+// Called by the composer to send the output report. "dirty" has the UNI_OUTPUT_DIRTY_ bits
+// that changed since the previous flush. The rest of the values should be sent as well,
+// since the controllers don't keep the ones that are not in the report.
+typedef void (*uni_output_composer_flush_fn_t)(struct uni_hid_device_s* d,
+                                               const struct uni_output_composer_s* c,
+                                               uint32_t dirty);
+
+typedef struct uni_output_composer_s {
+    // Desired state
+    uint8_t rumble;
+    uint8_t lightbar_red;
+    uint8_t lightbar_green;
+    uint8_t lightbar_blue;
+    uint8_t player_leds;
+
+    uint32_t dirty;
+    uni_output_composer_flush_fn_t flush;
+    btstack_timer_source_t flush_timer;
+    bool flush_scheduled;
+
+    // Stats
+    uint32_t requests;  // Total number of changes requested
+    uint32_t reports;   // Total number of output reports sent
+    uint32_t window_start_ms;
+    uint32_t window_requests;
+    uint32_t window_reports;
+    uint32_t saved_per_second;      // Reports saved during the last complete second
+    uint32_t max_saved_per_second;  // Max reports saved in a single second
+} uni_output_composer_t;
+
+// "flush" is NULL for devices that don't use the composer.
+void uni_output_composer_init(uni_output_composer_t* c, uni_output_composer_flush_fn_t flush);
+// Must be called before the device gets deleted.
+void uni_output_composer_deinit(uni_output_composer_t* c);
+
+void uni_output_composer_set_rumble(struct uni_hid_device_s* d, uint8_t value);
+void uni_output_composer_set_lightbar_color(struct uni_hid_device_s* d, uint8_t r, uint8_t g, uint8_t b);
+void uni_output_composer_set_player_leds(struct uni_hid_device_s* d, uint8_t leds);
+// Sends the pending changes now, if any, without waiting for the next run-loop iteration.
+void uni_output_composer_flush(struct uni_hid_device_s* d);
+
+void uni_output_composer_dump(const uni_output_composer_t* c);
+
+#endif  // UNI_OUTPUT_COMPOSER_H
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#ifndef UNI_PROFILER_H
+#define UNI_PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "uni_system.h"
+
+// Cycle accounting of the parser callbacks and the rest of the input report pipeline,
+// aggregated per controller type. Printed by uni_hid_device_dump_all().
+//
+// Samples are measured in cycles, and stored in nanoseconds using the clock in effect when
+// they were taken. Samples taken before and after a clock change can be aggregated.
+//
+// Enabled by defining CONFIG_BLUEPAD32_PROFILER. When disabled, the UNI_PROFILER_ macros
+// don't generate any code.
+
+struct uni_hid_device_s;
+
+typedef enum {
+    UNI_PROFILER_STAGE_INIT_REPORT,
+    UNI_PROFILER_STAGE_PARSE_INPUT_REPORT,
+    // HID descriptor walk, including the calls to "parse_usage"
+    UNI_PROFILER_STAGE_PARSE_USAGE,
+    UNI_PROFILER_STAGE_PARSE_FEATURE_REPORT,
+    UNI_PROFILER_STAGE_SET_PLAYER_LEDS,
+    UNI_PROFILER_STAGE_SET_LIGHTBAR_COLOR,
+    // Parsers that use the output composer only mark the value as dirty in the "set_" callbacks.
+    // The output report is built and sent later, in OUTPUT_FLUSH.
+    UNI_PROFILER_STAGE_SET_RUMBLE,
+    UNI_PROFILER_STAGE_OUTPUT_FLUSH,
+    UNI_PROFILER_STAGE_GAMEPAD_REMAP,
+    UNI_PROFILER_STAGE_ON_CONTROLLER_DATA,
+
+    UNI_PROFILER_STAGE_COUNT,
+} uni_profiler_stage_t;
+
+#ifdef CONFIG_BLUEPAD32_PROFILER
+// Usage:
+//   UNI_PROFILER_BEGIN(start);
+//   rp->parse_input_report(d, report, len);
+//   UNI_PROFILER_END(d, UNI_PROFILER_STAGE_PARSE_INPUT_REPORT, start);
+#define UNI_PROFILER_BEGIN(start) uint32_t start = uni_system_get_cycles()
+#define UNI_PROFILER_END(d, stage, start) uni_profiler_add((d), (stage), uni_system_get_cycles_since(start))
+#else
+#define UNI_PROFILER_BEGIN(start) \
+    do {                          \
+    } while (0)
+#define UNI_PROFILER_END(d, stage, start) \
+    do {                                  \
+    } while (0)
+#endif  // CONFIG_BLUEPAD32_PROFILER
+
+void uni_profiler_init(void);
+void uni_profiler_reset(void);
+void uni_profiler_add(struct uni_hid_device_s* d, uni_profiler_stage_t stage, uint32_t cycles);
+// Wraps the parser callbacks that are called from outside Bluepad32, like "set_rumble".
+// Must be called after d->report_parser is set.
+void uni_profiler_wrap_report_parser(struct uni_hid_device_s* d);
+void uni_profiler_dump(void);
+// Same as above, one line at a time. Call it with step = 0, 1, 2... until it returns false.
+bool uni_profiler_dump_step(int step);
+
+#endif  // UNI_PROFILER_H
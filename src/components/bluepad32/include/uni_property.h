@@ -47,6 +47,8 @@ typedef enum {
     UNI_PROPERTY_IDX_UNI_MOUSE_EMULATION,
     UNI_PROPERTY_IDX_UNI_SERIAL_NUMBER,
     UNI_PROPERTY_IDX_UNI_VENDOR,
+    // Appended, to keep the indexes of the previous ones.
+    UNI_PROPERTY_IDX_UNI_AUTOFIRE_DUTY,
     UNI_PROPERTY_IDX_UNI_LAST,
 
     // Should be the last one
@@ -84,6 +86,11 @@ typedef struct {
 void uni_property_set(uni_property_idx_t idx, uni_property_value_t value);
 uni_property_value_t uni_property_get(uni_property_idx_t idx);
 void uni_property_list_all(void);
+// Returns NULL if the property doesn't exist.
+const uni_property_t* uni_property_get_property_by_idx(uni_property_idx_t idx);
+const uni_property_t* uni_property_get_property_by_name(const char* name);
+// Prints "name = value".
+void uni_property_dump_property(const uni_property_t* p);
 void uni_property_init_debug(void);
 
 // Interface
@@ -91,5 +98,7 @@ void uni_property_init_debug(void);
 void uni_property_init(void);
 void uni_property_set_with_property(const uni_property_t* p, uni_property_value_t value);
 uni_property_value_t uni_property_get_with_property(const uni_property_t* p);
+// Writes the pending changes to storage, for the archs that defer them. E.g: Pico W.
+void uni_property_flush(void);
 
 #endif  // UNI_PROPERTY_H
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#ifndef UNI_REPORT_STATS_H
+#define UNI_REPORT_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-device input report statistics.
+// Used to find out the real report rate, jitter and loss of each controller
+// without having to hook a logic analyzer / sniffer.
+
+// Histogram of the inter-report interval, in power-of-two milliseconds buckets:
+// [0-1), [1-2), [2-4), [4-8), [8-16), [16-32), [32-64), [64-inf) ms
+#define UNI_REPORT_STATS_HISTOGRAM_BUCKETS 8
+
+typedef struct uni_report_stats_s {
+    uint32_t reports;  // Total number of input reports received
+    uint32_t last_report_us;
+    uint32_t min_interval_us;
+    uint32_t max_interval_us;
+    // Exponentially weighted moving average of the interval, in microseconds (alpha = 1/8).
+    uint32_t ewma_interval_us;
+    uint32_t histogram[UNI_REPORT_STATS_HISTOGRAM_BUCKETS];
+
+    // Sequence number related. Only valid for controllers that report one.
+    bool has_seq;
+    uint8_t last_seq;
+    uint32_t seq_lost;        // Reports that never arrived, based on gaps in the sequence number
+    uint32_t seq_duplicated;  // Reports that have the same sequence number as the previous one
+
+    // Time spent processing each report, from reception until the platform got it.
+    uint32_t processing_ewma_us;
+    uint32_t processing_max_us;
+    // Histogram of the processing time, in power-of-two microseconds buckets:
+    // [0-16), [16-32), [32-64), [64-128), [128-256), [256-512), [512-1024), [1024-inf) us
+    uint32_t processing_histogram[UNI_REPORT_STATS_HISTOGRAM_BUCKETS];
+    uint32_t fast_path_reports;  // Reports processed by the BR/EDR Interrupt fast-path
+} uni_report_stats_t;
+
+void uni_report_stats_reset(uni_report_stats_t* s);
+// Should be called once per received input report, before parsing it.
+void uni_report_stats_on_report(uni_report_stats_t* s, uint32_t now_us);
+// Should be called by the parsers that have a sequence number / counter in their reports.
+// "mask" is the counter's wrap-around mask (e.g.: 0x3f for a 6-bit counter), and "step" is
+// how much the counter is expected to increase between two consecutive reports.
+void uni_report_stats_on_sequence(uni_report_stats_t* s, uint8_t seq, uint8_t mask, uint8_t step);
+// Should be called once the report was parsed and delivered to the platform.
+void uni_report_stats_on_processed(uni_report_stats_t* s, uint32_t elapsed_us, bool fast_path);
+void uni_report_stats_dump(const uni_report_stats_t* s);
+
+#endif  // UNI_REPORT_STATS_H
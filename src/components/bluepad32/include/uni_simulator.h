@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#ifndef UNI_SIMULATOR_H
+#define UNI_SIMULATOR_H
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "uni_hid_device.h"
+
+// Linux only.
+// Simulated controllers, to benchmark Bluepad32 without a Bluetooth dongle.
+//
+// Enabled by defining CONFIG_BLUEPAD32_SIMULATOR, e.g: with "cmake -DBLUEPAD32_SIMULATOR=ON" on
+// Linux, plus "-DBLUEPAD32_SIMULATOR_SCRIPT=<script>" to change the default script.
+// When enabled, the Bluetooth controller is not used at all. Instead, scripted controllers
+// get injected right above L2CAP (BR/EDR) and GATT HOG (BLE):
+// - They get created / named / connected like the real ones.
+// - They answer to the requests that the parsers send while doing their setup.
+// - Once ready, they send input reports at the requested rate.
+//
+// The script is a comma-separated list of controllers: "<count>*<type>:<rate_hz>".
+// Both "count" and "rate_hz" are optional. E.g: "ds4:250,2*switch,wii:100,xbox".
+// Types: ds4, switch, wii, xbox.
+//
+// Command line options:
+//   --sim=<script>       Overrides CONFIG_BLUEPAD32_SIMULATOR_SCRIPT
+//   --sim-duration=<s>   Dumps the stats and exits after "s" seconds. 0 runs forever.
+//   --sim-latency=<ms>   Delay before a simulated controller answers a request.
+//   --sim-replay=<file>  Replays a HID capture instead of running the script, then dumps the
+//                        stats and exits. <file> is either the binary stream, or the console
+//                        output of the "capture dump" command. See uni_hid_capture.h.
+
+#ifndef CONFIG_BLUEPAD32_SIMULATOR_SCRIPT
+#define CONFIG_BLUEPAD32_SIMULATOR_SCRIPT "ds4,switch,wii,xbox"
+#endif
+
+int uni_simulator_init(int argc, const char** argv);
+// Called for each report that Bluepad32 sends to a simulated controller.
+void uni_simulator_on_output_report(uni_hid_device_t* d, uint16_t cid, const uint8_t* report, uint16_t len);
+void uni_simulator_dump(void);
+
+#endif  // UNI_SIMULATOR_H
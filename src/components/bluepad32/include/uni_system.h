@@ -5,10 +5,25 @@
 #ifndef UNI_SYSTEM_H
 #define UNI_SYSTEM_H
 
+#include <stdint.h>
+
 // Interface
 // Each arch needs to implement these functions
 
 // Reboots the microcontroller
 void uni_system_reboot(void);
 
+// Returns a monotonic timestamp in microseconds. Wraps around every ~71 minutes.
+uint32_t uni_system_get_time_us(void);
+
+// Cycle counter, to measure short intervals. Call uni_system_init_cycle_counter() before using it.
+// - ESP32: CPU cycle counter (CCOUNT)
+// - Pico W: SysTick, which counts CPU cycles. 24-bit: wraps around every ~130ms at 125MHz.
+// - Linux: nanoseconds
+void uni_system_init_cycle_counter(void);
+uint32_t uni_system_get_cycles(void);
+// Cycles elapsed since "start", taking care of the wrap-around.
+uint32_t uni_system_get_cycles_since(uint32_t start);
+uint32_t uni_system_get_cycles_per_us(void);
+
 #endif  // UNI_SYSTEM_H
@@ -5,31 +5,122 @@
 #include "parser/uni_hid_parser.h"
 
 #include "hid_usage.h"
+#include "parser/uni_hid_parser_8bitdo.h"
+#include "parser/uni_hid_parser_android.h"
+#include "parser/uni_hid_parser_atari.h"
+#include "parser/uni_hid_parser_ds3.h"
+#include "parser/uni_hid_parser_ds4.h"
+#include "parser/uni_hid_parser_ds5.h"
+#include "parser/uni_hid_parser_generic.h"
+#include "parser/uni_hid_parser_icade.h"
+#include "parser/uni_hid_parser_keyboard.h"
+#include "parser/uni_hid_parser_mouse.h"
+#include "parser/uni_hid_parser_nimbus.h"
+#include "parser/uni_hid_parser_ouya.h"
+#include "parser/uni_hid_parser_psmove.h"
+#include "parser/uni_hid_parser_smarttvremote.h"
+#include "parser/uni_hid_parser_steam.h"
+#include "parser/uni_hid_parser_switch.h"
+#include "parser/uni_hid_parser_wii.h"
+#include "parser/uni_hid_parser_xboxone.h"
+#include "uni_config.h"
+#include "uni_hid_capture.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
+#include "uni_profiler.h"
+
+// Parsers included in the build. All of them, unless CONFIG_BLUEPAD32_PARSERS_CUSTOM is defined.
+// The ones that are not listed here are not referenced, and get removed by the linker.
+// Order matters for uni_hid_parser_get_entry_for_name().
+static const uni_hid_parser_entry_t* const parsers[] = {
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_8BITDO)
+    &uni_hid_parser_8bitdo_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_ANDROID)
+    &uni_hid_parser_android_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_ATARI)
+    &uni_hid_parser_atari_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_DS3)
+    &uni_hid_parser_ds3_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_DS4)
+    &uni_hid_parser_ds4_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_DS5)
+    &uni_hid_parser_ds5_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_ICADE)
+    &uni_hid_parser_icade_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_KEYBOARD)
+    &uni_hid_parser_keyboard_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_MOUSE)
+    &uni_hid_parser_mouse_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_NIMBUS)
+    &uni_hid_parser_nimbus_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_OUYA)
+    &uni_hid_parser_ouya_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_PSMOVE)
+    &uni_hid_parser_psmove_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_SMARTTVREMOTE)
+    &uni_hid_parser_smarttvremote_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_STEAM)
+    &uni_hid_parser_steam_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_SWITCH)
+    &uni_hid_parser_switch_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_WII)
+    &uni_hid_parser_wii_entry,
+#endif
+#if !defined(CONFIG_BLUEPAD32_PARSERS_CUSTOM) || defined(CONFIG_BLUEPAD32_PARSER_XBOXONE)
+    &uni_hid_parser_xboxone_entry,
+#endif
+    // Always included: it is the fallback parser.
+    &uni_hid_parser_generic_entry,
+};
 
 // HID Usage Tables:
 // https://www.usb.org/sites/default/files/documents/hut1_12v2.pdf
 
-void uni_hid_parse_input_report(struct uni_hid_device_s* d, const uint8_t* report, uint16_t report_len) {
+void UNI_HOT_FUNC(uni_hid_parse_input_report)(struct uni_hid_device_s* d, const uint8_t* report, uint16_t report_len) {
     btstack_hid_parser_t parser;
 
     uni_report_parser_t* rp = &d->report_parser;
 
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+    uni_hid_capture_on_input_report(d, report, report_len);
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+
     // Certain devices like iCade might not set "init_report".
-    if (rp->init_report)
+    if (rp->init_report) {
+        UNI_PROFILER_BEGIN(start);
         rp->init_report(d);
+        UNI_PROFILER_END(d, UNI_PROFILER_STAGE_INIT_REPORT, start);
+    }
 
     // Certain devices like Nintendo Wii U Pro doesn't support HID descriptor.
     // For those kind of devices, just send the raw report.
     if (rp->parse_input_report) {
+        UNI_PROFILER_BEGIN(start);
         rp->parse_input_report(d, report, report_len);
+        UNI_PROFILER_END(d, UNI_PROFILER_STAGE_PARSE_INPUT_REPORT, start);
     }
 
     // Devices that suport regular HID reports.
     if (rp->parse_usage) {
-        btstack_hid_parser_init(&parser, d->hid_descriptor, d->hid_descriptor_len, HID_REPORT_TYPE_INPUT, report,
-                                report_len);
+        UNI_PROFILER_BEGIN(start);
+        btstack_hid_parser_init(&parser, uni_hid_device_get_hid_descriptor(d), d->hid_descriptor_len,
+                                HID_REPORT_TYPE_INPUT, report, report_len);
         while (btstack_hid_parser_has_more(&parser)) {
             uint16_t usage_page;
             uint16_t usage;
@@ -50,6 +141,7 @@ void uni_hid_parse_input_report(struct uni_hid_device_s* d, const uint8_t* repor
             logd("usage_page = 0x%04x, usage = 0x%04x, value = 0x%x\n", usage_page, usage, value);
             rp->parse_usage(d, &globals, usage_page, usage, value);
         }
+        UNI_PROFILER_END(d, UNI_PROFILER_STAGE_PARSE_USAGE, start);
     }
 }
 
@@ -176,3 +268,38 @@ uint8_t uni_hid_parser_hat_to_dpad(uint8_t hat) {
     }
     return dpad;
 }
+
+const uni_hid_parser_entry_t* uni_hid_parser_get_entry_for_type(uint16_t type) {
+    if (type == CONTROLLER_TYPE_Unknown)
+        return NULL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(parsers); i++) {
+        for (int j = 0; j < UNI_HID_PARSER_MAX_TYPES; j++) {
+            if (parsers[i]->types[j] == type)
+                return parsers[i];
+        }
+    }
+    return NULL;
+}
+
+const uni_hid_parser_entry_t* uni_hid_parser_get_entry_for_name(struct uni_hid_device_s* d,
+                                                                const char* name,
+                                                                bool fallback) {
+    for (size_t i = 0; i < ARRAY_SIZE(parsers); i++) {
+        const uni_hid_parser_entry_t* p = parsers[i];
+        if (!p->does_name_match)
+            continue;
+        if (fallback != !!(p->flags & UNI_HID_PARSER_FLAG_NAME_MATCH_AS_FALLBACK))
+            continue;
+        if (p->does_name_match(d, name))
+            return p;
+    }
+    return NULL;
+}
+
+void uni_hid_parser_list_all(void) {
+    logi("Parsers:");
+    for (size_t i = 0; i < ARRAY_SIZE(parsers); i++)
+        logi("%s%s", i == 0 ? " " : ", ", parsers[i]->name);
+    logi("\n");
+}
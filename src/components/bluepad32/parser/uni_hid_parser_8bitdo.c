@@ -7,6 +7,7 @@
 #include "controller/uni_controller.h"
 #include "hid_usage.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 // 8BitDo controllers support different "modes":
@@ -233,3 +234,13 @@ void uni_hid_parser_8bitdo_parse_usage(uni_hid_device_t* d,
             break;
     }
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_8bitdo_entry = {
+    .name = "8BITDO",
+    .types = {CONTROLLER_TYPE_8BitdoController},
+    .report_parser =
+        {
+            .init_report = uni_hid_parser_8bitdo_init_report,
+            .parse_usage = uni_hid_parser_8bitdo_parse_usage,
+        },
+};
@@ -11,6 +11,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 void uni_hid_parser_android_init_report(uni_hid_device_t* d) {
@@ -233,3 +234,14 @@ void uni_hid_parser_android_set_player_leds(uni_hid_device_t* d, uint8_t leds) {
     ARG_UNUSED(leds);
 #endif
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_android_entry = {
+    .name = "Android",
+    .types = {CONTROLLER_TYPE_AndroidController},
+    .report_parser =
+        {
+            .init_report = uni_hid_parser_android_init_report,
+            .parse_usage = uni_hid_parser_android_parse_usage,
+            .set_player_leds = uni_hid_parser_android_set_player_leds,
+        },
+};
@@ -11,6 +11,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 typedef struct __attribute((packed)) {
@@ -103,3 +104,14 @@ void uni_hid_parser_atari_parse_input_report(struct uni_hid_device_s* d, const u
             logi("Atari: Unknown report id = %x#\n", report[0]);
     }
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_atari_entry = {
+    .name = "Atari Joystick/Controller",
+    .types = {CONTROLLER_TYPE_AtariJoystick},
+    .report_parser =
+        {
+            .setup = uni_hid_parser_atari_setup,
+            .init_report = uni_hid_parser_atari_init_report,
+            .parse_input_report = uni_hid_parser_atari_parse_input_report,
+        },
+};
@@ -31,6 +31,7 @@ limitations under the License.
 #include "hid_usage.h"
 #include "uni_config.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 static const uint16_t DUALSHOCK3_VID = 0x054c;  // Sony
@@ -123,14 +124,14 @@ static ds3_instance_t* get_ds3_instance(uni_hid_device_t* d);
 static void ds3_update_led(uni_hid_device_t* d, uint8_t player_leds);
 static void ds3_send_output_report(uni_hid_device_t* d, ds3_output_report_t* out);
 
-void uni_hid_parser_ds3_init_report(uni_hid_device_t* d) {
+void UNI_HOT_FUNC(uni_hid_parser_ds3_init_report)(uni_hid_device_t* d) {
     uni_controller_t* ctl = &d->controller;
     memset(ctl, 0, sizeof(*ctl));
 
     ctl->klass = UNI_CONTROLLER_CLASS_GAMEPAD;
 }
 
-void uni_hid_parser_ds3_parse_input_report(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
+void UNI_HOT_FUNC(uni_hid_parser_ds3_parse_input_report)(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
     ds3_instance_t* ins = get_ds3_instance(d);
     if (ins->state == DS3_FSM_REQUIRES_LED_UPDATE) {
         ds3_update_led(d, ins->player_leds);
@@ -343,3 +344,17 @@ static void ds3_send_output_report(uni_hid_device_t* d, ds3_output_report_t* out
         uni_hid_device_send_intr_report(d, (uint8_t*)out, sizeof(*out));
     }
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_ds3_entry = {
+    .name = "DUALSHOCK3",
+    .types = {CONTROLLER_TYPE_PS3Controller},
+    .does_name_match = uni_hid_parser_ds3_does_name_match,
+    .report_parser =
+        {
+            .setup = uni_hid_parser_ds3_setup,
+            .init_report = uni_hid_parser_ds3_init_report,
+            .parse_input_report = uni_hid_parser_ds3_parse_input_report,
+            .set_player_leds = uni_hid_parser_ds3_set_player_leds,
+            .set_rumble = uni_hid_parser_ds3_set_rumble,
+        },
+};
@@ -17,6 +17,7 @@
 #include "hid_usage.h"
 #include "uni_config.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 #include "uni_utils.h"
 
@@ -53,12 +54,6 @@ typedef struct {
     int x_prev;
     int y_prev;
     bool prev_touch_active;
-
-    // Prev LED color and rumble values.
-    uint8_t prev_color_red;
-    uint8_t prev_color_green;
-    uint8_t prev_color_blue;
-    uint8_t prev_rumble;
 } ds4_instance_t;
 _Static_assert(sizeof(ds4_instance_t) < HID_DEVICE_MAX_PARSER_DATA, "DS4 instance too big");
 
@@ -194,11 +189,13 @@ static void ds4_request_calibration_report(uni_hid_device_t* d);
 static void ds4_request_firmware_version_report(uni_hid_device_t* d);
 static void ds4_send_enable_lightbar_report(uni_hid_device_t* d);
 static void ds4_set_rumble_off(btstack_timer_source_t* ts);
+static void ds4_flush_output(uni_hid_device_t* d, const uni_output_composer_t* c, uint32_t dirty);
 static void ds4_parse_mouse(uni_hid_device_t* d, const ds4_input_report_11_t* r);
 
 void uni_hid_parser_ds4_setup(struct uni_hid_device_s* d) {
     ds4_instance_t* ins = get_ds4_instance(d);
     memset(ins, 0, sizeof(*ins));
+    uni_output_composer_init(&d->output_composer, ds4_flush_output);
 
     // Default values for Accel / Gyro calibration data, until calibration is supported.
     for (size_t i = 0; i < ARRAY_SIZE(ins->accel_calib_data); i++) {
@@ -241,7 +238,7 @@ void uni_hid_parser_ds4_setup(struct uni_hid_device_s* d) {
     }
 }
 
-void uni_hid_parser_ds4_init_report(uni_hid_device_t* d) {
+void UNI_HOT_FUNC(uni_hid_parser_ds4_init_report)(uni_hid_device_t* d) {
     uni_controller_t* ctl = &d->controller;
     memset(ctl, 0, sizeof(*ctl));
 
@@ -355,7 +352,7 @@ void uni_hid_parser_ds4_parse_feature_report(uni_hid_device_t* d, const uint8_t*
     }
 }
 
-static void ds4_parse_input_report_01(uni_hid_device_t* d, const ds4_input_report_01_t* r) {
+static void UNI_HOT_FUNC(ds4_parse_input_report_01)(uni_hid_device_t* d, const ds4_input_report_01_t* r) {
     uni_controller_t* ctl = &d->controller;
 
     // Axis
@@ -404,7 +401,7 @@ static void ds4_parse_input_report_01(uni_hid_device_t* d, const ds4_input_repor
     ctl->gamepad.throttle = r->throttle * 4;
 }
 
-static void ds4_parse_input_report_11(uni_hid_device_t* d, const ds4_input_report_11_t* r) {
+static void UNI_HOT_FUNC(ds4_parse_input_report_11)(uni_hid_device_t* d, const ds4_input_report_11_t* r) {
     ds4_instance_t* ins = get_ds4_instance(d);
     uni_controller_t* ctl = &d->controller;
 
@@ -478,12 +475,15 @@ static void ds4_parse_input_report_11(uni_hid_device_t* d, const ds4_input_repor
     }
 }
 
-void uni_hid_parser_ds4_parse_input_report(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
+void UNI_HOT_FUNC(uni_hid_parser_ds4_parse_input_report)(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
     if (report[0] == 0x11 && len == 78) {
         const ds4_input_report_11_t* r = (ds4_input_report_11_t*)&report[3];
+        // Upper 6 bits of the 3rd button byte is the report counter.
+        uni_report_stats_on_sequence(&d->report_stats, r->buttons[2] >> 2, 0x3f, 1);
         ds4_parse_input_report_11(d, r);
     } else if (report[0] == 0x01 && len == 10) {
         const ds4_input_report_01_t* r = (ds4_input_report_01_t*)&report[1];
+        uni_report_stats_on_sequence(&d->report_stats, r->buttons[2] >> 2, 0x3f, 1);
         ds4_parse_input_report_01(d, r);
     } else {
         loge("DS4: Unexpected report type and len: report id=0x%02x, len=%d\n", report[0], len);
@@ -496,24 +496,8 @@ void uni_hid_parser_ds4_parse_input_report(uni_hid_device_t* d, const uint8_t* r
 // https://gitlab.com/ricardoquesada/bluepad32/-/blob/c32598f39831fd8c2fa2f73ff3c1883049caafc2/src/main/uni_hid_parser_ds4.c#L185
 
 void uni_hid_parser_ds4_set_lightbar_color(uni_hid_device_t* d, uint8_t r, uint8_t g, uint8_t b) {
-    ds4_instance_t* ins = get_ds4_instance(d);
-
-    // Сache the previous LED color values
-    ins->prev_color_red = r;
-    ins->prev_color_green = g;
-    ins->prev_color_blue = b;
-
-    ds4_output_report_t out = {
-        .flags = DS4_FF_FLAG_BLINK_COLOR_RUMBLE,  // blink + LED + motor
-        .led_red = r,
-        .led_green = g,
-        .led_blue = b,
-        // Prev rumble value to keep the rumble from turning off
-        .motor_right = ins->prev_rumble,
-        .motor_left = ins->prev_rumble,
-    };
-
-    ds4_send_output_report(d, &out);
+    // Sent together with the rest of the pending changes by ds4_flush_output().
+    uni_output_composer_set_lightbar_color(d, r, g, b);
 }
 
 void uni_hid_parser_ds4_set_rumble(uni_hid_device_t* d, uint8_t value, uint8_t duration) {
@@ -521,20 +505,7 @@ void uni_hid_parser_ds4_set_rumble(uni_hid_device_t* d, uint8_t value, uint8_t d
     if (ins->rumble_in_progress)
         return;
 
-    // Сache the previous rumble value
-    ins->prev_rumble = value;
-
-    ds4_output_report_t out = {
-        .flags = DS4_FF_FLAG_BLINK_COLOR_RUMBLE,  // blink + LED + motor
-        // Right motor: small force; left motor: big force
-        .motor_right = value,
-        .motor_left = value,
-        // Prev LED color values to keep the LED color from turning off
-        .led_red = ins->prev_color_red,
-        .led_green = ins->prev_color_green,
-        .led_blue = ins->prev_color_blue,
-    };
-    ds4_send_output_report(d, &out);
+    uni_output_composer_set_rumble(d, value);
 
     // Set timer to turn off rumble
     ins->rumble_timer.process = &ds4_set_rumble_off;
@@ -573,15 +544,22 @@ static void ds4_set_rumble_off(btstack_timer_source_t* ts) {
     assert(ins->rumble_in_progress);
     ins->rumble_in_progress = 0;
 
-    // Сache the previous rumble value
-    ins->prev_rumble = 0x00;
+    uni_output_composer_set_rumble(d, 0x00);
+}
+
+static void ds4_flush_output(uni_hid_device_t* d, const uni_output_composer_t* c, uint32_t dirty) {
+    ARG_UNUSED(dirty);
 
+    // The DS4 doesn't keep the values that are not in the report, so
+    // LED and motors are always sent, even if only one of them changed.
     ds4_output_report_t out = {
         .flags = DS4_FF_FLAG_BLINK_COLOR_RUMBLE,  // blink + LED + motor
-        // Prev LED color values to keep the LED color from turning off
-        .led_red = ins->prev_color_red,
-        .led_green = ins->prev_color_green,
-        .led_blue = ins->prev_color_blue,
+        // Right motor: small force; left motor: big force
+        .motor_right = c->rumble,
+        .motor_left = c->rumble,
+        .led_red = c->lightbar_red,
+        .led_green = c->lightbar_green,
+        .led_blue = c->lightbar_blue,
     };
     ds4_send_output_report(d, &out);
 }
@@ -614,27 +592,15 @@ static void ds4_request_firmware_version_report(uni_hid_device_t* d) {
 static void ds4_send_enable_lightbar_report(uni_hid_device_t* d) {
     logi("DS4: ds4_send_enable_lightbar_report()\n");
 
-    ds4_instance_t* ins = get_ds4_instance(d);
-
-    // Cache the previous LED color and rumble values
-    ins->prev_color_red = 0x00;
-    ins->prev_color_green = 0x00;
-    ins->prev_color_blue = 0x40;
-    ins->prev_rumble = 0x00;
-
     // Also turns off blinking, LED and rumble.
-    ds4_output_report_t out = {
-        // blink + LED + motor
-        .flags = DS4_FF_FLAG_BLINK_COLOR_RUMBLE,
-        // Default LED color: Blue
-        .led_red = ins->prev_color_red,
-        .led_green = ins->prev_color_green,
-        .led_blue = ins->prev_color_blue,
-    };
-    ds4_send_output_report(d, &out);
+    // Default LED color: Blue
+    uni_output_composer_set_lightbar_color(d, 0x00, 0x00, 0x40);
+    uni_output_composer_set_rumble(d, 0x00);
+    // Needed before the calibration report request, don't wait for the next run-loop iteration.
+    uni_output_composer_flush(d);
 }
 
-static void ds4_parse_mouse(uni_hid_device_t* d, const ds4_input_report_11_t* r) {
+static void UNI_HOT_FUNC(ds4_parse_mouse)(uni_hid_device_t* d, const ds4_input_report_11_t* r) {
     ds4_instance_t* ins = get_ds4_instance(d);
 
     // We can safely assume that device is connected and report is valid; otherwise
@@ -679,3 +645,18 @@ static void ds4_parse_mouse(uni_hid_device_t* d, const ds4_input_report_11_t* r)
 
     uni_hid_device_process_controller(d);
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_ds4_entry = {
+    .name = "DUALSHOCK4",
+    .types = {CONTROLLER_TYPE_PS4Controller},
+    .report_parser =
+        {
+            .setup = uni_hid_parser_ds4_setup,
+            .init_report = uni_hid_parser_ds4_init_report,
+            .parse_input_report = uni_hid_parser_ds4_parse_input_report,
+            .parse_feature_report = uni_hid_parser_ds4_parse_feature_report,
+            .set_lightbar_color = uni_hid_parser_ds4_set_lightbar_color,
+            .set_rumble = uni_hid_parser_ds4_set_rumble,
+            .device_dump = uni_hid_parser_ds4_device_dump,
+        },
+};
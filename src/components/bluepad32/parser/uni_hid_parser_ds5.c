@@ -14,6 +14,7 @@
 #include "uni_common.h"
 #include "uni_config.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 #include "uni_utils.h"
 
@@ -193,9 +194,10 @@ static void ds5_request_pairing_info_report(uni_hid_device_t* d);
 static void ds5_request_firmware_version_report(uni_hid_device_t* d);
 static void ds5_request_calibration_report(uni_hid_device_t* d);
 static void ds5_set_rumble_off(btstack_timer_source_t* ts);
+static void ds5_flush_output(uni_hid_device_t* d, const uni_output_composer_t* c, uint32_t dirty);
 static void ds5_parse_mouse(uni_hid_device_t* d, const uint8_t* report, uint16_t len);
 
-void uni_hid_parser_ds5_init_report(uni_hid_device_t* d) {
+void UNI_HOT_FUNC(uni_hid_parser_ds5_init_report)(uni_hid_device_t* d) {
     uni_controller_t* ctl = &d->controller;
     memset(ctl, 0, sizeof(*ctl));
 
@@ -213,6 +215,7 @@ void uni_hid_parser_ds5_init_report(uni_hid_device_t* d) {
 void uni_hid_parser_ds5_setup(uni_hid_device_t* d) {
     ds5_instance_t* ins = get_ds5_instance(d);
     memset(ins, 0, sizeof(*ins));
+    uni_output_composer_init(&d->output_composer, ds5_flush_output);
 
     // Default values for Accel / Gyro calibration data, until calibration is supported.
     for (size_t i = 0; i < ARRAY_SIZE(ins->accel_calib_data); i++) {
@@ -356,7 +359,7 @@ void uni_hid_parser_ds5_parse_feature_report(uni_hid_device_t* d, const uint8_t*
     }
 }
 
-void uni_hid_parser_ds5_parse_input_report(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
+void UNI_HOT_FUNC(uni_hid_parser_ds5_parse_input_report)(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
     ds5_instance_t* ins = get_ds5_instance(d);
 
     // Don't process reports until state is ready. Prevents possible div-by-0 on calibration
@@ -376,6 +379,8 @@ void uni_hid_parser_ds5_parse_input_report(uni_hid_device_t* d, const uint8_t* r
     uni_controller_t* ctl = &d->controller;
     const ds5_input_report_t* r = (ds5_input_report_t*)&report[2];
 
+    uni_report_stats_on_sequence(&d->report_stats, r->seq_number, 0xff, 1);
+
     // Axis
     ctl->gamepad.axis_x = (r->x - 127) * 4;
     ctl->gamepad.axis_y = (r->y - 127) * 4;
@@ -465,23 +470,11 @@ void uni_hid_parser_ds5_set_player_leds(struct uni_hid_device_s* d, uint8_t valu
         BIT(0) | BIT(1) | BIT(3) | BIT(4),  // Player 4
     };
 
-    ds5_output_report_t out = {
-        .player_leds = led_values[value % ARRAY_SIZE(led_values)],
-        .valid_flag1 = DS5_FLAG1_PLAYER_LED,
-    };
-
-    ds5_send_output_report(d, &out);
+    uni_output_composer_set_player_leds(d, led_values[value % ARRAY_SIZE(led_values)]);
 }
 
 void uni_hid_parser_ds5_set_lightbar_color(struct uni_hid_device_s* d, uint8_t r, uint8_t g, uint8_t b) {
-    ds5_output_report_t out = {
-        .lightbar_red = r,
-        .lightbar_green = g,
-        .lightbar_blue = b,
-        .valid_flag1 = DS5_FLAG1_LIGHTBAR,
-    };
-
-    ds5_send_output_report(d, &out);
+    uni_output_composer_set_lightbar_color(d, r, g, b);
 }
 
 void uni_hid_parser_ds5_set_rumble(struct uni_hid_device_s* d, uint8_t value, uint8_t duration) {
@@ -489,15 +482,7 @@ void uni_hid_parser_ds5_set_rumble(struct uni_hid_device_s* d, uint8_t value, ui
     if (ins->rumble_in_progress)
         return;
 
-    ds5_output_report_t out = {
-        .valid_flag0 = DS5_FLAG0_HAPTICS_SELECT | DS5_FLAG0_COMPATIBLE_VIBRATION,
-
-        // Right motor: small force; left motor: big force
-        .motor_right = value,
-        .motor_left = value,
-    };
-
-    ds5_send_output_report(d, &out);
+    uni_output_composer_set_rumble(d, value);
 
     // Set timer to turn off rumble
     ins->rumble_timer.process = &ds5_set_rumble_off;
@@ -546,9 +531,29 @@ static void ds5_set_rumble_off(btstack_timer_source_t* ts) {
     assert(ins->rumble_in_progress);
     ins->rumble_in_progress = 0;
 
-    ds5_output_report_t out = {
-        .valid_flag0 = DS5_FLAG0_COMPATIBLE_VIBRATION | DS5_FLAG0_HAPTICS_SELECT,
-    };
+    uni_output_composer_set_rumble(d, 0x00);
+}
+
+static void ds5_flush_output(uni_hid_device_t* d, const uni_output_composer_t* c, uint32_t dirty) {
+    // Unlike the DS4, the DS5 has "valid" flags. Only the parts that changed are sent.
+    ds5_output_report_t out = {0};
+
+    if (dirty & UNI_OUTPUT_DIRTY_RUMBLE) {
+        out.valid_flag0 |= DS5_FLAG0_HAPTICS_SELECT | DS5_FLAG0_COMPATIBLE_VIBRATION;
+        // Right motor: small force; left motor: big force
+        out.motor_right = c->rumble;
+        out.motor_left = c->rumble;
+    }
+    if (dirty & UNI_OUTPUT_DIRTY_LIGHTBAR) {
+        out.valid_flag1 |= DS5_FLAG1_LIGHTBAR;
+        out.lightbar_red = c->lightbar_red;
+        out.lightbar_green = c->lightbar_green;
+        out.lightbar_blue = c->lightbar_blue;
+    }
+    if (dirty & UNI_OUTPUT_DIRTY_PLAYER_LEDS) {
+        out.valid_flag1 |= DS5_FLAG1_PLAYER_LED;
+        out.player_leds = c->player_leds;
+    }
 
     ds5_send_output_report(d, &out);
 }
@@ -626,7 +631,7 @@ static void ds5_send_enable_lightbar_report(uni_hid_device_t* d) {
     }
 }
 
-static void ds5_parse_mouse(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
+static void UNI_HOT_FUNC(ds5_parse_mouse)(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
     ARG_UNUSED(len);
 
     ds5_instance_t* ins = get_ds5_instance(d);
@@ -668,3 +673,19 @@ static void ds5_parse_mouse(uni_hid_device_t* d, const uint8_t* report, uint16_t
 
     uni_hid_device_process_controller(d);
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_ds5_entry = {
+    .name = "DualSense",
+    .types = {CONTROLLER_TYPE_PS5Controller},
+    .report_parser =
+        {
+            .init_report = uni_hid_parser_ds5_init_report,
+            .setup = uni_hid_parser_ds5_setup,
+            .parse_input_report = uni_hid_parser_ds5_parse_input_report,
+            .parse_feature_report = uni_hid_parser_ds5_parse_feature_report,
+            .set_player_leds = uni_hid_parser_ds5_set_player_leds,
+            .set_lightbar_color = uni_hid_parser_ds5_set_lightbar_color,
+            .set_rumble = uni_hid_parser_ds5_set_rumble,
+            .device_dump = uni_hid_parser_ds5_device_dump,
+        },
+};
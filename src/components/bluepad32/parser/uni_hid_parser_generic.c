@@ -10,6 +10,7 @@
 
 #include "hid_usage.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 void uni_hid_parser_generic_init_report(uni_hid_device_t* d) {
@@ -202,3 +203,13 @@ void uni_hid_parser_generic_parse_usage(uni_hid_device_t* d,
             break;
     }
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_generic_entry = {
+    .name = "generic",
+    .types = {CONTROLLER_TYPE_GenericController},
+    .report_parser =
+        {
+            .init_report = uni_hid_parser_generic_init_report,
+            .parse_usage = uni_hid_parser_generic_parse_usage,
+        },
+};
@@ -7,6 +7,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 /*
@@ -301,3 +302,13 @@ void uni_hid_parser_icade_parse_usage(uni_hid_device_t* d,
 static icade_instance_t* get_icade_instance(uni_hid_device_t* d) {
     return (icade_instance_t*)&d->parser_data[0];
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_icade_entry = {
+    .name = "iCade",
+    .types = {CONTROLLER_TYPE_iCadeController},
+    .report_parser =
+        {
+            .setup = uni_hid_parser_icade_setup,
+            .parse_usage = uni_hid_parser_icade_parse_usage,
+        },
+};
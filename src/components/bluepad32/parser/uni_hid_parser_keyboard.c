@@ -11,6 +11,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 typedef struct {
@@ -97,3 +98,16 @@ void uni_hid_parser_keyboard_device_dump(struct uni_hid_device_s* d) {
 static keyboard_instance_t* get_keyboard_instance(uni_hid_device_t* d) {
     return (keyboard_instance_t*)&d->parser_data[0];
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_keyboard_entry = {
+    .name = "Keyboard",
+    .types = {CONTROLLER_TYPE_GenericKeyboard},
+    .report_parser =
+        {
+            .setup = uni_hid_parser_keyboard_setup,
+            .parse_input_report = uni_hid_parser_keyboard_parse_input_report,
+            .init_report = uni_hid_parser_keyboard_init_report,
+            .parse_usage = uni_hid_parser_keyboard_parse_usage,
+            .device_dump = uni_hid_parser_keyboard_device_dump,
+        },
+};
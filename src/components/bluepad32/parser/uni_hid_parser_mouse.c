@@ -11,6 +11,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 #define TANK_MOUSE_VID 0x248a
@@ -284,3 +285,16 @@ void uni_hid_parser_mouse_device_dump(struct uni_hid_device_s* d) {
     sprintf(buf, "\tmouse: scale=%f\n", ins->scale);
     logi(buf);
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_mouse_entry = {
+    .name = "Mouse",
+    .types = {CONTROLLER_TYPE_GenericMouse},
+    .report_parser =
+        {
+            .setup = uni_hid_parser_mouse_setup,
+            .parse_input_report = uni_hid_parser_mouse_parse_input_report,
+            .init_report = uni_hid_parser_mouse_init_report,
+            .parse_usage = uni_hid_parser_mouse_parse_usage,
+            .device_dump = uni_hid_parser_mouse_device_dump,
+        },
+};
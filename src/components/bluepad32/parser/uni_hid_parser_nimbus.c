@@ -7,6 +7,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 void uni_hid_parser_nimbus_init_report(uni_hid_device_t* d) {
@@ -155,3 +156,14 @@ void uni_hid_parser_nimbus_set_player_leds(uni_hid_device_t* d, uint8_t leds) {
     ARG_UNUSED(leds);
 #endif
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_nimbus_entry = {
+    .name = "Nimbus",
+    .types = {CONTROLLER_TYPE_NimbusController},
+    .report_parser =
+        {
+            .init_report = uni_hid_parser_nimbus_init_report,
+            .parse_usage = uni_hid_parser_nimbus_parse_usage,
+            .set_player_leds = uni_hid_parser_nimbus_set_player_leds,
+        },
+};
@@ -7,6 +7,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 void uni_hid_parser_ouya_init_report(uni_hid_device_t* d) {
@@ -135,3 +136,14 @@ void uni_hid_parser_ouya_set_player_leds(uni_hid_device_t* d, uint8_t leds) {
     ARG_UNUSED(leds);
 #endif
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_ouya_entry = {
+    .name = "OUYA",
+    .types = {CONTROLLER_TYPE_OUYAController},
+    .report_parser =
+        {
+            .init_report = uni_hid_parser_ouya_init_report,
+            .parse_usage = uni_hid_parser_ouya_parse_usage,
+            .set_player_leds = uni_hid_parser_ouya_set_player_leds,
+        },
+};
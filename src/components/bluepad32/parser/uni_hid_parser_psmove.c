@@ -15,6 +15,7 @@
 #include "hid_usage.h"
 #include "uni_config.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 #define ZCM1_PID 0x03d5
@@ -244,3 +245,16 @@ static void psmove_send_output_report(uni_hid_device_t* d, psmove_output_report_
     // uni_hid_device_send_ctrl_report(d, (uint8_t*)out, sizeof(*out));
     uni_hid_device_send_intr_report(d, (uint8_t*)out, sizeof(*out));
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_psmove_entry = {
+    .name = "PS Move",
+    .types = {CONTROLLER_TYPE_PSMoveController},
+    .report_parser =
+        {
+            .setup = uni_hid_parser_psmove_setup,
+            .init_report = uni_hid_parser_psmove_init_report,
+            .parse_input_report = uni_hid_parser_psmove_parse_input_report,
+            .set_lightbar_color = uni_hid_parser_psmove_set_lightbar_color,
+            .set_rumble = uni_hid_parser_psmove_set_rumble,
+        },
+};
@@ -10,6 +10,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 void uni_hid_parser_smarttvremote_init_report(uni_hid_device_t* d) {
@@ -108,3 +109,13 @@ void uni_hid_parser_smarttvremote_parse_usage(uni_hid_device_t* d,
             break;
     }
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_smarttvremote_entry = {
+    .name = "Smart TV remote",
+    .types = {CONTROLLER_TYPE_SmartTVRemoteController},
+    .report_parser =
+        {
+            .init_report = uni_hid_parser_smarttvremote_init_report,
+            .parse_usage = uni_hid_parser_smarttvremote_parse_usage,
+        },
+};
@@ -14,6 +14,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 // clang-format off
@@ -339,4 +340,15 @@ static void parse_right_pad(struct uni_hid_device_s* d, const uint8_t* data) {
 
     ctl->gamepad.axis_rx = (x >> 6);
     ctl->gamepad.axis_ry = (y >> 6);
-}
\ No newline at end of file
+}
+
+const uni_hid_parser_entry_t uni_hid_parser_steam_entry = {
+    .name = "Steam",
+    .types = {CONTROLLER_TYPE_SteamController},
+    .report_parser =
+        {
+            .setup = uni_hid_parser_steam_setup,
+            .init_report = uni_hid_parser_steam_init_report,
+            .parse_input_report = uni_hid_parser_steam_parse_input_report,
+        },
+};
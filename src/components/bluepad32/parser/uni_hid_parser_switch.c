@@ -24,7 +24,9 @@
 #include "controller/uni_controller.h"
 #include "hid_usage.h"
 #include "uni_common.h"
+#include "uni_config.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 // Support for Nintendo Switch Pro gamepad and JoyCons.
@@ -363,12 +365,14 @@ void uni_hid_parser_switch_setup(struct uni_hid_device_s* d) {
     process_fsm(d);
 }
 
-void uni_hid_parser_switch_init_report(uni_hid_device_t* d) {
+void UNI_HOT_FUNC(uni_hid_parser_switch_init_report)(uni_hid_device_t* d) {
     ARG_UNUSED(d);
     // Nothing
 }
 
-void uni_hid_parser_switch_parse_input_report(struct uni_hid_device_s* d, const uint8_t* report, uint16_t len) {
+void UNI_HOT_FUNC(uni_hid_parser_switch_parse_input_report)(struct uni_hid_device_s* d,
+                                                            const uint8_t* report,
+                                                            uint16_t len) {
     if (len < 12) {
         loge("Nintendo Switch: Invalid packet len; got %d, want >= 12\n", len);
         return;
@@ -694,7 +698,7 @@ static void process_input_subcmd_reply(struct uni_hid_device_s* d, const uint8_t
     process_fsm(d);
 }
 
-static void parse_imu(uni_hid_device_t* d, const struct switch_imu_data_s* r) {
+static void UNI_HOT_FUNC(parse_imu)(uni_hid_device_t* d, const struct switch_imu_data_s* r) {
     switch_instance_t* ins = get_switch_instance(d);
     uni_controller_t* ctl = &d->controller;
 
@@ -725,7 +729,7 @@ static void parse_imu(uni_hid_device_t* d, const struct switch_imu_data_s* r) {
 }
 
 // Process 0x30 input report: SWITCH_INPUT_IMU_DATA
-static void parse_report_30(struct uni_hid_device_s* d, const uint8_t* report, int len) {
+static void UNI_HOT_FUNC(parse_report_30)(struct uni_hid_device_s* d, const uint8_t* report, int len) {
     // Expecting something like:
     // (a1) 30 44 60 00 00 00 FD 87 7B 0E B8 70 00 6C FD FC FF 78 10 35 00 C1 FF
     // 9D FF 72 FD 01 00 72 10 35 00 C1 FF 9B FF 75 FD FF FF 6C 10 34 00 C2 FF
@@ -739,6 +743,10 @@ static void parse_report_30(struct uni_hid_device_s* d, const uint8_t* report, i
 
     const struct switch_report_30_s* r = (const struct switch_report_30_s*)&report[3];
 
+    // report[1] is the timer. It is incremented every 5ms, and the Pro Controller sends
+    // one report every 15ms.
+    uni_report_stats_on_sequence(&d->report_stats, report[1], 0xff, 3);
+
     switch (ins->controller_type) {
         case SWITCH_CONTROLLER_TYPE_JCL:
             parse_report_30_joycon_left(d, r);
@@ -765,7 +773,7 @@ static void parse_report_30(struct uni_hid_device_s* d, const uint8_t* report, i
 }
 
 // Shared both by Switch Pro Controller and Switch SNES.
-static void parse_report_30_pro_controller(uni_hid_device_t* d, const struct switch_report_30_s* r) {
+static void UNI_HOT_FUNC(parse_report_30_pro_controller)(uni_hid_device_t* d, const struct switch_report_30_s* r) {
     switch_instance_t* ins = get_switch_instance(d);
     uni_controller_t* ctl = &d->controller;
     // Buttons "right"
@@ -811,7 +819,7 @@ static void parse_report_30_pro_controller(uni_hid_device_t* d, const struct swi
     }
 }
 
-static void parse_report_30_joycon_left(uni_hid_device_t* d, const struct switch_report_30_s* r) {
+static void UNI_HOT_FUNC(parse_report_30_joycon_left)(uni_hid_device_t* d, const struct switch_report_30_s* r) {
     // JoyCons are treated as standalone controllers. So the buttons/axis are
     // "rotated".
     uni_controller_t* ctl = &d->controller;
@@ -840,7 +848,7 @@ static void parse_report_30_joycon_left(uni_hid_device_t* d, const struct switch
     ctl->gamepad.misc_buttons |= (r->buttons.buttons_misc & 0b00100000) ? MISC_BUTTON_START : 0;   // Capture
 }
 
-static void parse_report_30_joycon_right(uni_hid_device_t* d, const struct switch_report_30_s* r) {
+static void UNI_HOT_FUNC(parse_report_30_joycon_right)(uni_hid_device_t* d, const struct switch_report_30_s* r) {
     // JoyCons are treated as standalone controllers. So the buttons/axis are
     // "rotated".
     uni_controller_t* ctl = &d->controller;
@@ -1230,3 +1238,18 @@ void uni_hid_parser_switch_device_dump(uni_hid_device_t* d) {
     switch_instance_t* ins = get_switch_instance(d);
     logi("\tSwitch: FW version %d.%d\n", ins->firmware_version_hi, ins->firmware_version_lo);
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_switch_entry = {
+    .name = "Nintendo Switch",
+    .types = {CONTROLLER_TYPE_SwitchProController, CONTROLLER_TYPE_SwitchJoyConRight, CONTROLLER_TYPE_SwitchJoyConLeft},
+    .does_name_match = uni_hid_parser_switch_does_name_match,
+    .report_parser =
+        {
+            .setup = uni_hid_parser_switch_setup,
+            .init_report = uni_hid_parser_switch_init_report,
+            .parse_input_report = uni_hid_parser_switch_parse_input_report,
+            .set_player_leds = uni_hid_parser_switch_set_player_leds,
+            .set_rumble = uni_hid_parser_switch_set_rumble,
+            .device_dump = uni_hid_parser_switch_device_dump,
+        },
+};
@@ -23,6 +23,7 @@
 #include "hid_usage.h"
 #include "uni_common.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 #if ENABLE_EEPROM_DUMP
@@ -1371,3 +1372,17 @@ void uni_hid_parser_wii_device_dump(uni_hid_device_t* d) {
     wii_instance_t* ins = get_wii_instance(d);
     logi("\tWii: device '%s', extension '%s'\n", wii_devtype_names[ins->dev_type], wii_exttype_names[ins->ext_type]);
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_wii_entry = {
+    .name = "Wii controller",
+    .types = {CONTROLLER_TYPE_WiiController},
+    .report_parser =
+        {
+            .setup = uni_hid_parser_wii_setup,
+            .init_report = uni_hid_parser_wii_init_report,
+            .parse_input_report = uni_hid_parser_wii_parse_input_report,
+            .set_player_leds = uni_hid_parser_wii_set_player_leds,
+            .set_rumble = uni_hid_parser_wii_set_rumble,
+            .device_dump = uni_hid_parser_wii_device_dump,
+        },
+};
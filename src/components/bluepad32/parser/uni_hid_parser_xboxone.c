@@ -13,6 +13,7 @@
 #include "controller/uni_controller.h"
 #include "hid_usage.h"
 #include "uni_hid_device.h"
+#include "uni_hid_device_vendors.h"
 #include "uni_log.h"
 
 // Xbox doesn't report trigger buttons. Instead it reports throttle/brake.
@@ -500,3 +501,18 @@ void uni_hid_parser_xboxone_device_dump(uni_hid_device_t* d) {
 xboxone_instance_t* get_xboxone_instance(uni_hid_device_t* d) {
     return (xboxone_instance_t*)&d->parser_data[0];
 }
+
+const uni_hid_parser_entry_t uni_hid_parser_xboxone_entry = {
+    .name = "Xbox Wireless",
+    .types = {CONTROLLER_TYPE_XBoxOneController},
+    .does_name_match = uni_hid_parser_xboxone_does_name_match,
+    .flags = UNI_HID_PARSER_FLAG_NAME_MATCH_AS_FALLBACK,
+    .report_parser =
+        {
+            .setup = uni_hid_parser_xboxone_setup,
+            .init_report = uni_hid_parser_xboxone_init_report,
+            .parse_usage = uni_hid_parser_xboxone_parse_usage,
+            .set_rumble = uni_hid_parser_xboxone_set_rumble,
+            .device_dump = uni_hid_parser_xboxone_device_dump,
+        },
+};
@@ -9,6 +9,7 @@
 #include "platform/uni_platform_custom.h"
 #include "platform/uni_platform_mightymiggy.h"
 #include "platform/uni_platform_nina.h"
+#include "uni_config.h"
 #include "uni_log.h"
 
 #ifdef CONFIG_BLUEPAD32_PLATFORM_UNIJOYSTICLE
@@ -46,7 +47,7 @@ void uni_platform_init(int argc, const char** argv) {
     _platform->init(argc, argv);
 }
 
-struct uni_platform* uni_get_platform(void) {
+struct uni_platform* UNI_HOT_FUNC(uni_get_platform)(void) {
     return _platform;
 }
 
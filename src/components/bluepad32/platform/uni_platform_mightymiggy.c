@@ -4,12 +4,24 @@
 #include "platform/uni_platform_mightymiggy.h"
 
 #include <driver/gpio.h>
+#include <esp_idf_version.h>
+#include <esp_rom_gpio.h>
 #include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <freertos/queue.h>
+#if ESP_IDF_VERSION_MAJOR == 4
+#include <driver/periph_ctrl.h>
+#include <hal/cpu_hal.h>
+#else
+#include <esp_cpu.h>
+#include <esp_private/periph_ctrl.h>
+#endif
+#include <hal/spi_ll.h>
 #include <nvs.h>
 #include <nvs_flash.h>
+#include <soc/gpio_sig_map.h>
+#include <soc/spi_periph.h>
 
 #include "sdkconfig.h"
 
@@ -70,6 +82,16 @@ static const unsigned int PEDAL_THRESHOLD = 800;
  * means to measure how long they take to execute fully, by using a logic
  * analyzer or oscilloscope.
  *
+ * In CD32 mode, #PIN_INTERRUPT_TIMING stays high from the moment the MODE ISR
+ * is entered until the shift register has been preloaded. The distance between
+ * its falling edge and the first clock pulse from the console is the timing
+ * margin. The number of bits clocked out in each read and the worst preload
+ * time are also collected and logged periodically.
+ *
+ * The time between a controller report being received and the DB-9 port pins
+ * being updated accordingly (report-to-port latency) is also measured for both
+ * seats, together with the number of reports that could not be queued.
+ *
  * Disabled by default.
  */
 //~ #define ENABLE_INSTRUMENTATION
@@ -85,6 +107,36 @@ static const gpio_num_t PIN_INTERRUPT_TIMING = GPIO_NUM_0;
 static const gpio_num_t PIN_CD32MODE = GPIO_NUM_4;
 #endif
 
+#ifdef ENABLE_CD32_SUPPORT
+/** \name SPI peripherals used as CD32 shift registers
+ *
+ * In CD32 mode the button status is shifted out by an SPI peripheral in slave
+ * mode: the console's clock is SCLK, the MODE pin is CS and the data goes out
+ * on MISO (button 2 pin). No interrupt is needed for each clock edge.
+ *
+ * The spi_slave driver is not used: it is transaction based, and it would need
+ * a task to queue them. The peripheral is configured and armed directly.
+ */
+//! @{
+static const spi_host_device_t CD32_SPI_HOST_PORT_A = SPI2_HOST;
+static const spi_host_device_t CD32_SPI_HOST_PORT_B = SPI3_HOST;
+
+/** \brief SPI mode used for CD32 shifting
+ *
+ * CPHA=0: the first bit is output as soon as CS (MODE) goes low, and the
+ * following ones on the trailing clock edge, which is the rising one for CPOL=1.
+ */
+#define CD32_SPI_MODE 2
+
+/** \brief Bits preloaded into the shift register
+ *
+ * 7 buttons + the 2-bit ID sequence, plus some margin, since extra clocks shall
+ * report buttons as pressed.
+ */
+#define CD32_SHIFT_BITS 16
+//! @}
+#endif
+
 static const char* STORAGE_NAMESPACE = "storage";
 
 static const char* NVS_KEY_CONFIG = "config";
@@ -549,7 +601,53 @@ enum {
 
 static EventGroupHandle_t evGrpCd32;
 
-static QueueHandle_t controllerUpdateQueue = NULL;
+/** \brief Events processed by loopCore0()
+ *
+ * Everything the controller state machines react to is delivered as one of
+ * these, there is no periodic polling.
+ */
+typedef enum {
+    MM_EVENT_CONTROLLER_DATA,  //!< New report received from a controller
+    MM_EVENT_DEADLINE,         //!< A time-driven transition (timeout, debounce, blink...) is due
+    MM_EVENT_PORT,             //!< An ISR changed the state of a port (i.e.: CD32 mode exited)
+    MM_EVENT_SWAP_BUTTON,      //!< SWAP button pressed
+} MmEventType;
+
+typedef struct {
+    MmEventType type;
+
+    //! \brief Controller the event refers to, NULL if none
+    RuntimeControllerInfo* cinfo;
+
+    //! \brief Time the event was generated at, in microseconds
+    int64_t timestamp;
+} MmEvent;
+
+static QueueHandle_t eventQueue = NULL;
+
+//! \brief Number of seats, i.e.: DB-9 ports
+#define SEATS_NO 2
+
+/** \brief Time at which each seat needs its state machine to run again
+ *
+ * In microseconds, 0 if no time-driven transition is pending.
+ */
+static int64_t seatDeadlines[SEATS_NO];
+
+//! \brief One-shot timer firing at the earliest of #seatDeadlines
+static esp_timer_handle_t deadlineTimer;
+
+//! \brief Deadline #deadlineTimer is currently armed for, 0 if idle
+static int64_t armedDeadline;
+
+/** \brief Led flashing sequence in progress on each seat
+ *
+ * See flashLed().
+ */
+static struct {
+    unsigned long start;
+    uint8_t count;
+} ledFlashes[SEATS_NO];
 
 //! @}		// End of global variables
 
@@ -586,6 +684,93 @@ static int16_t constrain16(const int16_t x, const int16_t min, const int16_t max
 
 //! @}
 
+//! \name Scheduling of time-driven transitions
+//! @{
+
+/** \brief Index of the seat a controller is connected to
+ *
+ * \return 0 for Seat A, 1 for Seat B, -1 if the controller has no seat
+ */
+static int getSeatIndex(const uni_gamepad_seat_t seat) {
+    if (seat == GAMEPAD_SEAT_A) {
+        return 0;
+    } else if (seat == GAMEPAD_SEAT_B) {
+        return 1;
+    } else {
+        return -1;
+    }
+}
+
+/** \brief Ask for the state machine of a seat to be run again
+ *
+ * This is how time-driven transitions are implemented: whoever is waiting for
+ * some time to elapse asks to be woken up after \a ms milliseconds, and only
+ * the earliest request per seat is kept. See armDeadlineTimer().
+ */
+static void scheduleWakeup(const uni_gamepad_seat_t seat, unsigned long ms) {
+    int idx = getSeatIndex(seat);
+    if (idx < 0) {
+        return;
+    }
+
+    int64_t due = esp_timer_get_time() + (int64_t)ms * 1000;
+    if (seatDeadlines[idx] == 0 || due < seatDeadlines[idx]) {
+        seatDeadlines[idx] = due;
+    }
+}
+
+/** \brief Make sure #deadlineTimer fires at the earliest pending deadline
+ *
+ * Only called from loopCore0(), after an event has been processed.
+ */
+static void armDeadlineTimer(void) {
+    int64_t earliest = 0;
+
+    for (int i = 0; i < SEATS_NO; i++) {
+        if (seatDeadlines[i] != 0 && (earliest == 0 || seatDeadlines[i] < earliest)) {
+            earliest = seatDeadlines[i];
+        }
+    }
+
+    if (earliest == armedDeadline) {
+        // Already armed for it, or nothing to do
+        return;
+    }
+
+    // Fails harmlessly if the timer is not running
+    esp_timer_stop(deadlineTimer);
+    armedDeadline = earliest;
+    if (earliest != 0) {
+        int64_t delay = earliest - esp_timer_get_time();
+        ESP_ERROR_CHECK(esp_timer_start_once(deadlineTimer, delay > 0 ? delay : 1));
+    }
+}
+
+//! \brief #deadlineTimer callback, runs in the esp_timer task
+static void onDeadline(void* arg) {
+    ARG_UNUSED(arg);
+
+    MmEvent ev = {.type = MM_EVENT_DEADLINE, .cinfo = NULL, .timestamp = esp_timer_get_time()};
+
+    /* If the queue is full, there is no need to retry: deadlines are checked
+     * anyway when the pending events are processed
+     */
+    xQueueSendToBack(eventQueue, &ev, 0);
+}
+
+//! \brief Signal an event to loopCore0() from an ISR
+static void postEventFromISR(MmEventType type, RuntimeControllerInfo* cinfo) {
+    MmEvent ev = {.type = type, .cinfo = cinfo, .timestamp = esp_timer_get_time()};
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    xQueueSendToBackFromISR(eventQueue, &ev, &xHigherPriorityTaskWoken);
+    if (xHigherPriorityTaskWoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+//! @}
+
 //! \name Manipulation functions for #PadButtons
 //! @{
 
@@ -714,25 +899,26 @@ static bool buttonJustPressed(const PadButtons buttonWord,
  * \param[in] holdTime Time the button/combo must be stable for
  */
 // FIXME: Use previousButtons?
-static PadButtons debounceButtons(const PadButtons buttonWord,
-                                  const PadButtons previousButtonWord,
-                                  const unsigned long holdTime) {
+static PadButtons debounceButtons(const RuntimeControllerInfo* cinfo, const unsigned long holdTime) {
     static PadButtons oldButtons = BTN_NONE;
     static unsigned long pressedOn = 0;
 
     PadButtons ret = BTN_NONE;
 
-    if (buttonWord == oldButtons) {
-        if (millis() - pressedOn > holdTime) {
+    if (cinfo->buttonWord == oldButtons) {
+        unsigned long held = millis() - pressedOn;
+        if (held > holdTime) {
             // Same combo held long enough
-            ret = buttonWord;
+            ret = cinfo->buttonWord;
         } else {
-            // Combo held not long enough (yet)
+            // Combo held not long enough (yet), check again when it might be
+            scheduleWakeup(cinfo->seat, holdTime - held + 1);
         }
     } else {
         // Buttons bouncing
-        oldButtons = buttonWord;
+        oldButtons = cinfo->buttonWord;
         pressedOn = millis();
+        scheduleWakeup(cinfo->seat, holdTime + 1);
     }
 
     return ret;
@@ -1154,17 +1340,27 @@ static void setSeat(uni_hid_device_t* d, uni_gamepad_seat_t seat) {
     }
 }
 
+//! \brief Time the led stays on during each flash, in milliseconds
+static const unsigned long LED_FLASH_ON_TIME = 40U;
+
+//! \brief Duration of a single flash, on + off time, in milliseconds
+static const unsigned long LED_FLASH_PERIOD = 120U;
+
 /** \brief Flash the Mode LED
+ *
+ * This only starts the sequence, the led is actually driven by updateLeds(),
+ * so that the state machine does not stall while flashing.
  *
  * \param[in] n Desired number of flashes
  */
-static void flashLed(gpio_num_t pin, int n) {
-    for (int i = 0; i < n; ++i) {
-        gpio_set_level(pin, 1);
-        vTaskDelay(pdMS_TO_TICKS(40));
-        gpio_set_level(pin, 0);
-        vTaskDelay(pdMS_TO_TICKS(80));
+static void flashLed(const RuntimeControllerInfo* cinfo, int n) {
+    int idx = getSeatIndex(cinfo->seat);
+    if (idx < 0) {
+        return;
     }
+
+    ledFlashes[idx].start = millis();
+    ledFlashes[idx].count = n;
 }
 
 /** \brief Check if the right analog stick has been moved
@@ -1246,6 +1442,10 @@ static void dumpJoy(const TwoButtonJoystick* j) {
     mmlogi("\n");
 }
 
+#ifdef ENABLE_CD32_SUPPORT
+static void armCd32ShiftRegister(RuntimeControllerInfo* cinfo);
+#endif
+
 /** \brief Update the output direction pins
  *
  * This functions updates the status of the 4 directional pins of the DB-9 port.
@@ -1306,7 +1506,7 @@ static void handleJoystickDirections(RuntimeControllerInfo* cinfo, TwoButtonJoys
     // FIXME: No better place for this? It prevents us from keeping cinfo const
     if (buttonJustPressed(cinfo->buttonWord, cinfo->previousButtonWord, BTN_BACK)) {
         cinfo->useAlternativeCd32Mapping = !cinfo->useAlternativeCd32Mapping;
-        flashLed(cinfo->ledPin, ((uint8_t)cinfo->useAlternativeCd32Mapping) + 1);  // Flash-saving hack
+        flashLed(cinfo, ((uint8_t)cinfo->useAlternativeCd32Mapping) + 1);  // Flash-saving hack
     }
 
     if (cinfo->useAlternativeCd32Mapping) {
@@ -1356,7 +1556,17 @@ static void handleJoystickDirections(RuntimeControllerInfo* cinfo, TwoButtonJoys
     }
 
     // Atomic operation, interrupt either happens before or after this
+    bool changed = cinfo->buttonsLive != buttonsTmp;
     cinfo->buttonsLive = buttonsTmp;
+
+#ifdef ENABLE_CD32_SUPPORT
+    // Keep the preloaded shift register up to date until the next read
+    if (changed && cinfo->joyPins != NULL) {
+        armCd32ShiftRegister(cinfo);
+    }
+#else
+    ARG_UNUSED(changed);
+#endif
 }
 
 /** \brief Update the output fire button pins when in joystick mode
@@ -1459,6 +1669,25 @@ static void handleJoystickButtonsTemp(const RuntimeControllerInfo* cinfo) {
     taskENABLE_INTERRUPTS();
 }
 
+/** \brief Milliseconds until the next edge on a mouse axis
+ *
+ * Each axis toggles one of its lines every \a period and the other one half a
+ * period later.
+ *
+ * \param[in] last Time the first line was last toggled at
+ */
+static unsigned long nextMouseEdge(const unsigned long last, const unsigned int period) {
+    unsigned long elapsed = millis() - last;
+
+    if (elapsed < period / 2) {
+        return period / 2 - elapsed;
+    } else if (elapsed < period) {
+        return period - elapsed;
+    } else {
+        return 1;
+    }
+}
+
 /** \brief Update all output pins for Mouse mode
  *
  * This function updates all the output pins as necessary to emulate mouse
@@ -1499,6 +1728,9 @@ static void handleMouse(const RuntimeControllerInfo* cinfo) {
                     gpio_set_level(cinfo->mousePins[PIN_NO_RIGHT], !gpio_get_level(cinfo->mousePins[PIN_NO_DOWN]));
                 }
             }
+
+            // Keep moving until the stick is released
+            scheduleWakeup(cinfo->seat, nextMouseEdge(tx, period));
         }
 
         // Vertical axis
@@ -1529,6 +1761,8 @@ static void handleMouse(const RuntimeControllerInfo* cinfo) {
                     gpio_set_level(cinfo->mousePins[PIN_NO_LEFT], !gpio_get_level(cinfo->mousePins[PIN_NO_UP]));
                 }
             }
+
+            scheduleWakeup(cinfo->seat, nextMouseEdge(ty, period));
         }
 
         /* Buttons - This won't happen while in CD32 mode, so there's no need to
@@ -1642,11 +1876,14 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
             if (cinfo->stateEnteredTime == 0) {
                 // ControllerState was just entered
                 cinfo->stateEnteredTime = millis();
+                scheduleWakeup(cinfo->seat, TIMEOUT_CD32_MODE + 1);
             } else if (millis() - cinfo->stateEnteredTime > TIMEOUT_CD32_MODE) {
                 // CD32 mode was exited once for all
                 mmlogd("CD32 -> Joystick\n");
                 cinfo->stateEnteredTime = 0;
                 cinfo->state = ST_JOYSTICK;
+            } else {
+                scheduleWakeup(cinfo->seat, TIMEOUT_CD32_MODE + 1 - (millis() - cinfo->stateEnteredTime));
             }
             break;
 
@@ -1689,6 +1926,9 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
             if (cinfo->stateEnteredTime == 0) {
                 // State was just entered
                 cinfo->stateEnteredTime = millis();
+                if (isButtonProgrammable(cinfo->selectComboButton)) {
+                    scheduleWakeup(cinfo->seat, TIMEOUT_PROGRAMMING_MODE + 1);
+                }
             } else if (isButtonProgrammable(cinfo->selectComboButton) &&
                        millis() - cinfo->stateEnteredTime > TIMEOUT_PROGRAMMING_MODE) {
                 // Combo kept pressed, enter programming mode
@@ -1708,22 +1948,22 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
                 case BTN_X:
                     mmlogi("Setting normal mapping\n");
                     cinfo->joyMappingFunc = mapJoystickNormal;
-                    flashLed(cinfo->ledPin, JMAP_NORMAL);
+                    flashLed(cinfo, JMAP_NORMAL);
                     break;
                 case BTN_Y:
                     mmlogi("Setting Racing1 mapping\n");
                     cinfo->joyMappingFunc = mapJoystickRacing1;
-                    flashLed(cinfo->ledPin, JMAP_RACING1);
+                    flashLed(cinfo, JMAP_RACING1);
                     break;
                 case BTN_B:
                     mmlogi("Setting Racing2 mapping\n");
                     cinfo->joyMappingFunc = mapJoystickRacing2;
-                    flashLed(cinfo->ledPin, JMAP_RACING2);
+                    flashLed(cinfo, JMAP_RACING2);
                     break;
                 case BTN_A:
                     mmlogi("Setting Platform mapping\n");
                     cinfo->joyMappingFunc = mapJoystickPlatform;
-                    flashLed(cinfo->ledPin, JMAP_PLATFORM);
+                    flashLed(cinfo, JMAP_PLATFORM);
                     break;
                 case BTN_SHOULDER_L:
                 case BTN_SHOULDER_R:
@@ -1734,7 +1974,7 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
                         mmlogi("Setting Custom mapping for controllerConfig %u\n", (unsigned int)configIdx);
                         cinfo->currentCustomConfig = &(controllerConfigs[configIdx]);
                         cinfo->joyMappingFunc = mapJoystickCustom;
-                        flashLed(cinfo->ledPin, JMAP_CUSTOM);
+                        flashLed(cinfo, JMAP_CUSTOM);
                     } else {
                         /* Something went wrong, just ignore it and pretend
                          * nothing ever happened
@@ -1744,9 +1984,9 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
                 }
                 case BTN_HOME:
                     if (cinfo->c64Mode) {
-                        flashLed(cinfo->ledPin, 2);
+                        flashLed(cinfo, 2);
                     } else {
-                        flashLed(cinfo->ledPin, 1);
+                        flashLed(cinfo, 1);
                     }
                     cinfo->c64Mode = !cinfo->c64Mode;
                     break;
@@ -1773,12 +2013,12 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
                 saveConfigurations();  // No need to check for changes as this uses EEPROM.update()
                 cinfo->state = ST_WAIT_SELECT_RELEASE_FOR_EXIT;
             } else {
-                buttons = debounceButtons(cinfo->buttonWord, cinfo->previousButtonWord, DEBOUNCE_TIME_BUTTON);
+                buttons = debounceButtons(cinfo, DEBOUNCE_TIME_BUTTON);
                 if (isButtonMappable(buttons)) {
                     // Exactly one key pressed, go on
                     cinfo->programmedButton = (PadButton)buttons;
                     mmlogi("Programming button %s\n", getButtonName(buttons));
-                    flashLed(cinfo->ledPin, 3);
+                    flashLed(cinfo, 3);
                     cinfo->state = ST_WAIT_BUTTON_RELEASE;
                 }
             }
@@ -1789,7 +2029,7 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
             }
             break;
         case ST_WAIT_COMBO_PRESS:
-            buttons = debounceButtons(cinfo->buttonWord, cinfo->previousButtonWord, DEBOUNCE_TIME_COMBO);
+            buttons = debounceButtons(cinfo, DEBOUNCE_TIME_COMBO);
             if (buttons != BTN_NONE && psxButton2Amiga(buttons, &j)) {
                 mmlogi("Programmed to ");
                 dumpJoy(&j);
@@ -1807,7 +2047,7 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
                 }
 
                 cinfo->programmedButton = BTN_NONE;
-                flashLed(cinfo->ledPin, 5);
+                flashLed(cinfo, 5);
                 cinfo->state = ST_WAIT_COMBO_RELEASE;
             }
             break;
@@ -1828,22 +2068,13 @@ static void stateMachine(RuntimeControllerInfo* cinfo) {
 }
 
 static void gpio_isr_handler_button(void* arg) {
-    mmlogd("Button ISR running on core %d\n", xPortGetCoreID());
-
     // Button released?
     if (gpio_get_level(GPIO_PUSH_BUTTON)) {
-        //~ g_last_time_pressed_us = esp_timer_get_time ();
-        mmlogi("SWAP Button released\n");
         return;
     }
 
-    // Button pressed!
-    mmlogi("SWAP Button pressed\n");
-    //~ BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    //~ xEventGroupSetBitsFromISR (g_event_group, EVENT_BIT_BUTTON,
-    //~ &xHigherPriorityTaskWoken);
-    //~ if (xHigherPriorityTaskWoken == pdTRUE)
-    //~ portYIELD_FROM_ISR ();
+    // Button pressed! Let loopCore0() handle it
+    postEventFromISR(MM_EVENT_SWAP_BUTTON, NULL);
 }
 
 //! @}
@@ -1853,52 +2084,134 @@ static void gpio_isr_handler_button(void* arg) {
 //! \name Interrupt handlers for CD32 mode
 //! @{
 
-/** \brief ISR servicing rising edges on #pins_port[PIN_NO_B1]
+#ifdef ENABLE_INSTRUMENTATION
+/** \brief CD32 timing statistics
  *
- * Called on clock pin rising, this function shall shift out next bit.
+ * Collected in the MODE ISR, logged periodically by loopCore0().
  */
-static void onClockEdge(void* arg) {
-    RuntimeControllerInfo* cinfo = (RuntimeControllerInfo*)arg;
+static volatile struct {
+    uint32_t reads;
+    uint32_t shortReads;  // Reads where fewer than 9 bits were clocked
+    uint32_t minBits;
+    uint32_t maxBits;
+    uint32_t maxModeIsrCycles;  // Falling edge of MODE
+} cd32Stats = {.minBits = UINT32_MAX};
 
-#ifdef ENABLE_INSTRUMENTATION
-    gpio_set_level(PIN_INTERRUPT_TIMING, 1);
+static inline uint32_t getCycleCount(void) {
+#if ESP_IDF_VERSION_MAJOR == 4
+    return cpu_hal_get_cycle_count();
+#else
+    return esp_cpu_get_cycle_count();
 #endif
+}
+#endif
+
+static spi_host_device_t getCd32Host(const RuntimeControllerInfo* cinfo) {
+    return cinfo->joyPins == PINS_PORT_A ? CD32_SPI_HOST_PORT_A : CD32_SPI_HOST_PORT_B;
+}
 
-    if (!(cinfo->isrButtons & 0x01)) {
-        gpio_set_level(cinfo->joyPins[PIN_NO_B2], 1);
+/** \brief Connect button 2 pin to the SPI shift register or back to GPIO
+ *
+ * The pin is routed through the GPIO matrix, so this is just a register write.
+ */
+static void routeCd32Data(const RuntimeControllerInfo* cinfo, bool toSpi) {
+    gpio_num_t pin = cinfo->joyPins[PIN_NO_B2];
+
+    if (toSpi) {
+        esp_rom_gpio_connect_out_signal(pin, spi_periph_signal[getCd32Host(cinfo)].spiq_out, false, false);
     } else {
-        gpio_set_level(cinfo->joyPins[PIN_NO_B2], 0);
+        esp_rom_gpio_connect_out_signal(pin, SIG_GPIO_OUT_IDX, false, false);
     }
+}
 
-    cinfo->isrButtons >>= 1U; /* Again, non-existing button 10 will be
-                               * reported as pressed for the ID sequence
-                               */
+/** \brief Prepare an SPI peripheral to be used as the CD32 shift register
+ *
+ * The console clock and MODE go to the peripheral through the GPIO matrix. The
+ * pins are configured as inputs by the caller. Button 2 pin is connected to
+ * MISO only while in CD32 mode, see routeCd32Data().
+ */
+static void setupCd32ShiftRegister(spi_host_device_t host, const gpio_num_t* pins) {
+    spi_dev_t* hw = SPI_LL_GET_HW(host);
+    const spi_signal_conn_t* sig = &spi_periph_signal[host];
 
-#ifdef ENABLE_INSTRUMENTATION
-    gpio_set_level(PIN_INTERRUPT_TIMING, 0);
-#endif
+    periph_module_enable(sig->module);
+    spi_ll_slave_init(hw);
+    spi_ll_slave_set_mode(hw, CD32_SPI_MODE, false);
+    spi_ll_set_tx_lsbfirst(hw, true);
+    spi_ll_set_rx_lsbfirst(hw, true);
+
+    esp_rom_gpio_connect_in_signal(pins[PIN_NO_CLOCK], sig->spiclk_in, false);
+    esp_rom_gpio_connect_in_signal(pins[PIN_NO_MODE], sig->spics_in, false);
+
+    // Button 2 pin is a normal joystick output until CD32 mode is entered
+    esp_rom_gpio_connect_out_signal(pins[PIN_NO_B2], SIG_GPIO_OUT_IDX, false, false);
+}
+
+static portMUX_TYPE cd32Mux = portMUX_INITIALIZER_UNLOCKED;
+
+/** \brief Preload the shift register with #buttonsLive and arm it
+ *
+ * The SPI slave latches the start of the transaction when CS (MODE) goes low,
+ * so it must be armed while MODE is high: on its rising edge, and whenever
+ * buttonsLive changes in the meantime. Arming it from the falling edge ISR
+ * would make the first bit and the bit count depend on the ISR latency.
+ *
+ * Called from both the MODE ISR (core 1) and the Bluetooth task (core 0).
+ */
+static void armCd32ShiftRegister(RuntimeControllerInfo* cinfo) {
+    spi_dev_t* hw = SPI_LL_GET_HW(getCd32Host(cinfo));
+
+    portENTER_CRITICAL_SAFE(&cd32Mux);
+    // The console is reading: the next rising edge will arm it again.
+    if (gpio_get_level(cinfo->joyPins[PIN_NO_MODE]) == 0) {
+        portEXIT_CRITICAL_SAFE(&cd32Mux);
+        return;
+    }
+
+    /* At this point MSB must be 1 for ID sequence. Bits after the first 8
+     * are 0, which reports non-existing buttons 8 as released and 9 as
+     * pressed as required by the ID sequence.
+     *
+     * Remember there's an inverter between us and the Amiga, so bits are
+     * sent inverted: 1 = pressed.
+     */
+    cinfo->isrButtons = cinfo->buttonsLive;
+    uint8_t buffer[CD32_SHIFT_BITS / 8] = {(uint8_t)~cinfo->isrButtons, 0xFF};
+
+    spi_ll_slave_reset(hw);
+    spi_ll_write_buffer(hw, buffer, CD32_SHIFT_BITS);
+    spi_ll_slave_set_tx_bitlen(hw, CD32_SHIFT_BITS);
+    spi_ll_slave_set_rx_bitlen(hw, CD32_SHIFT_BITS);
+    spi_ll_clear_int_stat(hw);
+    spi_ll_user_start(hw);
+    portEXIT_CRITICAL_SAFE(&cd32Mux);
 }
 
 /** \brief ISR servicing edges on #pins_port[PIN_NO_MODE]
  *
  * Called on pins_port[PIN_NO_MODE] changing, this function shall set things up
- * for CD32 mode, sample buttons and shift out the first bit on FALLING edges,
- * and restore Atari-style signals on RISING edges.
+ * for CD32 mode on FALLING edges, and restore Atari-style signals and arm the
+ * shift register for the next read on RISING edges.
+ *
+ * The actual shifting is done by the SPI peripheral, clocked by the console.
+ * The buttons were sampled when it was armed.
  */
 static void onPadModeChange(void* arg) {
     RuntimeControllerInfo* cinfo = (RuntimeControllerInfo*)arg;
+#ifdef ENABLE_INSTRUMENTATION
+    spi_dev_t* hw = SPI_LL_GET_HW(getCd32Host(cinfo));
+#endif
 
     if (gpio_get_level(cinfo->joyPins[PIN_NO_MODE]) == 0) {
         // Switch to CD32 mode
 #ifdef ENABLE_INSTRUMENTATION
+        uint32_t start = getCycleCount();
+        gpio_set_level(PIN_INTERRUPT_TIMING, 1);
         gpio_set_level(PIN_CD32MODE, 0);
 #endif
-        // Output status of first button as soon as possible
-        if (!(cinfo->buttonsLive & 0x01)) {
-            gpio_set_level(cinfo->joyPins[PIN_NO_B2], 1);
-        } else {
-            gpio_set_level(cinfo->joyPins[PIN_NO_B2], 0);
-        }
+        // The shift register was armed while MODE was high. Output status of
+        // first button as soon as possible
+        routeCd32Data(cinfo, true);
 
         /* Disable output on clock pin. No need to rush here, as when the CD32
          * drives it high, it's doing so open-collector-style as well.
@@ -1907,18 +2220,6 @@ static void onPadModeChange(void* arg) {
          */
         gpio_set_level(cinfo->joyPins[PIN_NO_B1], 0);
 
-        /* Sample input values, they will be shifted out on subsequent clock
-         * inputs.
-         *
-         * At this point MSB must be 1 for ID sequence. Then it will be zeroed
-         * by the shift. This will report non-existing buttons 8 as released and
-         * 9 as pressed as required by the ID sequence.
-         */
-        cinfo->isrButtons = cinfo->buttonsLive >> 1U;
-
-        // Enable interrupt on clock edges
-        ESP_ERROR_CHECK(gpio_isr_handler_add(cinfo->joyPins[PIN_NO_CLOCK], onClockEdge, (void*)cinfo));
-
         // Set state to ST_CD32
         if (cinfo->state != ST_CD32 && cinfo->state != ST_JOYSTICK_TEMP) {
             mmlogd("Joystick -> CD32\n");
@@ -1926,6 +2227,10 @@ static void onPadModeChange(void* arg) {
         cinfo->stateEnteredTime = 0;
         cinfo->state = ST_CD32;
 #ifdef ENABLE_INSTRUMENTATION
+        gpio_set_level(PIN_INTERRUPT_TIMING, 0);
+        uint32_t cycles = getCycleCount() - start;
+        if (cycles > cd32Stats.maxModeIsrCycles)
+            cd32Stats.maxModeIsrCycles = cycles;
         gpio_set_level(PIN_CD32MODE, 1);
         gpio_set_level(PIN_CD32MODE, 0);
 #endif
@@ -1933,8 +2238,20 @@ static void onPadModeChange(void* arg) {
 #ifdef ENABLE_INSTRUMENTATION
         gpio_set_level(PIN_CD32MODE, 1);
         gpio_set_level(PIN_CD32MODE, 0);
+
+        uint32_t bits = spi_ll_slave_get_rcv_bitlen(hw);
+        cd32Stats.reads++;
+        if (bits < 9)
+            cd32Stats.shortReads++;
+        if (bits < cd32Stats.minBits)
+            cd32Stats.minBits = bits;
+        if (bits > cd32Stats.maxBits)
+            cd32Stats.maxBits = bits;
 #endif
 
+        // Give button 2 pin back to GPIO before setting its level
+        routeCd32Data(cinfo, false);
+
         /* Set pin directions and set levels according to buttons, as waiting
          * for the main loop to do it takes too much time (= a few ms), for some
          * reason
@@ -1951,18 +2268,35 @@ static void onPadModeChange(void* arg) {
             buttonRelease(cinfo->joyPins[PIN_NO_B2]);
         }
 
-        // Disable interrupt on clock edges
-        gpio_isr_handler_remove(cinfo->joyPins[PIN_NO_CLOCK]);
+        // Preload the shift register for the next read while MODE is high
+        armCd32ShiftRegister(cinfo);
 
         // Set state to ST_JOYSTICK_TEMP
         cinfo->state = ST_JOYSTICK_TEMP;
 
+        // The state machine will start the timeout to go back to joystick mode
+        postEventFromISR(MM_EVENT_PORT, cinfo);
+
 #ifdef ENABLE_INSTRUMENTATION
         gpio_set_level(PIN_CD32MODE, 1);
 #endif
     }
 }
 
+#ifdef ENABLE_INSTRUMENTATION
+static void dumpCd32Stats(void) {
+    static unsigned long lastDump;
+
+    if (millis() - lastDump < 5000UL || cd32Stats.reads == 0)
+        return;
+    lastDump = millis();
+
+    mmlogi("CD32: reads=%u, short reads=%u, bits min=%u max=%u, max MODE ISR=%u cycles\n",
+           (unsigned int)cd32Stats.reads, (unsigned int)cd32Stats.shortReads, (unsigned int)cd32Stats.minBits,
+           (unsigned int)cd32Stats.maxBits, (unsigned int)cd32Stats.maxModeIsrCycles);
+}
+#endif
+
 //! @}
 
 #endif
@@ -1990,7 +2324,7 @@ static uni_hid_device_t* getControllerForSeat(const uni_gamepad_seat_t seat) {
  */
 static void updateLeds() {
     // LOL, how crap! :X
-    for (int i = 0; i < 2; ++i) {
+    for (int i = 0; i < SEATS_NO; ++i) {
         uni_gamepad_seat_t seat = GAMEPAD_SEAT_A;
         gpio_num_t pin = PIN_LED_P1;
 
@@ -2002,6 +2336,19 @@ static void updateLeds() {
         uni_hid_device_t* dev = getControllerForSeat(seat);
         RuntimeControllerInfo* cinfo;
         if (dev && (cinfo = getControllerInstance(dev))) {
+            if (ledFlashes[i].count > 0) {
+                // Flashing takes precedence over everything else
+                unsigned long elapsed = millis() - ledFlashes[i].start;
+                if (elapsed < ledFlashes[i].count * LED_FLASH_PERIOD) {
+                    unsigned long phase = elapsed % LED_FLASH_PERIOD;
+                    gpio_set_level(cinfo->ledPin, phase < LED_FLASH_ON_TIME);
+                    scheduleWakeup(seat, phase < LED_FLASH_ON_TIME ? LED_FLASH_ON_TIME - phase
+                                                                   : LED_FLASH_PERIOD - phase);
+                    continue;
+                }
+                ledFlashes[i].count = 0;
+            }
+
             switch (cinfo->state) {
                 case ST_FIRST_READ:
                 case ST_WAIT_SELECT_RELEASE_FOR_EXIT:
@@ -2021,42 +2368,154 @@ static void updateLeds() {
                 case ST_WAIT_COMBO_RELEASE:
                     // Programming mode, blink fast
                     gpio_set_level(cinfo->ledPin, (millis() / 250) % 2 == 0);
+                    scheduleWakeup(seat, 250 - millis() % 250);
                     break;
                 default:
                     // WTF?! Blink fast... er!
                     gpio_set_level(cinfo->ledPin, (millis() / 100) % 2 == 0);
+                    scheduleWakeup(seat, 100 - millis() % 100);
                     break;
             }
         } else {
             gpio_set_level(pin, 0);
+            ledFlashes[i].count = 0;
+        }
+    }
+}
+
+#ifdef ENABLE_INSTRUMENTATION
+/** \brief Report-to-port latency statistics
+ *
+ * Time from a report being received to the state machine having updated the
+ * port pins, for each seat.
+ */
+static struct {
+    uint32_t reports;
+    int64_t totalUs;
+    int64_t maxUs;
+} latencyStats[SEATS_NO];
+
+//! \brief Reports that could not be queued for loopCore0()
+static volatile uint32_t droppedReports;
+
+static void updateLatencyStats(const MmEvent* ev) {
+    int idx = getSeatIndex(ev->cinfo->seat);
+    if (idx < 0) {
+        return;
+    }
+
+    int64_t latency = esp_timer_get_time() - ev->timestamp;
+    latencyStats[idx].reports++;
+    latencyStats[idx].totalUs += latency;
+    if (latency > latencyStats[idx].maxUs) {
+        latencyStats[idx].maxUs = latency;
+    }
+}
+
+static void dumpLatencyStats(void) {
+    static unsigned long lastDump;
+
+    if (millis() - lastDump < 5000UL)
+        return;
+    lastDump = millis();
+
+    for (int i = 0; i < SEATS_NO; i++) {
+        if (latencyStats[i].reports == 0)
+            continue;
+        mmlogi("Seat %c: reports=%u, report-to-port latency avg=%u us, max=%u us\n", 'A' + i,
+               (unsigned int)latencyStats[i].reports,
+               (unsigned int)(latencyStats[i].totalUs / latencyStats[i].reports),
+               (unsigned int)latencyStats[i].maxUs);
+    }
+    if (droppedReports > 0) {
+        mmlogi("Dropped reports: %u\n", (unsigned int)droppedReports);
+    }
+}
+#endif
+
+/** \brief Run the state machine of a controller in response to an event
+ *
+ * Any deadline the seat was waiting for is forgotten, as the state machine will
+ * ask for it again if still needed.
+ */
+static void runStateMachine(RuntimeControllerInfo* cinfo) {
+    int idx = getSeatIndex(cinfo->seat);
+    if (idx >= 0) {
+        seatDeadlines[idx] = 0;
+    }
+
+    ControllerState oldState = cinfo->state;
+    stateMachine(cinfo);
+    if (cinfo->state != oldState) {
+        /* Controllers usually only send reports on changes, so let the new
+         * state have a look at the current one right away
+         */
+        scheduleWakeup(cinfo->seat, 0);
+    }
+}
+
+//! \brief Run the state machines whose deadline has expired
+static void runExpiredDeadlines(void) {
+    int64_t now = esp_timer_get_time();
+
+    for (int i = 0; i < SEATS_NO; i++) {
+        if (seatDeadlines[i] == 0 || seatDeadlines[i] > now) {
+            continue;
+        }
+
+        uni_hid_device_t* dev = getControllerForSeat(i == 0 ? GAMEPAD_SEAT_A : GAMEPAD_SEAT_B);
+        if (dev) {
+            runStateMachine(getControllerInstance(dev));
+        } else {
+            seatDeadlines[i] = 0;
         }
     }
 }
 
 static void loopCore0(void* arg) {
-    RuntimeControllerInfo* cinfo = NULL;
+    MmEvent ev;
 
     mmlogi("loopCore0() running on core %d\n", xPortGetCoreID());
 
-    const TickType_t timeout = pdMS_TO_TICKS(10);
     while (true) {
-        if (xQueueReceive(controllerUpdateQueue, &cinfo, timeout)) {
-            // Process new data from controller
-            stateMachine(cinfo);
-        } else {
-            /* Force the state machine to run even if no update was received,
-             * since some transitions are time-driven
-             */
-            for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
-                uni_hid_device_t* dev = uni_hid_device_get_instance_for_idx(i);
-                cinfo = getControllerInstance(dev);
-                if (cinfo->seat == GAMEPAD_SEAT_A || cinfo->seat == GAMEPAD_SEAT_B) {
-                    stateMachine(cinfo);
-                }
-            }
+        /* Sleep until something happens. Time-driven transitions are woken up
+         * by deadlineTimer, so there is no need for a timeout here.
+         */
+        if (!xQueueReceive(eventQueue, &ev, portMAX_DELAY)) {
+            continue;
+        }
+
+        switch (ev.type) {
+            case MM_EVENT_CONTROLLER_DATA:
+                // Process new data from controller
+                runStateMachine(ev.cinfo);
+#ifdef ENABLE_INSTRUMENTATION
+                updateLatencyStats(&ev);
+#endif
+                break;
+            case MM_EVENT_PORT:
+                runStateMachine(ev.cinfo);
+                break;
+            case MM_EVENT_DEADLINE:
+                // One-shot timer, it is no longer armed
+                armedDeadline = 0;
+                break;
+            case MM_EVENT_SWAP_BUTTON:
+                mmlogi("SWAP Button pressed\n");
+                break;
         }
 
+        /* Check deadlines on every event, so that none is lost even if the
+         * timer event could not be queued
+         */
+        runExpiredDeadlines();
         updateLeds();
+        armDeadlineTimer();
+
+#ifdef ENABLE_INSTRUMENTATION
+        dumpLatencyStats();
+        dumpCd32Stats();
+#endif
     }
 }
 
@@ -2088,13 +2547,18 @@ static void loopCore1(void* arg) {
     io_conf.pin_bit_mask = (1ULL << PINS_PORT_A[PIN_NO_MODE]) | (1ULL << PINS_PORT_B[PIN_NO_MODE]);
     ESP_ERROR_CHECK(gpio_config(&io_conf));
 
-    io_conf.intr_type = GPIO_INTR_POSEDGE;  // Only on rising edges
+    // Clock is sampled by the SPI peripherals, no interrupt needed
+    io_conf.intr_type = GPIO_INTR_DISABLE;
     io_conf.mode = GPIO_MODE_INPUT;
     io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
     io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
     io_conf.pin_bit_mask = (1ULL << PINS_PORT_A[PIN_NO_CLOCK]) | (1ULL << PINS_PORT_B[PIN_NO_CLOCK]);
     ESP_ERROR_CHECK(gpio_config(&io_conf));
 
+    // SPI slaves acting as shift registers. Button 2 pins are connected to them on demand.
+    setupCd32ShiftRegister(CD32_SPI_HOST_PORT_A, PINS_PORT_A);
+    setupCd32ShiftRegister(CD32_SPI_HOST_PORT_B, PINS_PORT_B);
+
     // Interrupts are not activated here, preparation is enough :)
 #endif
 
@@ -2157,20 +2621,19 @@ static void loopCore1(void* arg) {
             uni_hid_device_t* dev = getControllerForSeat(GAMEPAD_SEAT_A);
             if (dev && (cinfo = getControllerInstance(dev))) {
                 ESP_ERROR_CHECK(gpio_isr_handler_add(cinfo->joyPins[PIN_NO_MODE], onPadModeChange, (void*)cinfo));
+                armCd32ShiftRegister(cinfo);
             }
 #endif
         }
 
         if (uxBits & EVENT_DISABLE_CD32_SEAT_A) {
 #ifdef ENABLE_CD32_SUPPORT
-            // Disable both interrupts, as this might happen halfway during a shift
+            // Disconnect the shift register too, as this might happen halfway during a shift
             mmlogi("Disabling CD32 trigger for Seat A on core %d\n", xPortGetCoreID());
             uni_hid_device_t* dev = getControllerForSeat(GAMEPAD_SEAT_A);
             if (dev && (cinfo = getControllerInstance(dev))) {
-                //~ taskDISABLE_INTERRUPTS ();
-                gpio_isr_handler_remove(cinfo->joyPins[PIN_NO_CLOCK]);
                 gpio_isr_handler_remove(cinfo->joyPins[PIN_NO_MODE]);
-                //~ taskENABLE_INTERRUPTS ();
+                routeCd32Data(cinfo, false);
             }
 #endif
         }
@@ -2181,20 +2644,19 @@ static void loopCore1(void* arg) {
             uni_hid_device_t* dev = getControllerForSeat(GAMEPAD_SEAT_B);
             if (dev && (cinfo = getControllerInstance(dev))) {
                 ESP_ERROR_CHECK(gpio_isr_handler_add(cinfo->joyPins[PIN_NO_MODE], onPadModeChange, (void*)cinfo));
+                armCd32ShiftRegister(cinfo);
             }
 #endif
         }
 
         if (uxBits & EVENT_DISABLE_CD32_SEAT_B) {
 #ifdef ENABLE_CD32_SUPPORT
-            // Disable both interrupts, as this might happen halfway during a shift
+            // Disconnect the shift register too, as this might happen halfway during a shift
             mmlogi("Disabling CD32 trigger for Seat B on core %d\n", xPortGetCoreID());
             uni_hid_device_t* dev = getControllerForSeat(GAMEPAD_SEAT_B);
             if (dev && (cinfo = getControllerInstance(dev))) {
-                //~ taskDISABLE_INTERRUPTS ();
-                gpio_isr_handler_remove(cinfo->joyPins[PIN_NO_CLOCK]);
                 gpio_isr_handler_remove(cinfo->joyPins[PIN_NO_MODE]);
-                //~ taskENABLE_INTERRUPTS ();
+                routeCd32Data(cinfo, false);
             }
 #endif
         }
@@ -2270,7 +2732,14 @@ static void mightymiggy_init(int argc, const char** argv) {
     }
 
     // Create task stuff
-    controllerUpdateQueue = xQueueCreate(3, sizeof(RuntimeControllerInfo*));
+    const esp_timer_create_args_t timerArgs = {
+        .callback = onDeadline,
+        .name = "mm_deadline",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timerArgs, &deadlineTimer));
+
+    // Room for reports from both seats, plus ISR and timer events
+    eventQueue = xQueueCreate(8, sizeof(MmEvent));
     xTaskCreatePinnedToCore(loopCore0, "loopCore0", 2048, NULL, 10, NULL, 0);
 
     // This other task sets up GPIO interrupts before starting its loop
@@ -2477,7 +2946,7 @@ static uni_error_t mightymiggy_on_device_ready(uni_hid_device_t* d) {
          * controller, but if we do this, everything will crash badly, not sure
          * why :(. Anyway, we'll get a reading soon.
          */
-        //~ xQueueSendToBack (controllerUpdateQueue, &cinfo, 0);
+        //~ xQueueSendToBack (eventQueue, &ev, 0);
         //~ taskYIELD ();
     }
 
@@ -2545,6 +3014,9 @@ static void mightymiggy_on_gamepad_data(uni_hid_device_t* d, uni_gamepad_t* gp)
         return;
     }
 
+    // Report-to-port latency is measured from here
+    int64_t reportTime = esp_timer_get_time();
+
     RuntimeControllerInfo* cinfo = getControllerInstance(d);
 
     // Convert data to our internal representation, starting with analog sticks
@@ -2756,8 +3228,12 @@ static void mightymiggy_on_gamepad_data(uni_hid_device_t* d, uni_gamepad_t* gp)
             break;
     }
 
-    xQueueSendToBack(controllerUpdateQueue, &cinfo, 0);
-    //~ taskYIELD ();
+    MmEvent ev = {.type = MM_EVENT_CONTROLLER_DATA, .cinfo = cinfo, .timestamp = reportTime};
+    if (xQueueSendToBack(eventQueue, &ev, 0) != pdTRUE) {
+#ifdef ENABLE_INSTRUMENTATION
+        droppedReports++;
+#endif
+    }
 }
 
 static const uni_property_t* mightymiggy_get_property(uni_property_idx_t idx) {
@@ -18,6 +18,8 @@
 
 #include "platform/uni_platform_nina.h"
 
+#include <inttypes.h>
+
 #include <driver/spi_slave.h>
 #include <driver/uart.h>
 #include <esp_timer.h>
@@ -67,6 +69,10 @@
 #define GPIO_READY GPIO_NUM_33
 #define DMA_CHANNEL 1
 
+// Must be modulo 4 and word aligned.
+// A higher value up to SPI_MAX_DMA_LEN can be defined if needed.
+#define SPI_BUFFER_LEN 256
+
 enum {
     NINA_CONTROLLER_INVALID = -1,
 };
@@ -133,6 +139,19 @@ typedef struct __attribute__((packed)) {
     uint8_t battery;
 } nina_controller_t;
 
+// Fields reported by "controllers data since sequence".
+// The field mask sent via the wire uses BIT(field). Fields are sent in this order.
+enum {
+    CONTROLLER_FIELD_KLASS,    // klass: 1 byte
+    CONTROLLER_FIELD_BATTERY,  // battery: 1 byte
+    CONTROLLER_FIELD_BUTTONS,  // Gamepad: dpad, buttons, misc_buttons: 4 bytes
+    CONTROLLER_FIELD_AXIS,     // Gamepad: axis_x, axis_y, axis_rx, axis_ry: 16 bytes
+    CONTROLLER_FIELD_PEDALS,   // Gamepad: brake, throttle: 8 bytes
+    CONTROLLER_FIELD_MOTION,   // Gamepad: gyro, accel: 24 bytes
+    CONTROLLER_FIELD_DATA,     // Non-gamepads: nina_mouse_t or nina_balance_board_t, depending on klass
+    CONTROLLER_FIELD_COUNT,
+};
+
 enum {
     PROPERTY_FLAG_RUMBLE = BIT(0),
     PROPERTY_FLAG_PLAYER_LEDS = BIT(1),
@@ -178,10 +197,29 @@ _Static_assert(sizeof(nina_instance_t) < HID_DEVICE_MAX_PLATFORM_DATA, "NINA int
 
 static SemaphoreHandle_t _ready_semaphore = NULL;
 static QueueHandle_t _pending_queue = NULL;
-static SemaphoreHandle_t controller_mutex = NULL;
+// _controllers, _controllers_properties and _gamepad_seats are protected by a seqlock.
+// Only CPU0 (BT) writes them, and CPU1 (SPI) reads them without blocking:
+// if the sequence changed while reading, the read is retried.
+// The sequence is odd while an update is in progress.
+static volatile uint32_t _controllers_seq;
 static nina_controller_t _controllers[CONFIG_BLUEPAD32_MAX_DEVICES];
 static nina_controller_properties_t _controllers_properties[CONFIG_BLUEPAD32_MAX_DEVICES];
 static volatile uni_gamepad_seat_t _gamepad_seats;
+// Value of _controllers_seq when each field was updated. Protected by the seqlock as well.
+static uint32_t _controllers_field_seq[CONFIG_BLUEPAD32_MAX_DEVICES][CONTROLLER_FIELD_COUNT];
+
+// Host poll stats. Measured from the moment the request was received until the response is ready.
+// Histogram buckets are power-of-two microseconds: <1us, <2us, <4us, ... and the rest in the last one.
+#define POLL_STATS_BUCKETS 12
+// Dump stats every N polls. At 1 kHz, every 10 seconds.
+#define POLL_STATS_DUMP_EVERY 10000
+static struct {
+    uint32_t polls;
+    uint32_t retries;
+    uint32_t max_retries;
+    uint32_t max_us;
+    uint32_t histogram[POLL_STATS_BUCKETS];
+} _poll_stats;
 
 static nina_instance_t* get_nina_instance(uni_hid_device_t* d);
 static uint8_t predicate_nina_index(uni_hid_device_t* d, void* data);
@@ -212,6 +250,10 @@ typedef struct {
 
 #define MAX_PENDING_REQUESTS 16
 
+// Received length of the command being processed. Set by process_request(), for the
+// handlers that have variable-length params. Only used by CPU1.
+static int _command_len;
+
 //
 //
 // CPU1 - CPU1 - CPU1
@@ -221,6 +263,62 @@ typedef struct {
 //
 //
 
+//
+// Seqlock readers
+//
+
+static uint32_t controllers_read_begin(void) {
+    uint32_t seq;
+
+    // Writer is in the middle of an update. It is short, just spin.
+    // Not counted as a retry: only torn reads are, in controllers_read_retry().
+    while ((seq = _controllers_seq) & 1) {
+    }
+    __sync_synchronize();
+    return seq;
+}
+
+static bool controllers_read_retry(uint32_t seq) {
+    __sync_synchronize();
+    if (seq == _controllers_seq)
+        return false;
+    _poll_stats.retries++;
+    return true;
+}
+
+static void poll_stats_update(int64_t elapsed_us, uint32_t retries) {
+    int bucket = 0;
+    while (bucket < POLL_STATS_BUCKETS - 1 && elapsed_us >= (1 << bucket))
+        bucket++;
+
+    _poll_stats.polls++;
+    _poll_stats.histogram[bucket]++;
+    if (elapsed_us > _poll_stats.max_us)
+        _poll_stats.max_us = elapsed_us;
+    if (retries > _poll_stats.max_retries)
+        _poll_stats.max_retries = retries;
+}
+
+// Returns the upper bound, in microseconds, of the bucket that contains the percentile.
+static uint32_t poll_stats_percentile(int percentile) {
+    uint32_t wanted = ((uint64_t)_poll_stats.polls * percentile + 99) / 100;
+    uint32_t count = 0;
+
+    for (int i = 0; i < POLL_STATS_BUCKETS; i++) {
+        count += _poll_stats.histogram[i];
+        if (count >= wanted)
+            return (i == POLL_STATS_BUCKETS - 1) ? _poll_stats.max_us : (1 << i);
+    }
+    return _poll_stats.max_us;
+}
+
+static void poll_stats_dump(void) {
+    logi("NINA: polls=%" PRIu32 ", latency p50<=%" PRIu32 "us, p90<=%" PRIu32 "us, p99<=%" PRIu32 "us, max=%" PRIu32
+         "us, retries=%" PRIu32 " (max %" PRIu32 " per poll)\n",
+         _poll_stats.polls, poll_stats_percentile(50), poll_stats_percentile(90), poll_stats_percentile(99),
+         _poll_stats.max_us, _poll_stats.retries, _poll_stats.max_retries);
+}
+
 //
 // SPI / NINA-fw related
 //
@@ -257,7 +355,7 @@ enum {
 // Command 0x00
 static int request_protocol_version(const uint8_t command[], uint8_t response[]) {
 #define PROTOCOL_VERSION_HI 0x01
-#define PROTOCOL_VERSION_LO 0x04
+#define PROTOCOL_VERSION_LO 0x05
 
     response[2] = 1;  // Number of parameters
     response[3] = 2;  // Param len
@@ -275,29 +373,32 @@ static int request_gamepads_data(const uint8_t command[], uint8_t response[]) {
     //      3: param len (sizeof(_gamepads[0])
     //      4: gamepad N data
 
-    xSemaphoreTake(controller_mutex, portMAX_DELAY);
-
-    int total_controllers = 0;
-    int offset = 3;
-    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
-        if (_gamepad_seats & BIT(i)) {
-            total_controllers++;
-            // Update param len
-            // +1 is for the "idx" field
-            response[offset] = sizeof(_controllers[0].gamepad) + 1;
-            // Update param (data)
-            response[offset + 1] = _controllers[i].idx;
-            memcpy(&response[offset + 2], &_controllers[i].gamepad, sizeof(_controllers[0].gamepad));
-            // +1 for len
-            // +1 for idx
-            offset += sizeof(_controllers[0].gamepad) + 1 + 1;
+    int total_controllers;
+    int offset;
+    uint32_t seq;
+
+    do {
+        seq = controllers_read_begin();
+        total_controllers = 0;
+        offset = 3;
+        for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+            if (_gamepad_seats & BIT(i)) {
+                total_controllers++;
+                // Update param len
+                // +1 is for the "idx" field
+                response[offset] = sizeof(_controllers[0].gamepad) + 1;
+                // Update param (data)
+                response[offset + 1] = _controllers[i].idx;
+                memcpy(&response[offset + 2], &_controllers[i].gamepad, sizeof(_controllers[0].gamepad));
+                // +1 for len
+                // +1 for idx
+                offset += sizeof(_controllers[0].gamepad) + 1 + 1;
+            }
         }
-    }
+    } while (controllers_read_retry(seq));
 
     response[2] = total_controllers;  // total params
 
-    xSemaphoreGive(controller_mutex);
-
     // "offset" has the total length
     return offset;
 }
@@ -429,14 +530,16 @@ static int request_get_gamepad_properties(const uint8_t command[], uint8_t respo
     response[4] = RESPONSE_OK;                         // Ok
     response[5] = sizeof(_controllers_properties[0]);  // Param len
 
-    xSemaphoreTake(controller_mutex, portMAX_DELAY);
-    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
-        if (_controllers_properties[i].idx == idx) {
-            memcpy(&response[6], &_controllers_properties[i], sizeof(_controllers_properties[0]));
-            break;
+    uint32_t seq;
+    do {
+        seq = controllers_read_begin();
+        for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+            if (_controllers_properties[i].idx == idx) {
+                memcpy(&response[6], &_controllers_properties[i], sizeof(_controllers_properties[0]));
+                break;
+            }
         }
-    }
-    xSemaphoreGive(controller_mutex);
+    } while (controllers_read_retry(seq));
 
     return 6 + sizeof(nina_controller_properties_t);
 }
@@ -486,29 +589,220 @@ static int request_controllers_data(const uint8_t command[], uint8_t response[])
     //      3: param len (sizeof(_controllers[0])
     //      4: gamepad N data
 
-    xSemaphoreTake(controller_mutex, portMAX_DELAY);
-
-    int total_controllers = 0;
-    int offset = 3;
-    for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
-        if (_gamepad_seats & BIT(i)) {
-            total_controllers++;
-            // Update param len
-            response[offset] = sizeof(_controllers[0]);
-            // Update param (data)
-            memcpy(&response[offset + 1], &_controllers[i], sizeof(_controllers[0]));
-            offset += sizeof(_controllers[0]) + 1;
+    int total_controllers;
+    int offset;
+    uint32_t seq;
+
+    do {
+        seq = controllers_read_begin();
+        total_controllers = 0;
+        offset = 3;
+        for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+            if (_gamepad_seats & BIT(i)) {
+                total_controllers++;
+                // Update param len
+                response[offset] = sizeof(_controllers[0]);
+                // Update param (data)
+                memcpy(&response[offset + 1], &_controllers[i], sizeof(_controllers[0]));
+                offset += sizeof(_controllers[0]) + 1;
+            }
         }
-    }
+    } while (controllers_read_retry(seq));
 
     response[2] = total_controllers;  // total params
 
-    xSemaphoreGive(controller_mutex);
+    // "offset" has the total length
+    return offset;
+}
+
+// Returns the number of bytes written in "out"
+static int serialize_controller_fields(const nina_controller_t* c, uint8_t mask, uint8_t* out) {
+    int offset = 0;
+
+#define APPEND_FIELD(_field)                         \
+    do {                                             \
+        memcpy(&out[offset], &(_field), sizeof(_field)); \
+        offset += sizeof(_field);                    \
+    } while (0)
+
+    if (mask & BIT(CONTROLLER_FIELD_KLASS))
+        APPEND_FIELD(c->klass);
+    if (mask & BIT(CONTROLLER_FIELD_BATTERY))
+        APPEND_FIELD(c->battery);
+    if (mask & BIT(CONTROLLER_FIELD_BUTTONS)) {
+        APPEND_FIELD(c->gamepad.dpad);
+        APPEND_FIELD(c->gamepad.buttons);
+        APPEND_FIELD(c->gamepad.misc_buttons);
+    }
+    if (mask & BIT(CONTROLLER_FIELD_AXIS)) {
+        APPEND_FIELD(c->gamepad.axis_x);
+        APPEND_FIELD(c->gamepad.axis_y);
+        APPEND_FIELD(c->gamepad.axis_rx);
+        APPEND_FIELD(c->gamepad.axis_ry);
+    }
+    if (mask & BIT(CONTROLLER_FIELD_PEDALS)) {
+        APPEND_FIELD(c->gamepad.brake);
+        APPEND_FIELD(c->gamepad.throttle);
+    }
+    if (mask & BIT(CONTROLLER_FIELD_MOTION)) {
+        APPEND_FIELD(c->gamepad.gyro);
+        APPEND_FIELD(c->gamepad.accel);
+    }
+    if (mask & BIT(CONTROLLER_FIELD_DATA)) {
+        if (c->klass == CONTROLLER_CLASS_MOUSE)
+            APPEND_FIELD(c->mouse);
+        else if (c->klass == CONTROLLER_CLASS_BALANCE_BOARD)
+            APPEND_FIELD(c->balance);
+    }
+#undef APPEND_FIELD
+
+    return offset;
+}
+
+// Command 0x0a
+static int request_controllers_data_since(const uint8_t command[], uint8_t response[]) {
+    // command[2]: total params
+    // command[3]: param len
+    // command[4-7]: sequence, little endian. The one returned by the previous call. 0 to get everything.
+    //
+    // Returned struct:
+    // --- generic to all requests
+    // byte 2: number of parameters: 1 + number of changed controllers
+    //      3: param len (5)
+    //      4-7: current sequence, little endian. Should be sent in the next call.
+    //      8: connected controllers, as a bitmask of indexes
+    //      9: param len
+    //     10: controller idx
+    //     11: field mask: BIT(CONTROLLER_FIELD_xxx)
+    //     12: changed fields, in CONTROLLER_FIELD_xxx order
+    //     ...: next changed controller
+    uint32_t since = command[4] | (command[5] << 8) | (command[6] << 16) | ((uint32_t)command[7] << 24);
+
+    int total_params;
+    int offset;
+    uint32_t seq;
+
+    do {
+        seq = controllers_read_begin();
+
+        response[3] = 5;  // Param len
+        response[4] = seq & 0xff;
+        response[5] = (seq >> 8) & 0xff;
+        response[6] = (seq >> 16) & 0xff;
+        response[7] = (seq >> 24) & 0xff;
+        response[8] = _gamepad_seats;
+        total_params = 1;
+        offset = 9;
+
+        for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+            if (!(_gamepad_seats & BIT(i)))
+                continue;
+
+            uint8_t mask = 0;
+            for (int field = 0; field < CONTROLLER_FIELD_COUNT; field++) {
+                // Signed difference, to support wrap around.
+                if (since == 0 || (int32_t)(_controllers_field_seq[i][field] - since) > 0)
+                    mask |= BIT(field);
+            }
+            if (mask == 0)
+                continue;
+
+            int len = serialize_controller_fields(&_controllers[i], mask, &response[offset + 3]);
+            response[offset] = len + 2;  // Param len: +1 for idx, +1 for mask
+            response[offset + 1] = i;
+            response[offset + 2] = mask;
+            offset += len + 3;
+            total_params++;
+        }
+    } while (controllers_read_retry(seq));
+
+    response[2] = total_params;
 
     // "offset" has the total length
     return offset;
 }
 
+// Command 0x0b
+static int request_multi_command(const uint8_t command[], uint8_t response[]) {
+    // Several "output" requests in one transaction.
+    // command[2]: total params, one per request
+    // Each param:
+    //   byte 0: param len
+    //        1: command: 0x02 (player LEDs), 0x03 (color LED), 0x04 (rumble) or 0x08 (disconnect)
+    //        2: controller idx
+    //        3...: arguments, same as in the individual commands
+    //
+    // Returned struct:
+    // byte 2: number of parameters. Same as in the request.
+    //      3: param len (1)
+    //      4: RESPONSE_OK / RESPONSE_ERROR for the first request
+    //     ...: and so on for the rest of the requests
+    if (_command_len < 3)
+        return 0;
+
+    int total_params = command[2];
+    int in_offset = 3;
+    int out_offset = 3;
+
+    if (total_params > MAX_PENDING_REQUESTS)
+        return 0;
+
+    // Validate all the params before queuing any of them.
+    for (int i = 0; i < total_params; i++) {
+        if (in_offset >= _command_len)
+            return 0;
+        int len = command[in_offset];
+        if (len < 2 || in_offset + 1 + len > _command_len)
+            return 0;
+        in_offset += len + 1;
+    }
+
+    in_offset = 3;
+    for (int i = 0; i < total_params; i++) {
+        int len = command[in_offset];
+        const uint8_t* param = &command[in_offset + 1];
+        int idx = param[1];
+        pending_request_t request = {
+            .controller_idx = idx,
+        };
+        int nargs = len - 2;
+        if (nargs > (int)sizeof(request.args))
+            nargs = sizeof(request.args);
+        memcpy(request.args, &param[2], nargs);
+
+        switch (param[0]) {
+            case 0x02:
+                request.cmd = PENDING_REQUEST_CMD_PLAYER_LEDS;
+                break;
+            case 0x03:
+                request.cmd = PENDING_REQUEST_CMD_LIGHTBAR_COLOR;
+                break;
+            case 0x04:
+                request.cmd = PENDING_REQUEST_CMD_RUMBLE;
+                break;
+            case 0x08:
+                request.cmd = PENDING_REQUEST_CMD_DISCONNECT;
+                break;
+            default:
+                request.cmd = PENDING_REQUEST_CMD_NONE;
+                break;
+        }
+
+        uint8_t ret = RESPONSE_ERROR;
+        if (request.cmd != PENDING_REQUEST_CMD_NONE && idx < CONFIG_BLUEPAD32_MAX_DEVICES &&
+            xQueueSendToBack(_pending_queue, &request, (TickType_t)0) == pdTRUE)
+            ret = RESPONSE_OK;
+
+        response[out_offset] = 1;  // Param len
+        response[out_offset + 1] = ret;
+        out_offset += 2;
+        in_offset += len + 1;
+    }
+
+    response[2] = total_params;
+    return out_offset;
+}
+
 // Command 0x1a
 static int request_set_debug(const uint8_t command[], uint8_t response[]) {
     uni_uart_enable_output(command[4]);
@@ -693,8 +987,8 @@ const command_handler_t command_handlers[] = {
     request_enable_bluetooth_connections,  // Enable/Disable bluetooth connection
     request_disconnect_gamepad,            // Disconnect gamepad
     request_controllers_data,              // Gamepad, Mouse, Balance. Deprecates request_gamepads_data
-    NULL,
-    NULL,
+    request_controllers_data_since,        // Only the controllers/fields that changed since a sequence
+    request_multi_command,                 // Several LEDs/rumble/disconnect requests in one transaction
     NULL,
     NULL,
     NULL,
@@ -837,6 +1131,7 @@ static int process_request(const uint8_t command[], int command_len, uint8_t res
         if (command_handler) {
             // To make the code "compatible", we pass "command" to all the request
             // handlers. On an ideal world, we should pass &command[2] instead.
+            _command_len = command_len;
             response_len = command_handler(command, response);
         }
     }
@@ -914,9 +1209,6 @@ static void spi_main_loop(void* arg) {
     esp_err_t ret = spi_slave_initialize(VSPI_HOST, &buscfg, &slvcfg, DMA_CHANNEL);
     assert(ret == ESP_OK);
 
-    // Must be modulo 4 and word aligned.
-    // A higher value up to SPI_MAX_DMA_LEN can be defined if needed.
-#define SPI_BUFFER_LEN 256
     WORD_ALIGNED_ATTR uint8_t response_buf[SPI_BUFFER_LEN];
     WORD_ALIGNED_ATTR uint8_t command_buf[SPI_BUFFER_LEN];
 
@@ -927,9 +1219,18 @@ static void spi_main_loop(void* arg) {
             continue;
 
         // process request
+        int64_t start = esp_timer_get_time();
+        uint32_t retries = _poll_stats.retries;
         memset(response_buf, 0, SPI_BUFFER_LEN);
         int response_len = process_request(command_buf, command_len, response_buf);
 
+        // Only the polls that read controller data: "gamepads data", "controllers data" and "since".
+        if (command_len >= 2 && (command_buf[1] == 0x01 || command_buf[1] == 0x09 || command_buf[1] == 0x0a)) {
+            poll_stats_update(esp_timer_get_time() - start, _poll_stats.retries - retries);
+            if ((_poll_stats.polls % POLL_STATS_DUMP_EVERY) == 0)
+                poll_stats_dump();
+        }
+
         spi_transfer(response_buf, NULL, response_len);
     }
 }
@@ -942,6 +1243,39 @@ static void spi_main_loop(void* arg) {
 // Be extra careful when calling code that runs on the other CPU
 //
 
+static void controllers_write_begin(void) {
+    _controllers_seq++;
+    __sync_synchronize();
+}
+
+static void controllers_write_end(void) {
+    __sync_synchronize();
+    _controllers_seq++;
+}
+
+// Must be called between controllers_write_begin() and controllers_write_end().
+// "changes" is a mask of UNI_CONTROLLER_CHANGED_xxx.
+static void controllers_mark_fields_changed(int idx, uint32_t changes) {
+    // The sequence that readers will see once the write finishes.
+    uint32_t seq = _controllers_seq + 1;
+    uint32_t* fields = _controllers_field_seq[idx];
+
+    if (changes & UNI_CONTROLLER_CHANGED_CLASS)
+        fields[CONTROLLER_FIELD_KLASS] = seq;
+    if (changes & UNI_CONTROLLER_CHANGED_BATTERY)
+        fields[CONTROLLER_FIELD_BATTERY] = seq;
+    if (changes & (UNI_CONTROLLER_CHANGED_DPAD | UNI_CONTROLLER_CHANGED_BUTTONS | UNI_CONTROLLER_CHANGED_MISC_BUTTONS))
+        fields[CONTROLLER_FIELD_BUTTONS] = seq;
+    if (changes & UNI_CONTROLLER_CHANGED_AXES)
+        fields[CONTROLLER_FIELD_AXIS] = seq;
+    if (changes & UNI_CONTROLLER_CHANGED_PEDALS)
+        fields[CONTROLLER_FIELD_PEDALS] = seq;
+    if (changes & UNI_CONTROLLER_CHANGED_IMU)
+        fields[CONTROLLER_FIELD_MOTION] = seq;
+    if (changes & UNI_CONTROLLER_CHANGED_DATA)
+        fields[CONTROLLER_FIELD_DATA] = seq;
+}
+
 static void process_pending_requests(void) {
     pending_request_t request;
 
@@ -1003,9 +1337,6 @@ static void nina_init(int argc, const char** argv) {
 }
 
 static void nina_on_init_complete(void) {
-    controller_mutex = xSemaphoreCreateMutex();
-    assert(controller_mutex != NULL);
-
     _pending_queue = xQueueCreate(MAX_PENDING_REQUESTS, sizeof(pending_request_t));
     assert(_pending_queue != NULL);
 
@@ -1031,6 +1362,7 @@ static void nina_on_device_disconnected(uni_hid_device_t* d) {
                  CONFIG_BLUEPAD32_MAX_DEVICES);
             return;
         }
+        controllers_write_begin();
         _gamepad_seats &= ~BIT(ins->controller_idx);
 
         memset(&_controllers[ins->controller_idx], 0, sizeof(_controllers[0]));
@@ -1038,6 +1370,7 @@ static void nina_on_device_disconnected(uni_hid_device_t* d) {
 
         memset(&_controllers_properties[ins->controller_idx], 0, sizeof(_controllers_properties[0]));
         _controllers_properties[ins->controller_idx].idx = NINA_CONTROLLER_INVALID;
+        controllers_write_end();
 
         ins->controller_idx = NINA_CONTROLLER_INVALID;
     }
@@ -1060,7 +1393,6 @@ static uni_error_t nina_on_device_ready(uni_hid_device_t* d) {
     for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
         if ((_gamepad_seats & BIT(i)) == 0) {
             ins->controller_idx = i;
-            _gamepad_seats |= BIT(i);
             break;
         }
     }
@@ -1072,6 +1404,8 @@ static uni_error_t nina_on_device_ready(uni_hid_device_t* d) {
 
     // This is how "client" knows which gamepad emitted the events.
     int idx = ins->controller_idx;
+    controllers_write_begin();
+    _gamepad_seats |= BIT(idx);
     _controllers[idx].idx = idx;
 
     // FIXME: To save RAM gamepad_properties should be updated at "request time".
@@ -1099,6 +1433,9 @@ static uni_error_t nina_on_device_ready(uni_hid_device_t* d) {
         _controllers_properties[idx].flags |= PROPERTY_FLAG_GAMEPAD;
 
     memcpy(_controllers_properties[idx].btaddr, d->conn.btaddr, sizeof(_controllers_properties[0].btaddr));
+    // New controller: everything is reported as changed.
+    controllers_mark_fields_changed(idx, UNI_CONTROLLER_CHANGED_ALL);
+    controllers_write_end();
 
     if (d->report_parser.set_player_leds != NULL) {
         d->report_parser.set_player_leds(d, BIT(idx));
@@ -1114,7 +1451,7 @@ static uint8_t predicate_nina_index(uni_hid_device_t* d, void* data) {
     return 1;
 }
 
-static void nina_on_controller_data(uni_hid_device_t* d, uni_controller_t* ctl) {
+static void nina_on_controller_data_changed(uni_hid_device_t* d, uni_controller_t* ctl, uint32_t changes) {
     // FIXME:
     // When SPI-slave (CPU1) receives a request that cannot be fulfilled
     // immediately (e.g: the ones that needs to run on CPU0), it is processed from
@@ -1130,8 +1467,12 @@ static void nina_on_controller_data(uni_hid_device_t* d, uni_controller_t* ctl)
         return;
     }
 
+    // Nothing new for the host. Don't make the SPI readers retry.
+    if (changes == 0)
+        return;
+
     // Populate gamepad data on shared struct.
-    xSemaphoreTake(controller_mutex, portMAX_DELAY);
+    controllers_write_begin();
     switch (ctl->klass) {
         case UNI_CONTROLLER_CLASS_GAMEPAD:
             _controllers[ins->controller_idx].gamepad.dpad = ctl->gamepad.dpad;
@@ -1162,7 +1503,8 @@ static void nina_on_controller_data(uni_hid_device_t* d, uni_controller_t* ctl)
     _controllers[ins->controller_idx].klass = ctl->klass;
     _controllers[ins->controller_idx].battery = ctl->battery;
 
-    xSemaphoreGive(controller_mutex);
+    controllers_mark_fields_changed(ins->controller_idx, changes);
+    controllers_write_end();
 }
 
 static void nina_on_oob_event(uni_platform_oob_event_t event, void* data) {
@@ -1195,7 +1537,8 @@ struct uni_platform* uni_platform_nina_create(void) {
         .on_device_disconnected = nina_on_device_disconnected,
         .on_device_ready = nina_on_device_ready,
         .on_oob_event = nina_on_oob_event,
-        .on_controller_data = nina_on_controller_data,
+        // Not using "controller_data_interest": pending requests are processed on every report.
+        .on_controller_data_changed = nina_on_controller_data_changed,
         .get_property = nina_get_property,
     };
 
@@ -1212,7 +1555,7 @@ struct uni_platform* uni_platform_airlift_create(void) {
         .on_device_disconnected = nina_on_device_disconnected,
         .on_device_ready = nina_on_device_ready,
         .on_oob_event = nina_on_oob_event,
-        .on_controller_data = nina_on_controller_data,
+        .on_controller_data_changed = nina_on_controller_data_changed,
         .get_property = nina_get_property,
     };
 
@@ -6,22 +6,33 @@
 
 #include "platform/uni_platform_unijoysticle.h"
 
+#include <inttypes.h>
 #include <math.h>
 #include <stdbool.h>
 #include <sys/cdefs.h>
 
 #include <argtable3/argtable3.h>
 #include <driver/gpio.h>
+#include <driver/ledc.h>
 #include <esp_chip_info.h>
 #include <esp_console.h>
 #include <esp_flash.h>
 #include <esp_idf_version.h>
 #include <esp_ota_ops.h>
+#include <esp_rom_gpio.h>
 #include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <freertos/queue.h>
 #include <hal/gpio_types.h>
+#include <soc/gpio_reg.h>
+#include <soc/gpio_sig_map.h>
+#include <soc/soc.h>
+#if ESP_IDF_VERSION_MAJOR == 4
+#include <hal/cpu_hal.h>
+#else
+#include <esp_cpu.h>
+#endif
 
 #include "sdkconfig.h"
 
@@ -81,13 +92,20 @@
 #define AUTOFIRE_CPS_QUICKSHOT (29)        // ~17ms, ~1 frame
 #define AUTOFIRE_CPS_COMPETITION_PRO (62)  // ~8ms, ~1/2 frame
 #define AUTOFIRE_CPS_DEFAULT AUTOFIRE_CPS_QUICKGUN
+// Percentage of the period that "fire" is pressed.
+#define AUTOFIRE_DUTY_DEFAULT (50)
+
+// Autofire waveform is generated by the LEDC peripheral. One LEDC timer + channel per port.
+// Resolution is big enough to generate 1 cps with the 80Mhz APB clock.
+#define AUTOFIRE_LEDC_MODE LEDC_HIGH_SPEED_MODE
+#define AUTOFIRE_LEDC_RESOLUTION LEDC_TIMER_17_BIT
 
-#define TASK_AUTOFIRE_PRIO (9)
 #define TASK_PUSH_BUTTON_PRIO (8)
 #define TASK_BLINK_LED_PRIO (7)
 
 // Unijoysticle properties: Keep them sorted
 #define UNI_PROPERTY_NAME_UNI_AUTOFIRE_CPS "bp.uni.autofire"
+#define UNI_PROPERTY_NAME_UNI_AUTOFIRE_DUTY "bp.uni.afduty"
 #define UNI_PROPERTY_NAME_UNI_BB_FIRE_THRESHOLD "bp.uni.bb_fire"
 #define UNI_PROPERTY_NAME_UNI_BB_MOVE_THRESHOLD "bp.uni.bb_move"
 #define UNI_PROPERTY_NAME_UNI_C64_POT_MODE "bp.uni.c64pot"
@@ -104,10 +122,6 @@ enum {
     // Push buttons
     EVENT_BUTTON_0 = UNI_PLATFORM_UNIJOYSTICLE_PUSH_BUTTON_0,
     EVENT_BUTTON_1 = UNI_PLATFORM_UNIJOYSTICLE_PUSH_BUTTON_1,
-
-    // Autofire group
-    EVENT_AUTOFIRE_TRIGGER = 0,
-    EVENT_AUTOFIRE_CONFIG = 1,
 };
 
 typedef enum {
@@ -148,8 +162,37 @@ typedef enum {
 // It might not be true for newer models, like the Falcon.
 #define ATARIST_MOUSE_DELTA_MAX (28)
 
+// Ports, used as index for the port GPIO masks
+enum {
+    PORT_A,
+    PORT_B,
+    PORT_MAX,
+};
+
+// ESP32 has two GPIO output banks: GPIO 0-31 and GPIO 32-39
+enum {
+    GPIO_BANK_0,
+    GPIO_BANK_1,
+    GPIO_BANK_MAX,
+};
+
 // --- Structs / Typedefs
 
+// Precomputed GPIO masks of a port, so that all its lines can be updated
+// with one W1TS + one W1TC write per GPIO bank.
+struct port_gpio_masks {
+    uint32_t lines[UNI_PLATFORM_UNIJOYSTICLE_JOY_MAX][GPIO_BANK_MAX];
+    uint32_t all[GPIO_BANK_MAX];
+};
+
+// CPU cycles spent in joy_update_port()
+struct port_update_stats {
+    uint32_t updates;
+    uint32_t last_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+};
+
 // This is the "state" of the push button, and changes in runtime.
 // This is the "mutable" part of the button that is stored in RAM.
 // The "fixed" part is stored in ROM.
@@ -171,7 +214,8 @@ static void process_mouse(uni_hid_device_t* d,
 static void process_gamepad(uni_hid_device_t* d, uni_gamepad_t* gp);
 static void process_balance_board(uni_hid_device_t* d, uni_balance_board_t* bb);
 static void process_keyboard(uni_hid_device_t* d, uni_keyboard_t* kb);
-static void joy_update_port(const uni_joystick_t* joy, const gpio_num_t* gpios);
+static void init_port_masks(void);
+static void joy_update_port(const uni_joystick_t* joy, int port);
 static void init_quadrature_mouse(void);
 static int get_mouse_emulation_from_nvs(void);
 // Interrupt handlers
@@ -179,7 +223,9 @@ static void handle_event_button(int button_idx);
 // GPIO Interrupt handlers
 static void gpio_isr_handler_button(void* arg);
 _Noreturn static void pushbutton_event_task(void* arg);
-_Noreturn static void auto_fire_task(void* arg);
+static void init_autofire(void);
+static void set_autofire_enabled(int port, bool enabled);
+static void update_autofire_config(void);
 static void maybe_enable_mouse_timers(void);
 // Commands or Event related
 static int cmd_swap_ports(int argc, char** argv);
@@ -223,6 +269,8 @@ static const uni_property_t properties[] = {
      .default_value.u32 = 0, .flags = UNI_PROPERTY_FLAG_READ_ONLY},
     {UNI_PROPERTY_IDX_UNI_VENDOR, UNI_PROPERTY_NAME_UNI_VENDOR, UNI_PROPERTY_TYPE_STRING,
      .default_value.str = "Unknown", .flags = UNI_PROPERTY_FLAG_READ_ONLY},
+    {UNI_PROPERTY_IDX_UNI_AUTOFIRE_DUTY, UNI_PROPERTY_NAME_UNI_AUTOFIRE_DUTY, UNI_PROPERTY_TYPE_U8,
+     .default_value.u8 = AUTOFIRE_DUTY_DEFAULT},
 };
 _Static_assert(ARRAY_SIZE(properties) == (UNI_PROPERTY_IDX_UNI_LAST - UNI_PROPERTY_IDX_LAST), "Invalid property size");
 
@@ -232,14 +280,15 @@ static const struct uni_platform_unijoysticle_variant* g_variant;
 // Used as cache of g_variant->gpio_config
 static const struct uni_platform_unijoysticle_gpio_config* g_gpio_config;
 
+static struct port_gpio_masks g_port_masks[PORT_MAX];
+static struct port_update_stats g_port_update_stats[PORT_MAX];
+
 static EventGroupHandle_t g_pushbutton_group;
-static EventGroupHandle_t g_autofire_group;
 
 struct push_button_state g_push_buttons_state[UNI_PLATFORM_UNIJOYSTICLE_PUSH_BUTTON_MAX] = {0};
 
 // Autofire
-static bool g_autofire_a_enabled;
-static bool g_autofire_b_enabled;
+static bool g_autofire_enabled[PORT_MAX];
 
 // Button "mode". Used in A500/C64/800XL
 static int s_bluetooth_led_on;  // Used as a cache
@@ -259,6 +308,7 @@ static struct {
 
 static struct {
     struct arg_int* value;
+    struct arg_int* duty;
     struct arg_end* end;
 } autofire_cps_args;
 
@@ -306,6 +356,8 @@ static void unijoysticle_init(int argc, const char** argv) {
     g_gpio_config = g_variant->gpio_config;
     logi("Hardware detected: Unijoysticle%s\n", g_variant->name);
 
+    init_port_masks();
+
     gpio_config_t io_conf = {0};
 
     io_conf.intr_type = GPIO_INTR_DISABLE;
@@ -340,12 +392,10 @@ static void unijoysticle_init(int argc, const char** argv) {
     // Tasks should be created before the ISR, just in case an interrupt
     // gets called before the Task-that-handles-the-ISR gets triggered.
 
-    // Split "events" from "auto_fire", since auto-fire is an ongoing event.
     g_pushbutton_group = xEventGroupCreate();
     xTaskCreate(pushbutton_event_task, "bp.uni.button", 4096, NULL, TASK_PUSH_BUTTON_PRIO, NULL);
 
-    g_autofire_group = xEventGroupCreate();
-    xTaskCreate(auto_fire_task, "bp.uni.autofire", 4096, NULL, TASK_AUTOFIRE_PRIO, NULL);
+    init_autofire();
 
     // Push Buttons
     ESP_ERROR_CHECK(gpio_install_isr_service(0));
@@ -687,6 +737,17 @@ static void unijoysticle_device_dump(uni_hid_device_t* d) {
         }
     }
     logi("seat=0x%02x\n", ins->seat);
+
+    for (int i = 0; i < PORT_MAX; i++) {
+        if (!(ins->seat & (i == PORT_A ? GAMEPAD_SEAT_A : GAMEPAD_SEAT_B)))
+            continue;
+        const struct port_update_stats* st = &g_port_update_stats[i];
+        if (st->updates != 0)
+            logi("\tport %c updates: %" PRIu32 ", cycles: last=%" PRIu32 ", max=%" PRIu32 ", avg=%" PRIu32 "\n",
+                 'A' + i, st->updates, st->last_cycles, st->max_cycles, (uint32_t)(st->total_cycles / st->updates));
+        if (uni_hid_device_is_mouse(d) || ins->gamepad_mode == UNI_PLATFORM_UNIJOYSTICLE_GAMEPAD_MODE_MOUSE)
+            uni_mouse_quadrature_dump(i == PORT_A ? UNI_MOUSE_QUADRATURE_PORT_0 : UNI_MOUSE_QUADRATURE_PORT_1);
+    }
 }
 
 static void init_quadrature_mouse(void) {
@@ -821,7 +882,8 @@ static void unijoysticle_register_cmds(void) {
     gamepad_mode_args.end = arg_end(2);
 
     autofire_cps_args.value = arg_int1(NULL, NULL, "<cps>", "clicks per second (cps)");
-    autofire_cps_args.end = arg_end(2);
+    autofire_cps_args.duty = arg_int0(NULL, NULL, "<duty>", "percentage of the time that fire is pressed");
+    autofire_cps_args.end = arg_end(3);
 
     const esp_console_cmd_t swap_ports = {
         .command = "swap_ports",
@@ -844,8 +906,8 @@ static void unijoysticle_register_cmds(void) {
     const esp_console_cmd_t autofire_cps = {
         .command = "autofire_cps",
         .help =
-            "Get/Set the autofire 'clicks per second' (cps)\n"
-            "Default: 7",
+            "Get/Set the autofire 'clicks per second' (cps) and duty cycle\n"
+            "Default: 7 cps, 50% duty",
         .hint = NULL,
         .func = &cmd_autofire_cps,
         .argtable = &autofire_cps_args,
@@ -914,6 +976,21 @@ static int get_autofire_cps_from_nvs(void) {
     return value.u8;
 }
 
+static void set_autofire_duty_to_nvs(int duty) {
+    uni_property_value_t value;
+    value.u8 = duty;
+
+    uni_property_set(UNI_PROPERTY_IDX_UNI_AUTOFIRE_DUTY, value);
+    logi("Done\n");
+}
+
+static int get_autofire_duty_from_nvs(void) {
+    uni_property_value_t value;
+
+    value = uni_property_get(UNI_PROPERTY_IDX_UNI_AUTOFIRE_DUTY);
+    return value.u8;
+}
+
 static board_model_t get_uni_model_from_pins(void) {
 #if PLAT_UNIJOYSTICLE_SINGLE_PORT
     // Legacy: Only needed for Arananet's Unijoy2Amiga.
@@ -1036,19 +1113,17 @@ static void process_mouse(uni_hid_device_t* d,
 
 static void process_joystick(uni_hid_device_t* d, uni_gamepad_seat_t seat, const uni_joystick_t* joy) {
     ARG_UNUSED(d);
+    // Autofire must be updated before the port, so that "fire" is released to the GPIO
+    // before joy_update_port() sets its value.
     if (seat == GAMEPAD_SEAT_A) {
-        joy_update_port(joy, g_gpio_config->port_a);
-        g_autofire_a_enabled = joy->auto_fire;
+        set_autofire_enabled(PORT_A, joy->auto_fire);
+        joy_update_port(joy, PORT_A);
     } else if (seat == GAMEPAD_SEAT_B) {
-        joy_update_port(joy, g_gpio_config->port_b);
-        g_autofire_b_enabled = joy->auto_fire;
+        set_autofire_enabled(PORT_B, joy->auto_fire);
+        joy_update_port(joy, PORT_B);
     } else {
         loge("unijoysticle: process_joystick: invalid gamepad seat: %d\n", seat);
     }
-
-    if (g_autofire_a_enabled || g_autofire_b_enabled) {
-        xEventGroupSetBits(g_autofire_group, BIT(EVENT_AUTOFIRE_TRIGGER));
-    }
 }
 
 static void process_gamepad(uni_hid_device_t* d, uni_gamepad_t* gp) {
@@ -1194,27 +1269,85 @@ static void set_gamepad_seat(uni_hid_device_t* d, uni_gamepad_seat_t seat) {
     }
 }
 
-static void joy_update_port(const uni_joystick_t* joy, const gpio_num_t* gpios) {
+static inline uint32_t get_cycle_count(void) {
+#if ESP_IDF_VERSION_MAJOR == 4
+    return cpu_hal_get_cycle_count();
+#else
+    return esp_cpu_get_cycle_count();
+#endif
+}
+
+static void init_port_masks(void) {
+    const gpio_num_t* ports[PORT_MAX] = {g_gpio_config->port_a, g_gpio_config->port_b};
+
+    for (int port = 0; port < PORT_MAX; port++) {
+        struct port_gpio_masks* m = &g_port_masks[port];
+        for (int i = 0; i < UNI_PLATFORM_UNIJOYSTICLE_JOY_MAX; i++) {
+            gpio_num_t gpio = ports[port][i];
+            if (gpio == -1)
+                continue;
+            if (gpio < 32)
+                m->lines[i][GPIO_BANK_0] = BIT(gpio);
+            else
+                m->lines[i][GPIO_BANK_1] = BIT(gpio - 32);
+            m->all[GPIO_BANK_0] |= m->lines[i][GPIO_BANK_0];
+            m->all[GPIO_BANK_1] |= m->lines[i][GPIO_BANK_1];
+        }
+    }
+}
+
+static void joy_update_port(const uni_joystick_t* joy, int port) {
     logd("up=%d, down=%d, left=%d, right=%d, fire=%d, bt2=%d, bt3=%d\n", joy->up, joy->down, joy->left, joy->right,
          joy->fire, joy->button2, joy->button3);
 
-    uni_gpio_set_level(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_UP], joy->up);
-    uni_gpio_set_level(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_DOWN], joy->down);
-    uni_gpio_set_level(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_LEFT], joy->left);
-    uni_gpio_set_level(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_RIGHT], joy->right);
+    uint32_t start = get_cycle_count();
 
-    // Only update fire if auto-fire is off. Otherwise it will conflict.
-    if (!joy->auto_fire) {
-        uni_gpio_set_level(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_FIRE], joy->fire);
-    }
+    const struct port_gpio_masks* m = &g_port_masks[port];
+    uni_platform_unijoysticle_pot_output_t pot_output =
+        g_variant->get_pot_output ? g_variant->get_pot_output() : UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_NORMAL;
+    bool pot_inverted = (pot_output == UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_INVERTED);
 
-    if (g_variant->set_gpio_level_for_pot) {
-        g_variant->set_gpio_level_for_pot(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_BUTTON2], joy->button2);
-        g_variant->set_gpio_level_for_pot(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_BUTTON3], joy->button3);
-    } else {
-        uni_gpio_set_level(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_BUTTON2], joy->button2);
-        uni_gpio_set_level(gpios[UNI_PLATFORM_UNIJOYSTICLE_JOY_BUTTON3], joy->button3);
+    // Same order as UNI_PLATFORM_UNIJOYSTICLE_JOY_xxx
+    const bool values[UNI_PLATFORM_UNIJOYSTICLE_JOY_MAX] = {
+        joy->up,   joy->down, joy->left, joy->right, joy->fire, (joy->button2 != 0) != pot_inverted,
+        (joy->button3 != 0) != pot_inverted,
+    };
+
+    for (int bank = 0; bank < GPIO_BANK_MAX; bank++) {
+        uint32_t mask = m->all[bank];
+        if (mask == 0)
+            continue;
+
+        // Only update fire if auto-fire is off. Otherwise it will conflict.
+        if (joy->auto_fire)
+            mask &= ~m->lines[UNI_PLATFORM_UNIJOYSTICLE_JOY_FIRE][bank];
+        if (pot_output == UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_DISABLED)
+            mask &= ~(m->lines[UNI_PLATFORM_UNIJOYSTICLE_JOY_BUTTON2][bank] |
+                      m->lines[UNI_PLATFORM_UNIJOYSTICLE_JOY_BUTTON3][bank]);
+
+        uint32_t high = 0;
+        for (int i = 0; i < UNI_PLATFORM_UNIJOYSTICLE_JOY_MAX; i++) {
+            if (values[i])
+                high |= m->lines[i][bank];
+        }
+        high &= mask;
+
+        if (bank == GPIO_BANK_0) {
+            REG_WRITE(GPIO_OUT_W1TS_REG, high);
+            REG_WRITE(GPIO_OUT_W1TC_REG, mask & ~high);
+        } else {
+            REG_WRITE(GPIO_OUT1_W1TS_REG, high);
+            REG_WRITE(GPIO_OUT1_W1TC_REG, mask & ~high);
+        }
     }
+
+    uint32_t cycles = get_cycle_count() - start;
+    struct port_update_stats* st = &g_port_update_stats[port];
+    st->updates++;
+    st->last_cycles = cycles;
+    st->total_cycles += cycles;
+    if (cycles > st->max_cycles)
+        st->max_cycles = cycles;
 }
 
 _Noreturn static void pushbutton_event_task(void* arg) {
@@ -1236,40 +1369,72 @@ _Noreturn static void pushbutton_event_task(void* arg) {
     }
 }
 
-_Noreturn static void auto_fire_task(void* arg) {
-    // timeout of 100s
-    const TickType_t timeout = pdMS_TO_TICKS(100000);
-    int ms = 1000 / get_autofire_cps_from_nvs() / 2;
-    TickType_t delay_ticks = pdMS_TO_TICKS(ms);
-    while (1) {
-        EventBits_t bits = xEventGroupWaitBits(
-            g_autofire_group, BIT(EVENT_AUTOFIRE_TRIGGER) | BIT(EVENT_AUTOFIRE_CONFIG), pdTRUE, pdFALSE, timeout);
+static gpio_num_t get_fire_gpio(int port) {
+    if (port == PORT_A)
+        return g_gpio_config->port_a[UNI_PLATFORM_UNIJOYSTICLE_JOY_FIRE];
+    return g_gpio_config->port_b[UNI_PLATFORM_UNIJOYSTICLE_JOY_FIRE];
+}
 
-        // timeout ?
-        if (bits == 0)
-            continue;
+static uint32_t get_autofire_ledc_duty(void) {
+    return ((1 << AUTOFIRE_LEDC_RESOLUTION) * get_autofire_duty_from_nvs()) / 100;
+}
 
-        if (bits & BIT(EVENT_AUTOFIRE_CONFIG)) {
-            ms = 1000 / get_autofire_cps_from_nvs() / 2;
-            delay_ticks = pdMS_TO_TICKS(ms);
-        }
+static void init_autofire(void) {
+    // One timer per port so that each port can have its own phase.
+    for (int i = 0; i < PORT_MAX; i++) {
+        ledc_timer_config_t timer_conf = {
+            .speed_mode = AUTOFIRE_LEDC_MODE,
+            .duty_resolution = AUTOFIRE_LEDC_RESOLUTION,
+            .timer_num = LEDC_TIMER_0 + i,
+            .freq_hz = get_autofire_cps_from_nvs(),
+            .clk_cfg = LEDC_USE_APB_CLK,
+        };
+        ESP_ERROR_CHECK(ledc_timer_config(&timer_conf));
+        ledc_timer_pause(AUTOFIRE_LEDC_MODE, LEDC_TIMER_0 + i);
+    }
+}
 
-        if (bits & BIT(EVENT_AUTOFIRE_TRIGGER)) {
-            while (g_autofire_a_enabled || g_autofire_b_enabled) {
-                if (g_autofire_a_enabled)
-                    uni_gpio_set_level(g_gpio_config->port_a[UNI_PLATFORM_UNIJOYSTICLE_JOY_FIRE], 1);
-                if (g_autofire_b_enabled)
-                    uni_gpio_set_level(g_gpio_config->port_b[UNI_PLATFORM_UNIJOYSTICLE_JOY_FIRE], 1);
+// The "fire" GPIO is routed to the LEDC channel while autofire is enabled, so there is no
+// CPU involvement while firing. Once disabled, the GPIO is routed back to the GPIO matrix.
+static void set_autofire_enabled(int port, bool enabled) {
+    if (g_autofire_enabled[port] == enabled)
+        return;
 
-                vTaskDelay(delay_ticks);
+    gpio_num_t gpio = get_fire_gpio(port);
+    if (gpio == -1)
+        return;
 
-                if (g_autofire_a_enabled)
-                    uni_gpio_set_level(g_gpio_config->port_a[UNI_PLATFORM_UNIJOYSTICLE_JOY_FIRE], 0);
-                if (g_autofire_b_enabled)
-                    uni_gpio_set_level(g_gpio_config->port_b[UNI_PLATFORM_UNIJOYSTICLE_JOY_FIRE], 0);
+    g_autofire_enabled[port] = enabled;
+
+    if (enabled) {
+        ledc_channel_config_t channel_conf = {
+            .gpio_num = gpio,
+            .speed_mode = AUTOFIRE_LEDC_MODE,
+            .channel = LEDC_CHANNEL_0 + port,
+            .intr_type = LEDC_INTR_DISABLE,
+            .timer_sel = LEDC_TIMER_0 + port,
+            .duty = get_autofire_ledc_duty(),
+            // Fire is pressed at the beginning of the period.
+            .hpoint = 0,
+        };
+        ESP_ERROR_CHECK(ledc_channel_config(&channel_conf));
+        // Align the phase to the moment autofire was pressed: the first "click" happens right away.
+        ledc_timer_rst(AUTOFIRE_LEDC_MODE, LEDC_TIMER_0 + port);
+        ledc_timer_resume(AUTOFIRE_LEDC_MODE, LEDC_TIMER_0 + port);
+    } else {
+        ledc_stop(AUTOFIRE_LEDC_MODE, LEDC_CHANNEL_0 + port, 0 /* idle level */);
+        ledc_timer_pause(AUTOFIRE_LEDC_MODE, LEDC_TIMER_0 + port);
+        esp_rom_gpio_connect_out_signal(gpio, SIG_GPIO_OUT_IDX, false, false);
+    }
+}
 
-                vTaskDelay(delay_ticks);
-            }
+static void update_autofire_config(void) {
+    uint32_t duty = get_autofire_ledc_duty();
+    for (int i = 0; i < PORT_MAX; i++) {
+        ledc_set_freq(AUTOFIRE_LEDC_MODE, LEDC_TIMER_0 + i, get_autofire_cps_from_nvs());
+        if (g_autofire_enabled[i]) {
+            ledc_set_duty(AUTOFIRE_LEDC_MODE, LEDC_CHANNEL_0 + i, duty);
+            ledc_update_duty(AUTOFIRE_LEDC_MODE, LEDC_CHANNEL_0 + i);
         }
     }
 }
@@ -1717,15 +1882,33 @@ static int cmd_autofire_cps(int argc, char** argv) {
 
         // Don't treat as error, just print current value.
         cps = get_autofire_cps_from_nvs();
-        logi("%d\n", cps);
+        logi("%d cps, %d%% duty\n", cps, get_autofire_duty_from_nvs());
         return 0;
     }
     cps = autofire_cps_args.value->ival[0];
-    set_autofire_cps_to_nvs(cps);
+    if (cps < 1 || cps > 255) {
+        loge("Invalid autofire cps: %d. Valid values: 1 - 255\n", cps);
+        return 1;
+    }
 
+    // Validate both before storing any of them.
+    int duty = -1;
+    if (autofire_cps_args.duty->count > 0) {
+        duty = autofire_cps_args.duty->ival[0];
+        if (duty < 1 || duty > 99) {
+            loge("Invalid autofire duty: %d. Valid values: 1 - 99\n", duty);
+            return 1;
+        }
+    }
+
+    set_autofire_cps_to_nvs(cps);
     logi("New autofire cps: %d\n", cps);
+    if (duty != -1) {
+        set_autofire_duty_to_nvs(duty);
+        logi("New autofire duty: %d%%\n", duty);
+    }
 
-    xEventGroupSetBits(g_autofire_group, BIT(EVENT_AUTOFIRE_CONFIG));
+    update_autofire_config();
     return 0;
 }
 
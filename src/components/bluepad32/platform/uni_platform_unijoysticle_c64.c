@@ -8,13 +8,23 @@
 
 #include "platform/uni_platform_unijoysticle_c64.h"
 
+#include <inttypes.h>
 #include <stdbool.h>
 
 #include <argtable3/argtable3.h>
+#include <driver/timer.h>
 #include <esp_console.h>
 #include <esp_err.h>
+#include <esp_idf_version.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+#if ESP_IDF_VERSION_MAJOR == 4
+#include <hal/cpu_hal.h>
+#else
+#include <esp_cpu.h>
+#endif
 
 #include "sdkconfig.h"
 
@@ -26,7 +36,19 @@
 
 #define TASK_SYNC_IRQ_PRIO (9)
 #define uS_MIN 3
-#define uS_MAX 243  // Larger values cause the interrupt to take too long
+#define uS_MAX 243
+
+// Time that the SID needs to discharge the capacitor.
+// According to the spec, this should be 320 microseconds.
+// Value taken from the original busy-wait implementation, which had function overhead on top.
+#define SID_DISCHARGE_US 220
+
+// Paddle release edges are generated with one-shot alarms, one per pot.
+// The sync ISR only arms them. No busy-waits in the ISR.
+// Timers are free since the quadrature mouse uses RMT.
+#define PADDLE_TIMER_GROUP TIMER_GROUP_0
+// APB clock runs at 80Mhz. 80Mhz / 80 = 1Mhz = tick every 1us
+#define PADDLE_TIMER_DIVIDER (80)
 
 // CPU where the Pot task runs
 #define POT_TASK_CPU 1
@@ -42,9 +64,31 @@ static int get_c64_pot_mode_from_nvs(void);
 // GPIO Interrupt handlers
 static void sync_irq_event_task(void* arg);
 
-static volatile bool pot_x_leads = true;  // if false, y leads
-static volatile uint16_t pot_x_delay_us = uS_MAX;
-static volatile uint16_t pot_y_delay_us = uS_MAX;
+enum {
+    PADDLE_POT_X,
+    PADDLE_POT_Y,
+    PADDLE_POT_MAX,
+};
+
+// Delays are relative to the end of the SID discharge.
+static volatile uint16_t pot_delays_us[PADDLE_POT_MAX] = {uS_MAX, uS_MAX};
+
+// Stats to measure the edge placement: how late was the edge compared to the target.
+struct paddle_stats {
+    uint64_t targets[PADDLE_POT_MAX];
+    uint32_t edges[PADDLE_POT_MAX];
+    uint32_t max_error_us[PADDLE_POT_MAX];
+    uint64_t total_error_us[PADDLE_POT_MAX];
+    // CPU cycles spent in the sync ISR
+    uint32_t isr_count;
+    uint32_t isr_max_cycles;
+    uint64_t isr_total_cycles;
+};
+static struct paddle_stats s_paddle_stats;
+static bool s_paddle_timers_initialized;
+// Pot GPIOs, copied to DRAM: the paddle ISRs can run while the flash cache is disabled
+// (e.g: NVS writes), so they can't read the config table in flash or call gpio_set_level().
+static DRAM_ATTR gpio_num_t s_paddle_gpios[PADDLE_POT_MAX];
 
 // --- Consts (ROM)
 
@@ -78,6 +122,7 @@ static const char* c64_pot_modes[] = {
     "3buttons",  // UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_3BUTTONS
     "5buttons",  // UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_5BUTTONS
     "rumble",    // UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_RUMBLE
+    "paddle",    // UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_PADDLE
 };
 
 // Globals to the file (RAM)
@@ -166,36 +211,121 @@ static IRAM_ATTR void gpio_isr_handler_sync(void* arg) {
         portYIELD_FROM_ISR();
 }
 
-inline void delay_us(uint32_t delay) {
+static inline uint32_t get_cycle_count(void) {
 #if ESP_IDF_VERSION_MAJOR == 4
-    ets_delay_us(delay);
+    return cpu_hal_get_cycle_count();
 #else
-    esp_rom_delay_us(delay);
+    return esp_cpu_get_cycle_count();
 #endif
 }
 
+static inline gpio_num_t get_paddle_gpio(int pot) {
+    return gpio_config_univ2c64.port_a[(pot == PADDLE_POT_X) ? UNI_PLATFORM_UNIJOYSTICLE_JOY_BUTTON3
+                                                             : UNI_PLATFORM_UNIJOYSTICLE_JOY_BUTTON2];
+}
+
+static inline IRAM_ATTR void set_paddle_level(int pot, bool level) {
+    gpio_num_t gpio = s_paddle_gpios[pot];
+
+    if (gpio < 32)
+        REG_WRITE(level ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, BIT(gpio));
+    else
+        REG_WRITE(level ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, BIT(gpio - 32));
+}
+
+static IRAM_ATTR bool paddle_timer_handler(void* arg) {
+    int pot = (int)arg;
+    uint64_t now = timer_group_get_counter_value_in_isr(PADDLE_TIMER_GROUP, pot);
+
+    set_paddle_level(pot, 0);
+
+    uint32_t error = (uint32_t)(now - s_paddle_stats.targets[pot]);
+    s_paddle_stats.edges[pot]++;
+    s_paddle_stats.total_error_us[pot] += error;
+    if (error > s_paddle_stats.max_error_us[pot])
+        s_paddle_stats.max_error_us[pot] = error;
+
+    // No task was woken up
+    return false;
+}
+
 static IRAM_ATTR void gpio_isr_handler_paddle(void* arg) {
     // From:
     // https://github.com/LeifBloomquist/JoystickEmulator/blob/master/Arduino/PaddleEmulator/PaddleEmulator.ino
-    gpio_set_level(GPIO_NUM_16, 1);
-    gpio_set_level(GPIO_NUM_33, 1);
-
-    // Wait while the SID discharges the capacitor.
-    // According to the spec, this should be 320 microseconds.
-    // With function overhead and so on, this seems about right.
-    delay_us(220);
-
-    // Now, delay the amount required to represent the desired values.
-    if (pot_x_leads) {
-        delay_us(pot_x_delay_us);
-        gpio_set_level(GPIO_NUM_16, 0);
-        delay_us(pot_y_delay_us);  // This is a delta!
-        gpio_set_level(GPIO_NUM_33, 0);
-    } else {
-        delay_us(pot_y_delay_us);
-        gpio_set_level(GPIO_NUM_33, 0);
-        delay_us(pot_x_delay_us);  // This is a delta!
-        gpio_set_level(GPIO_NUM_16, 0);
+    uint32_t start = get_cycle_count();
+
+    // Hold the lines high while the SID discharges the capacitor, and then release them
+    // after the amount required to represent the desired values.
+    // The release is done by the timer alarms.
+    for (int pot = 0; pot < PADDLE_POT_MAX; pot++) {
+        set_paddle_level(pot, 1);
+        uint64_t now = timer_group_get_counter_value_in_isr(PADDLE_TIMER_GROUP, pot);
+        uint64_t target = now + SID_DISCHARGE_US + pot_delays_us[pot];
+        s_paddle_stats.targets[pot] = target;
+        timer_group_set_alarm_value_in_isr(PADDLE_TIMER_GROUP, pot, target);
+        timer_group_enable_alarm_in_isr(PADDLE_TIMER_GROUP, pot);
+    }
+
+    uint32_t cycles = get_cycle_count() - start;
+    s_paddle_stats.isr_count++;
+    s_paddle_stats.isr_total_cycles += cycles;
+    if (cycles > s_paddle_stats.isr_max_cycles)
+        s_paddle_stats.isr_max_cycles = cycles;
+}
+
+static void init_paddle_timers(void) {
+    // The timer ISR is attached to the CPU that calls this function.
+    if (s_paddle_timers_initialized)
+        return;
+
+    timer_config_t config = {
+        .divider = PADDLE_TIMER_DIVIDER,
+        .counter_dir = TIMER_COUNT_UP,
+        .counter_en = TIMER_PAUSE,
+        .alarm_en = TIMER_ALARM_DIS,
+        .auto_reload = TIMER_AUTORELOAD_DIS,
+    };
+
+    for (int pot = 0; pot < PADDLE_POT_MAX; pot++) {
+        s_paddle_gpios[pot] = get_paddle_gpio(pot);
+        ESP_ERROR_CHECK(timer_init(PADDLE_TIMER_GROUP, pot, &config));
+        timer_set_counter_value(PADDLE_TIMER_GROUP, pot, 0);
+        timer_isr_callback_add(PADDLE_TIMER_GROUP, pot, paddle_timer_handler, (void*)pot, ESP_INTR_FLAG_IRAM);
+        timer_start(PADDLE_TIMER_GROUP, pot);
+    }
+    s_paddle_timers_initialized = true;
+}
+
+static void stop_paddle(void) {
+    gpio_num_t gpio = gpio_config_univ2c64.sync_irq[0];
+
+    // Sync ISR first, so that the alarms are not armed again.
+    if (gpio != -1) {
+        gpio_set_intr_type(gpio, GPIO_INTR_DISABLE);
+        gpio_isr_handler_remove(gpio);
+    }
+
+    if (!s_paddle_timers_initialized)
+        return;
+    for (int pot = 0; pot < PADDLE_POT_MAX; pot++) {
+        timer_set_alarm(PADDLE_TIMER_GROUP, pot, TIMER_ALARM_DIS);
+        // Release the line, in case an alarm was pending.
+        set_paddle_level(pot, 0);
+    }
+}
+
+static void print_paddle_stats(void) {
+    const struct paddle_stats* st = &s_paddle_stats;
+
+    if (st->isr_count == 0)
+        return;
+    logi("\tPaddle sync ISR: count=%" PRIu32 ", cycles: max=%" PRIu32 ", avg=%" PRIu32 "\n", st->isr_count,
+         st->isr_max_cycles, (uint32_t)(st->isr_total_cycles / st->isr_count));
+    for (int pot = 0; pot < PADDLE_POT_MAX; pot++) {
+        if (st->edges[pot] == 0)
+            continue;
+        logi("\tPaddle pot %c edge error: max=%" PRIu32 "us, avg=%" PRIu32 "us\n", (pot == PADDLE_POT_X) ? 'X' : 'Y',
+             st->max_error_us[pot], (uint32_t)(st->total_error_us[pot] / st->edges[pot]));
     }
 }
 
@@ -255,6 +385,9 @@ static void set_pot_mode_from_cpu(void* m) {
         goto exit;
     }
 
+    if (_pot_mode == UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_PADDLE)
+        stop_paddle();
+
     _pot_mode = mode;
     set_c64_pot_mode_to_nvs(mode);
 
@@ -314,6 +447,8 @@ static void set_pot_mode_from_cpu(void* m) {
             ESP_ERROR_CHECK(gpio_isr_handler_add(gpio, gpio_isr_handler_sync, (void*)i));
         }
     } else if (mode == UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_PADDLE) {
+        init_paddle_timers();
+
         // Sync IRQs
         for (int i = 0; i < 1; i++) {
             gpio_num_t gpio = gpio_config_univ2c64.sync_irq[i];
@@ -347,6 +482,7 @@ void uni_platform_unijoysticle_c64_set_pot_mode(uni_platform_unijoysticle_c64_po
 
 void uni_platform_unijoysticle_c64_version(void) {
     logi("\tPot mode: %s\n", c64_pot_modes[get_c64_pot_mode_from_nvs()]);
+    print_paddle_stats();
 }
 
 static void process_5button(uni_hid_device_t* d, uni_gamepad_seat_t seat, uint8_t misc_buttons) {
@@ -382,15 +518,6 @@ static void process_paddle(uni_hid_device_t* d, uni_gamepad_seat_t seat, uint8_t
     int delay_x = (1024 - gp->brake) / 4;
     int delay_y = (1024 - gp->throttle) / 4;
 
-    // Now the trick to keep everything in one interrupt.  Use the other delay as a delta!
-    if (delay_x < delay_y) {
-        pot_x_leads = true;
-        delay_y -= delay_x;
-    } else {
-        pot_x_leads = false;
-        delay_x -= delay_y;
-    }
-
     if (delay_x > uS_MAX)
         delay_x = uS_MAX;
     else if (delay_x < uS_MIN)
@@ -401,8 +528,8 @@ static void process_paddle(uni_hid_device_t* d, uni_gamepad_seat_t seat, uint8_t
     else if (delay_y < uS_MIN)
         delay_y = uS_MIN;
 
-    pot_x_delay_us = delay_x;
-    pot_y_delay_us = delay_y;
+    pot_delays_us[PADDLE_POT_X] = delay_x;
+    pot_delays_us[PADDLE_POT_Y] = delay_y;
 #endif
 }
 
@@ -410,19 +537,27 @@ static void process_paddle(uni_hid_device_t* d, uni_gamepad_seat_t seat, uint8_t
 // Variant overrides
 //
 
+static uni_platform_unijoysticle_pot_output_t get_pot_output_c64(void) {
+    switch (_pot_mode) {
+        case UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_3BUTTONS:
+        case UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_5BUTTONS:
+            // C64 uses pull-ups for Pot-x, Pot-y, so the value needs to be "inverted" to be off.
+            return UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_INVERTED;
+        case UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_RUMBLE:
+            // Leave it disabled to allow the SYNC to reach ESP32 without interference.
+            return UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_NORMAL;
+        default:
+            // Paddle, or mode not set yet.
+            return UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_DISABLED;
+    }
+}
+
 static void set_gpio_level_for_pot_c64(gpio_num_t gpio_num, bool level) {
-    if (_pot_mode == UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_3BUTTONS ||
-        _pot_mode == UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_5BUTTONS) {
-        // C64 uses pull-ups for Pot-x, Pot-y, so the value needs to be "inverted" to be off.
+    uni_platform_unijoysticle_pot_output_t output = get_pot_output_c64();
+    if (output == UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_INVERTED)
         uni_gpio_set_level(gpio_num, !level);
-    } else if (_pot_mode == UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_RUMBLE) {
-        // Leave it disabled to allow the SYNC to reach ESP32 without interference.
+    else if (output == UNI_PLATFORM_UNIJOYSTICLE_POT_OUTPUT_NORMAL)
         uni_gpio_set_level(gpio_num, level);
-    } else if (_pot_mode == UNI_PLATFORM_UNIJOYSTICLE_C64_POT_MODE_PADDLE) {
-        // do nothing
-    } else {
-        loge("unijoysticle: unsupported pot_level mode: %d\n", _pot_mode);
-    }
 }
 
 static void on_init_complete_c64(void) {
@@ -485,7 +620,7 @@ const struct uni_platform_unijoysticle_variant* uni_platform_unijoysticle_c64_cr
         .on_init_complete = on_init_complete_c64,
         .register_console_cmds = register_console_cmds_c64,
         .process_gamepad_misc_buttons = process_gamepad_misc_buttons_c64,
-        .set_gpio_level_for_pot = set_gpio_level_for_pot_c64,
+        .get_pot_output = get_pot_output_c64,
         .preferred_seat_for_mouse = GAMEPAD_SEAT_A,
         .preferred_seat_for_joystick = GAMEPAD_SEAT_B,
     };
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#include "uni_boot.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <btstack.h>
+
+#include "uni_common.h"
+#include "uni_config.h"
+#include "uni_log.h"
+#include "uni_system.h"
+
+#if defined(CONFIG_BLUEPAD32_BOOT_TIMELINE) || defined(CONFIG_BLUEPAD32_FAST_BOOT)
+#define BOOT_PHASES_ENABLED 1
+#endif  // defined(CONFIG_BLUEPAD32_BOOT_TIMELINE) || defined(CONFIG_BLUEPAD32_FAST_BOOT)
+
+#ifdef BOOT_PHASES_ENABLED
+
+_Static_assert(UNI_BOOT_PHASE_COUNT <= 32, "Too many boot phases");
+
+static uint32_t phases_us[UNI_BOOT_PHASE_COUNT];
+// Bitmask of the recorded phases
+static uint32_t phases_marked;
+// The dump and the deferred work are done from the run loop, not from the caller.
+static btstack_timer_source_t timer;
+
+#ifdef CONFIG_BLUEPAD32_FAST_BOOT
+// Console, GATT service, stdio, list of keys... a few are enough.
+#define MAX_DEFERRED_FNS 8
+static uni_boot_deferred_fn_t deferred_fns[MAX_DEFERRED_FNS];
+static int deferred_fns_count;
+static bool boot_complete;
+#endif  // CONFIG_BLUEPAD32_FAST_BOOT
+
+static void on_timer(btstack_timer_source_t* ts) {
+    ARG_UNUSED(ts);
+
+#ifdef CONFIG_BLUEPAD32_FAST_BOOT
+    if (!boot_complete) {
+        // Set before calling them, so that they can call uni_boot_defer() as well.
+        boot_complete = true;
+        for (int i = 0; i < deferred_fns_count; i++)
+            deferred_fns[i]();
+        deferred_fns_count = 0;
+        uni_boot_mark(UNI_BOOT_PHASE_DEFERRED_DONE);
+    }
+#endif  // CONFIG_BLUEPAD32_FAST_BOOT
+
+#if defined(CONFIG_BLUEPAD32_BOOT_TIMELINE) && !defined(CONFIG_TARGET_PICO_W)
+    // Pico W: not printed. stdout is usually USB CDC, and the host didn't open it this early,
+    // even less so if stdio was just initialized by the deferred work. Use the "boot" command.
+    if (phases_marked & BIT(UNI_BOOT_PHASE_FIRST_REPORT))
+        uni_boot_dump();
+#endif  // defined(CONFIG_BLUEPAD32_BOOT_TIMELINE) && !defined(CONFIG_TARGET_PICO_W)
+}
+
+static void schedule(uint32_t delay_ms) {
+    btstack_run_loop_remove_timer(&timer);
+    btstack_run_loop_set_timer_handler(&timer, on_timer);
+    btstack_run_loop_set_timer(&timer, delay_ms);
+    btstack_run_loop_add_timer(&timer);
+}
+
+void UNI_HOT_FUNC(uni_boot_mark)(uni_boot_phase_t phase) {
+    // Common case, called for each report.
+    if (phases_marked & BIT(phase))
+        return;
+
+    phases_us[phase] = uni_system_get_time_us();
+    phases_marked |= BIT(phase);
+
+    if (phase == UNI_BOOT_PHASE_FIRST_REPORT) {
+        schedule(0);
+    }
+#ifdef CONFIG_BLUEPAD32_FAST_BOOT
+    else if (phase == UNI_BOOT_PHASE_INIT_COMPLETE) {
+        // In case no controller connects, or it doesn't send reports.
+        schedule(CONFIG_BLUEPAD32_FAST_BOOT_TIMEOUT_MS);
+    }
+#endif  // CONFIG_BLUEPAD32_FAST_BOOT
+}
+
+#else
+
+void uni_boot_mark(uni_boot_phase_t phase) {
+    ARG_UNUSED(phase);
+}
+
+#endif  // BOOT_PHASES_ENABLED
+
+void uni_boot_defer(uni_boot_deferred_fn_t fn) {
+#ifdef CONFIG_BLUEPAD32_FAST_BOOT
+    if (!boot_complete) {
+        if (deferred_fns_count < MAX_DEFERRED_FNS) {
+            deferred_fns[deferred_fns_count++] = fn;
+            return;
+        }
+        loge("Fast boot: Too many deferred functions, calling it now\n");
+    }
+#endif  // CONFIG_BLUEPAD32_FAST_BOOT
+    fn();
+}
+
+#ifdef CONFIG_BLUEPAD32_BOOT_TIMELINE
+static const char* phase_names[UNI_BOOT_PHASE_COUNT] = {
+    [UNI_BOOT_PHASE_MAIN] = "main",
+    [UNI_BOOT_PHASE_STDIO_INIT] = "stdio_init",
+    [UNI_BOOT_PHASE_CYW43_INIT] = "cyw43_init",
+    [UNI_BOOT_PHASE_UNI_INIT] = "uni_init",
+    [UNI_BOOT_PHASE_PROPERTY_INIT] = "property_init",
+    [UNI_BOOT_PHASE_PLATFORM_INIT] = "platform_init",
+    [UNI_BOOT_PHASE_HCI_POWER_ON] = "hci_power_on",
+    [UNI_BOOT_PHASE_UNI_INIT_DONE] = "uni_init_done",
+    [UNI_BOOT_PHASE_HCI_WORKING] = "hci_working",
+    [UNI_BOOT_PHASE_SETUP_COMPLETE] = "setup_complete",
+    [UNI_BOOT_PHASE_INIT_COMPLETE] = "init_complete",
+    [UNI_BOOT_PHASE_FIRST_CONNECTION] = "first_connection",
+    [UNI_BOOT_PHASE_FIRST_READY] = "first_ready",
+    [UNI_BOOT_PHASE_FIRST_REPORT] = "first_report",
+    [UNI_BOOT_PHASE_DEFERRED_DONE] = "deferred_done",
+};
+
+// Sorted by time: with fast boot, some phases (e.g: stdio_init) happen after the first report.
+// Returns the number of recorded phases.
+static int get_sorted_phases(uint8_t order[UNI_BOOT_PHASE_COUNT]) {
+    int count = 0;
+
+    for (int phase = 0; phase < UNI_BOOT_PHASE_COUNT; phase++) {
+        if (!(phases_marked & BIT(phase)))
+            continue;
+        int i = count++;
+        while (i > 0 && phases_us[order[i - 1]] > phases_us[phase]) {
+            order[i] = order[i - 1];
+            i--;
+        }
+        order[i] = phase;
+    }
+    return count;
+}
+
+void uni_boot_dump(void) {
+    for (int step = 0; uni_boot_dump_step(step); step++) {
+    }
+}
+
+bool uni_boot_dump_step(int step) {
+    uint8_t order[UNI_BOOT_PHASE_COUNT];
+    // Phases might be marked between two steps. Good enough for a dump.
+    int count = get_sorted_phases(order);
+
+    if (step == 0) {
+        logi("Boot timeline:\n");
+        return true;
+    }
+    if (step == 1) {
+        logi("\t%-16s %10s %10s\n", "phase", "time_us", "delta_us");
+        return true;
+    }
+
+    int i = step - 2;
+    if (i < count) {
+        uint32_t t = phases_us[order[i]];
+        uint32_t delta = i > 0 ? t - phases_us[order[i - 1]] : 0;
+        logi("\t%-16s %10" PRIu32 " %10" PRIu32 "\n", phase_names[order[i]], t, delta);
+        return true;
+    }
+
+    if (i == count) {
+        if (count > 0 && (phases_marked & BIT(UNI_BOOT_PHASE_FIRST_REPORT)))
+            logi("First report: %" PRIu32 " us after %s\n",
+                 phases_us[UNI_BOOT_PHASE_FIRST_REPORT] - phases_us[order[0]], phase_names[order[0]]);
+        return IS_ENABLED(CONFIG_BLUEPAD32_FAST_BOOT);
+    }
+
+#ifdef CONFIG_BLUEPAD32_FAST_BOOT
+    logi("Fast boot: enabled, %s\n", boot_complete ? "deferred work done" : "deferred work pending");
+#endif  // CONFIG_BLUEPAD32_FAST_BOOT
+    return false;
+}
+#endif  // CONFIG_BLUEPAD32_BOOT_TIMELINE
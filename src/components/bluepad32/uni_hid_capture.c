@@ -0,0 +1,675 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#include "uni_hid_capture.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <btstack.h>
+
+#include "bt/uni_bt_conn.h"
+#include "uni_common.h"
+#include "uni_config.h"
+#include "uni_log.h"
+#include "uni_system.h"
+
+#define MAGIC "BP32CAP"
+#define MAGIC_LEN 7
+#define MAX_VARINT_LEN 5
+// type + dt / timestamp + len + report
+#define MAX_REPORT_RECORD_LEN (1 + MAX_VARINT_LEN + 1 + UNI_HID_CAPTURE_MAX_REPORT_LEN)
+// type + vid + pid + cod + protocol + name_len
+#define DEVICE_RECORD_HEADER_LEN (1 + 2 + 2 + 4 + 1 + 1)
+#define RECORD_HEADER(type, idx) ((uint8_t)(((type) << 4) | (idx)))
+
+_Static_assert(CONFIG_BLUEPAD32_MAX_DEVICES <= UNI_HID_CAPTURE_MAX_DEVICES, "Capture format supports 16 devices");
+_Static_assert(UNI_HID_CAPTURE_MAX_REPORT_LEN < 256, "Report len is stored in 1 byte");
+_Static_assert(HID_MAX_NAME_LEN < 256, "Name len is stored in 1 byte");
+
+static int put_varint(uint8_t* out, uint32_t value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+// Returns the number of bytes used, or -1 if the varint is invalid.
+static int get_varint(const uint8_t* data, size_t len, uint32_t* value) {
+    *value = 0;
+    for (int i = 0; i < MAX_VARINT_LEN && (size_t)i < len; i++) {
+        *value |= (uint32_t)(data[i] & 0x7f) << (7 * i);
+        if ((data[i] & 0x80) == 0)
+            return i + 1;
+    }
+    return -1;
+}
+
+static void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xff;
+    out[1] = value >> 8;
+}
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    put_u16(out, value & 0xffff);
+    put_u16(out + 2, value >> 16);
+}
+
+static uint16_t get_u16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* data) {
+    return get_u16(data) | ((uint32_t)get_u16(data + 2) << 16);
+}
+
+//
+// Recorder
+//
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+
+// Unchanged bytes that are cheaper to include in a run than to start a new one.
+#define MAX_RUN_GAP 2
+#define DUMP_BYTES_PER_LINE 32
+
+typedef void (*write_fn_t)(const uint8_t* data, uint32_t len);
+
+enum {
+    CMD_DUMP,
+    CMD_CLEAR,
+    CMD_ENABLE,
+    CMD_DISABLE,
+};
+
+typedef struct {
+    uint8_t report[UNI_HID_CAPTURE_MAX_REPORT_LEN];
+    uint8_t len;
+    bool valid;
+    uint8_t since_keyframe;
+} capture_device_t;
+
+// Records are stored back to back, from "tail" (oldest) to "head", wrapping around.
+static uint8_t ring[CONFIG_BLUEPAD32_HID_CAPTURE_BUFFER_SIZE];
+static uint32_t ring_head;
+static uint32_t ring_tail;
+static uint32_t ring_used;
+// Position of "ring_tail" in the stream: bytes removed from the ring since boot.
+static uint32_t ring_tail_pos;
+
+static capture_device_t devices[CONFIG_BLUEPAD32_MAX_DEVICES];
+static uint32_t last_record_us;
+static bool enabled;
+
+static struct {
+    uint32_t records;
+    uint32_t overwritten;  // Oldest records removed to make room
+    uint32_t dropped;      // Records bigger than the ring
+    uint32_t truncated;    // Reports longer than UNI_HID_CAPTURE_MAX_REPORT_LEN
+    uint32_t raw_bytes;    // Report bytes before encoding
+    uint32_t bytes;        // Encoded bytes, including the framing
+    uint64_t cost_total_us;
+    uint32_t cost_max_us;
+} stats;
+
+static uint8_t dump_line[DUMP_BYTES_PER_LINE];
+static int dump_line_len;
+// Stream positions of the next byte to dump, and of the end of the dump.
+static uint32_t dump_pos;
+static uint32_t dump_end;
+
+static btstack_context_callback_registration_t cmd_callback_registration;
+
+static uint8_t ring_peek(uint32_t offset) {
+    return ring[(ring_tail + offset) % sizeof(ring)];
+}
+
+static void ring_write(const uint8_t* data, uint32_t len) {
+    uint32_t first = sizeof(ring) - ring_head;
+    if (first > len)
+        first = len;
+    memcpy(&ring[ring_head], data, first);
+    memcpy(ring, data + first, len - first);
+    ring_head = (ring_head + len) % sizeof(ring);
+    ring_used += len;
+}
+
+static void ring_drop_oldest(void) {
+    uint32_t body_len = 0;
+    uint32_t i = 0;
+    uint8_t b;
+
+    do {
+        b = ring_peek(i);
+        body_len |= (uint32_t)(b & 0x7f) << (7 * i);
+        i++;
+    } while (b & 0x80);
+
+    ring_tail = (ring_tail + i + body_len) % sizeof(ring);
+    ring_tail_pos += i + body_len;
+    ring_used -= i + body_len;
+    stats.overwritten++;
+}
+
+static bool ring_reserve(uint32_t len) {
+    if (len > sizeof(ring)) {
+        stats.dropped++;
+        return false;
+    }
+    while (sizeof(ring) - ring_used < len)
+        ring_drop_oldest();
+    return true;
+}
+
+static void UNI_HOT_FUNC(put_record)(const uint8_t* body, uint32_t len) {
+    uint8_t prefix[MAX_VARINT_LEN];
+    int n = put_varint(prefix, len);
+
+    if (!ring_reserve(n + len))
+        return;
+    ring_write(prefix, n);
+    ring_write(body, len);
+    stats.records++;
+    stats.bytes += n + len;
+}
+
+static void UNI_HOT_FUNC(update_cost)(uint32_t start_us) {
+    uint32_t cost = uni_system_get_time_us() - start_us;
+    stats.cost_total_us += cost;
+    if (cost > stats.cost_max_us)
+        stats.cost_max_us = cost;
+}
+
+// Returns the length of the record, or 0 if it is not smaller than the full one.
+static int UNI_HOT_FUNC(encode_delta)(uint8_t* body,
+                                      int idx,
+                                      uint32_t dt,
+                                      const uint8_t* prev,
+                                      const uint8_t* cur,
+                                      uint8_t len) {
+    int full_len = 1 + 4 + 1 + len;
+    int last = 0;
+    int i = 0;
+    int n = 0;
+
+    body[n++] = RECORD_HEADER(UNI_HID_CAPTURE_RECORD_INPUT_DELTA, idx);
+    n += put_varint(&body[n], dt);
+    body[n++] = len;
+
+    while (i < len) {
+        if (cur[i] == prev[i]) {
+            i++;
+            continue;
+        }
+
+        int start = i;
+        int end = i + 1;
+        while (end < len) {
+            if (cur[end] != prev[end]) {
+                end++;
+                continue;
+            }
+            int gap = 1;
+            while (gap <= MAX_RUN_GAP && end + gap < len && cur[end + gap] == prev[end + gap])
+                gap++;
+            if (gap > MAX_RUN_GAP || end + gap >= len)
+                break;
+            end += gap + 1;
+        }
+
+        int count = end - start;
+        if (n + 2 + count >= full_len)
+            return 0;
+        body[n++] = start - last;
+        body[n++] = count;
+        memcpy(&body[n], &cur[start], count);
+        n += count;
+        last = end;
+        i = end;
+    }
+    return n < full_len ? n : 0;
+}
+
+static uint32_t get_device_record_body_len(uni_hid_device_t* d) {
+    uint16_t desc_len = uni_hid_device_get_hid_descriptor(d) ? d->hid_descriptor_len : 0;
+    return DEVICE_RECORD_HEADER_LEN + strnlen(d->name, HID_MAX_NAME_LEN - 1) + 2 + desc_len;
+}
+
+// Returns the number of bytes written.
+static uint32_t write_device_record(uni_hid_device_t* d, int idx, write_fn_t write) {
+    uint8_t header[MAX_VARINT_LEN + DEVICE_RECORD_HEADER_LEN];
+    uint8_t desc_len_buf[2];
+    const uint8_t* desc = uni_hid_device_get_hid_descriptor(d);
+    uint16_t desc_len = desc ? d->hid_descriptor_len : 0;
+    uint8_t name_len = strnlen(d->name, HID_MAX_NAME_LEN - 1);
+    uint32_t body_len = get_device_record_body_len(d);
+
+    int n = put_varint(header, body_len);
+    header[n++] = RECORD_HEADER(UNI_HID_CAPTURE_RECORD_DEVICE, idx);
+    put_u16(&header[n], d->vendor_id);
+    put_u16(&header[n + 2], d->product_id);
+    put_u32(&header[n + 4], d->cod);
+    header[n + 8] = d->conn.protocol;
+    header[n + 9] = name_len;
+    n += 10;
+    put_u16(desc_len_buf, desc_len);
+
+    write(header, n);
+    write((const uint8_t*)d->name, name_len);
+    write(desc_len_buf, sizeof(desc_len_buf));
+    if (desc_len)
+        write(desc, desc_len);
+    return n + name_len + sizeof(desc_len_buf) + desc_len;
+}
+
+void uni_hid_capture_init(void) {
+    uni_hid_capture_clear();
+    enabled = true;
+    logi("HID capture: enabled, buffer size: %d bytes\n", CONFIG_BLUEPAD32_HID_CAPTURE_BUFFER_SIZE);
+}
+
+void uni_hid_capture_set_enabled(bool value) {
+    enabled = value;
+}
+
+bool uni_hid_capture_is_enabled(void) {
+    return enabled;
+}
+
+void uni_hid_capture_clear(void) {
+    // Everything is removed. Aborts the dump in progress, if any.
+    ring_tail_pos += ring_used;
+    ring_head = 0;
+    ring_tail = 0;
+    ring_used = 0;
+    memset(devices, 0, sizeof(devices));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void uni_hid_capture_on_device(uni_hid_device_t* d) {
+    if (!enabled)
+        return;
+
+    int idx = uni_hid_device_get_idx_for_instance(d);
+    if (idx < 0)
+        return;
+
+    // A new connection: the next input report can't be a delta.
+    devices[idx].valid = false;
+
+    uint8_t prefix[MAX_VARINT_LEN];
+    uint32_t body_len = get_device_record_body_len(d);
+
+    if (!ring_reserve(put_varint(prefix, body_len) + body_len))
+        return;
+    stats.records++;
+    stats.bytes += write_device_record(d, idx, ring_write);
+}
+
+void UNI_HOT_FUNC(uni_hid_capture_on_input_report)(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
+    uint8_t body[MAX_REPORT_RECORD_LEN];
+    int n = 0;
+
+    if (!enabled)
+        return;
+
+    uint32_t now = uni_system_get_time_us();
+    int idx = uni_hid_device_get_idx_for_instance(d);
+    if (idx < 0)
+        return;
+    capture_device_t* cd = &devices[idx];
+
+    stats.raw_bytes += len;
+    if (len > UNI_HID_CAPTURE_MAX_REPORT_LEN) {
+        len = UNI_HID_CAPTURE_MAX_REPORT_LEN;
+        stats.truncated++;
+    }
+
+    if (cd->valid && cd->len == len && cd->since_keyframe < UNI_HID_CAPTURE_KEYFRAME_INTERVAL)
+        n = encode_delta(body, idx, now - last_record_us, cd->report, report, len);
+
+    if (n == 0) {
+        body[0] = RECORD_HEADER(UNI_HID_CAPTURE_RECORD_INPUT_FULL, idx);
+        put_u32(&body[1], now);
+        body[5] = len;
+        memcpy(&body[6], report, len);
+        n = 6 + len;
+        cd->since_keyframe = 0;
+    } else {
+        cd->since_keyframe++;
+    }
+
+    memcpy(cd->report, report, len);
+    cd->len = len;
+    cd->valid = true;
+    last_record_us = now;
+
+    put_record(body, n);
+    update_cost(now);
+}
+
+// Output and feature reports. They are not delta-encoded: they are few, and they are not
+// similar to the previous one.
+static void put_report_record(uni_hid_device_t* d,
+                              uni_hid_capture_record_type_t type,
+                              const uint8_t* report,
+                              uint16_t len) {
+    uint8_t body[MAX_REPORT_RECORD_LEN];
+    int n = 0;
+
+    if (!enabled)
+        return;
+
+    uint32_t now = uni_system_get_time_us();
+    int idx = uni_hid_device_get_idx_for_instance(d);
+    if (idx < 0)
+        return;
+
+    stats.raw_bytes += len;
+    if (len > UNI_HID_CAPTURE_MAX_REPORT_LEN) {
+        len = UNI_HID_CAPTURE_MAX_REPORT_LEN;
+        stats.truncated++;
+    }
+
+    body[n++] = RECORD_HEADER(type, idx);
+    n += put_varint(&body[n], now - last_record_us);
+    body[n++] = len;
+    memcpy(&body[n], report, len);
+    n += len;
+    last_record_us = now;
+
+    put_record(body, n);
+    update_cost(now);
+}
+
+void uni_hid_capture_on_output_report(uni_hid_device_t* d, bool ctrl, const uint8_t* report, uint16_t len) {
+    put_report_record(d, ctrl ? UNI_HID_CAPTURE_RECORD_OUTPUT_CTRL : UNI_HID_CAPTURE_RECORD_OUTPUT_INTR, report, len);
+}
+
+void uni_hid_capture_on_feature_report(uni_hid_device_t* d, const uint8_t* report, uint16_t len) {
+    put_report_record(d, UNI_HID_CAPTURE_RECORD_FEATURE, report, len);
+}
+
+static void dump_flush(void) {
+    char hex[DUMP_BYTES_PER_LINE * 2 + 1];
+
+    if (dump_line_len == 0)
+        return;
+    for (int i = 0; i < dump_line_len; i++)
+        sprintf(&hex[i * 2], "%02x", dump_line[i]);
+    logi("bp32cap:%s\n", hex);
+    dump_line_len = 0;
+}
+
+static void dump_write(const uint8_t* data, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        dump_line[dump_line_len++] = data[i];
+        if (dump_line_len == DUMP_BYTES_PER_LINE)
+            dump_flush();
+    }
+}
+
+static void dump_stats(void) {
+    logi("HID capture: %" PRIu32 " records (%" PRIu32 " overwritten, %" PRIu32 " dropped, %" PRIu32
+         " truncated), buffer: %" PRIu32 "/%d bytes\n",
+         stats.records, stats.overwritten, stats.dropped, stats.truncated, ring_used,
+         CONFIG_BLUEPAD32_HID_CAPTURE_BUFFER_SIZE);
+    logi("HID capture: reports: %" PRIu32 " bytes, encoded: %" PRIu32 " bytes (%" PRIu32 "%%)\n", stats.raw_bytes,
+         stats.bytes, stats.raw_bytes ? (uint32_t)((uint64_t)stats.bytes * 100 / stats.raw_bytes) : 0);
+    logi("HID capture: cost per record: avg=%" PRIu32 ".%02" PRIu32 " us, max=%" PRIu32 " us\n",
+         stats.records ? (uint32_t)(stats.cost_total_us / stats.records) : 0,
+         stats.records ? (uint32_t)(stats.cost_total_us * 100 / stats.records % 100) : 0, stats.cost_max_us);
+}
+
+// Step 0: the header. Steps 1..MAX_DEVICES: the connected devices. Then the ring, one line per step.
+// Recording goes on in between: only the records that were in the ring at step 0 are dumped.
+bool uni_hid_capture_dump_step(int step) {
+    if (step == 0) {
+        const uint8_t header[] = {'B', 'P', '3', '2', 'C', 'A', 'P', UNI_HID_CAPTURE_VERSION};
+        dump_line_len = 0;
+        dump_pos = ring_tail_pos;
+        dump_end = ring_tail_pos + ring_used;
+        dump_write(header, sizeof(header));
+        return true;
+    }
+
+    if (step <= CONFIG_BLUEPAD32_MAX_DEVICES) {
+        // Connected devices go first, in case their own DEVICE records were overwritten.
+        // If they were not, the ones in the ring take precedence since they come later.
+        uni_hid_device_t* d = uni_hid_device_get_instance_for_idx(step - 1);
+        uni_bt_conn_state_t state = uni_bt_conn_get_state(&d->conn);
+        if (state == UNI_BT_CONN_STATE_DEVICE_PENDING_READY || state == UNI_BT_CONN_STATE_DEVICE_READY)
+            write_device_record(d, step - 1, dump_write);
+        return true;
+    }
+
+    // Overwritten by the new records since the dump started.
+    if ((int32_t)(dump_pos - ring_tail_pos) < 0) {
+        dump_flush();
+        loge("HID capture: records overwritten while dumping. Dump is incomplete\n");
+        return false;
+    }
+
+    // Up to the end of the current line.
+    uint32_t offset = dump_pos - ring_tail_pos;
+    int n = DUMP_BYTES_PER_LINE - dump_line_len;
+    while (n-- > 0 && dump_pos != dump_end) {
+        uint8_t b = ring_peek(offset++);
+        dump_pos++;
+        dump_write(&b, 1);
+    }
+    if (dump_pos != dump_end)
+        return true;
+
+    dump_flush();
+    dump_stats();
+    return false;
+}
+
+void uni_hid_capture_dump(void) {
+    for (int step = 0; uni_hid_capture_dump_step(step); step++) {
+    }
+}
+
+static void cmd_callback(void* context) {
+    switch ((intptr_t)context) {
+        case CMD_DUMP:
+            uni_hid_capture_dump();
+            break;
+        case CMD_CLEAR:
+            uni_hid_capture_clear();
+            break;
+        case CMD_ENABLE:
+            uni_hid_capture_set_enabled(true);
+            break;
+        case CMD_DISABLE:
+            uni_hid_capture_set_enabled(false);
+            break;
+        default:
+            loge("HID capture: invalid command: %d\n", (int)(intptr_t)context);
+            break;
+    }
+}
+
+static void execute_on_main_thread(intptr_t cmd) {
+    cmd_callback_registration.callback = &cmd_callback;
+    cmd_callback_registration.context = (void*)cmd;
+    btstack_run_loop_execute_on_main_thread(&cmd_callback_registration);
+}
+
+void uni_hid_capture_dump_safe(void) {
+    execute_on_main_thread(CMD_DUMP);
+}
+
+void uni_hid_capture_clear_safe(void) {
+    execute_on_main_thread(CMD_CLEAR);
+}
+
+void uni_hid_capture_set_enabled_safe(bool value) {
+    execute_on_main_thread(value ? CMD_ENABLE : CMD_DISABLE);
+}
+
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+
+//
+// Decoder
+//
+typedef struct {
+    uint8_t report[UNI_HID_CAPTURE_MAX_REPORT_LEN];
+    uint8_t len;
+    bool valid;
+} decoder_device_t;
+
+static int decode_device(const uint8_t* p,
+                         const uint8_t* end,
+                         int idx,
+                         const uni_hid_capture_decoder_t* decoder,
+                         void* context) {
+    uni_hid_capture_device_t device;
+
+    if (end - p < DEVICE_RECORD_HEADER_LEN - 1)
+        return -1;
+
+    memset(&device, 0, sizeof(device));
+    device.vendor_id = get_u16(p);
+    device.product_id = get_u16(p + 2);
+    device.cod = get_u32(p + 4);
+    device.protocol = p[8];
+    uint8_t name_len = p[9];
+    p += 10;
+
+    if (end - p < name_len + 2 || name_len >= sizeof(device.name))
+        return -1;
+    memcpy(device.name, p, name_len);
+    p += name_len;
+
+    device.hid_descriptor_len = get_u16(p);
+    p += 2;
+    if (end - p != device.hid_descriptor_len)
+        return -1;
+    device.hid_descriptor = device.hid_descriptor_len ? p : NULL;
+
+    if (decoder->on_device)
+        decoder->on_device(context, idx, &device);
+    return 0;
+}
+
+int uni_hid_capture_decode(const uint8_t* data, size_t len, const uni_hid_capture_decoder_t* decoder, void* context) {
+    decoder_device_t devs[UNI_HID_CAPTURE_MAX_DEVICES];
+    uint32_t now = 0;
+    bool has_time = false;
+    size_t pos = MAGIC_LEN + 1;
+
+    if (len < pos || memcmp(data, MAGIC, MAGIC_LEN) != 0) {
+        loge("HID capture: invalid header\n");
+        return -1;
+    }
+    if (data[MAGIC_LEN] < 1 || data[MAGIC_LEN] > UNI_HID_CAPTURE_VERSION) {
+        loge("HID capture: unsupported version %d\n", data[MAGIC_LEN]);
+        return -1;
+    }
+
+    memset(devs, 0, sizeof(devs));
+
+    while (pos < len) {
+        size_t record_pos = pos;
+        uint32_t body_len;
+        uint32_t dt;
+        int n = get_varint(&data[pos], len - pos, &body_len);
+        if (n < 0 || body_len == 0 || body_len > len - pos - n) {
+            loge("HID capture: truncated record at offset %zu\n", pos);
+            return -1;
+        }
+
+        const uint8_t* p = &data[pos + n];
+        const uint8_t* end = p + body_len;
+        int type = p[0] >> 4;
+        int idx = p[0] & 0x0f;
+        decoder_device_t* dev = &devs[idx];
+        p++;
+        pos += n + body_len;
+
+        switch (type) {
+            case UNI_HID_CAPTURE_RECORD_DEVICE:
+                if (decode_device(p, end, idx, decoder, context) != 0)
+                    goto invalid;
+                dev->valid = false;
+                break;
+
+            case UNI_HID_CAPTURE_RECORD_INPUT_FULL:
+                if (end - p < 5 || end - p - 5 != p[4] || p[4] > UNI_HID_CAPTURE_MAX_REPORT_LEN)
+                    goto invalid;
+                now = get_u32(p);
+                has_time = true;
+                dev->len = p[4];
+                dev->valid = true;
+                memcpy(dev->report, p + 5, dev->len);
+                if (decoder->on_report)
+                    decoder->on_report(context, idx, type, now, dev->report, dev->len);
+                break;
+
+            case UNI_HID_CAPTURE_RECORD_INPUT_DELTA: {
+                n = get_varint(p, end - p, &dt);
+                if (n < 0 || end - p < n + 1)
+                    goto invalid;
+                uint8_t report_len = p[n];
+                if (report_len > UNI_HID_CAPTURE_MAX_REPORT_LEN)
+                    goto invalid;
+                p += n + 1;
+                if (has_time)
+                    now += dt;
+
+                // The previous report was overwritten. Wait for the next INPUT_FULL.
+                if (!has_time || !dev->valid || dev->len != report_len) {
+                    dev->valid = false;
+                    break;
+                }
+
+                int offset = 0;
+                while (p < end) {
+                    if (end - p < 2)
+                        goto invalid;
+                    int skip = p[0];
+                    int count = p[1];
+                    p += 2;
+                    if (end - p < count || offset + skip + count > report_len)
+                        goto invalid;
+                    offset += skip;
+                    memcpy(&dev->report[offset], p, count);
+                    offset += count;
+                    p += count;
+                }
+                if (decoder->on_report)
+                    decoder->on_report(context, idx, UNI_HID_CAPTURE_RECORD_INPUT_FULL, now, dev->report,
+                                       dev->len);
+                break;
+            }
+
+            case UNI_HID_CAPTURE_RECORD_OUTPUT_INTR:
+            case UNI_HID_CAPTURE_RECORD_OUTPUT_CTRL:
+            case UNI_HID_CAPTURE_RECORD_FEATURE:
+                n = get_varint(p, end - p, &dt);
+                if (n < 0 || end - p < n + 1 || end - p - n - 1 != p[n])
+                    goto invalid;
+                // Delivered even without a time base: the setup replies usually come before
+                // the first input report.
+                if (has_time)
+                    now += dt;
+                if (decoder->on_report)
+                    decoder->on_report(context, idx, type, now, p + n + 1, p[n]);
+                break;
+
+            default:
+                goto invalid;
+        }
+        continue;
+
+    invalid:
+        loge("HID capture: invalid record type=%d at offset %zu\n", type, record_pos);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#include "uni_hid_descriptor.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "uni_common.h"
+#include "uni_log.h"
+
+// What each device used to reserve for its HID descriptor. Used to compare the memory used.
+#define INLINE_DESCRIPTOR_LEN 512
+
+// At most one descriptor per device: uni_hid_device_set_hid_descriptor() releases the old
+// descriptor before acquiring a new one.
+#define MAX_DESCRIPTORS CONFIG_BLUEPAD32_MAX_DEVICES
+_Static_assert(MAX_DESCRIPTORS < 256, "uni_hid_descriptor_handle_t too small");
+_Static_assert(UNI_HID_DESCRIPTOR_ARENA_SIZE <= UINT16_MAX, "Arena offsets are 16-bit");
+
+typedef struct {
+    uint32_t hash;
+    uint16_t offset;
+    uint16_t len;
+    uint8_t refcount;  // 0 means the entry is free
+} descriptor_entry_t;
+
+// Descriptors are stored back to back, in [0, used). There are no holes: the arena is compacted
+// when a descriptor is removed.
+static uint8_t arena[UNI_HID_DESCRIPTOR_ARENA_SIZE];
+static uint16_t used;
+static descriptor_entry_t entries[MAX_DESCRIPTORS];
+
+// Stats
+static uint16_t peak_used;
+static uint32_t shared_hits;  // Times a descriptor was already in the arena
+static uint32_t failures;     // Times a descriptor didn't fit
+
+// FNV-1a
+static uint32_t hash_data(const uint8_t* data, uint16_t len) {
+    uint32_t h = 2166136261u;
+    for (uint16_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static descriptor_entry_t* get_entry(uni_hid_descriptor_handle_t handle) {
+    if (handle == UNI_HID_DESCRIPTOR_HANDLE_NONE || handle > MAX_DESCRIPTORS)
+        return NULL;
+    descriptor_entry_t* e = &entries[handle - 1];
+    if (e->refcount == 0)
+        return NULL;
+    return e;
+}
+
+uni_hid_descriptor_handle_t uni_hid_descriptor_acquire(const uint8_t* data, uint16_t len) {
+    if (data == NULL || len == 0)
+        return UNI_HID_DESCRIPTOR_HANDLE_NONE;
+
+    uint32_t hash = hash_data(data, len);
+    int free_idx = -1;
+
+    for (int i = 0; i < MAX_DESCRIPTORS; i++) {
+        descriptor_entry_t* e = &entries[i];
+        if (e->refcount == 0) {
+            if (free_idx == -1)
+                free_idx = i;
+            continue;
+        }
+        if (e->hash == hash && e->len == len && memcmp(&arena[e->offset], data, len) == 0) {
+            e->refcount++;
+            shared_hits++;
+            return i + 1;
+        }
+    }
+
+    if (free_idx == -1 || len > sizeof(arena) - used) {
+        loge("HID descriptor: no space for %d bytes (used %d of %d bytes, %d entries)\n", len, used,
+             (int)sizeof(arena), MAX_DESCRIPTORS);
+        failures++;
+        return UNI_HID_DESCRIPTOR_HANDLE_NONE;
+    }
+
+    descriptor_entry_t* e = &entries[free_idx];
+    e->hash = hash;
+    e->offset = used;
+    e->len = len;
+    e->refcount = 1;
+    memcpy(&arena[used], data, len);
+    used += len;
+    if (used > peak_used)
+        peak_used = used;
+
+    return free_idx + 1;
+}
+
+void uni_hid_descriptor_release(uni_hid_descriptor_handle_t handle) {
+    descriptor_entry_t* e = get_entry(handle);
+    if (e == NULL)
+        return;
+
+    if (--e->refcount > 0)
+        return;
+
+    // Compact: move the descriptors that are after this one.
+    uint16_t end = e->offset + e->len;
+    memmove(&arena[e->offset], &arena[end], used - end);
+    for (int i = 0; i < MAX_DESCRIPTORS; i++) {
+        if (entries[i].refcount > 0 && entries[i].offset > e->offset)
+            entries[i].offset -= e->len;
+    }
+    used -= e->len;
+    memset(e, 0, sizeof(*e));
+}
+
+const uint8_t* uni_hid_descriptor_get(uni_hid_descriptor_handle_t handle, uint16_t* len) {
+    descriptor_entry_t* e = get_entry(handle);
+    if (e == NULL) {
+        if (len)
+            *len = 0;
+        return NULL;
+    }
+    if (len)
+        *len = e->len;
+    return &arena[e->offset];
+}
+
+void uni_hid_descriptor_dump(void) {
+    int count = 0;
+    for (int i = 0; i < MAX_DESCRIPTORS; i++) {
+        if (entries[i].refcount > 0)
+            count++;
+    }
+    int inline_size = CONFIG_BLUEPAD32_MAX_DEVICES * INLINE_DESCRIPTOR_LEN;
+    int arena_size = sizeof(arena) + sizeof(entries);
+    logi("HID descriptors: %d, used=%d/%d bytes (peak=%d), shared=%u, failures=%u\n", count, used,
+         (int)sizeof(arena), peak_used, shared_hits, failures);
+    // Not the same capacity: inline buffers reserved 512 bytes per device, the arena is shared.
+    logi("HID descriptors: arena takes %d bytes, %d bytes inline per device took %d bytes\n", arena_size,
+         INLINE_DESCRIPTOR_LEN, inline_size);
+}
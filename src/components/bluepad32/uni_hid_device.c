@@ -5,6 +5,7 @@
 #include "uni_hid_device.h"
 
 #include <stdbool.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include "sdkconfig.h"
@@ -13,29 +14,17 @@
 #include "bt/uni_bt_defines.h"
 #include "bt/uni_bt_le.h"
 #include "bt/uni_bt_service.h"
-#include "parser/uni_hid_parser_8bitdo.h"
-#include "parser/uni_hid_parser_android.h"
-#include "parser/uni_hid_parser_atari.h"
-#include "parser/uni_hid_parser_ds3.h"
-#include "parser/uni_hid_parser_ds4.h"
-#include "parser/uni_hid_parser_ds5.h"
 #include "parser/uni_hid_parser_generic.h"
-#include "parser/uni_hid_parser_icade.h"
-#include "parser/uni_hid_parser_keyboard.h"
-#include "parser/uni_hid_parser_mouse.h"
-#include "parser/uni_hid_parser_nimbus.h"
-#include "parser/uni_hid_parser_ouya.h"
-#include "parser/uni_hid_parser_psmove.h"
-#include "parser/uni_hid_parser_smarttvremote.h"
-#include "parser/uni_hid_parser_steam.h"
-#include "parser/uni_hid_parser_switch.h"
-#include "parser/uni_hid_parser_wii.h"
-#include "parser/uni_hid_parser_xboxone.h"
 #include "platform/uni_platform.h"
+#include "uni_boot.h"
+#include "uni_clock_scaling.h"
 #include "uni_common.h"
 #include "uni_config.h"
+#include "uni_hid_capture.h"
 #include "uni_hid_device_vendors.h"
 #include "uni_log.h"
+#include "uni_profiler.h"
+#include "uni_simulator.h"
 #include "uni_virtual_device.h"
 
 enum {
@@ -46,6 +35,7 @@ enum {
     FLAGS_HAS_VENDOR_ID = BIT(11),
     FLAGS_HAS_PRODUCT_ID = BIT(12),
     FLAGS_HAS_CONTROLLER_TYPE = BIT(13),
+    FLAGS_HID_DESCRIPTOR_REJECTED = BIT(14),  // Didn't fit in the arena. Device is being disconnected.
 };
 
 #define MISC_BUTTON_DELAY_MS 200
@@ -136,7 +126,7 @@ uni_hid_device_t* uni_hid_device_get_instance_for_address(bd_addr_t addr) {
     return NULL;
 }
 
-uni_hid_device_t* uni_hid_device_get_instance_for_cid(uint16_t cid) {
+uni_hid_device_t* UNI_HOT_FUNC(uni_hid_device_get_instance_for_cid)(uint16_t cid) {
     if (cid == 0)
         return NULL;
     for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
@@ -184,7 +174,7 @@ uni_hid_device_t* uni_hid_device_get_instance_for_idx(int idx) {
     return &g_devices[idx];
 }
 
-int uni_hid_device_get_idx_for_instance(const uni_hid_device_t* d) {
+int UNI_HOT_FUNC(uni_hid_device_get_idx_for_instance)(const uni_hid_device_t* d) {
     int idx = d - &g_devices[0];
 
     if (idx < 0 || idx >= CONFIG_BLUEPAD32_MAX_DEVICES)
@@ -214,6 +204,11 @@ void uni_hid_device_set_ready(uni_hid_device_t* d) {
 
     uni_bt_conn_set_state(&d->conn, UNI_BT_CONN_STATE_DEVICE_PENDING_READY);
 
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+    // Before the setup, so that the capture includes the setup traffic.
+    uni_hid_capture_on_device(d);
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+
     // Each "parser" is responsible to call uni_hid_device_set_ready() once the
     // "parser" is ready.
     if (d->report_parser.setup)
@@ -253,6 +248,10 @@ bool uni_hid_device_set_ready_complete(uni_hid_device_t* d) {
     uni_bt_service_on_device_ready(d);
 
     uni_bt_conn_set_state(&d->conn, UNI_BT_CONN_STATE_DEVICE_READY);
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_FIRST_READY);
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+    uni_clock_scaling_on_device_ready(d);
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
     return true;
 }
 
@@ -272,12 +271,16 @@ void uni_hid_device_on_connected(uni_hid_device_t* d, bool connected) {
 
     if (connected) {
         // connected
+        UNI_BOOT_MARK(UNI_BOOT_PHASE_FIRST_CONNECTION);
         uni_get_platform()->on_device_connected(d);
         uni_bt_service_on_device_connected(d);
     } else {
         // disconnected
         uni_get_platform()->on_device_disconnected(d);
         uni_bt_service_on_device_disconnected(d);
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+        uni_clock_scaling_on_device_disconnected(d);
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
     }
 }
 
@@ -356,16 +359,51 @@ bool uni_hid_device_has_name(uni_hid_device_t* d) {
     return (d->flags & FLAGS_HAS_NAME) != 0;
 }
 
-void uni_hid_device_set_hid_descriptor(uni_hid_device_t* d, const uint8_t* descriptor, int len) {
+uni_hid_descriptor_handle_t uni_hid_device_set_hid_descriptor(uni_hid_device_t* d, const uint8_t* descriptor, int len) {
     if (d == NULL) {
         log_error("ERROR: Invalid device\n");
-        return;
+        return UNI_HID_DESCRIPTOR_HANDLE_NONE;
     }
 
-    int min = btstack_min(HID_MAX_DESCRIPTOR_LEN, len);
-    memcpy(d->hid_descriptor, descriptor, len);
-    d->hid_descriptor_len = min;
+    if (len <= 0 || len > HID_MAX_DESCRIPTOR_LEN) {
+        loge("Invalid HID descriptor len: %d\n", len);
+        return UNI_HID_DESCRIPTOR_HANDLE_NONE;
+    }
+
+    // Already rejected. Don't retry, the disconnection is in progress.
+    if (d->flags & FLAGS_HID_DESCRIPTOR_REJECTED)
+        return UNI_HID_DESCRIPTOR_HANDLE_NONE;
+
+    // Setting the same descriptor again is a no-op.
+    uint16_t current_len;
+    const uint8_t* current = uni_hid_descriptor_get(d->hid_descriptor, &current_len);
+    if (current != NULL && current_len == len && memcmp(current, descriptor, len) == 0)
+        return d->hid_descriptor;
+
+    // Release first, so that the arena doesn't need room for both the old and the new one.
+    uni_hid_descriptor_release(d->hid_descriptor);
+    d->hid_descriptor = UNI_HID_DESCRIPTOR_HANDLE_NONE;
+    d->hid_descriptor_len = 0;
+    d->flags &= ~FLAGS_HAS_HID_DESCRIPTOR;
+
+    uni_hid_descriptor_handle_t handle = uni_hid_descriptor_acquire(descriptor, len);
+    if (handle == UNI_HID_DESCRIPTOR_HANDLE_NONE) {
+        // Without its descriptor, the device can't be parsed correctly. Better to reject it than
+        // to have it "connected" but not working. See CONFIG_BLUEPAD32_HID_DESCRIPTOR_ARENA_SIZE.
+        loge("HID descriptor arena is full, disconnecting device: %s\n", bd_addr_to_str(d->conn.btaddr));
+        d->flags |= FLAGS_HID_DESCRIPTOR_REJECTED;
+        uni_hid_device_disconnect(d);
+        return handle;
+    }
+
+    d->hid_descriptor = handle;
+    d->hid_descriptor_len = len;
     d->flags |= FLAGS_HAS_HID_DESCRIPTOR;
+    return handle;
+}
+
+const uint8_t* uni_hid_device_get_hid_descriptor(uni_hid_device_t* d) {
+    return uni_hid_descriptor_get(d->hid_descriptor, NULL);
 }
 
 bool uni_hid_device_has_hid_descriptor(uni_hid_device_t* d) {
@@ -437,7 +475,7 @@ void uni_hid_device_disconnect(uni_hid_device_t* d) {
     connected = d->conn.connected;
 
     // Cleanup
-    if (!uni_hid_device_is_virtual_device(d)) {
+    if (!uni_hid_device_is_virtual_device(d) && !d->conn.simulated) {
         type = gap_get_connection_type(d->conn.handle);
         if (IS_ENABLED(UNI_ENABLE_BLE) && type == GAP_CONNECTION_LE)
             uni_bt_le_disconnect(d);
@@ -476,11 +514,13 @@ void uni_hid_device_delete(uni_hid_device_t* d) {
 
     // Remove the timer. If it was still running, it will crash if the handler gets called.
     btstack_run_loop_remove_timer(&d->connection_timer);
+    uni_output_composer_deinit(&d->output_composer);
+    uni_hid_descriptor_release(d->hid_descriptor);
 
     uni_hid_device_init(d);
 }
 
-void uni_hid_device_dump_device(uni_hid_device_t* d) {
+static void dump_device_info(uni_hid_device_t* d) {
     const char* conn_type;
     gap_connection_type_t type;
 
@@ -515,10 +555,33 @@ void uni_hid_device_dump_device(uni_hid_device_t* d) {
          : (d->controller.klass == UNI_CONTROLLER_CLASS_BALANCE_BOARD) ? "balance board"
          : (d->controller.klass == UNI_CONTROLLER_CLASS_KEYBOARD)      ? "keyboard"
                                                                        : "unknown");
-    if (uni_get_platform()->device_dump)
-        uni_get_platform()->device_dump(d);
-    if (d->report_parser.device_dump)
-        d->report_parser.device_dump(d);
+}
+
+bool uni_hid_device_dump_device_step(uni_hid_device_t* d, int step) {
+    switch (step) {
+        case 0:
+            dump_device_info(d);
+            return true;
+        case 1:
+            uni_report_stats_dump(&d->report_stats);
+            return true;
+        case 2:
+            uni_output_composer_dump(&d->output_composer);
+            return true;
+        case 3:
+            if (uni_get_platform()->device_dump)
+                uni_get_platform()->device_dump(d);
+            return true;
+        default:
+            if (d->report_parser.device_dump)
+                d->report_parser.device_dump(d);
+            return false;
+    }
+}
+
+void uni_hid_device_dump_device(uni_hid_device_t* d) {
+    for (int step = 0; uni_hid_device_dump_device_step(d, step); step++) {
+    }
 }
 
 void uni_hid_device_dump_all(void) {
@@ -530,6 +593,16 @@ void uni_hid_device_dump_all(void) {
         uni_hid_device_dump_device(&g_devices[i]);
         logi("\n");
     }
+    uni_hid_descriptor_dump();
+#ifdef CONFIG_BLUEPAD32_PROFILER
+    uni_profiler_dump();
+#endif  // CONFIG_BLUEPAD32_PROFILER
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+    uni_clock_scaling_dump();
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
+#ifdef CONFIG_BLUEPAD32_BOOT_TIMELINE
+    uni_boot_dump();
+#endif  // CONFIG_BLUEPAD32_BOOT_TIMELINE
 }
 
 bool uni_hid_device_guess_controller_type_from_name(uni_hid_device_t* d, const char* name) {
@@ -537,15 +610,13 @@ bool uni_hid_device_guess_controller_type_from_name(uni_hid_device_t* d, const c
         return false;
 
     // Try with the different matchers.
-    // But don't include Xbox here yet, since we should try to get the HID descriptor first.
-    // This is because the Xbox Wireless has 3 different types of HID descriptors.
-    bool ret = uni_hid_parser_ds3_does_name_match(d, name);
-    ret = ret || uni_hid_parser_switch_does_name_match(d, name);
+    // But don't include Xbox here yet (it is a "fallback" matcher), since we should try to get the
+    // HID descriptor first. This is because the Xbox Wireless has 3 different types of HID descriptors.
+    if (uni_hid_parser_get_entry_for_name(d, name, false) == NULL)
+        return false;
 
-    if (ret) {
-        uni_hid_device_guess_controller_type_from_pid_vid(d);
-    }
-    return ret;
+    uni_hid_device_guess_controller_type_from_pid_vid(d);
+    return true;
 }
 
 void uni_hid_device_guess_controller_type_from_pid_vid(uni_hid_device_t* d) {
@@ -553,6 +624,8 @@ void uni_hid_device_guess_controller_type_from_pid_vid(uni_hid_device_t* d) {
         logi("device already has a controller type");
         return;
     }
+    const uni_hid_parser_entry_t* parser;
+
     // Try to guess it from Vendor/Product id.
     uni_controller_type_t type = guess_controller_type(d->vendor_id, d->product_id);
 
@@ -563,10 +636,10 @@ void uni_hid_device_guess_controller_type_from_pid_vid(uni_hid_device_t* d) {
             type = CONTROLLER_TYPE_GenericMouse;
         } else if (uni_hid_device_is_keyboard(d)) {
             type = CONTROLLER_TYPE_GenericKeyboard;
-        } else if (uni_hid_parser_xboxone_does_name_match(d, d->name)) {
+        } else if ((parser = uni_hid_parser_get_entry_for_name(d, d->name, true)) != NULL) {
             // Needed for some Xbox Controllers clones, like the GameSir T3s, that returns empty
             // answers for SDP queries.
-            type = CONTROLLER_TYPE_XBoxOneController;
+            type = parser->types[0];
         } else {
             loge("Failed to find gamepad profile for device. Fallback: using Android profile.\n");
             type = CONTROLLER_TYPE_AndroidController;
@@ -576,149 +649,22 @@ void uni_hid_device_guess_controller_type_from_pid_vid(uni_hid_device_t* d) {
     // Subtype is still unknown, it will be set by the relevant parse_input_report() func
     d->controller_subtype = CONTROLLER_SUBTYPE_NONE;
 
-    memset(&d->report_parser, 0, sizeof(d->report_parser));
-
-    switch (type) {
-        case CONTROLLER_TYPE_iCadeController:
-            d->report_parser.setup = uni_hid_parser_icade_setup;
-            d->report_parser.parse_usage = uni_hid_parser_icade_parse_usage;
-            logi("Device detected as iCade: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_OUYAController:
-            d->report_parser.init_report = uni_hid_parser_ouya_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_ouya_parse_usage;
-            d->report_parser.set_player_leds = uni_hid_parser_ouya_set_player_leds;
-            logi("Device detected as OUYA: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_XBoxOneController:
-            d->report_parser.setup = uni_hid_parser_xboxone_setup;
-            d->report_parser.init_report = uni_hid_parser_xboxone_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_xboxone_parse_usage;
-            d->report_parser.set_rumble = uni_hid_parser_xboxone_set_rumble;
-            d->report_parser.device_dump = uni_hid_parser_xboxone_device_dump;
-            logi("Device detected as Xbox Wireless: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_AndroidController:
-            d->report_parser.init_report = uni_hid_parser_android_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_android_parse_usage;
-            d->report_parser.set_player_leds = uni_hid_parser_android_set_player_leds;
-            logi("Device detected as Android: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_NimbusController:
-            d->report_parser.init_report = uni_hid_parser_nimbus_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_nimbus_parse_usage;
-            d->report_parser.set_player_leds = uni_hid_parser_nimbus_set_player_leds;
-            logi("Device detected as Nimbus: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_SmartTVRemoteController:
-            d->report_parser.init_report = uni_hid_parser_smarttvremote_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_smarttvremote_parse_usage;
-            logi("Device detected as Smart TV remote: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_PSMoveController:
-            d->report_parser.setup = uni_hid_parser_psmove_setup;
-            d->report_parser.init_report = uni_hid_parser_psmove_init_report;
-            d->report_parser.parse_input_report = uni_hid_parser_psmove_parse_input_report;
-            d->report_parser.set_lightbar_color = uni_hid_parser_psmove_set_lightbar_color;
-            d->report_parser.set_rumble = uni_hid_parser_psmove_set_rumble;
-            logi("Device detected as PS Move: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_PS3Controller:
-            d->report_parser.setup = uni_hid_parser_ds3_setup;
-            d->report_parser.init_report = uni_hid_parser_ds3_init_report;
-            d->report_parser.parse_input_report = uni_hid_parser_ds3_parse_input_report;
-            d->report_parser.set_player_leds = uni_hid_parser_ds3_set_player_leds;
-            d->report_parser.set_rumble = uni_hid_parser_ds3_set_rumble;
-            logi("Device detected as DUALSHOCK3: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_PS4Controller:
-            d->report_parser.setup = uni_hid_parser_ds4_setup;
-            d->report_parser.init_report = uni_hid_parser_ds4_init_report;
-            d->report_parser.parse_input_report = uni_hid_parser_ds4_parse_input_report;
-            d->report_parser.parse_feature_report = uni_hid_parser_ds4_parse_feature_report;
-            d->report_parser.set_lightbar_color = uni_hid_parser_ds4_set_lightbar_color;
-            d->report_parser.set_rumble = uni_hid_parser_ds4_set_rumble;
-            d->report_parser.device_dump = uni_hid_parser_ds4_device_dump;
-            logi("Device detected as DUALSHOCK4: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_PS5Controller:
-            d->report_parser.init_report = uni_hid_parser_ds5_init_report;
-            d->report_parser.setup = uni_hid_parser_ds5_setup;
-            d->report_parser.parse_input_report = uni_hid_parser_ds5_parse_input_report;
-            d->report_parser.parse_feature_report = uni_hid_parser_ds5_parse_feature_report;
-            d->report_parser.set_player_leds = uni_hid_parser_ds5_set_player_leds;
-            d->report_parser.set_lightbar_color = uni_hid_parser_ds5_set_lightbar_color;
-            d->report_parser.set_rumble = uni_hid_parser_ds5_set_rumble;
-            d->report_parser.device_dump = uni_hid_parser_ds5_device_dump;
-            logi("Device detected as DualSense: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_8BitdoController:
-            d->report_parser.init_report = uni_hid_parser_8bitdo_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_8bitdo_parse_usage;
-            logi("Device detected as 8BITDO: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_GenericController:
-            d->report_parser.init_report = uni_hid_parser_generic_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_generic_parse_usage;
-            logi("Device detected as generic: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_WiiController:
-            d->report_parser.setup = uni_hid_parser_wii_setup;
-            d->report_parser.init_report = uni_hid_parser_wii_init_report;
-            d->report_parser.parse_input_report = uni_hid_parser_wii_parse_input_report;
-            d->report_parser.set_player_leds = uni_hid_parser_wii_set_player_leds;
-            d->report_parser.set_rumble = uni_hid_parser_wii_set_rumble;
-            d->report_parser.device_dump = uni_hid_parser_wii_device_dump;
-            logi("Device detected as Wii controller: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_SwitchProController:
-        case CONTROLLER_TYPE_SwitchJoyConRight:
-        case CONTROLLER_TYPE_SwitchJoyConLeft:
-            d->report_parser.setup = uni_hid_parser_switch_setup;
-            d->report_parser.init_report = uni_hid_parser_switch_init_report;
-            d->report_parser.parse_input_report = uni_hid_parser_switch_parse_input_report;
-            d->report_parser.set_player_leds = uni_hid_parser_switch_set_player_leds;
-            d->report_parser.set_rumble = uni_hid_parser_switch_set_rumble;
-            d->report_parser.device_dump = uni_hid_parser_switch_device_dump;
-            logi("Device detected as Nintendo Switch Pro controller: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_SteamController:
-            d->report_parser.setup = uni_hid_parser_steam_setup;
-            d->report_parser.init_report = uni_hid_parser_steam_init_report;
-            d->report_parser.parse_input_report = uni_hid_parser_steam_parse_input_report;
-            logi("Device detected as Steam: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_AtariJoystick:
-            d->report_parser.setup = uni_hid_parser_atari_setup;
-            d->report_parser.init_report = uni_hid_parser_atari_init_report;
-            d->report_parser.parse_input_report = uni_hid_parser_atari_parse_input_report;
-            logi("Device detected as Atari Joystick/Controller: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_GenericMouse:
-            d->report_parser.setup = uni_hid_parser_mouse_setup;
-            d->report_parser.parse_input_report = uni_hid_parser_mouse_parse_input_report;
-            d->report_parser.init_report = uni_hid_parser_mouse_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_mouse_parse_usage;
-            d->report_parser.device_dump = uni_hid_parser_mouse_device_dump;
-            logi("Device detected as Mouse: 0x%02x\n", type);
-            break;
-        case CONTROLLER_TYPE_GenericKeyboard:
-            d->report_parser.setup = uni_hid_parser_keyboard_setup;
-            d->report_parser.parse_input_report = uni_hid_parser_keyboard_parse_input_report;
-            d->report_parser.init_report = uni_hid_parser_keyboard_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_keyboard_parse_usage;
-            d->report_parser.device_dump = uni_hid_parser_keyboard_device_dump;
-            logi("Device detected as Keyboard: 0x%02x\n", type);
-            break;
-        default:
-            d->report_parser.init_report = uni_hid_parser_generic_init_report;
-            d->report_parser.parse_usage = uni_hid_parser_generic_parse_usage;
-            logi("Device not detected (0x%02x). Using generic driver.\n", type);
-            break;
+    parser = uni_hid_parser_get_entry_for_type(type);
+    if (parser) {
+        d->report_parser = parser->report_parser;
+        logi("Device detected as %s: 0x%02x\n", parser->name, type);
+    } else {
+        // Either unknown, or its parser was not included in the build.
+        d->report_parser = uni_hid_parser_generic_entry.report_parser;
+        logi("Device not detected (0x%02x). Using generic driver.\n", type);
     }
 
     d->controller_type = type;
     d->flags |= FLAGS_HAS_CONTROLLER_TYPE;
+
+#ifdef CONFIG_BLUEPAD32_PROFILER
+    uni_profiler_wrap_report_parser(d);
+#endif  // CONFIG_BLUEPAD32_PROFILER
 }
 
 bool uni_hid_device_has_controller_type(uni_hid_device_t* d) {
@@ -734,22 +680,38 @@ void uni_hid_device_set_connection_handle(uni_hid_device_t* d, hci_con_handle_t
     d->conn.handle = handle;
 }
 
-void uni_hid_device_process_controller(uni_hid_device_t* d) {
+void UNI_HOT_FUNC(uni_hid_device_process_controller)(uni_hid_device_t* d) {
     uni_gamepad_t gp;
     if (uni_bt_conn_get_state(&d->conn) != UNI_BT_CONN_STATE_DEVICE_READY) {
         return;
     }
 
     if (d->controller.klass == UNI_CONTROLLER_CLASS_GAMEPAD) {
+        UNI_PROFILER_BEGIN(remap_start);
         gp = uni_gamepad_remap(&d->controller.gamepad);
         d->controller.gamepad = gp;
+        UNI_PROFILER_END(d, UNI_PROFILER_STAGE_GAMEPAD_REMAP, remap_start);
     }
 
-    if (uni_get_platform()->on_controller_data != NULL)
-        uni_get_platform()->on_controller_data(d, &d->controller);
-    else if (uni_get_platform()->on_gamepad_data != NULL)
+    uni_bt_service_on_controller_data(d);
+
+    // Computed once here, instead of each platform keeping its own copy to compare against.
+    uint32_t changes = uni_controller_get_changes(&d->prev_controller, &d->controller);
+    d->prev_controller = d->controller;
+
+    struct uni_platform* plat = uni_get_platform();
+    UNI_PROFILER_BEGIN(platform_start);
+    if (plat->on_controller_data_changed != NULL) {
+        if (plat->controller_data_interest == 0 || (changes & plat->controller_data_interest) != 0)
+            plat->on_controller_data_changed(d, &d->controller, changes);
+    } else if (plat->on_controller_data != NULL) {
+        plat->on_controller_data(d, &d->controller);
+    } else if (plat->on_gamepad_data != NULL) {
         // Deprecated: should implement only on_controller_data
-        uni_get_platform()->on_gamepad_data(d, &d->controller.gamepad);
+        plat->on_gamepad_data(d, &d->controller.gamepad);
+    }
+    UNI_PROFILER_END(d, UNI_PROFILER_STAGE_ON_CONTROLLER_DATA, platform_start);
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_FIRST_REPORT);
 
     // FIXME: each backend should decide what to do with misc buttons
     process_misc_button_system(d);
@@ -773,6 +735,13 @@ void uni_hid_device_send_report(uni_hid_device_t* d, uint16_t cid, const uint8_t
         return;
     }
 
+#ifdef CONFIG_BLUEPAD32_SIMULATOR
+    if (d->conn.simulated) {
+        uni_simulator_on_output_report(d, cid, report, len);
+        return;
+    }
+#endif  // CONFIG_BLUEPAD32_SIMULATOR
+
     int err = l2cap_send(cid, (uint8_t*)report, len);
     if (err != 0) {
         logd("Could not send report (error=0x%04x). Adding it to queue\n", err);
@@ -792,6 +761,10 @@ void uni_hid_device_send_intr_report(uni_hid_device_t* d, const uint8_t* report,
         loge("Invalid device\n");
         return;
     }
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+    // Not in uni_hid_device_send_report(), since it is also called for the queued reports.
+    uni_hid_capture_on_output_report(d, false, report, len);
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
     uni_hid_device_send_report(d, d->conn.interrupt_cid, report, len);
 }
 
@@ -802,6 +775,10 @@ void uni_hid_device_send_ctrl_report(uni_hid_device_t* d, const uint8_t* report,
         loge("Invalid device\n");
         return;
     }
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+    // Not in uni_hid_device_send_report(), since it is also called for the queued reports.
+    uni_hid_capture_on_output_report(d, true, report, len);
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
     uni_hid_device_send_report(d, d->conn.control_cid, report, len);
 }
 
@@ -880,7 +857,7 @@ static void misc_button_enable_callback(btstack_timer_source_t* ts) {
 }
 
 // process_mic_button_system
-static void process_misc_button_system(uni_hid_device_t* d) {
+static void UNI_HOT_FUNC(process_misc_button_system)(uni_hid_device_t* d) {
     if ((d->controller.gamepad.misc_buttons & MISC_BUTTON_SYSTEM) == 0) {
         // System button released?
         d->misc_button_wait_release &= ~MISC_BUTTON_SYSTEM;
@@ -915,7 +892,7 @@ static void process_misc_button_system(uni_hid_device_t* d) {
 }
 
 // process_misc_button_home dumps uni_hid_device debug info in the console.
-static void process_misc_button_home(uni_hid_device_t* d) {
+static void UNI_HOT_FUNC(process_misc_button_home)(uni_hid_device_t* d) {
     if ((d->controller.gamepad.misc_buttons & MISC_BUTTON_START) == 0) {
         // Home button released? Clear "wait" flag.
         d->misc_button_wait_release &= ~MISC_BUTTON_START;
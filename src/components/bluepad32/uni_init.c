@@ -8,17 +8,25 @@
 
 #include "bt/uni_bt_allowlist.h"
 #include "bt/uni_bt_setup.h"
+#include "parser/uni_hid_parser.h"
 #include "platform/uni_platform.h"
+#include "uni_boot.h"
+#include "uni_clock_scaling.h"
 #include "uni_config.h"
 #include "uni_console.h"
+#include "uni_hid_capture.h"
 #include "uni_hid_device.h"
 #include "uni_log.h"
+#include "uni_profiler.h"
 #include "uni_property.h"
+#include "uni_simulator.h"
 #include "uni_uart.h"
 #include "uni_version.h"
 #include "uni_virtual_device.h"
 
 int uni_init(int argc, const char** argv) {
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_UNI_INIT);
+
     // UART should be initialized early on in case it is needed to disable it.
     uni_uart_init();
 
@@ -30,21 +38,41 @@ int uni_init(int argc, const char** argv) {
 
     // Honoring BTstack license
     logi("BTstack: Copyright (C) 2017 BlueKitchen GmbH.\n");
+    uni_hid_parser_list_all();
 
     uni_property_init();
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_PROPERTY_INIT);
     uni_platform_init(argc, argv);
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_PLATFORM_INIT);
     uni_hid_device_setup();
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+    uni_hid_capture_init();
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+#ifdef CONFIG_BLUEPAD32_PROFILER
+    uni_profiler_init();
+#endif  // CONFIG_BLUEPAD32_PROFILER
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+    uni_clock_scaling_init();
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
 
+#ifdef CONFIG_BLUEPAD32_SIMULATOR
+    // Linux only: no Bluetooth controller. Simulated controllers are used instead.
+    uni_simulator_init(argc, argv);
+#else
     // Continue with bluetooth setup.
     uni_bt_setup();
+#endif  // CONFIG_BLUEPAD32_SIMULATOR
     uni_bt_allowlist_init();
     uni_virtual_device_init();
 
 #if CONFIG_BLUEPAD32_USB_CONSOLE_ENABLE
-    uni_console_init();
+    // Not needed to get the first report.
+    uni_boot_defer(uni_console_init);
 #endif  // CONFIG_BLUEPAD32_CONSOLE_ENABLE
 
     uni_balance_board_init();
 
+    UNI_BOOT_MARK(UNI_BOOT_PHASE_UNI_INIT_DONE);
+
     return 0;
 }
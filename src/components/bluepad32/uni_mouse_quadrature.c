@@ -8,255 +8,278 @@
  */
 #include "uni_mouse_quadrature.h"
 
+#include <inttypes.h>
 #include <math.h>
 #include <stdbool.h>
 #include <string.h>
 #include <sys/cdefs.h>
 
 #include <driver/gpio.h>
-#include <driver/timer.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
+#include <driver/rmt.h>
+#include <esp_rom_gpio.h>
+#include <esp_timer.h>
+#include <soc/gpio_sig_map.h>
 
+#include "uni_common.h"
 #include "uni_log.h"
 #include "uni_property.h"
 
-// Probably I could use a smaller divider, and only do "1 tick per 80us".
-// That would work Ok except that it will lose resolution when we divide "128 steps by delta".
-// APB clock runs at 80Mhz.
-//   Option A:
-//   80Mhz / 80 = 1Mhz = tick every 1us
-// #define TIMER_DIVIDER (80)
-// #define TICKS_PER_80US (80)  // How many ticks are in 80us
-// #define ONE_SECOND (1000000)
-//
-//   Option B:
-//   80Mhz / 6400 = 12500Hz = tick every 80us
-#define TIMER_DIVIDER (80 * 80)
-#define TICKS_PER_80US (1)  // How many ticks are in 80us
-#define ONE_SECOND (12500)
-
-#define TASK_TIMER_STACK_SIZE (2048)
-#define TASK_TIMER_PRIO (10)
-
-// Default scale factor for the mouse movement
-#define DETAULT_SCALE_FACTOR (1)
-
-enum direction {
-    PHASE_DIRECTION_NEG,
-    PHASE_DIRECTION_POS,
+// The quadrature waveforms are generated by the RMT peripheral: each quadrature line (A and B)
+// of each encoder uses one RMT TX channel. Two ports * two encoders * two lines = 8 channels,
+// which are all the RMT channels that the ESP32 has.
+// For each update, a train of edges is precomputed and sent to RMT, so there is no CPU involvement
+// per edge.
+
+// APB clock runs at 80Mhz. 80Mhz / 80 = 1Mhz = tick every 1us
+#define RMT_CLK_DIV (80)
+
+// SmallyMouse2 mentions that 100-120 reports are received per second.
+// According to my test, they are ~90, which is in the same order.
+// A train should finish before the next report arrives, otherwise the next report
+// will have to wait until the next one to be sent.
+#define TRAIN_DURATION_US (8000)
+
+// Upper bound of the edge rate per encoder: one quadrature step every 80us = 12500 edges/sec.
+// Each port has two encoders, so the edge rate per port is bounded to 25000 edges/sec.
+// Same max rate used by the previous timer-based implementation.
+#define MIN_STEP_US (80)
+#define MAX_STEPS_PER_TRAIN (TRAIN_DURATION_US / MIN_STEP_US)
+
+// Deltas that could not be sent in one train are sent in the following ones.
+// But don't accumulate too many of them, otherwise the mouse "lags".
+#define MAX_PENDING_STEPS (MAX_STEPS_PER_TRAIN * 2)
+
+// Pending steps are stored as fixed-point, to keep the fractional part of the scaled deltas.
+#define STEP_FRACTION_BITS (8)
+
+// One segment per step at most, plus the "end" marker.
+#define MAX_ITEMS_PER_TRAIN ((MAX_STEPS_PER_TRAIN + 1) / 2 + 1)
+
+enum {
+    LINE_A,
+    LINE_B,
+    LINE_MAX,
 };
 
 // A mouse has two encoders.
 struct quadrature_state {
-    // horizontal or vertical encoder?
-    int encoder;
-    // Current direction
-    enum direction dir;
-    // Current value
-    int value;
-    // Current quadrature phase
+    // Current quadrature phase. Where the last train ends.
     int phase;
+    // Steps that were not sent yet. Signed, fixed point.
+    int32_t pending;
 
-    // Which group timer/timer is being used
-    int timer_group;
-    timer_idx_t timer_idx;
+    // RMT channel used for each line. Valid only if the GPIO is valid.
+    rmt_channel_t channels[LINE_MAX];
+    rmt_item32_t items[LINE_MAX][MAX_ITEMS_PER_TRAIN];
 
     // GPIOs used
     struct uni_mouse_quadrature_encoder_gpios gpios;
 };
 
+struct quadrature_stats {
+    uint32_t edges;
+    uint32_t trains;
+    uint32_t busy;           // Updates that arrived while a train was still being sent
+    uint32_t dropped_steps;  // Steps discarded because too many were pending
+
+    // edges/sec benchmark, calculated every second
+    int64_t window_start_us;
+    uint32_t window_edges;
+    uint32_t edges_per_sec;
+    uint32_t max_edges_per_sec;
+};
+
 static struct quadrature_state s_quadratures[UNI_MOUSE_QUADRATURE_PORT_MAX][UNI_MOUSE_QUADRATURE_ENCODER_MAX];
-// Cache to prevent enabling/disabling timers that were already enabled/disabled
+static struct quadrature_stats s_stats[UNI_MOUSE_QUADRATURE_PORT_MAX];
+// Cache to prevent enabling/disabling the output that were already enabled/disabled
 static bool timer_started[UNI_MOUSE_QUADRATURE_PORT_MAX];
 
-static TaskHandle_t s_timer_tasks[UNI_MOUSE_QUADRATURE_PORT_MAX][UNI_MOUSE_QUADRATURE_ENCODER_MAX];
-
 // "Scale factor" for mouse movement. To make the mouse move faster or slower.
-// Bigger means slower movement.
+// Bigger means faster movement. Stored as fixed point too.
 static float s_scale_factor;
+static int32_t s_scale_factor_fixed;
 
 static bool initialized;
 
-static void process_quadrature(struct quadrature_state* q) {
-    int a, b;
+// Quadrature phases: a, b
+static const uint8_t phase_levels[4][LINE_MAX] = {
+    {0, 0},
+    {1, 0},
+    {1, 1},
+    {0, 1},
+};
 
-    if (q->value <= 0) {
-        return;
+static void set_scale_factor_cache(float scale) {
+    s_scale_factor = scale;
+    s_scale_factor_fixed = (int32_t)roundf(scale * (1 << STEP_FRACTION_BITS));
+}
+
+// Fills the RMT items for one line. Returns the number of items, including the "end" marker.
+static int fill_items(rmt_item32_t* items, const uint8_t* levels, int steps, uint32_t step_ticks) {
+    int n_items = 0;
+    bool second_half = false;
+    int i = 0;
+
+    memset(items, 0, sizeof(rmt_item32_t) * MAX_ITEMS_PER_TRAIN);
+    while (i < steps) {
+        // Run-length: consecutive steps with the same level become one segment.
+        int run = 1;
+        while (i + run < steps && levels[i + run] == levels[i])
+            run++;
+
+        uint32_t duration = step_ticks * run;
+        if (!second_half) {
+            items[n_items].level0 = levels[i];
+            items[n_items].duration0 = duration;
+        } else {
+            items[n_items].level1 = levels[i];
+            items[n_items].duration1 = duration;
+            n_items++;
+        }
+        second_half = !second_half;
+        i += run;
     }
-    q->value--;
-
-    if (q->dir == PHASE_DIRECTION_NEG) {
-        q->phase--;
-        if (q->phase < 0)
-            q->phase = 3;
-    } else /* PHASE_DIRECTION_POS */ {
-        q->phase++;
-        if (q->phase > 3)
-            q->phase = 0;
+    // A zero duration marks the end of the transmission. Already zeroed by memset.
+    return n_items + 1;
+}
+
+static void send_train(struct quadrature_state* q, struct quadrature_stats* st) {
+    uint8_t levels[LINE_MAX][MAX_STEPS_PER_TRAIN];
+
+    int32_t steps = q->pending >> STEP_FRACTION_BITS;
+    // Arithmetic shift rounds towards -inf. Round towards zero to keep the remainder with the same sign.
+    if (steps < 0 && (q->pending & ((1 << STEP_FRACTION_BITS) - 1)))
+        steps++;
+    if (steps > MAX_STEPS_PER_TRAIN)
+        steps = MAX_STEPS_PER_TRAIN;
+    if (steps < -MAX_STEPS_PER_TRAIN)
+        steps = -MAX_STEPS_PER_TRAIN;
+    if (steps == 0)
+        return;
+    q->pending -= steps * (1 << STEP_FRACTION_BITS);
+
+    int abs_steps = (steps < 0) ? -steps : steps;
+    int dir = (steps < 0) ? -1 : 1;
+
+    // Levels of each line at the beginning of each step.
+    // Each step changes the level of only one of the lines.
+    // The first step is emitted right away.
+    int phase = q->phase;
+    for (int i = 0; i < abs_steps; i++) {
+        phase = (phase + dir) & 3;
+        levels[LINE_A][i] = phase_levels[phase][LINE_A];
+        levels[LINE_B][i] = phase_levels[phase][LINE_B];
     }
 
-    switch (q->phase) {
-        case 0:
-            a = 0;
-            b = 0;
-            break;
-        case 1:
-            a = 1;
-            b = 0;
-            break;
-        case 2:
-            a = 1;
-            b = 1;
-            break;
-        case 3:
-            a = 0;
-            b = 1;
-            break;
-        default:
-            loge("%s: invalid phase value: %d", __func__, q->phase);
-            a = b = 0;
-            break;
+    uint32_t step_ticks = TRAIN_DURATION_US / abs_steps;
+
+    const int gpios[LINE_MAX] = {q->gpios.a, q->gpios.b};
+    for (int line = 0; line < LINE_MAX; line++) {
+        if (gpios[line] == -1)
+            continue;
+        // Skip lines that don't change during the train. E.g: a one-step train only toggles one line.
+        bool changed = false;
+        for (int i = 0; i < abs_steps; i++) {
+            if (levels[line][i] != phase_levels[q->phase][line]) {
+                changed = true;
+                break;
+            }
+        }
+        if (!changed)
+            continue;
+        rmt_channel_t channel = q->channels[line];
+        int n_items = fill_items(q->items[line], levels[line], abs_steps, step_ticks);
+        // Once the train finishes, the line should keep the level of the last phase.
+        rmt_set_idle_level(channel, true, phase_levels[phase][line]);
+        rmt_write_items(channel, q->items[line], n_items, false /* wait */);
     }
 
-    int gpio_a = q->gpios.a;
-    int gpio_b = q->gpios.b;
-    gpio_set_level(gpio_a, a);
-    gpio_set_level(gpio_b, b);
-    logd("value: %d, quadrature phase: %d, a=%d, b=%d (%d,%d)\n", q->value, q->phase, a, b, gpio_a, gpio_b);
+    q->phase = phase;
+    st->edges += abs_steps;
+    st->window_edges += abs_steps;
+    st->trains++;
 }
 
-// Don't be confused, that is just one task.
-// Actually, this callback is called from 4 different tasks.
-static void timer_task(void* arg) {
-    uint32_t a = (uint32_t)arg;
-    uint16_t port_idx = (a >> 16);
-    uint16_t encoder_idx = (a & 0xffff);
-
-    while (true) {
-        ulTaskNotifyTake(true, portMAX_DELAY);
-        process_quadrature(&s_quadratures[port_idx][encoder_idx]);
+static bool is_train_in_progress(const struct quadrature_state* q) {
+    const int gpios[LINE_MAX] = {q->gpios.a, q->gpios.b};
+    for (int line = 0; line < LINE_MAX; line++) {
+        if (gpios[line] != -1 && rmt_wait_tx_done(q->channels[line], 0) == ESP_ERR_TIMEOUT)
+            return true;
     }
+    return false;
 }
 
-static bool timer_handler(void* arg) {
-    uint32_t a = (uint32_t)arg;
-    uint16_t port_idx = (a >> 16);
-    uint16_t encoder_idx = (a & 0xffff);
+static void process_update(struct quadrature_state* q, struct quadrature_stats* st, int32_t delta) {
+    q->pending += delta * s_scale_factor_fixed;
 
-    BaseType_t higher_priority_task_woken = false;
-    vTaskNotifyGiveFromISR(s_timer_tasks[port_idx][encoder_idx], &higher_priority_task_woken);
-    return higher_priority_task_woken;
-}
-
-static void init_from_cpu_task() {
-    // From ESP-IDF documentation:
-    // "Register Timer interrupt handler, the handler is an ISR.
-    // The handler will be attached to the same CPU core that this function is running on."
-
-    // Create timers
-    /* Select and initialize basic parameters of the timer */
-    timer_config_t config = {
-        .divider = TIMER_DIVIDER,
-        .counter_dir = TIMER_COUNT_DOWN,
-        .counter_en = TIMER_PAUSE,
-        .alarm_en = TIMER_ALARM_EN,
-        .auto_reload = TIMER_AUTORELOAD_EN,
-    };
+    const int32_t max_pending = MAX_PENDING_STEPS * (1 << STEP_FRACTION_BITS);
+    if (q->pending > max_pending) {
+        st->dropped_steps += (q->pending - max_pending) >> STEP_FRACTION_BITS;
+        q->pending = max_pending;
+    } else if (q->pending < -max_pending) {
+        st->dropped_steps += (-max_pending - q->pending) >> STEP_FRACTION_BITS;
+        q->pending = -max_pending;
+    }
 
-    for (int i = 0; i < UNI_MOUSE_QUADRATURE_PORT_MAX; i++) {
-        for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
-            uint32_t arg = (i << 16) | j;
-            char name[32];
-            ESP_ERROR_CHECK(timer_init(s_quadratures[i][j].timer_group, s_quadratures[i][j].timer_idx, &config));
-            timer_set_counter_value(s_quadratures[i][j].timer_group, s_quadratures[i][j].timer_idx, ONE_SECOND * 60);
-            timer_isr_callback_add(s_quadratures[i][j].timer_group, s_quadratures[i][j].timer_idx, timer_handler,
-                                   (void*)arg, 0);
-            // Don't start timer automatically. They should be started on demand.
-            // timer_start(s_quadratures[i][j].timer_group, s_quadratures[i][j].timer_idx);
-
-            // Create timer tasks
-            sprintf(name, "bp.quad.timer%d%c", i, (j == 0) ? 'H' : 'V');
-            xTaskCreatePinnedToCore(timer_task, name, TASK_TIMER_STACK_SIZE, (void*)arg, TASK_TIMER_PRIO,
-                                    &s_timer_tasks[i][j], xPortGetCoreID());
-        }
+    if (is_train_in_progress(q)) {
+        // Will be sent in the next update.
+        st->busy++;
+        return;
     }
+    send_train(q, st);
+}
 
-    // Kill itself
-    vTaskDelete(NULL);
+static void update_benchmark(struct quadrature_stats* st) {
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - st->window_start_us;
+    if (elapsed < 1000000)
+        return;
+    st->edges_per_sec = (uint32_t)((int64_t)st->window_edges * 1000000 / elapsed);
+    if (st->edges_per_sec > st->max_edges_per_sec)
+        st->max_edges_per_sec = st->edges_per_sec;
+    st->window_edges = 0;
+    st->window_start_us = now;
 }
 
-static void process_update(struct quadrature_state* q, int32_t delta) {
-    uint64_t units;
-    int32_t abs_delta = (delta < 0) ? -delta : delta;
-
-    if (delta != 0) {
-        // Hack to make the movement smoother with "small deltas". It guarantees that
-        // at least two phases (out of 4) of the quadrature will be run.
-        // if (abs_delta < 2)
-        //     abs_delta = 2;
-        /* Don't update the phase, it should start from the previous phase */
-        q->value = abs_delta;
-        q->dir = (delta < 0) ? PHASE_DIRECTION_NEG : PHASE_DIRECTION_POS;
-
-        // SmallyMouse2 mentions that 100-120 reports are received per second.
-        // According to my test, they are ~90, which is in the same order.
-        // For simplicity, I'll use 100. It means that, at most, reports are received
-        // every 10ms (1 second / 100 reports = 10ms per report).
-        //
-        // "delta" is a "somewhat normalized" value that goes from 0 to 127.
-        // So we should split 10 milliseconds (ms) in 128 steps = ~80 microseconds (us).
-        // That's good because the minimum "ISR" in ESP32 is 50us.
-        // So the ESP32 timer is configured as:
-        // - down timer
-        // - ticks every 1us
-        // - when it reaches 0, triggers the ISR.
-        //
-        // But a quadrature has 4 states (hence the name). So takes 4 "ticks" to have
-        // complete "state.", which is represented with "s_scale_factor",
-        // kind of "hand tuned" so that the mice movement feels "good" (to me).
-        //
-        // The smaller "units" is, the faster the mouse moves.
-        //
-        // But to avoid a "division" in the mouse driver, and a multiplication here,
-        // (which will lose precision), we just use a "s_scale_factor" of 1 instead of 4,
-        // and we don't divide by 4 here.
-        // Alternative: Do not divide the time, and use a constant "tick" time. But if we do so,
-        // the movement will have "jank".
-        // Perhaps for small deltas we can have a predefined "unit time".
-        //
-        // s_scale_factor is used as a divisor to honor the "scale" name:
-        // smaller numbers make it slower, high number faster
-        float max_ticks = 128 * TICKS_PER_80US;
-        float delta_f = abs_delta;
-        float units_f = max_ticks / (delta_f * s_scale_factor);
-        if (units_f < TICKS_PER_80US)
-            units_f = TICKS_PER_80US;
-        units = roundf(units_f);
-    } else {
-        // If there is no update, set timer to update less frequently
-        units = ONE_SECOND * 60;
+static void route_port_to_rmt(int port_idx, bool enabled) {
+    for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
+        struct quadrature_state* q = &s_quadratures[port_idx][j];
+        const int gpios[LINE_MAX] = {q->gpios.a, q->gpios.b};
+        for (int line = 0; line < LINE_MAX; line++) {
+            if (gpios[line] == -1)
+                continue;
+            if (enabled) {
+                rmt_set_idle_level(q->channels[line], true, phase_levels[q->phase][line]);
+                rmt_set_gpio(q->channels[line], RMT_MODE_TX, gpios[line], false);
+            } else {
+                rmt_tx_stop(q->channels[line]);
+                // Give the GPIO back to the GPIO matrix, so that it can be used as a joystick line.
+                esp_rom_gpio_connect_out_signal(gpios[line], SIG_GPIO_OUT_IDX, false, false);
+            }
+        }
     }
-    timer_set_counter_value(q->timer_group, q->timer_idx, units);
 }
 
 void uni_mouse_quadrature_init(int cpu_id) {
+    // The RMT driver doesn't need a task pinned to a certain CPU.
+    ARG_UNUSED(cpu_id);
+
     memset(s_quadratures, 0, sizeof(s_quadratures));
+    memset(s_stats, 0, sizeof(s_stats));
 
     for (int i = 0; i < UNI_MOUSE_QUADRATURE_PORT_MAX; i++) {
         timer_started[i] = false;
         for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
-            s_quadratures[i][j].timer_group = TIMER_GROUP_0 + i;
-            s_quadratures[i][j].timer_idx = TIMER_0 + j;
+            for (int line = 0; line < LINE_MAX; line++)
+                s_quadratures[i][j].channels[line] =
+                    (rmt_channel_t)((i * UNI_MOUSE_QUADRATURE_ENCODER_MAX + j) * LINE_MAX + line);
+            s_quadratures[i][j].gpios.a = -1;
+            s_quadratures[i][j].gpios.b = -1;
         }
     }
 
     // Default value that can be overridden from the console
-    s_scale_factor = uni_mouse_quadrature_get_scale_factor();
-
-    // Create tasks
-    xTaskCreatePinnedToCore(init_from_cpu_task, "uni.init_timers", TASK_TIMER_STACK_SIZE, NULL, TASK_TIMER_PRIO, NULL,
-                            cpu_id);
+    set_scale_factor_cache(uni_mouse_quadrature_get_scale_factor());
 
     initialized = true;
 }
@@ -270,16 +293,35 @@ void uni_mouse_quadrature_setup_port(int port_idx,
     }
     s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_H].gpios = h;
     s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_V].gpios = v;
+
+    for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
+        struct quadrature_state* q = &s_quadratures[port_idx][j];
+        const int gpios[LINE_MAX] = {q->gpios.a, q->gpios.b};
+        for (int line = 0; line < LINE_MAX; line++) {
+            if (gpios[line] == -1)
+                continue;
+            rmt_config_t config = RMT_DEFAULT_CONFIG_TX(gpios[line], q->channels[line]);
+            config.clk_div = RMT_CLK_DIV;
+            config.tx_config.idle_output_en = true;
+            config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+            ESP_ERROR_CHECK(rmt_config(&config));
+            ESP_ERROR_CHECK(rmt_driver_install(q->channels[line], 0, 0));
+        }
+    }
+    // Don't drive the GPIOs until the port is started. They are shared with the joystick.
+    route_port_to_rmt(port_idx, false);
 }
 
 void uni_mouse_quadrature_deinit(void) {
-    // Stop the timers
     for (int i = 0; i < UNI_MOUSE_QUADRATURE_PORT_MAX; i++) {
+        uni_mouse_quadrature_pause(i);
         for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++) {
-            timer_deinit(s_quadratures[i][j].timer_group, s_quadratures[i][j].timer_idx);
-            // Delete the tasks
-            vTaskDelete(s_timer_tasks[i][j]);
-            s_timer_tasks[i][j] = NULL;
+            struct quadrature_state* q = &s_quadratures[i][j];
+            const int gpios[LINE_MAX] = {q->gpios.a, q->gpios.b};
+            for (int line = 0; line < LINE_MAX; line++) {
+                if (gpios[line] != -1)
+                    rmt_driver_uninstall(q->channels[line]);
+            }
         }
     }
 
@@ -288,7 +330,7 @@ void uni_mouse_quadrature_deinit(void) {
 
 void uni_mouse_quadrature_start(int port_idx) {
     if (!initialized) {
-        loge("%s: Error, Not initialized\n");
+        loge("%s: Error, Not initialized\n", __func__);
         return;
     }
 
@@ -300,15 +342,16 @@ void uni_mouse_quadrature_start(int port_idx) {
     if (timer_started[port_idx])
         return;
 
-    for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++)
-        timer_start(s_quadratures[port_idx][j].timer_group, s_quadratures[port_idx][j].timer_idx);
+    route_port_to_rmt(port_idx, true);
+    s_stats[port_idx].window_start_us = esp_timer_get_time();
+    s_stats[port_idx].window_edges = 0;
 
     timer_started[port_idx] = true;
 }
 
 void uni_mouse_quadrature_pause(int port_idx) {
     if (!initialized) {
-        loge("%s: Error, Not initialized\n");
+        loge("%s: Error, Not initialized\n", __func__);
         return;
     }
 
@@ -320,8 +363,9 @@ void uni_mouse_quadrature_pause(int port_idx) {
     if (!timer_started[port_idx])
         return;
 
+    route_port_to_rmt(port_idx, false);
     for (int j = 0; j < UNI_MOUSE_QUADRATURE_ENCODER_MAX; j++)
-        timer_pause(s_quadratures[port_idx][j].timer_group, s_quadratures[port_idx][j].timer_idx);
+        s_quadratures[port_idx][j].pending = 0;
 
     timer_started[port_idx] = false;
 }
@@ -329,24 +373,39 @@ void uni_mouse_quadrature_pause(int port_idx) {
 // Should be called everytime that mouse report is received.
 void uni_mouse_quadrature_update(int port_idx, int32_t dx, int32_t dy) {
     if (!initialized) {
-        loge("%s: Error, Not initialized\n");
+        loge("%s: Error, Not initialized\n", __func__);
         return;
     }
     if (port_idx < 0 || port_idx >= UNI_MOUSE_QUADRATURE_PORT_MAX) {
         loge("%s: Invalid port idx=%d\n", __func__, port_idx);
         return;
     }
-    process_update(&s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_H], dx);
+    if (!timer_started[port_idx])
+        return;
+
+    struct quadrature_stats* st = &s_stats[port_idx];
+    process_update(&s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_H], st, dx);
     // Invert delta Y so that mouse goes the right direction.
     // This is based on empiric evidence. Also, it seems that SmallyMouse is doing the same thing
-    process_update(&s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_V], -dy);
+    process_update(&s_quadratures[port_idx][UNI_MOUSE_QUADRATURE_ENCODER_V], st, -dy);
+    update_benchmark(st);
+}
+
+void uni_mouse_quadrature_dump(int port_idx) {
+    if (port_idx < 0 || port_idx >= UNI_MOUSE_QUADRATURE_PORT_MAX)
+        return;
+    const struct quadrature_stats* st = &s_stats[port_idx];
+    logi("\tquadrature: edges=%" PRIu32 ", trains=%" PRIu32 ", busy=%" PRIu32 ", dropped steps=%" PRIu32
+         ", edges/sec=%" PRIu32 " (max=%" PRIu32 ", limit=%d)\n",
+         st->edges, st->trains, st->busy, st->dropped_steps, st->edges_per_sec, st->max_edges_per_sec,
+         UNI_MOUSE_QUADRATURE_ENCODER_MAX * 1000000 / MIN_STEP_US);
 }
 
 void uni_mouse_quadrature_set_scale_factor(float scale) {
     uni_property_value_t value;
     value.f32 = scale;
 
-    s_scale_factor = scale;
+    set_scale_factor_cache(scale);
     uni_property_set(UNI_PROPERTY_IDX_MOUSE_SCALE, value);
 }
 
@@ -354,6 +413,6 @@ float uni_mouse_quadrature_get_scale_factor(void) {
     uni_property_value_t value;
 
     value = uni_property_get(UNI_PROPERTY_IDX_MOUSE_SCALE);
-    s_scale_factor = value.f32;
+    set_scale_factor_cache(value.f32);
     return value.f32;
 }
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#include "uni_output_composer.h"
+
+#include <string.h>
+
+#include "uni_hid_device.h"
+#include "uni_log.h"
+#include "uni_profiler.h"
+
+#define STATS_WINDOW_MS 1000
+
+static void on_flush_timer(btstack_timer_source_t* ts);
+static void update_stats(uni_output_composer_t* c, bool report_sent);
+
+void uni_output_composer_init(uni_output_composer_t* c, uni_output_composer_flush_fn_t flush) {
+    if (c->flush_scheduled)
+        btstack_run_loop_remove_timer(&c->flush_timer);
+    memset(c, 0, sizeof(*c));
+    c->flush = flush;
+    c->window_start_ms = btstack_run_loop_get_time_ms();
+}
+
+void uni_output_composer_deinit(uni_output_composer_t* c) {
+    if (c->flush_scheduled)
+        btstack_run_loop_remove_timer(&c->flush_timer);
+    c->flush_scheduled = false;
+    c->dirty = 0;
+}
+
+static void mark_dirty(uni_hid_device_t* d, uint32_t dirty) {
+    uni_output_composer_t* c = &d->output_composer;
+
+    c->dirty |= dirty;
+    c->requests++;
+    update_stats(c, false);
+
+    if (c->flush_scheduled)
+        return;
+
+    // A 0ms timer fires in the next run-loop iteration, after the rest of the
+    // changes requested in this one were merged.
+    c->flush_scheduled = true;
+    c->flush_timer.process = &on_flush_timer;
+    c->flush_timer.context = d;
+    btstack_run_loop_set_timer(&c->flush_timer, 0);
+    btstack_run_loop_add_timer(&c->flush_timer);
+}
+
+void uni_output_composer_set_rumble(uni_hid_device_t* d, uint8_t value) {
+    d->output_composer.rumble = value;
+    mark_dirty(d, UNI_OUTPUT_DIRTY_RUMBLE);
+}
+
+void uni_output_composer_set_lightbar_color(uni_hid_device_t* d, uint8_t r, uint8_t g, uint8_t b) {
+    uni_output_composer_t* c = &d->output_composer;
+    c->lightbar_red = r;
+    c->lightbar_green = g;
+    c->lightbar_blue = b;
+    mark_dirty(d, UNI_OUTPUT_DIRTY_LIGHTBAR);
+}
+
+void uni_output_composer_set_player_leds(uni_hid_device_t* d, uint8_t leds) {
+    d->output_composer.player_leds = leds;
+    mark_dirty(d, UNI_OUTPUT_DIRTY_PLAYER_LEDS);
+}
+
+void uni_output_composer_flush(uni_hid_device_t* d) {
+    uni_output_composer_t* c = &d->output_composer;
+
+    if (c->flush_scheduled) {
+        btstack_run_loop_remove_timer(&c->flush_timer);
+        c->flush_scheduled = false;
+    }
+
+    if (c->dirty == 0)
+        return;
+
+    uint32_t dirty = c->dirty;
+    c->dirty = 0;
+
+    if (c->flush == NULL) {
+        loge("Output composer: no flush callback for device %s\n", bd_addr_to_str(d->conn.btaddr));
+        return;
+    }
+
+    UNI_PROFILER_BEGIN(start);
+    c->flush(d, c, dirty);
+    UNI_PROFILER_END(d, UNI_PROFILER_STAGE_OUTPUT_FLUSH, start);
+    c->reports++;
+    update_stats(c, true);
+}
+
+void uni_output_composer_dump(const uni_output_composer_t* c) {
+    if (c->flush == NULL || c->requests == 0)
+        return;
+    logi("\toutput: requests=%u, reports=%u, saved=%u, saved/s=%u (max=%u)\n", c->requests, c->reports,
+         c->requests - c->reports, c->saved_per_second, c->max_saved_per_second);
+}
+
+//
+// Helpers
+//
+static void on_flush_timer(btstack_timer_source_t* ts) {
+    uni_hid_device_t* d = ts->context;
+    d->output_composer.flush_scheduled = false;
+    uni_output_composer_flush(d);
+}
+
+static void update_stats(uni_output_composer_t* c, bool report_sent) {
+    uint32_t now = btstack_run_loop_get_time_ms();
+
+    if (now - c->window_start_ms >= STATS_WINDOW_MS) {
+        // Only the last complete window counts. If there was no activity for more than
+        // one window, the "saved" value is stale and should be reset.
+        if (now - c->window_start_ms >= 2 * STATS_WINDOW_MS)
+            c->saved_per_second = 0;
+        else if (c->window_requests > c->window_reports)
+            c->saved_per_second = c->window_requests - c->window_reports;
+        else
+            c->saved_per_second = 0;
+        if (c->saved_per_second > c->max_saved_per_second)
+            c->max_saved_per_second = c->saved_per_second;
+        c->window_start_ms = now;
+        c->window_requests = 0;
+        c->window_reports = 0;
+    }
+
+    if (report_sent)
+        c->window_reports++;
+    else
+        c->window_requests++;
+}
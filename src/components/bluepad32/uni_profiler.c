@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#include "uni_profiler.h"
+
+#ifdef CONFIG_BLUEPAD32_PROFILER
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "controller/uni_gamepad.h"
+#include "parser/uni_hid_parser.h"
+#include "uni_common.h"
+#include "uni_config.h"
+#include "uni_hid_device.h"
+#include "uni_log.h"
+
+// Bucket "b" has the samples in [2^(b-1), 2^b) ns. The last one has the rest.
+#define HISTOGRAM_BUCKETS 24
+// Usually, one controller type per device.
+#define MAX_TYPES CONFIG_BLUEPAD32_MAX_DEVICES
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t total;
+    uint32_t histogram[HISTOGRAM_BUCKETS];
+} stage_stats_t;
+
+typedef struct {
+    uint16_t controller_type;
+    bool used;
+    stage_stats_t stages[UNI_PROFILER_STAGE_COUNT];
+} type_stats_t;
+
+// Original callbacks of the ones that were wrapped.
+typedef struct {
+    report_set_player_leds_fn_t set_player_leds;
+    report_set_lightbar_color_fn_t set_lightbar_color;
+    report_set_rumble_fn_t set_rumble;
+} wrapped_callbacks_t;
+
+static const char* stage_names[UNI_PROFILER_STAGE_COUNT] = {
+    [UNI_PROFILER_STAGE_INIT_REPORT] = "init_report",
+    [UNI_PROFILER_STAGE_PARSE_INPUT_REPORT] = "parse_input_report",
+    [UNI_PROFILER_STAGE_PARSE_USAGE] = "parse_usage",
+    [UNI_PROFILER_STAGE_PARSE_FEATURE_REPORT] = "parse_feature_report",
+    [UNI_PROFILER_STAGE_SET_PLAYER_LEDS] = "set_player_leds",
+    [UNI_PROFILER_STAGE_SET_LIGHTBAR_COLOR] = "set_lightbar_color",
+    [UNI_PROFILER_STAGE_SET_RUMBLE] = "set_rumble",
+    [UNI_PROFILER_STAGE_OUTPUT_FLUSH] = "output_flush",
+    [UNI_PROFILER_STAGE_GAMEPAD_REMAP] = "gamepad_remap",
+    [UNI_PROFILER_STAGE_ON_CONTROLLER_DATA] = "on_controller_data",
+};
+
+static type_stats_t types[MAX_TYPES];
+static wrapped_callbacks_t wrapped[CONFIG_BLUEPAD32_MAX_DEVICES];
+// Samples that were not recorded because there were more controller types than MAX_TYPES.
+static uint32_t untracked;
+// Cycles taken by an empty measurement.
+static uint32_t overhead;
+// Nanoseconds per cycle in 16.16 fixed point, for the clock in cycles_per_us.
+static uint32_t cycles_per_us;
+static uint32_t ns_per_cycle_q16;
+
+static type_stats_t* UNI_HOT_FUNC(get_type_stats)(uint16_t controller_type) {
+    for (int i = 0; i < MAX_TYPES; i++) {
+        if (types[i].used && types[i].controller_type == controller_type)
+            return &types[i];
+    }
+    for (int i = 0; i < MAX_TYPES; i++) {
+        if (!types[i].used) {
+            types[i].used = true;
+            types[i].controller_type = controller_type;
+            return &types[i];
+        }
+    }
+    return NULL;
+}
+
+static int UNI_HOT_FUNC(get_histogram_bucket)(uint32_t ns) {
+    int bucket = ns ? 32 - __builtin_clz(ns) : 0;
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+// The clock might have changed since the last sample. E.g: CONFIG_BLUEPAD32_CLOCK_SCALING.
+static uint32_t UNI_HOT_FUNC(cycles_to_ns)(uint32_t cycles) {
+    uint32_t cpu = uni_system_get_cycles_per_us();
+    if (cpu != cycles_per_us) {
+        cycles_per_us = cpu;
+        ns_per_cycle_q16 = (1000u << 16) / cpu;
+    }
+    uint64_t ns = ((uint64_t)cycles * ns_per_cycle_q16) >> 16;
+    return ns < UINT32_MAX ? ns : UINT32_MAX;
+}
+
+// Linear interpolation inside the bucket that has the 99th percentile sample.
+static uint32_t get_p99(const stage_stats_t* s) {
+    uint32_t target = s->count - s->count / 100;
+    uint32_t cumulative = 0;
+
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        uint32_t n = s->histogram[b];
+        if (n != 0 && cumulative + n >= target) {
+            uint32_t lo = (b == 0) ? 0 : BIT(b - 1);
+            uint32_t hi = (b == HISTOGRAM_BUCKETS - 1) ? s->max + 1 : BIT(b);
+            uint32_t estimate = lo + (uint64_t)(hi - lo) * (target - cumulative) / n;
+            return estimate < s->max ? estimate : s->max;
+        }
+        cumulative += n;
+    }
+    return s->max;
+}
+
+static void profiled_set_player_leds(uni_hid_device_t* d, uint8_t leds) {
+    int idx = uni_hid_device_get_idx_for_instance(d);
+    if (idx < 0) {
+        loge("Profiler: invalid device\n");
+        return;
+    }
+    UNI_PROFILER_BEGIN(start);
+    wrapped[idx].set_player_leds(d, leds);
+    UNI_PROFILER_END(d, UNI_PROFILER_STAGE_SET_PLAYER_LEDS, start);
+}
+
+static void profiled_set_lightbar_color(uni_hid_device_t* d, uint8_t r, uint8_t g, uint8_t b) {
+    int idx = uni_hid_device_get_idx_for_instance(d);
+    if (idx < 0) {
+        loge("Profiler: invalid device\n");
+        return;
+    }
+    UNI_PROFILER_BEGIN(start);
+    wrapped[idx].set_lightbar_color(d, r, g, b);
+    UNI_PROFILER_END(d, UNI_PROFILER_STAGE_SET_LIGHTBAR_COLOR, start);
+}
+
+static void profiled_set_rumble(uni_hid_device_t* d, uint8_t force, uint8_t duration) {
+    int idx = uni_hid_device_get_idx_for_instance(d);
+    if (idx < 0) {
+        loge("Profiler: invalid device\n");
+        return;
+    }
+    UNI_PROFILER_BEGIN(start);
+    wrapped[idx].set_rumble(d, force, duration);
+    UNI_PROFILER_END(d, UNI_PROFILER_STAGE_SET_RUMBLE, start);
+}
+
+void uni_profiler_init(void) {
+    uni_system_init_cycle_counter();
+    uni_profiler_reset();
+
+    overhead = UINT32_MAX;
+    for (int i = 0; i < 8; i++) {
+        uint32_t start = uni_system_get_cycles();
+        uint32_t cycles = uni_system_get_cycles_since(start);
+        if (cycles < overhead)
+            overhead = cycles;
+    }
+
+    logi("Profiler: enabled, %" PRIu32 " cycles/us, overhead: %" PRIu32 " cycles\n", uni_system_get_cycles_per_us(),
+         overhead);
+}
+
+void uni_profiler_reset(void) {
+    memset(types, 0, sizeof(types));
+    untracked = 0;
+}
+
+void UNI_HOT_FUNC(uni_profiler_add)(uni_hid_device_t* d, uni_profiler_stage_t stage, uint32_t cycles) {
+    type_stats_t* t = get_type_stats(d->controller_type);
+    if (!t) {
+        untracked++;
+        return;
+    }
+
+    uint32_t ns = cycles_to_ns(cycles);
+    stage_stats_t* s = &t->stages[stage];
+    s->count++;
+    s->total += ns;
+    if (ns > s->max)
+        s->max = ns;
+    s->histogram[get_histogram_bucket(ns)]++;
+}
+
+void uni_profiler_wrap_report_parser(uni_hid_device_t* d) {
+    int idx = uni_hid_device_get_idx_for_instance(d);
+    uni_report_parser_t* rp = &d->report_parser;
+
+    if (idx < 0)
+        return;
+
+    // Might be called more than once for the same device. Don't wrap the wrappers.
+    if (rp->set_player_leds && rp->set_player_leds != profiled_set_player_leds) {
+        wrapped[idx].set_player_leds = rp->set_player_leds;
+        rp->set_player_leds = profiled_set_player_leds;
+    }
+    if (rp->set_lightbar_color && rp->set_lightbar_color != profiled_set_lightbar_color) {
+        wrapped[idx].set_lightbar_color = rp->set_lightbar_color;
+        rp->set_lightbar_color = profiled_set_lightbar_color;
+    }
+    if (rp->set_rumble && rp->set_rumble != profiled_set_rumble) {
+        wrapped[idx].set_rumble = rp->set_rumble;
+        rp->set_rumble = profiled_set_rumble;
+    }
+}
+
+void uni_profiler_dump(void) {
+    for (int step = 0; uni_profiler_dump_step(step); step++) {
+    }
+}
+
+// Each controller type takes: name + column titles + one line per stage.
+#define STEPS_PER_TYPE (UNI_PROFILER_STAGE_COUNT + 2)
+
+bool uni_profiler_dump_step(int step) {
+    if (step == 0) {
+        logi("Profiler: %" PRIu32 " cycles/us, overhead: %" PRIu32 " cycles, untracked: %" PRIu32 "\n",
+             uni_system_get_cycles_per_us(), overhead, untracked);
+        return true;
+    }
+
+    int i = (step - 1) / STEPS_PER_TYPE;
+    int line = (step - 1) % STEPS_PER_TYPE;
+    const type_stats_t* t = &types[i];
+
+    if (t->used) {
+        if (line == 0) {
+            logi("\t%s (0x%02x):\n", uni_gamepad_get_model_name(t->controller_type), t->controller_type);
+        } else if (line == 1) {
+            logi("\t\t%-20s %8s %8s %8s %8s %10s\n", "stage", "count", "avg_ns", "p99_ns", "max_ns", "total_us");
+        } else {
+            int j = line - 2;
+            const stage_stats_t* s = &t->stages[j];
+            if (s->count != 0)
+                logi("\t\t%-20s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %10" PRIu64 "\n", stage_names[j],
+                     s->count, (uint32_t)(s->total / s->count), get_p99(s), s->max, s->total / 1000);
+        }
+    }
+    return step < MAX_TYPES * STEPS_PER_TYPE;
+}
+
+#endif  // CONFIG_BLUEPAD32_PROFILER
@@ -6,6 +6,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "bt/uni_bt_defines.h"
 #include "platform/uni_platform.h"
@@ -84,31 +85,51 @@ void uni_property_list_all(void) {
         if (!p)
             // Means the property is not implemented, safe to break here.
             break;
-        uni_property_value_t val = uni_property_get_with_property(p);
-        switch (p->type) {
-            case UNI_PROPERTY_TYPE_BOOL:
-                logi("%s = %s\n", p->name, val.boolean ? "true" : "false");
-                break;
-            case UNI_PROPERTY_TYPE_U8:
-                logi("%s = %d\n", p->name, val.u8);
-                break;
-            case UNI_PROPERTY_TYPE_U32:
-                logi("%s = %u (%#x)\n", p->name, val.u32, val.u32);
-                break;
-            case UNI_PROPERTY_TYPE_FLOAT:
-                logi("%s = %f\n", p->name, val.f32);
-                break;
-                break;
-            case UNI_PROPERTY_TYPE_STRING:
-                if (val.str)
-                    logi("%s = '%s'\n", p->name, val.str);
-                else
-                    logi("%s = <empty>\n", p->name);
-                break;
-            default:
-                loge("%s = Unsupported property type %d\n", p->name, p->type);
-                break;
-        }
+        uni_property_dump_property(p);
+    }
+}
+
+const uni_property_t* uni_property_get_property_by_idx(uni_property_idx_t idx) {
+    if (idx >= UNI_PROPERTY_IDX_COUNT)
+        return NULL;
+    return get_property(idx);
+}
+
+const uni_property_t* uni_property_get_property_by_name(const char* name) {
+    for (int i = 0; i < UNI_PROPERTY_IDX_COUNT; i++) {
+        const uni_property_t* p = get_property(i);
+        if (!p)
+            break;
+        if (strcmp(p->name, name) == 0)
+            return p;
+    }
+    return NULL;
+}
+
+void uni_property_dump_property(const uni_property_t* p) {
+    uni_property_value_t val = uni_property_get_with_property(p);
+    switch (p->type) {
+        case UNI_PROPERTY_TYPE_BOOL:
+            logi("%s = %s\n", p->name, val.boolean ? "true" : "false");
+            break;
+        case UNI_PROPERTY_TYPE_U8:
+            logi("%s = %d\n", p->name, val.u8);
+            break;
+        case UNI_PROPERTY_TYPE_U32:
+            logi("%s = %u (%#x)\n", p->name, val.u32, val.u32);
+            break;
+        case UNI_PROPERTY_TYPE_FLOAT:
+            logi("%s = %f\n", p->name, val.f32);
+            break;
+        case UNI_PROPERTY_TYPE_STRING:
+            if (val.str)
+                logi("%s = '%s'\n", p->name, val.str);
+            else
+                logi("%s = <empty>\n", p->name);
+            break;
+        default:
+            loge("%s = Unsupported property type %d\n", p->name, p->type);
+            break;
     }
 }
 
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#include "uni_report_stats.h"
+
+#include <string.h>
+
+#include "uni_clock_scaling.h"
+#include "uni_config.h"
+#include "uni_log.h"
+
+// EWMA alpha is 1/(2^EWMA_SHIFT)
+#define EWMA_SHIFT 3
+// The first processing histogram bucket is [0-16) us
+#define PROCESSING_HISTOGRAM_SHIFT 4
+
+static int UNI_HOT_FUNC(get_histogram_bucket)(uint32_t value) {
+    int bucket = 0;
+    while (value != 0 && bucket < UNI_REPORT_STATS_HISTOGRAM_BUCKETS - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void uni_report_stats_reset(uni_report_stats_t* s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void UNI_HOT_FUNC(uni_report_stats_on_report)(uni_report_stats_t* s, uint32_t now_us) {
+    s->reports++;
+
+    if (s->reports == 1) {
+        // First report: there is no interval yet.
+        s->last_report_us = now_us;
+        return;
+    }
+
+    // Unsigned arithmetic takes care of the wrap-around.
+    uint32_t interval = now_us - s->last_report_us;
+    s->last_report_us = now_us;
+
+    if (s->reports == 2) {
+        s->min_interval_us = interval;
+        s->max_interval_us = interval;
+        s->ewma_interval_us = interval;
+    } else {
+        if (interval < s->min_interval_us)
+            s->min_interval_us = interval;
+        if (interval > s->max_interval_us)
+            s->max_interval_us = interval;
+        int32_t diff = (int32_t)(interval - s->ewma_interval_us);
+        s->ewma_interval_us += diff / (1 << EWMA_SHIFT);
+    }
+
+    s->histogram[get_histogram_bucket(interval / 1000)]++;
+}
+
+void UNI_HOT_FUNC(uni_report_stats_on_sequence)(uni_report_stats_t* s, uint8_t seq, uint8_t mask, uint8_t step) {
+    if (s->has_seq) {
+        uint8_t delta = (seq - s->last_seq) & mask;
+        if (delta == 0) {
+            s->seq_duplicated++;
+        } else if (delta > step) {
+            // Round to the nearest number of steps, since some counters (e.g.: Switch timer)
+            // don't advance by exactly "step" between reports.
+            s->seq_lost += ((delta + step / 2) / step) - 1;
+        }
+    }
+    s->has_seq = true;
+    s->last_seq = seq;
+}
+
+void UNI_HOT_FUNC(uni_report_stats_on_processed)(uni_report_stats_t* s, uint32_t elapsed_us, bool fast_path) {
+    if (fast_path)
+        s->fast_path_reports++;
+#ifdef CONFIG_BLUEPAD32_CLOCK_SCALING
+    uni_clock_scaling_on_report_processed(elapsed_us);
+#endif  // CONFIG_BLUEPAD32_CLOCK_SCALING
+    if (elapsed_us > s->processing_max_us)
+        s->processing_max_us = elapsed_us;
+    s->processing_histogram[get_histogram_bucket(elapsed_us >> PROCESSING_HISTOGRAM_SHIFT)]++;
+    if (s->processing_ewma_us == 0) {
+        s->processing_ewma_us = elapsed_us;
+    } else {
+        int32_t diff = (int32_t)(elapsed_us - s->processing_ewma_us);
+        s->processing_ewma_us += diff / (1 << EWMA_SHIFT);
+    }
+}
+
+void uni_report_stats_dump(const uni_report_stats_t* s) {
+    if (s->reports < 2) {
+        logi("\treports: %u\n", (unsigned int)s->reports);
+        return;
+    }
+    logi("\treports: %u, interval (us): min=%u, max=%u, avg=%u\n", (unsigned int)s->reports,
+         (unsigned int)s->min_interval_us, (unsigned int)s->max_interval_us, (unsigned int)s->ewma_interval_us);
+    logi("\tinterval histogram (ms): <1:%u, <2:%u, <4:%u, <8:%u, <16:%u, <32:%u, <64:%u, >=64:%u\n",
+         (unsigned int)s->histogram[0], (unsigned int)s->histogram[1], (unsigned int)s->histogram[2],
+         (unsigned int)s->histogram[3], (unsigned int)s->histogram[4], (unsigned int)s->histogram[5],
+         (unsigned int)s->histogram[6], (unsigned int)s->histogram[7]);
+    logi("\treport processing (us): avg=%u, max=%u, fast-path=%u\n", (unsigned int)s->processing_ewma_us,
+         (unsigned int)s->processing_max_us, (unsigned int)s->fast_path_reports);
+    logi("\tprocessing histogram (us): <16:%u, <32:%u, <64:%u, <128:%u, <256:%u, <512:%u, <1024:%u, >=1024:%u\n",
+         (unsigned int)s->processing_histogram[0], (unsigned int)s->processing_histogram[1],
+         (unsigned int)s->processing_histogram[2], (unsigned int)s->processing_histogram[3],
+         (unsigned int)s->processing_histogram[4], (unsigned int)s->processing_histogram[5],
+         (unsigned int)s->processing_histogram[6], (unsigned int)s->processing_histogram[7]);
+    if (s->has_seq)
+        logi("\tsequence: lost=%u, duplicated=%u\n", (unsigned int)s->seq_lost, (unsigned int)s->seq_duplicated);
+}
@@ -0,0 +1,1051 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Ricardo Quesada
+// http://retro.moe/unijoysticle2
+
+#include "uni_simulator.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <btstack.h>
+
+#include "bt/uni_bt_bredr.h"
+#include "bt/uni_bt_conn.h"
+#include "bt/uni_bt_defines.h"
+#include "uni_common.h"
+#include "uni_error.h"
+#include "uni_hid_capture.h"
+#include "uni_log.h"
+#include "uni_report_stats.h"
+#include "uni_system.h"
+
+// Simulated controllers.
+//
+// Instead of emulating a Bluetooth controller at the HCI level, the simulated controllers
+// are plugged right above L2CAP / GATT:
+// - Device creation + name + VID/PID + COD is what the real stack learns from inquiry,
+//   remote name request and SDP.
+// - Input reports and feature reports are delivered to the same entry points that
+//   BTstack calls: uni_bt_bredr_on_l2cap_data_packet() for BR/EDR, and the equivalent of
+//   the GATT HID report handler for BLE.
+// - Output reports are intercepted in uni_hid_device_send_report(), and answered by
+//   each profile "script" after "latency" milliseconds, like a real controller would do.
+//
+// Everything from the parser's setup until the platform callbacks is the real code.
+
+// Each simulated controller uses one uni_hid_device_t.
+#define SIM_MAX_CONTROLLERS CONFIG_BLUEPAD32_MAX_DEVICES
+#define SIM_MAX_PENDING_REPLIES 4
+#define SIM_MAX_REPORT_LEN 64
+#define SIM_MAX_SCRIPT_LEN 128
+#define SIM_DEFAULT_LATENCY_MS 2
+// Time between two simulated connections.
+#define SIM_CONNECT_INTERVAL_MS 100
+// Fake L2CAP cids and connection handles. Far away from the ones that BTstack assigns.
+#define SIM_CID_BASE 0xf000
+#define SIM_CONN_HANDLE_BASE 0x0e00
+// Replayed devices: 00:5A:5A:01:00:<idx>
+#define SIM_REPLAY_CID_BASE (SIM_CID_BASE + 0x100)
+#define SIM_REPLAY_CONN_HANDLE_BASE (SIM_CONN_HANDLE_BASE + 0x80)
+#define SIM_REPLAY_MAX_FILE_SIZE (4 * 1024 * 1024)
+
+#define DS4_INPUT_REPORT_LEN (1 + 78)
+#define DS4_FEATURE_REPORT_CALIBRATION 0x02
+#define DS4_FEATURE_REPORT_CALIBRATION_LEN (1 + 37)
+#define DS4_FEATURE_REPORT_FIRMWARE_VERSION 0xa3
+#define DS4_FEATURE_REPORT_FIRMWARE_VERSION_LEN (1 + 49)
+#define SWITCH_INPUT_REPORT_LEN (1 + 49)
+#define SWITCH_SUBCMD_REQ_DEV_INFO 0x02
+#define SWITCH_SUBCMD_SPI_FLASH_READ 0x10
+#define WII_REQ_DRM 0x12
+#define WII_REQ_SREQ 0x15
+#define WII_REQ_WMEM 0x16
+#define XBOX_INPUT_REPORT_LEN 17
+
+// HID transaction headers
+#define HID_HEADER_INPUT ((HID_MESSAGE_TYPE_DATA << 4) | HID_REPORT_TYPE_INPUT)
+#define HID_HEADER_OUTPUT ((HID_MESSAGE_TYPE_DATA << 4) | HID_REPORT_TYPE_OUTPUT)
+#define HID_HEADER_FEATURE ((HID_MESSAGE_TYPE_DATA << 4) | HID_REPORT_TYPE_FEATURE)
+#define HID_HEADER_GET_FEATURE ((HID_MESSAGE_TYPE_GET_REPORT << 4) | HID_REPORT_TYPE_FEATURE)
+
+typedef struct sim_controller_s sim_controller_t;
+
+typedef struct {
+    const char* type;  // As used in the script
+    const char* name;
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint32_t cod;
+    uni_bt_conn_protocol_t protocol;
+    uint16_t default_rate_hz;
+    // Answers the reports sent by Bluepad32. Optional.
+    void (*on_output_report)(sim_controller_t* c, uint16_t cid, const uint8_t* report, uint16_t len);
+    // Fills the next input report, including the HID header for BR/EDR. Returns its length.
+    uint16_t (*fill_input_report)(sim_controller_t* c, uint8_t* report);
+    // What the real stack gets from SDP (BR/EDR) or from the HID service (BLE). Optional.
+    const uint8_t* hid_descriptor;
+    uint16_t hid_descriptor_len;
+} sim_profile_t;
+
+typedef struct {
+    uint16_t cid;
+    uint16_t len;
+    uint8_t data[SIM_MAX_REPORT_LEN];
+} sim_reply_t;
+
+struct sim_controller_s {
+    const sim_profile_t* profile;
+    uni_hid_device_t* d;
+    bd_addr_t addr;
+    uint16_t rate_hz;
+
+    btstack_timer_source_t connect_timer;
+    btstack_timer_source_t reply_timer;
+    btstack_timer_source_t report_timer;
+
+    // Replies that will be delivered once the latency expires.
+    sim_reply_t replies[SIM_MAX_PENDING_REPLIES];
+    uint8_t replies_head;
+    uint8_t replies_count;
+    bool replying;
+
+    uint32_t connect_start_us;
+    uint32_t setup_us;
+    bool ready;
+    bool lost;  // Deleted by Bluepad32. E.g: rejected by the platform
+    uint32_t next_report_us;
+    uint32_t frame;  // Number of input reports sent. Used to animate the reports
+
+    // Stats
+    uint32_t input_reports;
+    uint32_t output_reports;
+    uint64_t cpu_ns;  // CPU time spent processing the input reports
+};
+
+static void ds4_on_output_report(sim_controller_t* c, uint16_t cid, const uint8_t* report, uint16_t len);
+static uint16_t ds4_fill_input_report(sim_controller_t* c, uint8_t* report);
+static void switch_on_output_report(sim_controller_t* c, uint16_t cid, const uint8_t* report, uint16_t len);
+static uint16_t switch_fill_input_report(sim_controller_t* c, uint8_t* report);
+static void wii_on_output_report(sim_controller_t* c, uint16_t cid, const uint8_t* report, uint16_t len);
+static uint16_t wii_fill_input_report(sim_controller_t* c, uint8_t* report);
+static uint16_t xbox_fill_input_report(sim_controller_t* c, uint8_t* report);
+
+// Xbox Wireless Controller, firmware 4.8. Matches the reports generated by xbox_fill_input_report().
+static const uint8_t xbox_hid_descriptor[] = {
+    0x05, 0x01, 0x09, 0x05, 0xa1, 0x01, 0x85, 0x01, 0x09, 0x01, 0xa1, 0x00, 0x09, 0x30, 0x09, 0x31, 0x15, 0x00, 0x27,
+    0xff, 0xff, 0x00, 0x00, 0x95, 0x02, 0x75, 0x10, 0x81, 0x02, 0xc0, 0x09, 0x01, 0xa1, 0x00, 0x09, 0x32, 0x09, 0x35,
+    0x15, 0x00, 0x27, 0xff, 0xff, 0x00, 0x00, 0x95, 0x02, 0x75, 0x10, 0x81, 0x02, 0xc0, 0x05, 0x02, 0x09, 0xc5, 0x15,
+    0x00, 0x26, 0xff, 0x03, 0x95, 0x01, 0x75, 0x0a, 0x81, 0x02, 0x15, 0x00, 0x25, 0x00, 0x75, 0x06, 0x95, 0x01, 0x81,
+    0x03, 0x05, 0x02, 0x09, 0xc4, 0x15, 0x00, 0x26, 0xff, 0x03, 0x95, 0x01, 0x75, 0x0a, 0x81, 0x02, 0x15, 0x00, 0x25,
+    0x00, 0x75, 0x06, 0x95, 0x01, 0x81, 0x03, 0x05, 0x01, 0x09, 0x39, 0x15, 0x01, 0x25, 0x08, 0x35, 0x00, 0x46, 0x3b,
+    0x01, 0x66, 0x14, 0x00, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42, 0x75, 0x04, 0x95, 0x01, 0x15, 0x00, 0x25, 0x00, 0x35,
+    0x00, 0x45, 0x00, 0x65, 0x00, 0x81, 0x03, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0f, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01,
+    0x95, 0x0f, 0x81, 0x02, 0x15, 0x00, 0x25, 0x00, 0x75, 0x01, 0x95, 0x01, 0x81, 0x03, 0x05, 0x0c, 0x0a, 0x24, 0x02,
+    0x15, 0x00, 0x25, 0x01, 0x95, 0x01, 0x75, 0x01, 0x81, 0x02, 0x15, 0x00, 0x25, 0x00, 0x75, 0x07, 0x95, 0x01, 0x81,
+    0x03, 0x05, 0x0c, 0x09, 0x01, 0x85, 0x02, 0xa1, 0x01, 0x05, 0x0c, 0x0a, 0x23, 0x02, 0x15, 0x00, 0x25, 0x01, 0x95,
+    0x01, 0x75, 0x01, 0x81, 0x02, 0x15, 0x00, 0x25, 0x00, 0x75, 0x07, 0x95, 0x01, 0x81, 0x03, 0xc0, 0x05, 0x0f, 0x09,
+    0x21, 0x85, 0x03, 0xa1, 0x02, 0x09, 0x97, 0x15, 0x00, 0x25, 0x01, 0x75, 0x04, 0x95, 0x01, 0x91, 0x02, 0x15, 0x00,
+    0x25, 0x00, 0x75, 0x04, 0x95, 0x01, 0x91, 0x03, 0x09, 0x70, 0x15, 0x00, 0x25, 0x64, 0x75, 0x08, 0x95, 0x04, 0x91,
+    0x02, 0x09, 0x50, 0x66, 0x01, 0x10, 0x55, 0x0e, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x01, 0x91, 0x02,
+    0x09, 0xa7, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x01, 0x91, 0x02, 0x65, 0x00, 0x55, 0x00, 0x09, 0x7c,
+    0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x01, 0x91, 0x02, 0xc0, 0x05, 0x06, 0x09, 0x20, 0x85, 0x04, 0x15,
+    0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02, 0xc0,
+};
+
+static const sim_profile_t profiles[] = {
+    {
+        .type = "ds4",
+        .name = "Wireless Controller",
+        .vendor_id = 0x054c,
+        .product_id = 0x09cc,
+        .cod = UNI_BT_COD_MAJOR_PERIPHERAL | UNI_BT_COD_MINOR_GAMEPAD,
+        .protocol = UNI_BT_CONN_PROTOCOL_BR_EDR,
+        .default_rate_hz = 250,
+        .on_output_report = ds4_on_output_report,
+        .fill_input_report = ds4_fill_input_report,
+    },
+    {
+        .type = "switch",
+        .name = "Pro Controller",
+        .vendor_id = 0x057e,
+        .product_id = 0x2009,
+        .cod = UNI_BT_COD_MAJOR_PERIPHERAL | UNI_BT_COD_MINOR_GAMEPAD,
+        .protocol = UNI_BT_CONN_PROTOCOL_BR_EDR,
+        .default_rate_hz = 66,  // One report every 15ms
+        .on_output_report = switch_on_output_report,
+        .fill_input_report = switch_fill_input_report,
+    },
+    {
+        .type = "wii",
+        .name = "Nintendo RVL-CNT-01",
+        .vendor_id = 0x057e,
+        .product_id = 0x0306,
+        .cod = UNI_BT_COD_MAJOR_PERIPHERAL | UNI_BT_COD_MINOR_JOYSTICK,
+        .protocol = UNI_BT_CONN_PROTOCOL_BR_EDR,
+        .default_rate_hz = 100,
+        .on_output_report = wii_on_output_report,
+        .fill_input_report = wii_fill_input_report,
+    },
+    {
+        .type = "xbox",
+        .name = "Xbox Wireless Controller",
+        .vendor_id = 0x045e,
+        .product_id = 0x0b13,
+        .protocol = UNI_BT_CONN_PROTOCOL_BLE,
+        .default_rate_hz = 125,
+        .fill_input_report = xbox_fill_input_report,
+        .hid_descriptor = xbox_hid_descriptor,
+        .hid_descriptor_len = sizeof(xbox_hid_descriptor),
+    },
+};
+
+static sim_controller_t controllers[SIM_MAX_CONTROLLERS];
+static int controllers_count;
+static uint32_t latency_ms = SIM_DEFAULT_LATENCY_MS;
+static uint32_t duration_s;
+static uint32_t start_us;
+static uint64_t start_cpu_ns;
+static btstack_timer_source_t duration_timer;
+
+// Replay
+typedef struct {
+    uni_hid_device_t* devices[UNI_HID_CAPTURE_MAX_DEVICES];
+    uint32_t input_reports;
+    uint32_t output_reports;
+    uint32_t feature_reports;
+    uint32_t skipped_reports;  // Reports for devices that couldn't be created
+} sim_replay_t;
+
+static const char* replay_path;
+static btstack_timer_source_t replay_timer;
+
+//
+// Helpers
+//
+static uint64_t get_cpu_time_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 0 -> 255 -> 0 in 512 frames. Used for the axis.
+static uint8_t triangle(uint32_t frame) {
+    uint8_t v = frame & 0xff;
+    return (frame & 0x100) ? 0xff - v : v;
+}
+
+// One of the 4 face buttons is pressed for 16 frames, then released for 16 frames.
+static int pressed_button(const sim_controller_t* c) {
+    if ((c->frame & 0x10) == 0)
+        return -1;
+    return (c->frame >> 5) & 0x03;
+}
+
+static uni_hid_device_t* sim_get_device(sim_controller_t* c) {
+    if (c->d == NULL || c->lost)
+        return NULL;
+
+    // Bluepad32 might have deleted the device. E.g: the platform rejected it, or the
+    // connection timed out.
+    if (!c->d->conn.simulated || bd_addr_cmp(c->d->conn.btaddr, c->addr) != 0) {
+        loge("Simulator: %s (%s) is gone\n", c->profile->type, bd_addr_to_str(c->addr));
+        c->lost = true;
+        return NULL;
+    }
+    return c->d;
+}
+
+static void sim_deliver_report(sim_controller_t* c, uint16_t cid, const uint8_t* report, uint16_t len) {
+    uni_hid_device_t* d = c->d;
+
+    if (c->profile->protocol == UNI_BT_CONN_PROTOCOL_BR_EDR) {
+        uni_bt_bredr_on_l2cap_data_packet(cid, report, len);
+        return;
+    }
+
+    // BLE: Same as what uni_bt_le does with the GATT HID reports.
+    uint32_t now = uni_system_get_time_us();
+    uni_report_stats_on_report(&d->report_stats, now);
+    uni_hid_parse_input_report(d, report, len);
+    uni_hid_device_process_controller(d);
+    uni_report_stats_on_processed(&d->report_stats, uni_system_get_time_us() - now, false);
+}
+
+static void sim_schedule_next_report(sim_controller_t* c) {
+    uint32_t now = uni_system_get_time_us();
+
+    c->next_report_us += 1000000 / c->rate_hz;
+    int32_t delay_us = (int32_t)(c->next_report_us - now);
+    if (delay_us < 0) {
+        // Running late. Don't try to catch up by sending a burst of reports.
+        c->next_report_us = now;
+        delay_us = 0;
+    }
+    btstack_run_loop_set_timer(&c->report_timer, delay_us / 1000);
+    btstack_run_loop_add_timer(&c->report_timer);
+}
+
+static void sim_check_ready(sim_controller_t* c) {
+    if (c->ready)
+        return;
+
+    uni_hid_device_t* d = sim_get_device(c);
+    if (!d || uni_bt_conn_get_state(&d->conn) != UNI_BT_CONN_STATE_DEVICE_READY)
+        return;
+
+    c->ready = true;
+    c->setup_us = uni_system_get_time_us() - c->connect_start_us;
+    logi("Simulator: %s (%s) ready in %" PRIu32 " us\n", c->profile->type, bd_addr_to_str(c->addr), c->setup_us);
+
+    c->next_report_us = uni_system_get_time_us();
+    sim_schedule_next_report(c);
+}
+
+static void sim_on_reply_timer(btstack_timer_source_t* ts) {
+    sim_controller_t* c = btstack_run_loop_get_timer_context(ts);
+
+    // Only the replies queued before the timer fired. Replies to the requests that are
+    // sent while processing these ones have to wait for the next round trip.
+    int count = c->replies_count;
+    c->replying = true;
+    for (int i = 0; i < count; i++) {
+        sim_reply_t reply = c->replies[c->replies_head];
+        c->replies_head = (c->replies_head + 1) % SIM_MAX_PENDING_REPLIES;
+        c->replies_count--;
+
+        if (sim_get_device(c) == NULL)
+            break;
+        sim_deliver_report(c, reply.cid, reply.data, reply.len);
+    }
+    c->replying = false;
+
+    if (c->replies_count > 0 && !c->lost) {
+        btstack_run_loop_set_timer(&c->reply_timer, latency_ms);
+        btstack_run_loop_add_timer(&c->reply_timer);
+    }
+
+    sim_check_ready(c);
+}
+
+// Returns a zeroed reply, that will be sent after "latency" milliseconds.
+static sim_reply_t* sim_new_reply(sim_controller_t* c, uint16_t cid, uint16_t len) {
+    if (c->replies_count == SIM_MAX_PENDING_REPLIES) {
+        loge("Simulator: %s reply queue full, dropping reply\n", c->profile->type);
+        return NULL;
+    }
+
+    sim_reply_t* reply = &c->replies[(c->replies_head + c->replies_count) % SIM_MAX_PENDING_REPLIES];
+    memset(reply, 0, sizeof(*reply));
+    reply->cid = cid;
+    reply->len = len;
+    c->replies_count++;
+
+    // If it is replying, the timer gets scheduled once it finishes.
+    if (c->replies_count == 1 && !c->replying) {
+        btstack_run_loop_set_timer(&c->reply_timer, latency_ms);
+        btstack_run_loop_add_timer(&c->reply_timer);
+    }
+    return reply;
+}
+
+//
+// DualShock 4
+//
+static void ds4_on_output_report(sim_controller_t* c, uint16_t cid, const uint8_t* report, uint16_t len) {
+    sim_reply_t* reply;
+    uint8_t* r;
+
+    // Output reports (lightbar, rumble) don't need an answer.
+    if (cid != c->d->conn.control_cid || len < 2 || report[0] != HID_HEADER_GET_FEATURE)
+        return;
+
+    switch (report[1]) {
+        case DS4_FEATURE_REPORT_CALIBRATION:
+            reply = sim_new_reply(c, cid, DS4_FEATURE_REPORT_CALIBRATION_LEN);
+            if (!reply)
+                return;
+            r = reply->data;
+            r[0] = HID_HEADER_FEATURE;
+            r[1] = DS4_FEATURE_REPORT_CALIBRATION;
+            // Gyro bias (3) are zero. Then gyro plus (3), gyro minus (3), gyro speed plus / minus
+            for (int i = 0; i < 3; i++) {
+                little_endian_store_16(r, 8 + i * 2, 8800);
+                little_endian_store_16(r, 14 + i * 2, (uint16_t)-8800);
+            }
+            little_endian_store_16(r, 20, 540);
+            little_endian_store_16(r, 22, 540);
+            // Accel plus / minus for x, y, z
+            for (int i = 0; i < 3; i++) {
+                little_endian_store_16(r, 24 + i * 4, 8192);
+                little_endian_store_16(r, 26 + i * 4, (uint16_t)-8192);
+            }
+            break;
+        case DS4_FEATURE_REPORT_FIRMWARE_VERSION:
+            reply = sim_new_reply(c, cid, DS4_FEATURE_REPORT_FIRMWARE_VERSION_LEN);
+            if (!reply)
+                return;
+            r = reply->data;
+            r[0] = HID_HEADER_FEATURE;
+            r[1] = DS4_FEATURE_REPORT_FIRMWARE_VERSION;
+            memcpy(&r[2], "Sep 21 2018", 11);
+            memcpy(&r[18], "04:50:51", 8);
+            r[35] = 1;
+            little_endian_store_16(r, 36, 0xb400);  // hw version
+            little_endian_store_16(r, 42, 0x01a0);  // fw version
+            break;
+        default:
+            logi("Simulator: DS4 unsupported feature report 0x%02x\n", report[1]);
+            break;
+    }
+}
+
+static uint16_t ds4_fill_input_report(sim_controller_t* c, uint8_t* report) {
+    uint8_t v = triangle(c->frame);
+    int button = pressed_button(c);
+
+    memset(report, 0, DS4_INPUT_REPORT_LEN);
+    report[0] = HID_HEADER_INPUT;
+    report[1] = 0x11;
+    report[2] = 0xc0;
+
+    uint8_t* r = &report[4];
+    r[0] = v;         // x
+    r[1] = 0xff - v;  // y
+    r[2] = 0x80;      // rx
+    r[3] = 0x80;      // ry
+    r[4] = 0x08;      // Hat centered
+    if (button >= 0)
+        r[4] |= 0x10 << button;
+    r[6] = (c->frame << 2) & 0xfc;  // 6-bit report counter
+    r[7] = v;                       // brake
+    r[29] = 0x08;                   // Battery
+    return DS4_INPUT_REPORT_LEN;
+}
+
+//
+// Nintendo Switch Pro Controller
+//
+// 12-bit values, packed in 3 bytes: x,y
+#define SWITCH_STICK(x, y) (x) & 0xff, (((x) >> 8) & 0x0f) | (((y) & 0x0f) << 4), ((y) >> 4) & 0xff
+
+static void switch_read_spi_flash(uint32_t addr, uint8_t* out, int len) {
+    // Left stick: max, center, min. Right stick: center, min, max.
+    static const uint8_t stick_calibration[] = {
+        SWITCH_STICK(1535, 1535), SWITCH_STICK(2048, 2048), SWITCH_STICK(1535, 1535),
+        SWITCH_STICK(2048, 2048), SWITCH_STICK(1535, 1535), SWITCH_STICK(1535, 1535),
+    };
+    // Accel offset, accel scale, gyro offset, gyro scale. Little endian.
+    static const uint8_t imu_calibration[] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3b, 0x34, 0x3b, 0x34, 0x3b, 0x34,
+    };
+
+    // Erased flash
+    memset(out, 0xff, len);
+    if (addr == 0x603d)
+        memcpy(out, stick_calibration, btstack_min(len, sizeof(stick_calibration)));
+    else if (addr == 0x6020)
+        memcpy(out, imu_calibration, btstack_min(len, sizeof(imu_calibration)));
+}
+
+// Header shared by reports 0x21 and 0x30. Returns the offset after the buttons.
+static int switch_fill_header(sim_controller_t* c, uint8_t* report, uint8_t report_id, bool animate) {
+    uint16_t x = 2048;
+    int button = animate ? pressed_button(c) : -1;
+
+    if (animate)
+        x = 2048 + (triangle(c->frame) - 128) * 8;
+
+    report[0] = HID_HEADER_INPUT;
+    report[1] = report_id;
+    report[2] = (c->frame * 3) & 0xff;  // Timer. Incremented every 5ms
+    report[3] = 0x8e;                   // Battery full, Pro Controller
+    // Buttons right: Y, X, B, A
+    report[4] = (button >= 0) ? BIT(button) : 0;
+    report[5] = 0;
+    report[6] = 0;
+    const uint8_t sticks[] = {SWITCH_STICK(x, 2048), SWITCH_STICK(2048, 2048)};
+    memcpy(&report[7], sticks, sizeof(sticks));
+    report[13] = 0;  // Vibrator report
+    return 14;
+}
+
+static void switch_on_output_report(sim_controller_t* c, uint16_t cid, const uint8_t* report, uint16_t len) {
+    // 0xa2, 0x01 (rumble + subcmd), packet number, rumble (8 bytes), subcmd id, subcmd data
+    // Rumble-only reports (0x10) don't need an answer.
+    if (len < 12 || report[0] != HID_HEADER_OUTPUT || report[1] != 0x01)
+        return;
+
+    uint8_t subcmd = report[11];
+    const uint8_t* args = &report[12];
+    int args_len = len - 12;
+
+    sim_reply_t* reply = sim_new_reply(c, cid, SWITCH_INPUT_REPORT_LEN);
+    if (!reply)
+        return;
+    uint8_t* r = reply->data;
+    int idx = switch_fill_header(c, r, 0x21, false);
+    uint8_t* ack = &r[idx];
+    r[idx + 1] = subcmd;
+    uint8_t* data = &r[idx + 2];
+
+    *ack = 0x80;
+    switch (subcmd) {
+        case SWITCH_SUBCMD_REQ_DEV_INFO:
+            *ack = 0x82;
+            data[0] = 0x03;  // Firmware version: 3.72
+            data[1] = 0x48;
+            data[2] = 0x03;  // Pro Controller
+            data[3] = 0x02;
+            for (int i = 0; i < 6; i++)
+                data[4 + i] = c->addr[5 - i];
+            data[10] = 0x01;
+            data[11] = 0x01;  // Colors in SPI
+            break;
+        case SWITCH_SUBCMD_SPI_FLASH_READ: {
+            if (args_len < 5)
+                break;
+            *ack = 0x90;
+            // Address + len are echoed back
+            memcpy(data, args, 5);
+            uint32_t addr = little_endian_read_32(args, 0);
+            int size = btstack_min(args[4], SWITCH_INPUT_REPORT_LEN - (data - r) - 5);
+            switch_read_spi_flash(addr, &data[5], size);
+            break;
+        }
+        default:
+            // Set report mode, enable IMU, set LEDs, etc: ack is enough.
+            break;
+    }
+}
+
+static uint16_t switch_fill_input_report(sim_controller_t* c, uint8_t* report) {
+    memset(report, 0, SWITCH_INPUT_REPORT_LEN);
+    // IMU data is left as zero
+    switch_fill_header(c, report, 0x30, true);
+    return SWITCH_INPUT_REPORT_LEN;
+}
+
+//
+// Wii Remote
+//
+static void wii_on_output_report(sim_controller_t* c, uint16_t cid, const uint8_t* report, uint16_t len) {
+    sim_reply_t* reply;
+
+    if (len < 3 || report[0] != HID_HEADER_OUTPUT)
+        return;
+
+    switch (report[1]) {
+        case WII_REQ_SREQ:
+            // Status: buttons, flags (no extension), battery
+            reply = sim_new_reply(c, cid, 8);
+            if (!reply)
+                return;
+            reply->data[0] = HID_HEADER_INPUT;
+            reply->data[1] = 0x20;
+            reply->data[7] = 0xc0;
+            break;
+        case WII_REQ_WMEM:
+            // Acknowledge, no error
+            reply = sim_new_reply(c, cid, 6);
+            if (!reply)
+                return;
+            reply->data[0] = HID_HEADER_INPUT;
+            reply->data[1] = 0x22;
+            reply->data[4] = WII_REQ_WMEM;
+            break;
+        case WII_REQ_DRM:
+            // Only "core buttons" (0x30) is simulated, regardless of the requested mode.
+            if (len >= 4 && report[3] != 0x30)
+                logi("Simulator: Wii report mode 0x%02x not supported, using 0x30\n", report[3]);
+            break;
+        default:
+            // LEDs, rumble: nothing to answer
+            break;
+    }
+}
+
+static uint16_t wii_fill_input_report(sim_controller_t* c, uint8_t* report) {
+    // Buttons: 2, 1, B, A
+    static const uint8_t buttons[] = {0x01, 0x02, 0x04, 0x08};
+    int button = pressed_button(c);
+
+    report[0] = HID_HEADER_INPUT;
+    report[1] = 0x30;
+    report[2] = 0;
+    report[3] = (button >= 0) ? buttons[button] : 0;
+    return 4;
+}
+
+//
+// Xbox Wireless Controller (BLE)
+//
+static uint16_t xbox_fill_input_report(sim_controller_t* c, uint8_t* report) {
+    // Buttons: A, B, X, Y
+    static const uint8_t buttons[] = {0, 1, 3, 4};
+    uint8_t v = triangle(c->frame);
+    int button = pressed_button(c);
+
+    // No HID header in BLE
+    memset(report, 0, XBOX_INPUT_REPORT_LEN);
+    report[0] = 0x01;
+    little_endian_store_16(report, 1, v << 8);             // x
+    little_endian_store_16(report, 3, (0xff - v) << 8);    // y
+    little_endian_store_16(report, 5, 0x8000);             // rx
+    little_endian_store_16(report, 7, 0x8000);             // ry
+    little_endian_store_16(report, 9, v << 2);             // brake, 10-bit
+    little_endian_store_16(report, 11, 0);                 // throttle, 10-bit
+    report[13] = 0;                                        // Hat centered
+    little_endian_store_16(report, 14, (button >= 0) ? BIT(buttons[button]) : 0);
+    return XBOX_INPUT_REPORT_LEN;
+}
+
+//
+// Replay
+//
+static void replay_get_addr(int idx, bd_addr_t addr) {
+    memset(addr, 0, sizeof(bd_addr_t));
+    addr[1] = 0x5a;
+    addr[2] = 0x5a;
+    addr[3] = 0x01;
+    addr[5] = idx;
+}
+
+static uni_hid_device_t* replay_get_device(sim_replay_t* r, int idx) {
+    uni_hid_device_t* d = r->devices[idx];
+    bd_addr_t addr;
+
+    if (!d)
+        return NULL;
+
+    // Bluepad32 might have deleted it. E.g: the platform rejected it.
+    replay_get_addr(idx, addr);
+    if (!d->conn.simulated || bd_addr_cmp(d->conn.btaddr, addr) != 0) {
+        r->devices[idx] = NULL;
+        return NULL;
+    }
+    return d;
+}
+
+static void replay_on_device(void* context, int idx, const uni_hid_capture_device_t* device) {
+    sim_replay_t* r = context;
+    bd_addr_t addr;
+
+    logi("Replay: idx=%d, name='%s', vid=0x%04x, pid=0x%04x, cod=0x%06" PRIx32 ", HID descriptor len=%d\n", idx,
+         device->name, device->vendor_id, device->product_id, device->cod, device->hid_descriptor_len);
+
+    // The slot was reused by a new connection.
+    uni_hid_device_t* d = replay_get_device(r, idx);
+    if (d) {
+        uni_hid_device_disconnect(d);
+        uni_hid_device_delete(d);
+        r->devices[idx] = NULL;
+    }
+
+    replay_get_addr(idx, addr);
+    d = uni_hid_device_create(addr);
+    if (!d) {
+        loge("Replay: failed to create device for idx=%d\n", idx);
+        return;
+    }
+
+    d->conn.simulated = true;
+    uni_bt_conn_set_protocol(&d->conn, device->protocol);
+    uni_hid_device_set_connection_handle(d, SIM_REPLAY_CONN_HANDLE_BASE + idx);
+    if (device->protocol == UNI_BT_CONN_PROTOCOL_BLE) {
+        d->hids_cid = SIM_REPLAY_CID_BASE + idx;
+    } else {
+        d->conn.control_cid = SIM_REPLAY_CID_BASE + idx * 2;
+        d->conn.interrupt_cid = SIM_REPLAY_CID_BASE + idx * 2 + 1;
+        uni_hid_device_set_cod(d, device->cod);
+    }
+    uni_hid_device_set_incoming(d, true);
+    uni_hid_device_set_name(d, device->name);
+    uni_hid_device_set_vendor_id(d, device->vendor_id);
+    uni_hid_device_set_product_id(d, device->product_id);
+    if (device->hid_descriptor_len)
+        uni_hid_device_set_hid_descriptor(d, device->hid_descriptor, device->hid_descriptor_len);
+    uni_hid_device_guess_controller_type_from_pid_vid(d);
+
+    r->devices[idx] = d;
+    uni_hid_device_connect(d);
+    // The setup replies are in the capture: feature reports (e.g: DualSense), or input reports
+    // (e.g: Switch). Replayed by replay_on_report().
+    uni_hid_device_set_ready(d);
+    /* 'd' might be invalid */
+}
+
+static void replay_on_report(void* context,
+                             int idx,
+                             uni_hid_capture_record_type_t type,
+                             uint32_t timestamp_us,
+                             const uint8_t* report,
+                             uint16_t len) {
+    sim_replay_t* r = context;
+    uni_hid_device_t* d = replay_get_device(r, idx);
+
+    if (!d) {
+        r->skipped_reports++;
+        return;
+    }
+
+    if (type == UNI_HID_CAPTURE_RECORD_FEATURE) {
+        r->feature_reports++;
+        if (d->report_parser.parse_feature_report)
+            d->report_parser.parse_feature_report(d, report, len);
+        return;
+    }
+
+    if (type != UNI_HID_CAPTURE_RECORD_INPUT_FULL) {
+        // Bluepad32 sends its own output reports while replaying. These are the captured ones.
+        r->output_reports++;
+        logd("Replay: idx=%d, %s output report, len=%d\n", idx,
+             type == UNI_HID_CAPTURE_RECORD_OUTPUT_CTRL ? "ctrl" : "intr", len);
+        return;
+    }
+
+    r->input_reports++;
+
+    // Use the captured time, so that the interval stats are the ones of the captured controller.
+    uni_report_stats_on_report(&d->report_stats, timestamp_us);
+
+    uint32_t now = uni_system_get_time_us();
+    uni_hid_parse_input_report(d, report, len);
+    uni_hid_device_process_controller(d);
+    uni_report_stats_on_processed(&d->report_stats, uni_system_get_time_us() - now, false);
+}
+
+// Every replayed device must complete its setup with the captured replies. E.g: a DualSense
+// only gets ready after its pairing, firmware and calibration feature reports.
+// Returns the number of devices that are not ready.
+static int replay_check_ready(sim_replay_t* r) {
+    int not_ready = 0;
+
+    for (int i = 0; i < UNI_HID_CAPTURE_MAX_DEVICES; i++) {
+        uni_hid_device_t* d = replay_get_device(r, i);
+        if (!d)
+            continue;
+        if (uni_bt_conn_get_state(&d->conn) != UNI_BT_CONN_STATE_DEVICE_READY) {
+            loge("Replay: idx=%d, '%s' is not ready. Setup replies missing from the capture?\n", i, d->name);
+            not_ready++;
+        }
+    }
+    return not_ready;
+}
+
+// Accepts both the binary stream, and the console output of the "capture dump" command.
+// Returns the length of the binary stream, or -1 on error.
+static long replay_load(const char* path, uint8_t* data, size_t size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        loge("Replay: could not open '%s'\n", path);
+        return -1;
+    }
+    size_t len = fread(data, 1, size, f);
+    fclose(f);
+
+    if (len == size) {
+        loge("Replay: '%s' is too big, max is %d bytes\n", path, SIM_REPLAY_MAX_FILE_SIZE);
+        return -1;
+    }
+
+    if (len >= 7 && memcmp(data, "BP32CAP", 7) == 0)
+        return len;
+
+    // Text: collect the hex digits that come after each "bp32cap:" prefix.
+    // Decoded in place, since the output is always shorter than the input.
+    data[len] = 0;
+    long out = 0;
+    char* line = (char*)data;
+    while ((line = strstr(line, "bp32cap:")) != NULL) {
+        line += 8;
+        while (isxdigit((unsigned char)line[0]) && isxdigit((unsigned char)line[1])) {
+            char hex[3] = {line[0], line[1], 0};
+            data[out++] = strtoul(hex, NULL, 16);
+            line += 2;
+        }
+    }
+    return out;
+}
+
+static void replay_on_timer(btstack_timer_source_t* ts) {
+    ARG_UNUSED(ts);
+    sim_replay_t replay;
+    int ret = -1;
+
+    // +1 for the string terminator, in case it is a text file.
+    uint8_t* data = malloc(SIM_REPLAY_MAX_FILE_SIZE + 1);
+    if (!data)
+        exit(EXIT_FAILURE);
+
+    long len = replay_load(replay_path, data, SIM_REPLAY_MAX_FILE_SIZE);
+    if (len > 0) {
+        const uni_hid_capture_decoder_t decoder = {
+            .on_device = replay_on_device,
+            .on_report = replay_on_report,
+        };
+
+        memset(&replay, 0, sizeof(replay));
+        uint64_t cpu = get_cpu_time_ns(CLOCK_THREAD_CPUTIME_ID);
+        ret = uni_hid_capture_decode(data, len, &decoder, &replay);
+        cpu = get_cpu_time_ns(CLOCK_THREAD_CPUTIME_ID) - cpu;
+
+        uni_hid_device_dump_all();
+        logi("Replay: %ld bytes, %" PRIu32 " input reports, %" PRIu32 " output reports, %" PRIu32
+             " feature reports, %" PRIu32 " skipped, %" PRIu64 " cpu_ns/report\n",
+             len, replay.input_reports, replay.output_reports, replay.feature_reports, replay.skipped_reports,
+             replay.input_reports ? cpu / replay.input_reports : 0);
+        if (ret == 0 && replay_check_ready(&replay) > 0)
+            ret = -1;
+    }
+    free(data);
+    exit(ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+//
+// Simulator
+//
+static void sim_on_report_timer(btstack_timer_source_t* ts) {
+    sim_controller_t* c = btstack_run_loop_get_timer_context(ts);
+    uint8_t report[SIM_MAX_REPORT_LEN];
+
+    uni_hid_device_t* d = sim_get_device(c);
+    if (!d)
+        return;
+
+    uint16_t len = c->profile->fill_input_report(c, report);
+
+    uint64_t cpu = get_cpu_time_ns(CLOCK_THREAD_CPUTIME_ID);
+    sim_deliver_report(c, d->conn.interrupt_cid, report, len);
+    c->cpu_ns += get_cpu_time_ns(CLOCK_THREAD_CPUTIME_ID) - cpu;
+
+    c->input_reports++;
+    c->frame++;
+    sim_schedule_next_report(c);
+}
+
+static void sim_on_connect_timer(btstack_timer_source_t* ts) {
+    sim_controller_t* c = btstack_run_loop_get_timer_context(ts);
+    const sim_profile_t* p = c->profile;
+    int idx = c - controllers;
+
+    c->connect_start_us = uni_system_get_time_us();
+    uni_hid_device_t* d = uni_hid_device_create(c->addr);
+    if (!d) {
+        loge("Simulator: failed to create device for %s\n", p->type);
+        c->lost = true;
+        return;
+    }
+    c->d = d;
+
+    // What the real stack learns from the inquiry, remote name request, SDP and L2CAP / GATT.
+    d->conn.simulated = true;
+    uni_bt_conn_set_protocol(&d->conn, p->protocol);
+    uni_hid_device_set_connection_handle(d, SIM_CONN_HANDLE_BASE + idx);
+    if (p->protocol == UNI_BT_CONN_PROTOCOL_BR_EDR) {
+        d->conn.control_cid = SIM_CID_BASE + idx * 2;
+        d->conn.interrupt_cid = SIM_CID_BASE + idx * 2 + 1;
+        uni_hid_device_set_cod(d, p->cod);
+    } else {
+        d->hids_cid = SIM_CID_BASE + idx;
+    }
+    uni_hid_device_set_incoming(d, true);
+    uni_hid_device_set_name(d, p->name);
+    uni_hid_device_set_vendor_id(d, p->vendor_id);
+    uni_hid_device_set_product_id(d, p->product_id);
+    uni_hid_device_guess_controller_type_from_pid_vid(d);
+
+    if (p->hid_descriptor)
+        uni_hid_device_set_hid_descriptor(d, p->hid_descriptor, p->hid_descriptor_len);
+
+    uni_hid_device_connect(d);
+    uni_hid_device_set_ready(d);
+    /* 'd' might be invalid */
+
+    sim_check_ready(c);
+}
+
+static void sim_on_duration_timer(btstack_timer_source_t* ts) {
+    ARG_UNUSED(ts);
+    int failed = 0;
+
+    uni_simulator_dump();
+
+    for (int i = 0; i < controllers_count; i++) {
+        if (!controllers[i].ready || controllers[i].lost)
+            failed++;
+    }
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static const sim_profile_t* get_profile(const char* type) {
+    for (size_t i = 0; i < ARRAY_SIZE(profiles); i++) {
+        if (strcmp(profiles[i].type, type) == 0)
+            return &profiles[i];
+    }
+    return NULL;
+}
+
+static int parse_script(const char* script) {
+    char buf[SIM_MAX_SCRIPT_LEN];
+    char* saveptr;
+
+    strncpy(buf, script, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = 0;
+
+    for (char* token = strtok_r(buf, ",", &saveptr); token != NULL; token = strtok_r(NULL, ",", &saveptr)) {
+        int count = 1;
+        int rate = 0;
+        char* type = token;
+
+        char* sep = strchr(type, '*');
+        if (sep) {
+            *sep = 0;
+            count = atoi(type);
+            type = sep + 1;
+        }
+        sep = strchr(type, ':');
+        if (sep) {
+            *sep = 0;
+            rate = atoi(sep + 1);
+        }
+
+        const sim_profile_t* p = get_profile(type);
+        if (!p || count <= 0 || rate < 0 || rate > 1000) {
+            loge("Simulator: invalid controller in script: '%s'\n", token);
+            return -1;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (controllers_count == SIM_MAX_CONTROLLERS) {
+                loge("Simulator: too many controllers, max is %d\n", SIM_MAX_CONTROLLERS);
+                return -1;
+            }
+            sim_controller_t* c = &controllers[controllers_count];
+            memset(c, 0, sizeof(*c));
+            c->profile = p;
+            c->rate_hz = rate ? rate : p->default_rate_hz;
+            // 00:5A:5A:00:00:<idx>
+            c->addr[1] = 0x5a;
+            c->addr[2] = 0x5a;
+            c->addr[5] = controllers_count;
+            controllers_count++;
+        }
+    }
+    return 0;
+}
+
+int uni_simulator_init(int argc, const char** argv) {
+    const char* script = CONFIG_BLUEPAD32_SIMULATOR_SCRIPT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--sim=", 6) == 0)
+            script = argv[i] + 6;
+        else if (strncmp(argv[i], "--sim-replay=", 13) == 0)
+            replay_path = argv[i] + 13;
+        else if (strncmp(argv[i], "--sim-duration=", 15) == 0)
+            duration_s = strtoul(argv[i] + 15, NULL, 10);
+        else if (strncmp(argv[i], "--sim-latency=", 14) == 0)
+            latency_ms = strtoul(argv[i] + 14, NULL, 10);
+    }
+
+    if (replay_path) {
+#ifdef CONFIG_BLUEPAD32_HID_CAPTURE
+        // Don't capture what is being replayed.
+        uni_hid_capture_set_enabled(false);
+#endif  // CONFIG_BLUEPAD32_HID_CAPTURE
+        logi("Simulator: replaying '%s'\n", replay_path);
+        btstack_run_loop_set_timer_handler(&replay_timer, replay_on_timer);
+        btstack_run_loop_set_timer(&replay_timer, 0);
+        btstack_run_loop_add_timer(&replay_timer);
+        return UNI_ERROR_SUCCESS;
+    }
+
+    controllers_count = 0;
+    if (parse_script(script) != 0)
+        return UNI_ERROR_INIT_FAILED;
+
+    logi("Simulator: script='%s', controllers=%d, latency=%" PRIu32 " ms, duration=%" PRIu32 " s\n", script,
+         controllers_count, latency_ms, duration_s);
+
+    start_us = uni_system_get_time_us();
+    start_cpu_ns = get_cpu_time_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+    for (int i = 0; i < controllers_count; i++) {
+        sim_controller_t* c = &controllers[i];
+
+        btstack_run_loop_set_timer_context(&c->reply_timer, c);
+        btstack_run_loop_set_timer_handler(&c->reply_timer, sim_on_reply_timer);
+        btstack_run_loop_set_timer_context(&c->report_timer, c);
+        btstack_run_loop_set_timer_handler(&c->report_timer, sim_on_report_timer);
+
+        // Connections are spread in time, like it happens with real controllers.
+        btstack_run_loop_set_timer_context(&c->connect_timer, c);
+        btstack_run_loop_set_timer_handler(&c->connect_timer, sim_on_connect_timer);
+        btstack_run_loop_set_timer(&c->connect_timer, i * SIM_CONNECT_INTERVAL_MS);
+        btstack_run_loop_add_timer(&c->connect_timer);
+    }
+
+    if (duration_s) {
+        btstack_run_loop_set_timer_handler(&duration_timer, sim_on_duration_timer);
+        btstack_run_loop_set_timer(&duration_timer, duration_s * 1000);
+        btstack_run_loop_add_timer(&duration_timer);
+    }
+
+    return UNI_ERROR_SUCCESS;
+}
+
+void uni_simulator_on_output_report(uni_hid_device_t* d, uint16_t cid, const uint8_t* report, uint16_t len) {
+    for (int i = 0; i < controllers_count; i++) {
+        sim_controller_t* c = &controllers[i];
+        if (c->d != d || c->lost)
+            continue;
+
+        c->output_reports++;
+        if (c->profile->on_output_report)
+            c->profile->on_output_report(c, cid, report, len);
+        return;
+    }
+    logd("Simulator: output report for unknown device %s\n", bd_addr_to_str(d->conn.btaddr));
+}
+
+void uni_simulator_dump(void) {
+    uint32_t now = uni_system_get_time_us();
+    uint32_t elapsed_us = now - start_us;
+    uint64_t cpu_ns = get_cpu_time_ns(CLOCK_PROCESS_CPUTIME_ID) - start_cpu_ns;
+    uint32_t total_reports = 0;
+    uint64_t total_cpu_ns = 0;
+
+    logi("Simulator: %d controllers, elapsed: %" PRIu32 " ms, process CPU: %" PRIu64 " ms (%" PRIu64 "%%)\n",
+         controllers_count, elapsed_us / 1000, cpu_ns / 1000000, elapsed_us ? cpu_ns / 10 / elapsed_us : 0);
+    logi("idx type    rate  setup_us  in_reports  out_reports  reports/s  cpu_ns/report  proc_avg_us  proc_max_us\n");
+
+    for (int i = 0; i < controllers_count; i++) {
+        sim_controller_t* c = &controllers[i];
+        uni_hid_device_t* d = sim_get_device(c);
+
+        if (!c->ready || !d) {
+            logi("%3d %-6s %5d  %s\n", i, c->profile->type, c->rate_hz, c->lost ? "lost" : "not ready");
+            continue;
+        }
+
+        uint32_t streaming_us = now - c->connect_start_us - c->setup_us;
+        logi("%3d %-6s %5d  %8" PRIu32 "  %10" PRIu32 "  %11" PRIu32 "  %9" PRIu64 "  %13" PRIu64 "  %11" PRIu32
+             "  %11" PRIu32 "\n",
+             i, c->profile->type, c->rate_hz, c->setup_us, c->input_reports, c->output_reports,
+             streaming_us ? (uint64_t)c->input_reports * 1000000 / streaming_us : 0,
+             c->input_reports ? c->cpu_ns / c->input_reports : 0, d->report_stats.processing_ewma_us,
+             d->report_stats.processing_max_us);
+
+        total_reports += c->input_reports;
+        total_cpu_ns += c->cpu_ns;
+    }
+
+    logi("Total: %" PRIu32 " reports, %" PRIu64 " reports/s, %" PRIu64 " cpu_ns/report\n", total_reports,
+         elapsed_us ? (uint64_t)total_reports * 1000000 / elapsed_us : 0,
+         total_reports ? total_cpu_ns / total_reports : 0);
+}